@@ -0,0 +1,234 @@
+/**
+/* @file		adaptive_summary.cpp
+/* @brief		Source file for an adaptive_summary object
+/* @author		Ken Campbell
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <iostream>
+
+#include "adaptive_summary.h"
+#include "results_writer.h"
+#include "live_results.h"
+
+#include "gsl_math.h"
+
+using namespace std;
+
+// Constructor
+adaptive_summary::adaptive_summary(results_writer* set_p_writer, live_results* set_p_live_results,
+	int set_no_of_fields, double set_relative_tolerance, double set_absolute_tolerance)
+{
+	//! Constructor
+	//! The rows are decimated together. A row is dropped if a straight
+	//! line between the rows either side of it that are kept passes
+	//! within the tolerance of every field. Each row is offered in turn,
+	//! and the last one is held back until the next shows whether the
+	//! line from the anchor, the last row kept, can reach past it
+	//! For each field, the rows between the anchor and the pending row
+	//! limit the slope of the line to a range, which only narrows as
+	//! rows are added, so each row is checked once whatever the length
+	//! of the line
+	//! The tolerance of a field is the larger of the absolute tolerance
+	//! and the relative tolerance times the largest magnitude of the
+	//! field so far, so that fields with very different units can share
+	//! one setting and a field passing through zero is not over-sampled
+
+	// Code
+	p_writer = set_p_writer;
+	p_live_results = set_p_live_results;
+
+	as_no_of_fields = set_no_of_fields;
+	as_relative_tolerance = set_relative_tolerance;
+	as_absolute_tolerance = set_absolute_tolerance;
+
+	as_pending_t_index = 0;
+	as_anchor_t_index = 0;
+	as_have_anchor = false;
+	as_have_pending = false;
+
+	as_rows_offered = 0;
+	as_rows_kept = 0;
+
+	// All of the storage is allocated here, so the rows do not
+	// allocate in the simulation loop
+	as_row = (double*)malloc(GSL_MAX(as_no_of_fields, 1) * sizeof(double));
+	as_pending_row = (double*)malloc(GSL_MAX(as_no_of_fields, 1) * sizeof(double));
+	as_anchor_row = (double*)malloc(GSL_MAX(as_no_of_fields, 1) * sizeof(double));
+	as_peak = (double*)malloc(GSL_MAX(as_no_of_fields, 1) * sizeof(double));
+	as_low_slope = (double*)malloc(GSL_MAX(as_no_of_fields, 1) * sizeof(double));
+	as_high_slope = (double*)malloc(GSL_MAX(as_no_of_fields, 1) * sizeof(double));
+
+	for (int f = 0; f < as_no_of_fields; f++)
+		as_peak[f] = 0.0;
+}
+
+// Destructor
+adaptive_summary::~adaptive_summary(void)
+{
+	//! Destructor
+
+	// Code
+	cout << "Adaptive summary kept " << as_rows_kept << " of " << as_rows_offered <<
+		" rows\n";
+
+	free(as_row);
+	free(as_pending_row);
+	free(as_anchor_row);
+	free(as_peak);
+	free(as_low_slope);
+	free(as_high_slope);
+}
+
+// Functions
+
+double* adaptive_summary::reserve_row(void)
+{
+	//! Function returns the row for the caller to fill
+
+	// Code
+	return as_row;
+}
+
+void adaptive_summary::commit_row(int t_index)
+{
+	//! Function takes the row filled by the caller
+	//! The pending row is written if the line from the anchor to the new
+	//! row would take one of the rows in between, or the pending row
+	//! itself, outside the tolerance. The new row becomes the pending row
+
+	// Variables
+	bool reached = true;
+
+	double slope;
+
+	double* p_swap;
+
+	// Code
+	as_rows_offered = as_rows_offered + 1;
+
+	// The first row is always kept
+	if (!as_have_anchor)
+	{
+		keep_row(as_row);
+
+		p_swap = as_anchor_row;
+		as_anchor_row = as_row;
+		as_row = p_swap;
+		as_anchor_t_index = t_index;
+		as_have_anchor = true;
+
+		for (int f = 0; f < as_no_of_fields; f++)
+		{
+			as_low_slope[f] = -GSL_POSINF;
+			as_high_slope[f] = GSL_POSINF;
+		}
+
+		return;
+	}
+
+	if (as_have_pending)
+	{
+		// The test is written so that a NaN fails it, so rows that are
+		// not numbers are kept along with their neighbours
+		for (int f = 0; f < as_no_of_fields; f++)
+		{
+			slope = (as_row[f] - as_anchor_row[f]) / (t_index - as_anchor_t_index);
+
+			if (!((slope >= as_low_slope[f]) && (slope <= as_high_slope[f])))
+			{
+				reached = false;
+				break;
+			}
+		}
+
+		if (!reached)
+		{
+			// The pending row is kept and becomes the anchor
+			keep_row(as_pending_row);
+
+			p_swap = as_anchor_row;
+			as_anchor_row = as_pending_row;
+			as_pending_row = p_swap;
+			as_anchor_t_index = as_pending_t_index;
+
+			for (int f = 0; f < as_no_of_fields; f++)
+			{
+				as_low_slope[f] = -GSL_POSINF;
+				as_high_slope[f] = GSL_POSINF;
+			}
+		}
+	}
+
+	// The new row is between the anchor and any later row, so it limits
+	// the slopes from now on
+	narrow_slopes(as_row, t_index);
+
+	p_swap = as_pending_row;
+	as_pending_row = as_row;
+	as_row = p_swap;
+	as_pending_t_index = t_index;
+	as_have_pending = true;
+}
+
+void adaptive_summary::narrow_slopes(double* p_row, int t_index)
+{
+	//! Function narrows the range of slopes from the anchor to the ones
+	//! that pass within the tolerance of p_row
+
+	// Variables
+	double tolerance;
+	double magnitude;
+
+	int steps = t_index - as_anchor_t_index;
+
+	// Code
+	for (int f = 0; f < as_no_of_fields; f++)
+	{
+		magnitude = fabs(p_row[f]);
+		if ((magnitude > as_peak[f]) && (gsl_finite(magnitude)))
+			as_peak[f] = magnitude;
+
+		tolerance = GSL_MAX(as_absolute_tolerance, as_relative_tolerance * as_peak[f]);
+
+		// A NaN makes both limits NaN, so the next test fails
+		as_low_slope[f] = GSL_MAX(as_low_slope[f],
+			(p_row[f] - tolerance - as_anchor_row[f]) / steps);
+		as_high_slope[f] = GSL_MIN(as_high_slope[f],
+			(p_row[f] + tolerance - as_anchor_row[f]) / steps);
+	}
+}
+
+void adaptive_summary::keep_row(double* p_row)
+{
+	//! Function writes a row to the results_writer, and to the live
+	//! results if there are any
+
+	// Variables
+	double* p_writer_row;
+
+	// Code
+	p_writer_row = p_writer->reserve_row();
+	memcpy(p_writer_row, p_row, as_no_of_fields * sizeof(double));
+
+	if (p_live_results != NULL)
+		p_live_results->add_row(p_writer_row);
+
+	p_writer->commit_row();
+
+	as_rows_kept = as_rows_kept + 1;
+}
+
+void adaptive_summary::finish(void)
+{
+	//! Function writes the pending row, so the last row is always kept
+
+	// Code
+	if (as_have_pending)
+	{
+		keep_row(as_pending_row);
+		as_have_pending = false;
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+/**
+/* @file		adaptive_summary.h
+/* @brief		Header file for an adaptive_summary object
+/* @author		Ken Campbell
+*/
+
+#include "stdio.h"
+#include <iostream>
+#include <string>
+
+#include "global_definitions.h"
+
+using namespace std;
+
+class results_writer;
+class live_results;
+
+class adaptive_summary
+{
+public:
+	/**
+	 * Constructor
+	 * Sets up the decimation of rows of set_no_of_fields that are passed
+	 * on to p_writer, and to p_live_results if it is not NULL
+	 */
+	adaptive_summary(results_writer* set_p_writer, live_results* set_p_live_results,
+		int set_no_of_fields, double set_relative_tolerance, double set_absolute_tolerance);
+
+	/**
+	* Destructor
+	*/
+	~adaptive_summary(void);
+
+	// Variables
+	results_writer* p_writer;				/**< pointer to the results_writer
+													the kept rows are written to */
+
+	live_results* p_live_results;			/**< pointer to the live_results the
+													kept rows are published to,
+													NULL if there is none */
+
+	int as_no_of_fields;					/**< integer with the number of
+													fields in a row */
+
+	double as_relative_tolerance;			/**< double with the error allowed,
+													as a fraction of the largest
+													magnitude of each field */
+
+	double as_absolute_tolerance;			/**< double with the smallest error
+													allowed */
+
+	double* as_row;							/**< pointer to the row being
+													committed */
+
+	double* as_pending_row;					/**< pointer to the last row, which
+													is written if the next row
+													cannot be reached from the
+													anchor */
+
+	double* as_anchor_row;					/**< pointer to the last row that
+													was written */
+
+	double* as_peak;						/**< pointer to the largest
+													magnitude of each field */
+
+	double* as_low_slope;					/**< pointer to the lowest slope from
+													the anchor for each field that
+													keeps the rows in between
+													within the tolerance */
+
+	double* as_high_slope;					/**< pointer to the highest slope
+													from the anchor for each
+													field */
+
+	int as_pending_t_index;					/**< integer with the simulation
+													index of the pending row */
+
+	int as_anchor_t_index;					/**< integer with the simulation
+													index of the anchor */
+
+	bool as_have_anchor;					/**< true once a row is written */
+
+	bool as_have_pending;					/**< true if there is a pending row */
+
+	long long as_rows_offered;				/**< number of rows committed */
+
+	long long as_rows_kept;					/**< number of rows written */
+
+	// Functions
+
+	double* reserve_row(void);				/**< function returns the row for
+													the caller to fill */
+
+	void commit_row(int t_index);			/**< function decides whether the
+													pending row has to be kept,
+													now that the next row is
+													known */
+
+	void finish(void);						/**< function writes the pending row,
+													so the last row is always
+													kept */
+
+	void keep_row(double* p_row);			/**< function writes a row */
+
+	void narrow_slopes(double* p_row, int t_index);
+											/**< function narrows the slopes
+													so that the line from the
+													anchor stays close to p_row */
+};
@@ -0,0 +1,131 @@
+/**
+ * @file    allocation_monitor.cpp
+ * @brief   Source file for functions that count heap allocations
+ * @author  Ken Campbell
+ */
+
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+#include "allocation_monitor.h"
+
+// The debug CRT can report every allocation, including the malloc calls
+// made by GSL. Other builds fall back to counting C++ new
+#if defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+#define ALLOCATION_MONITOR_CRT_HOOK
+#endif
+
+// Only the thread that called start() is monitored, so the results
+// writer threads, which grow their own buffers, are not counted
+static thread_local bool monitoring = false;
+static std::atomic<long long> no_of_allocations(0);
+
+#ifdef ALLOCATION_MONITOR_CRT_HOOK
+
+static _CRT_ALLOC_HOOK p_previous_hook = NULL;
+
+static int allocation_hook(int alloc_type, void* p_user_data, size_t size,
+    int block_type, long request_number, const unsigned char* filename, int line_number)
+{
+    //! Counts allocations requested by the monitored thread, ignoring the CRT's own blocks
+    if ((monitoring) && (block_type != _CRT_BLOCK) &&
+        ((alloc_type == _HOOK_ALLOC) || (alloc_type == _HOOK_REALLOC)))
+    {
+        no_of_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (p_previous_hook != NULL)
+    {
+        return p_previous_hook(alloc_type, p_user_data, size, block_type,
+            request_number, filename, line_number);
+    }
+
+    return TRUE;
+}
+
+#else
+
+void* operator new(std::size_t size)
+{
+    if (monitoring)
+        no_of_allocations.fetch_add(1, std::memory_order_relaxed);
+
+    void* p = std::malloc(size > 0 ? size : 1);
+    if (p == NULL)
+        throw std::bad_alloc();
+
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t size) noexcept
+{
+    (void)(size);
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t size) noexcept
+{
+    (void)(size);
+    std::free(p);
+}
+
+#endif
+
+namespace allocation_monitor {
+
+    //! Resets the counter and starts counting on the calling thread
+    void start(void)
+    {
+        no_of_allocations.store(0);
+
+#ifdef ALLOCATION_MONITOR_CRT_HOOK
+        p_previous_hook = _CrtSetAllocHook(allocation_hook);
+#endif
+
+        monitoring = true;
+    }
+
+    //! Stops counting
+    void stop(void)
+    {
+        monitoring = false;
+
+#ifdef ALLOCATION_MONITOR_CRT_HOOK
+        _CrtSetAllocHook(p_previous_hook);
+        p_previous_hook = NULL;
+#endif
+    }
+
+    //! Returns the number of allocations since start()
+    long long return_no_of_allocations(void)
+    {
+        return no_of_allocations.load();
+    }
+
+    //! Returns true if malloc calls are counted as well as C++ new
+    bool counts_malloc(void)
+    {
+#ifdef ALLOCATION_MONITOR_CRT_HOOK
+        return true;
+#else
+        return false;
+#endif
+    }
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+/**
+ * @file    allocation_monitor.h
+ * @brief   header file for functions that count heap allocations
+ * @author  Ken Campbell
+ */
+
+namespace allocation_monitor {
+
+    /**
+    * a function that resets the counter and starts counting heap allocations
+    * made by the calling thread
+    * @return void
+    */
+    void start(void);
+
+    /**
+    * a function that stops counting heap allocations, called from the same
+    * thread as start()
+    * @return void
+    */
+    void stop(void);
+
+    /**
+    * a function that returns the number of allocations made since start()
+    * @return long long
+    */
+    long long return_no_of_allocations(void);
+
+    /**
+    * a function that reports whether the counter sees every heap allocation
+    * @return bool, true when the debug CRT hook is available and malloc calls
+    *        from C libraries, like GSL, are counted, false when only C++ new
+    *        is counted
+    */
+    bool counts_malloc(void);
+
+};
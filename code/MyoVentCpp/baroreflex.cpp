@@ -18,6 +18,7 @@
 #include "reflex_control.h"
 
 #include "gsl_math.h"
+#include "gsl_errno.h"
 
 // Constructor
 baroreflex::baroreflex(circulation* set_p_parent_circulation)
@@ -100,6 +101,10 @@ void baroreflex::initialise_simulation(void)
 	p_cmv_results_beat->add_results_field("baro_P_set", &baro_P_set);
 	p_cmv_results_beat->add_results_field("baro_A", &baro_A);
 	p_cmv_results_beat->add_results_field("baro_B", &baro_B);
+
+	// The values at the end of each beat
+	p_parent_cmv_system->p_cmv_results_beat_metrics->add_results_field("baro_A", &baro_A);
+	p_parent_cmv_system->p_cmv_results_beat_metrics->add_results_field("baro_B", &baro_B);
 }
 
 void baroreflex::implement_time_step(double time_step_s)
@@ -141,26 +146,68 @@ void baroreflex::calculate_B_b(double time_step_s)
 	// Code
 
 	// Calculate the delta over the time-step
+	delta = return_B_b_rate(baro_B);
+
+	// Update
+	baro_B = baro_B + (delta * time_step_s);
+
+	// Limit
+	baro_B = GSL_MIN(baro_B, 1.0);
+	baro_B = GSL_MAX(baro_B, 0.0);
+}
+
+double baroreflex::return_B_b_rate(double B)
+{
+	//! Function returns dB_b/dt for the current B_a
+
+	// Variables
+	double delta;
+
+	// Code
 	if (baro_active > 0)
 	{
 		if (baro_A >= 0.5)
 		{
-			delta = -baro_k_drive * (baro_A - 0.5) * baro_B;
+			delta = -baro_k_drive * (baro_A - 0.5) * B;
 		}
 		else
 		{
-			delta = -baro_k_drive * (baro_A - 0.5) * (1.0 - baro_B);
+			delta = -baro_k_drive * (baro_A - 0.5) * (1.0 - B);
 		}
 	}
 	else
 	{
-		delta = -baro_k_recov * (baro_B - 0.5);
+		delta = -baro_k_recov * (B - 0.5);
 	}
 
-	// Update
-	baro_B = baro_B + (delta * time_step_s);
+	return delta;
+}
 
-	// Limit
-	baro_B = GSL_MIN(baro_B, 1.0);
-	baro_B = GSL_MAX(baro_B, 0.0);
+// This function is not a member of the baroreflex class but has the form
+// of a GSL ODE function so that the coupled integrator can advance the
+// reflex with the rest of the system
+
+int baro_calculate_derivs(double t, const double y[], double f[], void* params)
+{
+	//! Function sets derivs
+	//! y[0] is baro_B, y[1 + i] is rc_baro_C for reflex control i
+
+	// Variables
+	(void)(t);
+
+	baroreflex* p_baro = (baroreflex*)params;
+
+	// Code
+
+	// B_a follows the pressure in the monitored compartment
+	p_baro->calculate_B_a();
+
+	f[0] = p_baro->return_B_b_rate(y[0]);
+
+	for (int i = 0; i < p_baro->no_of_reflex_controls; i++)
+	{
+		f[1 + i] = p_baro->p_rc[i]->return_baro_C_rate(y[0], y[1 + i]);
+	}
+
+	return GSL_SUCCESS;
 }
@@ -82,4 +82,6 @@ public:
 	void calculate_B_a(void);
 
 	void calculate_B_b(double time_step_s);
+
+	double return_B_b_rate(double B);
 };
@@ -0,0 +1,306 @@
+#pragma once
+
+/**
+ * @file    bin_kernels.h
+ * @brief   inline kernels that work on the contiguous bin runs of an attached state
+ * @author  Ken Campbell
+ */
+
+#include <cstddef>
+
+// Each attached state holds its populations as one contiguous run of
+// no_of_bin_positions doubles in y, and the rate_table holds one contiguous
+// row of rates per transition, so every loop below walks unit-stride arrays.
+// The loops are kept simple, with __restrict pointers and reductions split
+// over 4 partial sums, so that the compiler can vectorize them under
+// /arch:AVX2 without needing /fp:fast
+
+namespace bin_kernels {
+
+    /**
+    * a function that adds attachment fluxes to the bins of an attached state
+    * f_to[i] += factor * rates[i]
+    * @param f_to pointer to the derivatives for the attached state
+    * @param rates pointer to the rates for each bin
+    * @param factor double, the detached population scaled by the free binding sites
+    * @param n integer, number of bins
+    * @return double, the total flux, which leaves the detached state
+    */
+    inline double attach(double* __restrict f_to, const double* __restrict rates,
+        const double factor, const int n)
+    {
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+        double flux;
+        int i;
+
+        for (i = 0; i + 3 < n; i = i + 4)
+        {
+            flux = factor * rates[i];
+            f_to[i] = f_to[i] + flux;
+            s0 = s0 + flux;
+
+            flux = factor * rates[i + 1];
+            f_to[i + 1] = f_to[i + 1] + flux;
+            s1 = s1 + flux;
+
+            flux = factor * rates[i + 2];
+            f_to[i + 2] = f_to[i + 2] + flux;
+            s2 = s2 + flux;
+
+            flux = factor * rates[i + 3];
+            f_to[i + 3] = f_to[i + 3] + flux;
+            s3 = s3 + flux;
+        }
+        for (; i < n; i++)
+        {
+            flux = factor * rates[i];
+            f_to[i] = f_to[i] + flux;
+            s0 = s0 + flux;
+        }
+
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    /**
+    * a function that adds attachment fluxes to the bins of an attached state
+    * on a non-uniform grid, f_to[i] += factor * widths[i] * rates[i]
+    * @param f_to pointer to the derivatives for the attached state
+    * @param rates pointer to the rates for each bin
+    * @param widths pointer to the width of each bin
+    * @param factor double, the detached population times the free binding sites
+    * @param n integer, number of bins
+    * @return double, the total flux, which leaves the detached state
+    */
+    inline double attach_weighted(double* __restrict f_to, const double* __restrict rates,
+        const double* __restrict widths, const double factor, const int n)
+    {
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+        double flux;
+        int i;
+
+        for (i = 0; i + 3 < n; i = i + 4)
+        {
+            flux = factor * widths[i] * rates[i];
+            f_to[i] = f_to[i] + flux;
+            s0 = s0 + flux;
+
+            flux = factor * widths[i + 1] * rates[i + 1];
+            f_to[i + 1] = f_to[i + 1] + flux;
+            s1 = s1 + flux;
+
+            flux = factor * widths[i + 2] * rates[i + 2];
+            f_to[i + 2] = f_to[i + 2] + flux;
+            s2 = s2 + flux;
+
+            flux = factor * widths[i + 3] * rates[i + 3];
+            f_to[i + 3] = f_to[i + 3] + flux;
+            s3 = s3 + flux;
+        }
+        for (; i < n; i++)
+        {
+            flux = factor * widths[i] * rates[i];
+            f_to[i] = f_to[i] + flux;
+            s0 = s0 + flux;
+        }
+
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    /**
+    * a function that removes detachment fluxes from the bins of an attached state
+    * f_from[i] -= rates[i] * y_from[i]
+    * @param f_from pointer to the derivatives for the attached state
+    * @param y_from pointer to the populations of the attached state
+    * @param rates pointer to the rates for each bin
+    * @param n integer, number of bins
+    * @return double, the total flux, which arrives in the detached state
+    */
+    inline double detach(double* __restrict f_from, const double* __restrict y_from,
+        const double* __restrict rates, const int n)
+    {
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+        double flux;
+        int i;
+
+        for (i = 0; i + 3 < n; i = i + 4)
+        {
+            flux = rates[i] * y_from[i];
+            f_from[i] = f_from[i] - flux;
+            s0 = s0 + flux;
+
+            flux = rates[i + 1] * y_from[i + 1];
+            f_from[i + 1] = f_from[i + 1] - flux;
+            s1 = s1 + flux;
+
+            flux = rates[i + 2] * y_from[i + 2];
+            f_from[i + 2] = f_from[i + 2] - flux;
+            s2 = s2 + flux;
+
+            flux = rates[i + 3] * y_from[i + 3];
+            f_from[i + 3] = f_from[i + 3] - flux;
+            s3 = s3 + flux;
+        }
+        for (; i < n; i++)
+        {
+            flux = rates[i] * y_from[i];
+            f_from[i] = f_from[i] - flux;
+            s0 = s0 + flux;
+        }
+
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    /**
+    * a function that moves fluxes bin by bin between two attached states
+    * flux[i] = rates[i] * y_from[i], f_from[i] -= flux[i], f_to[i] += flux[i]
+    * @param f_from pointer to the derivatives for the state being left
+    * @param f_to pointer to the derivatives for the state being entered
+    * @param y_from pointer to the populations of the state being left
+    * @param rates pointer to the rates for each bin
+    * @param n integer, number of bins
+    * @return void
+    */
+    inline void transfer(double* __restrict f_from, double* __restrict f_to,
+        const double* __restrict y_from, const double* __restrict rates, const int n)
+    {
+        double flux;
+
+        for (int i = 0; i < n; i++)
+        {
+            flux = rates[i] * y_from[i];
+            f_from[i] = f_from[i] - flux;
+            f_to[i] = f_to[i] + flux;
+        }
+    }
+
+    /**
+    * a function that sums a run of bins
+    * @param y pointer to the first bin
+    * @param n integer, number of bins
+    * @return double, the sum
+    */
+    inline double sum(const double* __restrict y, const int n)
+    {
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+        int i;
+
+        for (i = 0; i + 3 < n; i = i + 4)
+        {
+            s0 = s0 + y[i];
+            s1 = s1 + y[i + 1];
+            s2 = s2 + y[i + 2];
+            s3 = s3 + y[i + 3];
+        }
+        for (; i < n; i++)
+        {
+            s0 = s0 + y[i];
+        }
+
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    /**
+    * a function that makes one pass through a run of bins and returns
+    * the population, the first moment about the bin positions and,
+    * optionally, the flux through an ATP-requiring detachment
+    * @param y pointer to the first bin
+    * @param x pointer to the bin positions
+    * @param atp_rates pointer to the rates for the ATP-requiring detachment,
+    *        or NULL if the state does not have one
+    * @param n integer, number of bins
+    * @param p_pop pointer to a double set to sum(y[i])
+    * @param p_moment pointer to a double set to sum(y[i] * x[i])
+    * @param p_atp_flux pointer to a double set to sum(atp_rates[i] * y[i]),
+    *        or 0 if atp_rates is NULL
+    * @return void
+    */
+    inline void summarise(const double* __restrict y, const double* __restrict x,
+        const double* __restrict atp_rates, const int n,
+        double* p_pop, double* p_moment, double* p_atp_flux)
+    {
+        double p0 = 0.0, p1 = 0.0, p2 = 0.0, p3 = 0.0;
+        double m0 = 0.0, m1 = 0.0, m2 = 0.0, m3 = 0.0;
+        double a0 = 0.0, a1 = 0.0, a2 = 0.0, a3 = 0.0;
+        int i;
+
+        if (atp_rates == NULL)
+        {
+            for (i = 0; i + 3 < n; i = i + 4)
+            {
+                p0 = p0 + y[i];
+                p1 = p1 + y[i + 1];
+                p2 = p2 + y[i + 2];
+                p3 = p3 + y[i + 3];
+
+                m0 = m0 + (y[i] * x[i]);
+                m1 = m1 + (y[i + 1] * x[i + 1]);
+                m2 = m2 + (y[i + 2] * x[i + 2]);
+                m3 = m3 + (y[i + 3] * x[i + 3]);
+            }
+            for (; i < n; i++)
+            {
+                p0 = p0 + y[i];
+                m0 = m0 + (y[i] * x[i]);
+            }
+        }
+        else
+        {
+            for (i = 0; i + 3 < n; i = i + 4)
+            {
+                p0 = p0 + y[i];
+                p1 = p1 + y[i + 1];
+                p2 = p2 + y[i + 2];
+                p3 = p3 + y[i + 3];
+
+                m0 = m0 + (y[i] * x[i]);
+                m1 = m1 + (y[i + 1] * x[i + 1]);
+                m2 = m2 + (y[i + 2] * x[i + 2]);
+                m3 = m3 + (y[i + 3] * x[i + 3]);
+
+                a0 = a0 + (y[i] * atp_rates[i]);
+                a1 = a1 + (y[i + 1] * atp_rates[i + 1]);
+                a2 = a2 + (y[i + 2] * atp_rates[i + 2]);
+                a3 = a3 + (y[i + 3] * atp_rates[i + 3]);
+            }
+            for (; i < n; i++)
+            {
+                p0 = p0 + y[i];
+                m0 = m0 + (y[i] * x[i]);
+                a0 = a0 + (y[i] * atp_rates[i]);
+            }
+        }
+
+        *p_pop = (p0 + p1) + (p2 + p3);
+        *p_moment = (m0 + m1) + (m2 + m3);
+        *p_atp_flux = (a0 + a1) + (a2 + a3);
+    }
+
+    /**
+    * a function that returns the total flux through a transition
+    * leaving an attached state, sum(rates[i] * y[i])
+    * @param y pointer to the first bin
+    * @param rates pointer to the rates for each bin
+    * @param n integer, number of bins
+    * @return double, the flux
+    */
+    inline double flux(const double* __restrict y, const double* __restrict rates,
+        const int n)
+    {
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+        int i;
+
+        for (i = 0; i + 3 < n; i = i + 4)
+        {
+            s0 = s0 + (rates[i] * y[i]);
+            s1 = s1 + (rates[i + 1] * y[i + 1]);
+            s2 = s2 + (rates[i + 2] * y[i + 2]);
+            s3 = s3 + (rates[i + 3] * y[i + 3]);
+        }
+        for (; i < n; i++)
+        {
+            s0 = s0 + (rates[i] * y[i]);
+        }
+
+        return (s0 + s1) + (s2 + s3);
+    }
+};
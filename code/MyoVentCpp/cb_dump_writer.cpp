@@ -0,0 +1,673 @@
+/**
+/* @file		cb_dump_writer.cpp
+/* @brief		Source file for a cb_dump_writer object
+/* @author		Ken Campbell
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <iostream>
+#include <filesystem>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include "cb_dump_writer.h"
+#include "hemi_vent.h"
+#include "circulation.h"
+#include "valve.h"
+#include "half_sarcomere.h"
+#include "myofilaments.h"
+#include "kinetic_scheme.h"
+#include "cmv_system.h"
+#include "cmv_options.h"
+#include "cmv_protocol.h"
+#include "time_series_codec.h"
+
+#include "gsl_math.h"
+#include "gsl_vector.h"
+
+using namespace std;
+using namespace std::filesystem;
+
+// Cb dump files are little-endian whatever the machine, so values are
+// written a byte at a time
+static void put_little_endian(unsigned char* p_bytes, unsigned long long value, int no_of_bytes)
+{
+	for (int i = 0; i < no_of_bytes; i++)
+	{
+		p_bytes[i] = (unsigned char)(value & 0xFF);
+		value = value >> 8;
+	}
+}
+
+static void put_little_endian_double(unsigned char* p_bytes, double value)
+{
+	unsigned long long bits;
+
+	memcpy(&bits, &value, sizeof(double));
+	put_little_endian(p_bytes, bits, 8);
+}
+
+// Constructor
+cb_dump_writer::cb_dump_writer(hemi_vent* set_p_parent_hemi_vent)
+{
+	//! Constructor
+
+	// Variables
+	cmv_options* p_cmv_options;
+	cmv_protocol* p_cmv_protocol;
+
+	path options_file_path;
+	path base_dir;
+	path output_file_path;
+
+	double dt;
+	double steps;
+
+	int n;
+
+	// Code
+	p_parent_hemi_vent = set_p_parent_hemi_vent;
+	p_myofilaments = p_parent_hemi_vent->p_hs->p_myofilaments;
+
+	p_cmv_options = p_parent_hemi_vent->p_cmv_options;
+	p_cmv_protocol = p_parent_hemi_vent->p_parent_cmv_system->p_cmv_protocol;
+
+	cbw_no_of_values = p_myofilaments->p_m_scheme->no_of_attached_states *
+		p_myofilaments->no_of_bin_positions;
+	cbw_frame_bytes = CB_DUMP_FRAME_HEADER_BYTES + (4 * cbw_no_of_values);
+
+	cbw_buffer_frames = p_cmv_options->cb_dump_buffer_frames;
+
+	cbw_finished = false;
+	cbw_write_error = false;
+	cbw_frames_written = 0;
+	cbw_n_producer_waits = 0;
+
+	cbw_head = 0;
+	cbw_tail = 0;
+	cbw_done = false;
+
+	// Frames every cbw_stride time-steps, as for the summary
+	dt = p_cmv_protocol->time_step_s;
+	n = p_cmv_protocol->no_of_time_steps;
+
+	cbw_stride = 1;
+
+	if (p_cmv_options->cb_dump_time_step_s > 0.0)
+	{
+		steps = p_cmv_options->cb_dump_time_step_s / dt;
+		cbw_stride = (int)GSL_MAX(1.0, round(steps));
+
+		if (fabs(steps - cbw_stride) > (1e-6 * steps))
+		{
+			cout << "Error: cb_dump time_step_s " << p_cmv_options->cb_dump_time_step_s <<
+				" is not a multiple of the time-step " << dt << "\n";
+			exit(1);
+		}
+	}
+
+	// Windows, holding the steps whose end times are inside
+	cbw_no_of_windows = 0;
+	cbw_window = 0;
+
+	for (int w = 0; w < p_cmv_options->cb_dump_no_of_windows; w++)
+	{
+		int first = (int)ceil((p_cmv_options->cb_dump_start_s[w] / dt) - 1e-6) - 1;
+		int last = (int)floor((p_cmv_options->cb_dump_stop_s[w] / dt) + 1e-6) - 1;
+
+		first = GSL_MAX(first, 0);
+		last = GSL_MIN(last, n - 1);
+
+		if (last < first)
+		{
+			cout << "Warning: cb dump window " << w << " is outside the simulation\n";
+			continue;
+		}
+
+		cbw_first_t_index[cbw_no_of_windows] = first;
+		cbw_last_t_index[cbw_no_of_windows] = last;
+		cbw_no_of_windows = cbw_no_of_windows + 1;
+	}
+
+	// Beat phases
+	cbw_use_phases = (p_cmv_options->cb_dump_no_of_beat_phases > 0);
+
+	for (int i = 0; i < CB_DUMP_NO_OF_PHASE_CODES; i++)
+		cbw_phase_selected[i] = false;
+
+	for (int i = 0; i < p_cmv_options->cb_dump_no_of_beat_phases; i++)
+	{
+		if (p_cmv_options->cb_dump_beat_phases[i] == "end_diastole")
+			cbw_phase_selected[CB_DUMP_PHASE_END_DIASTOLE] = true;
+		else if (p_cmv_options->cb_dump_beat_phases[i] == "peak_systole")
+			cbw_phase_selected[CB_DUMP_PHASE_PEAK_SYSTOLE] = true;
+		else if (p_cmv_options->cb_dump_beat_phases[i] == "end_systole")
+			cbw_phase_selected[CB_DUMP_PHASE_END_SYSTOLE] = true;
+		else
+		{
+			cout << "Error: cb_dump beat phase " << p_cmv_options->cb_dump_beat_phases[i] <<
+				" is not end_diastole, peak_systole or end_systole\n";
+			exit(1);
+		}
+	}
+
+	cbw_mv_was_open = false;
+	cbw_av_was_open = false;
+	cbw_peak_pressure = -GSL_POSINF;
+	cbw_peak_pending = false;
+	cbw_peak_time_s = 0.0;
+	cbw_peak_t_index = 0;
+
+	// All of the storage is allocated here, so the frames do not
+	// allocate in the simulation loop
+	cbw_peak_values = (float*)malloc(GSL_MAX(cbw_no_of_values, 1) * sizeof(float));
+	cbw_queue = (float*)malloc((size_t)cbw_buffer_frames * GSL_MAX(cbw_no_of_values, 1) * sizeof(float));
+	cbw_queue_time_s = (double*)malloc(cbw_buffer_frames * sizeof(double));
+	cbw_queue_t_index = (int*)malloc(cbw_buffer_frames * sizeof(int));
+	cbw_queue_phase = (int*)malloc(cbw_buffer_frames * sizeof(int));
+	cbw_bytes = (unsigned char*)malloc((size_t)cbw_buffer_frames * cbw_frame_bytes);
+
+	// With the codec, the frames are gathered in chunks and each column,
+	// one bin over the frames in the chunk, is packed
+	cbw_codec = (p_cmv_options->cb_dump_codec == "lossless") ?
+		RESULTS_CODEC_LOSSLESS : RESULTS_CODEC_NONE;
+	cbw_chunk_frames = p_cmv_options->cb_dump_chunk_frames;
+	cbw_chunk_length = 0;
+	cbw_chunk_time_s = NULL;
+	cbw_chunk_t_index = NULL;
+	cbw_chunk_phase = NULL;
+	cbw_chunk_values = NULL;
+	cbw_words = NULL;
+	cbw_chunk_bytes = NULL;
+	cbw_codec_work = NULL;
+
+	if (cbw_codec == RESULTS_CODEC_LOSSLESS)
+	{
+		cbw_chunk_time_s = (double*)malloc(cbw_chunk_frames * sizeof(double));
+		cbw_chunk_t_index = (int*)malloc(cbw_chunk_frames * sizeof(int));
+		cbw_chunk_phase = (int*)malloc(cbw_chunk_frames * sizeof(int));
+		cbw_chunk_values = (float*)malloc((size_t)cbw_chunk_frames *
+			GSL_MAX(cbw_no_of_values, 1) * sizeof(float));
+		cbw_words = (unsigned long long*)malloc(cbw_chunk_frames * sizeof(unsigned long long));
+		cbw_chunk_bytes = (unsigned char*)malloc(8 + (4 * (size_t)(3 + cbw_no_of_values)) +
+			time_series_codec::return_max_encoded_bytes(cbw_chunk_frames, 8) +
+			((size_t)(2 + cbw_no_of_values) *
+				time_series_codec::return_max_encoded_bytes(cbw_chunk_frames, 4)));
+		cbw_codec_work = (unsigned char*)malloc(
+			time_series_codec::return_work_bytes(cbw_chunk_frames, 8));
+	}
+
+	// Set the file name
+	if (p_cmv_options->cb_dump_relative_to == "this_file")
+	{
+		options_file_path = path(p_cmv_options->options_file_string);
+		base_dir = options_file_path.parent_path();
+	}
+	else
+	{
+		base_dir = path(p_cmv_options->cb_dump_relative_to);
+	}
+
+	output_file_path = base_dir / p_cmv_options->cb_dump_file_string;
+	cbw_file_string = output_file_path.string();
+
+	// Make sure directory exists
+	output_file_path = absolute(path(cbw_file_string));
+
+	if (!(is_directory(output_file_path.parent_path())))
+	{
+		if (create_directories(output_file_path.parent_path()))
+		{
+			cout << "\nCreating folder: " << output_file_path.string() << "\n";
+		}
+		else
+		{
+			cout << "\nError: Folder for cb dump file could not be created: " <<
+				output_file_path.parent_path().string() << "\n";
+			exit(1);
+		}
+	}
+
+	// Check file can be opened, abort if not
+	errno_t err = fopen_s(&p_file, cbw_file_string.c_str(), "wb");
+	if (err != 0)
+	{
+		cout << "Cb dump file: " << cbw_file_string << " could not be opened\n";
+		exit(1);
+	}
+
+	cout << "Writing cb distributions to: " << cbw_file_string << "\n";
+
+	write_header();
+
+	fflush(p_file);
+
+	// Start the writer
+	cbw_thread = std::thread(&cb_dump_writer::write_loop, this);
+}
+
+// Destructor
+cb_dump_writer::~cb_dump_writer(void)
+{
+	//! Destructor
+
+	// Code
+	finish();
+
+	// Tidy up
+	free(cbw_peak_values);
+	free(cbw_queue);
+	free(cbw_queue_time_s);
+	free(cbw_queue_t_index);
+	free(cbw_queue_phase);
+	free(cbw_bytes);
+
+	if (cbw_codec == RESULTS_CODEC_LOSSLESS)
+	{
+		free(cbw_chunk_time_s);
+		free(cbw_chunk_t_index);
+		free(cbw_chunk_phase);
+		free(cbw_chunk_values);
+		free(cbw_words);
+		free(cbw_chunk_bytes);
+		free(cbw_codec_work);
+	}
+}
+
+// Other functions
+void cb_dump_writer::update(double time_s, int t_index)
+{
+	//! Function is called after each time-step and commits a frame if
+	//! the windows and either the stride or the beat phase ask for one
+	//! The phases follow the valves, so
+	//!		end_diastole is the step the mitral valve closes
+	//!		peak_systole is the step with the highest ventricular pressure
+	//!			while the aortic valve is open, which is known once it
+	//!			closes, so the frame is held until then
+	//!		end_systole is the step the aortic valve closes
+
+	// Variables
+	bool in_window = true;
+	bool mv_open;
+	bool av_open;
+
+	double pressure;
+
+	float* p_frame;
+
+	// Code
+
+	// The windows are in order so only the next one has to be checked
+	if (cbw_no_of_windows > 0)
+	{
+		while ((cbw_window < cbw_no_of_windows) &&
+			(t_index > cbw_last_t_index[cbw_window]))
+		{
+			cbw_window = cbw_window + 1;
+		}
+
+		in_window = ((cbw_window < cbw_no_of_windows) &&
+			(t_index >= cbw_first_t_index[cbw_window]));
+	}
+
+	if (!cbw_use_phases)
+	{
+		if ((in_window) && (((t_index + 1) % cbw_stride) == 0))
+		{
+			p_frame = reserve_frame(time_s, t_index, CB_DUMP_PHASE_NONE);
+			p_myofilaments->copy_cb_distributions(p_frame);
+			commit_frame();
+		}
+
+		return;
+	}
+
+	mv_open = (p_parent_hemi_vent->p_mv->valve_pos > p_parent_hemi_vent->p_mv->valve_leak);
+	av_open = (p_parent_hemi_vent->p_av->valve_pos > p_parent_hemi_vent->p_av->valve_leak);
+
+	pressure = p_parent_hemi_vent->p_parent_circulation->circ_pressure[0];
+
+	if ((cbw_phase_selected[CB_DUMP_PHASE_END_DIASTOLE]) && (in_window) &&
+		(cbw_mv_was_open) && (!mv_open))
+	{
+		p_frame = reserve_frame(time_s, t_index, CB_DUMP_PHASE_END_DIASTOLE);
+		p_myofilaments->copy_cb_distributions(p_frame);
+		commit_frame();
+	}
+
+	if ((cbw_phase_selected[CB_DUMP_PHASE_PEAK_SYSTOLE]) && (av_open))
+	{
+		if (!cbw_av_was_open)
+			cbw_peak_pressure = -GSL_POSINF;
+
+		if (pressure > cbw_peak_pressure)
+		{
+			cbw_peak_pressure = pressure;
+			cbw_peak_pending = in_window;
+
+			if (in_window)
+			{
+				cbw_peak_time_s = time_s;
+				cbw_peak_t_index = t_index;
+				p_myofilaments->copy_cb_distributions(cbw_peak_values);
+			}
+		}
+	}
+
+	if ((cbw_av_was_open) && (!av_open))
+	{
+		if (cbw_peak_pending)
+		{
+			p_frame = reserve_frame(cbw_peak_time_s, cbw_peak_t_index, CB_DUMP_PHASE_PEAK_SYSTOLE);
+			memcpy(p_frame, cbw_peak_values, cbw_no_of_values * sizeof(float));
+			commit_frame();
+
+			cbw_peak_pending = false;
+		}
+
+		if ((cbw_phase_selected[CB_DUMP_PHASE_END_SYSTOLE]) && (in_window))
+		{
+			p_frame = reserve_frame(time_s, t_index, CB_DUMP_PHASE_END_SYSTOLE);
+			p_myofilaments->copy_cb_distributions(p_frame);
+			commit_frame();
+		}
+	}
+
+	cbw_mv_was_open = mv_open;
+	cbw_av_was_open = av_open;
+}
+
+float* cb_dump_writer::reserve_frame(double time_s, int t_index, int phase)
+{
+	//! Function returns the slot for the next frame, after setting its
+	//! time and phase
+	//! Only the simulation thread calls this. If the writer has fallen
+	//! a whole buffer behind, the simulation waits
+
+	// Variables
+	long long tail = cbw_tail.load(std::memory_order_relaxed);
+	int slot;
+
+	// Code
+	if ((tail - cbw_head.load(std::memory_order_acquire)) >= cbw_buffer_frames)
+	{
+		cbw_n_producer_waits = cbw_n_producer_waits + 1;
+
+		while ((tail - cbw_head.load(std::memory_order_acquire)) >= cbw_buffer_frames)
+			std::this_thread::yield();
+	}
+
+	slot = (int)(tail % cbw_buffer_frames);
+
+	cbw_queue_time_s[slot] = time_s;
+	cbw_queue_t_index[slot] = t_index;
+	cbw_queue_phase[slot] = phase;
+
+	return &cbw_queue[(size_t)slot * cbw_no_of_values];
+}
+
+void cb_dump_writer::commit_frame(void)
+{
+	//! Function makes the reserved frame visible to the writer thread
+
+	cbw_tail.store(cbw_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void cb_dump_writer::finish(void)
+{
+	//! Function waits for the writer thread to write the remaining frames,
+	//! stores the number of frames in the header and closes the file
+
+	// Variables
+	unsigned char counts[8];
+
+	// Code
+	if (cbw_finished)
+		return;
+
+	cbw_finished = true;
+
+	cbw_done.store(true, std::memory_order_release);
+
+	if (cbw_thread.joinable())
+		cbw_thread.join();
+
+	_fseeki64(p_file, 24, SEEK_SET);
+	put_little_endian(counts, cbw_frames_written, 8);
+	if (fwrite(counts, 1, 8, p_file) != 8)
+		cbw_write_error = true;
+
+	fclose(p_file);
+
+	cout << "Closing cb dump file: " << cbw_file_string << ", " << cbw_frames_written <<
+		" frames, the simulation waited for the writer " << cbw_n_producer_waits << " time(s)\n";
+
+	if (cbw_write_error)
+		cout << "Error: cb dump file " << cbw_file_string << " could not be written\n";
+}
+
+void cb_dump_writer::write_loop(void)
+{
+	//! Function run by the writer thread
+	//! The frames waiting in the queue are converted to bytes and written
+	//! with one call, so the file is a whole number of frames after each
+	//! batch and can be read while the simulation runs
+
+	// Variables
+	long long head;
+	long long tail;
+
+	int slot;
+
+	unsigned char* p_bytes;
+	float* p_values;
+	unsigned int bits;
+
+	// Code
+	while (true)
+	{
+		head = cbw_head.load(std::memory_order_relaxed);
+		tail = cbw_tail.load(std::memory_order_acquire);
+
+		if (tail == head)
+		{
+			if (cbw_done.load(std::memory_order_acquire))
+			{
+				// Frames committed before done was set are visible now
+				if (cbw_tail.load(std::memory_order_acquire) == head)
+					break;
+				continue;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+
+		if (cbw_codec == RESULTS_CODEC_LOSSLESS)
+		{
+			for (long long r = head; r < tail; r++)
+				add_frame_to_chunk((int)(r % cbw_buffer_frames));
+
+			cbw_head.store(tail, std::memory_order_release);
+			continue;
+		}
+
+		p_bytes = cbw_bytes;
+
+		for (long long r = head; r < tail; r++)
+		{
+			slot = (int)(r % cbw_buffer_frames);
+			p_values = &cbw_queue[(size_t)slot * cbw_no_of_values];
+
+			put_little_endian_double(&p_bytes[0], cbw_queue_time_s[slot]);
+			put_little_endian(&p_bytes[8], (unsigned int)cbw_queue_t_index[slot], 4);
+			put_little_endian(&p_bytes[12], (unsigned int)cbw_queue_phase[slot], 4);
+
+			for (int i = 0; i < cbw_no_of_values; i++)
+			{
+				memcpy(&bits, &p_values[i], sizeof(float));
+				put_little_endian(&p_bytes[CB_DUMP_FRAME_HEADER_BYTES + (4 * i)], bits, 4);
+			}
+
+			p_bytes = p_bytes + cbw_frame_bytes;
+		}
+
+		// The slots can be reused
+		cbw_head.store(tail, std::memory_order_release);
+
+		if (fwrite(cbw_bytes, cbw_frame_bytes, (size_t)(tail - head), p_file) != (size_t)(tail - head))
+			cbw_write_error = true;
+
+		cbw_frames_written = cbw_frames_written + (tail - head);
+
+		if (fflush(p_file) != 0)
+			cbw_write_error = true;
+	}
+
+	// Complete the file
+	if (cbw_chunk_length > 0)
+		write_chunk();
+
+	if (fflush(p_file) != 0)
+		cbw_write_error = true;
+}
+
+void cb_dump_writer::add_frame_to_chunk(int slot)
+{
+	//! Function copies a frame from the queue to the chunk, and writes
+	//! the chunk if it is full
+
+	// Code
+	cbw_chunk_time_s[cbw_chunk_length] = cbw_queue_time_s[slot];
+	cbw_chunk_t_index[cbw_chunk_length] = cbw_queue_t_index[slot];
+	cbw_chunk_phase[cbw_chunk_length] = cbw_queue_phase[slot];
+
+	memcpy(&cbw_chunk_values[(size_t)cbw_chunk_length * cbw_no_of_values],
+		&cbw_queue[(size_t)slot * cbw_no_of_values], cbw_no_of_values * sizeof(float));
+
+	cbw_chunk_length = cbw_chunk_length + 1;
+
+	if (cbw_chunk_length == cbw_chunk_frames)
+		write_chunk();
+}
+
+void cb_dump_writer::write_chunk(void)
+{
+	//! Function encodes the chunk and writes it with one call
+	//! A chunk holds
+	//!		uint32 no_of_frames, uint32 no_of_columns
+	//!		uint32 bytes in each column
+	//!		the columns, each written by time_series_codec::encode, for
+	//!			the times (8-byte words), the simulation indices and the
+	//!			phase codes (4-byte words), and then each bin of each
+	//!			attached state in turn (float32 bits)
+
+	// Variables
+	int n = cbw_chunk_length;
+	int no_of_columns = 3 + cbw_no_of_values;
+
+	size_t chunk_bytes;
+	size_t column_bytes;
+
+	unsigned int f_bits;
+
+	// Code
+	put_little_endian(&cbw_chunk_bytes[0], n, 4);
+	put_little_endian(&cbw_chunk_bytes[4], no_of_columns, 4);
+
+	chunk_bytes = 8 + (4 * (size_t)no_of_columns);
+
+	for (int c = 0; c < no_of_columns; c++)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			if (c == 0)
+				memcpy(&cbw_words[i], &cbw_chunk_time_s[i], sizeof(double));
+			else if (c == 1)
+				cbw_words[i] = (unsigned int)cbw_chunk_t_index[i];
+			else if (c == 2)
+				cbw_words[i] = (unsigned int)cbw_chunk_phase[i];
+			else
+			{
+				memcpy(&f_bits, &cbw_chunk_values[((size_t)i * cbw_no_of_values) + (c - 3)],
+					sizeof(float));
+				cbw_words[i] = f_bits;
+			}
+		}
+
+		column_bytes = time_series_codec::encode(cbw_words, n, ((c == 0) ? 8 : 4),
+			&cbw_chunk_bytes[chunk_bytes], cbw_codec_work);
+
+		put_little_endian(&cbw_chunk_bytes[8 + (4 * c)], column_bytes, 4);
+
+		chunk_bytes = chunk_bytes + column_bytes;
+	}
+
+	if (fwrite(cbw_chunk_bytes, 1, chunk_bytes, p_file) != chunk_bytes)
+		cbw_write_error = true;
+
+	if (fflush(p_file) != 0)
+		cbw_write_error = true;
+
+	cbw_frames_written = cbw_frames_written + n;
+	cbw_chunk_length = 0;
+}
+
+void cb_dump_writer::write_header(void)
+{
+	//! Function writes the header and the bin positions
+	//! All numbers are little-endian. The file holds
+	//!		a header of CB_DUMP_HEADER_BYTES
+	//!			char[8] CB_DUMP_MAGIC, uint32 version,
+	//!			uint32 no_of_attached_states, uint32 no_of_bins,
+	//!			uint32 bytes per frame, uint64 no_of_frames (written when
+	//!			the file is closed), int32 system_id, uint32 stride in
+	//!			time-steps (0 if the frames are picked by beat phase),
+	//!			double simulation time-step in s, uint32 codec
+	//!			(RESULTS_CODEC_NONE or RESULTS_CODEC_LOSSLESS), uint32
+	//!			frames in a full chunk (0 without a codec)
+	//!		the bin positions in nm as no_of_bins doubles
+	//!		without a codec, the frames, each holding
+	//!			double time in s, int32 simulation index, uint32 phase code
+	//!			(0 none, 1 end_diastole, 2 peak_systole, 3 end_systole),
+	//!			float32 populations for each bin of each attached state
+	//!			in turn
+	//!		with the lossless codec, the chunks described in write_chunk
+	//! A reader that finds no_of_frames is 0 takes the frames from the
+	//! size of the file, or reads chunks to the end of the file, as the
+	//! run is still going or ended early
+	//! Version 1 files have no codec, and their header stops after the
+	//! time-step
+
+	// Variables
+	unsigned char header[CB_DUMP_HEADER_BYTES];
+	unsigned char bin_bytes[8];
+
+	cmv_system* p_cmv_system = p_parent_hemi_vent->p_parent_cmv_system;
+
+	// Code
+	memset(header, 0, CB_DUMP_HEADER_BYTES);
+	memcpy(header, CB_DUMP_MAGIC, 8);
+	put_little_endian(&header[8], CB_DUMP_VERSION, 4);
+	put_little_endian(&header[12], p_myofilaments->p_m_scheme->no_of_attached_states, 4);
+	put_little_endian(&header[16], p_myofilaments->no_of_bin_positions, 4);
+	put_little_endian(&header[20], cbw_frame_bytes, 4);
+	put_little_endian(&header[24], 0, 8);
+	put_little_endian(&header[32], (unsigned int)p_cmv_system->system_id, 4);
+	put_little_endian(&header[36], (cbw_use_phases ? 0 : cbw_stride), 4);
+	put_little_endian_double(&header[40], p_cmv_system->p_cmv_protocol->time_step_s);
+	put_little_endian(&header[48], cbw_codec, 4);
+	put_little_endian(&header[52], ((cbw_codec == RESULTS_CODEC_NONE) ? 0 : cbw_chunk_frames), 4);
+
+	fwrite(header, 1, CB_DUMP_HEADER_BYTES, p_file);
+
+	for (int i = 0; i < p_myofilaments->no_of_bin_positions; i++)
+	{
+		put_little_endian_double(bin_bytes, gsl_vector_get(p_myofilaments->x, i));
+		fwrite(bin_bytes, 1, 8, p_file);
+	}
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+/**
+/* @file		cb_dump_writer.h
+/* @brief		Header file for a cb_dump_writer object
+/* @author		Ken Campbell
+*/
+
+#include "stdio.h"
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <thread>
+
+#include "global_definitions.h"
+
+using namespace std;
+
+class hemi_vent;
+class myofilaments;
+
+class cb_dump_writer
+{
+public:
+	/**
+	 * Constructor
+	 * Opens the cb dump file, writes the header, and starts the thread
+	 * that writes frames as they are committed
+	 */
+	cb_dump_writer(hemi_vent* set_p_parent_hemi_vent);
+
+	/**
+	* Destructor
+	*/
+	~cb_dump_writer(void);
+
+	// Variables
+	hemi_vent* p_parent_hemi_vent;			/**< pointer to the parent hemi_vent */
+
+	myofilaments* p_myofilaments;			/**< pointer to the myofilaments
+													whose distributions are
+													dumped */
+
+	string cbw_file_string;					/**< string with the file name */
+
+	FILE* p_file;							/**< pointer to the output file */
+
+	int cbw_no_of_values;					/**< integer with the number of
+													values in a frame, a
+													distribution for each
+													attached state */
+
+	int cbw_frame_bytes;					/**< integer with the bytes in a
+													frame in the file */
+
+	int cbw_stride;							/**< integer with the number of
+													time-steps between frames */
+
+	int cbw_first_t_index[MAX_NO_OF_CB_DUMP_WINDOWS];
+											/**< array of integers with the first
+													simulation index in each
+													window */
+
+	int cbw_last_t_index[MAX_NO_OF_CB_DUMP_WINDOWS];
+											/**< array of integers with the last
+													simulation index in each
+													window */
+
+	int cbw_no_of_windows;					/**< integer with the number of
+													windows, 0 for the whole
+													simulation */
+
+	int cbw_window;							/**< integer with the first window
+													that has not ended */
+
+	bool cbw_use_phases;					/**< true if frames are picked by
+													beat phase, not by stride */
+
+	bool cbw_phase_selected[CB_DUMP_NO_OF_PHASE_CODES];
+											/**< array of booleans, true for
+													each phase that is dumped */
+
+	bool cbw_mv_was_open;					/**< true if the mitral valve was
+													open after the last step */
+
+	bool cbw_av_was_open;					/**< true if the aortic valve was
+													open after the last step */
+
+	double cbw_peak_pressure;				/**< double with the highest
+													ventricular pressure so far
+													in the ejection */
+
+	bool cbw_peak_pending;					/**< true if a peak systole frame is
+													held until the ejection ends */
+
+	float* cbw_peak_values;					/**< pointer to the distributions at
+													the highest pressure so far */
+
+	double cbw_peak_time_s;					/**< double with the time of the
+													peak systole frame */
+
+	int cbw_peak_t_index;					/**< integer with the simulation
+													index of the peak systole
+													frame */
+
+	int cbw_buffer_frames;					/**< integer with the number of
+													frames the queue can hold */
+
+	float* cbw_queue;						/**< pointer to the distributions
+													waiting to be written, used
+													as a ring */
+
+	double* cbw_queue_time_s;				/**< pointer to the time of each
+													frame in the queue */
+
+	int* cbw_queue_t_index;					/**< pointer to the simulation index
+													of each frame in the queue */
+
+	int* cbw_queue_phase;					/**< pointer to the phase code of
+													each frame in the queue */
+
+	unsigned char* cbw_bytes;				/**< pointer to the bytes the writer
+													thread builds for a batch of
+													frames */
+
+	int cbw_codec;							/**< integer with the codec,
+													RESULTS_CODEC_NONE or
+													RESULTS_CODEC_LOSSLESS */
+
+	int cbw_chunk_frames;					/**< integer with the frames in a
+													full chunk for the codec */
+
+	int cbw_chunk_length;					/**< integer with the frames in the
+													chunk being filled */
+
+	double* cbw_chunk_time_s;				/**< pointer to the times of the
+													frames in the chunk */
+
+	int* cbw_chunk_t_index;					/**< pointer to the simulation
+													indices of the frames in the
+													chunk */
+
+	int* cbw_chunk_phase;					/**< pointer to the phase codes of
+													the frames in the chunk */
+
+	float* cbw_chunk_values;				/**< pointer to the distributions of
+													the frames in the chunk */
+
+	unsigned long long* cbw_words;			/**< pointer to the bit patterns of
+													one column of the chunk */
+
+	unsigned char* cbw_chunk_bytes;			/**< pointer to the encoded chunk */
+
+	unsigned char* cbw_codec_work;			/**< pointer to the work space for
+													the codec */
+
+	std::atomic<long long> cbw_head;		/**< number of frames taken from the
+													queue by the writer thread */
+
+	std::atomic<long long> cbw_tail;		/**< number of frames committed to
+													the queue by the simulation */
+
+	std::atomic<bool> cbw_done;				/**< set when no more frames will be
+													committed */
+
+	std::thread cbw_thread;					/**< the thread writing the frames */
+
+	bool cbw_finished;						/**< true once the file is complete */
+
+	bool cbw_write_error;					/**< set by the writer thread if
+													the file could not be
+													written */
+
+	long long cbw_frames_written;			/**< number of frames in the file */
+
+	long long cbw_n_producer_waits;			/**< number of times the simulation
+													waited for space in a full
+													queue */
+
+	// Functions
+
+	void update(double time_s, int t_index);
+											/**< function is called after each
+													time-step and commits a
+													frame if one is due */
+
+	float* reserve_frame(double time_s, int t_index, int phase);
+											/**< function returns the next slot
+													in the queue, waiting if it
+													is full */
+
+	void commit_frame(void);				/**< function passes the reserved
+													frame to the writer thread */
+
+	void finish(void);						/**< function writes the remaining
+													frames and completes the file */
+
+	void write_loop(void);					/**< function run by the writer
+													thread */
+
+	void write_header(void);				/**< function writes the header and
+													the bin positions */
+
+	void add_frame_to_chunk(int slot);		/**< function copies a frame from
+													the queue to the chunk, and
+													writes the chunk if it is
+													full */
+
+	void write_chunk(void);					/**< function encodes the chunk and
+													writes it */
+};
@@ -8,6 +8,7 @@
 
 #include "circulation.h"
 #include "cmv_system.h"
+#include "update_schedule.h"
 #include "cmv_model.h"
 #include "cmv_protocol.h"
 #include "cmv_options.h"
@@ -17,6 +18,7 @@
 #include "half_sarcomere.h"
 #include "baroreflex.h"
 #include "growth.h"
+#include "matrix_functions.h"
 
 #include "gsl_math.h"
 #include "gsl_errno.h"
@@ -29,6 +31,10 @@ struct stats_structure{
 	double sum;
 };
 
+// Forward declaration of the function used by the GSL ODE system, so that
+// initialise_simulation can build the persistent driver
+int circ_vol_derivs(double t, const double y[], double f[], void* params);
+
 // Constructor
 circulation::circulation(cmv_system* set_p_parent_cmv_system = NULL)
 {
@@ -45,20 +51,62 @@ circulation::circulation(cmv_system* set_p_parent_cmv_system = NULL)
 	// Set pointers to safety
 	p_cmv_options = NULL;
 	p_cmv_results_beat = NULL;
+	p_circ_ode_driver = NULL;
+	circ_exp_propagator = NULL;
+	circ_exp_key = NULL;
+	circ_csr_row_start = NULL;
+	circ_csr_diag = NULL;
+	circ_csr_col = NULL;
+	circ_csr_value = NULL;
+	circ_edge_csr_index = NULL;
+	circ_edge_conductance = NULL;
+	circ_imp_diag = NULL;
+	circ_imp_rhs = NULL;
+	circ_imp_p = NULL;
+	circ_imp_r = NULL;
+	circ_imp_z = NULL;
+	circ_imp_d = NULL;
+	circ_imp_q = NULL;
+
+	// The exponential propagator is only used if set in the options
+	circ_exponential = false;
+	circ_exp_size = 0;
+	circ_exp_valid = false;
+	circ_elastance_dV = 1e-3;
+	circ_exp_n_rebuilds = 0;
+	circ_report_counters = false;
+
+	// As is the implicit solver
+	circ_implicit = false;
+	circ_csr_nnz = 0;
+	circ_imp_tolerance = 1e-12;
+	circ_imp_min_elastance = 1.0;
+	circ_imp_n_iterations = 0;
+	circ_imp_n_edge_updates = 0;
 
 	// Now initialise other objects
 	circ_blood_volume = p_cmv_model->circ_blood_volume;
 
+	circ_pressure_arteries_max = GSL_NAN;
+	circ_pressure_arteries_min = GSL_NAN;
+
 	circ_no_of_compartments = p_cmv_model->circ_no_of_compartments;
+	circ_no_of_edges = p_cmv_model->circ_no_of_edges;
 
 	// Set up arrays
-	circ_resistance = (double*)malloc(circ_no_of_compartments * sizeof(double));
 	circ_compliance = (double*)malloc(circ_no_of_compartments * sizeof(double));
 	circ_slack_volume = (double*)malloc(circ_no_of_compartments * sizeof(double));
-	circ_inertance = (double*)malloc(circ_no_of_compartments * sizeof(double));
 	circ_pressure = (double*)malloc(circ_no_of_compartments * sizeof(double));
 	circ_volume = (double*)malloc(circ_no_of_compartments * sizeof(double));
-	circ_flow = (double*)malloc(circ_no_of_compartments * sizeof(double));
+	circ_vol_calc = (double*)malloc(circ_no_of_compartments * sizeof(double));
+
+	circ_edge_from = (int*)malloc(circ_no_of_edges * sizeof(int));
+	circ_edge_to = (int*)malloc(circ_no_of_edges * sizeof(int));
+	p_edge_valve = (valve**)malloc(circ_no_of_edges * sizeof(valve*));
+	circ_resistance = (double*)malloc(circ_no_of_edges * sizeof(double));
+	circ_inertance = (double*)malloc(circ_no_of_edges * sizeof(double));
+	circ_flow = (double*)malloc(circ_no_of_edges * sizeof(double));
+	circ_flow_calc = (double*)malloc(circ_no_of_edges * sizeof(double));
 
 	// Initialise, noting total slack_volume as we go
 	// Start with the compartments at slack volume
@@ -66,16 +114,37 @@ circulation::circulation(cmv_system* set_p_parent_cmv_system = NULL)
 
 	for (int i = 0; i < circ_no_of_compartments; i++)
 	{
-		circ_resistance[i] = p_cmv_model->circ_resistance[i];
 		circ_compliance[i] = p_cmv_model->circ_compliance[i];
 		circ_slack_volume[i] = p_cmv_model->circ_slack_volume[i];
-		circ_inertance[i] = p_cmv_model->circ_inertance[i];
 		circ_pressure[i] = 0.0;
 		circ_volume[i] = circ_slack_volume[i];
-		circ_flow[i] = 0.0;
 
 		circ_total_slack_volume = circ_total_slack_volume +
 			circ_volume[i];
+
+		// Compartment 0 is the ventricle, the others need a compliance
+		if ((i > 0) && (circ_compliance[i] <= 0.0))
+		{
+			cout << "Error: compartment " << i << " needs a positive compliance\n";
+			exit(1);
+		}
+	}
+
+	for (int e = 0; e < circ_no_of_edges; e++)
+	{
+		circ_edge_from[e] = p_cmv_model->circ_edge_from[e];
+		circ_edge_to[e] = p_cmv_model->circ_edge_to[e];
+		circ_resistance[e] = p_cmv_model->circ_resistance[e];
+		circ_inertance[e] = p_cmv_model->circ_inertance[e];
+		circ_flow[e] = 0.0;
+
+		if ((circ_edge_from[e] < 0) || (circ_edge_from[e] >= circ_no_of_compartments) ||
+			(circ_edge_to[e] < 0) || (circ_edge_to[e] >= circ_no_of_compartments) ||
+			(circ_edge_from[e] == circ_edge_to[e]))
+		{
+			cout << "Error: circulation edge " << e << " does not join two compartments\n";
+			exit(1);
+		}
 	}
 
 	// Excess blood goes in veins
@@ -97,6 +166,44 @@ circulation::circulation(cmv_system* set_p_parent_cmv_system = NULL)
 	p_av = p_hemi_vent->p_av;
 	p_mv = p_hemi_vent->p_mv;
 
+	// Attach the valves to their edges
+	circ_av_edge = -1;
+	circ_mv_edge = -1;
+
+	for (int e = 0; e < circ_no_of_edges; e++)
+	{
+		p_edge_valve[e] = NULL;
+
+		if (p_cmv_model->circ_edge_valve[e] == "aortic")
+		{
+			p_edge_valve[e] = p_av;
+			circ_av_edge = (circ_av_edge < 0) ? e : -2;
+		}
+		else if (p_cmv_model->circ_edge_valve[e] == "mitral")
+		{
+			p_edge_valve[e] = p_mv;
+			circ_mv_edge = (circ_mv_edge < 0) ? e : -2;
+		}
+		else if (!p_cmv_model->circ_edge_valve[e].empty())
+		{
+			cout << "Error: circulation edge " << e << " valve " <<
+				p_cmv_model->circ_edge_valve[e] << " not recognized\n";
+			exit(1);
+		}
+
+		if ((p_edge_valve[e] != NULL) && (circ_inertance[e] > 0.0))
+		{
+			cout << "Error: circulation edge " << e << " cannot have a valve and an inertance\n";
+			exit(1);
+		}
+	}
+
+	if ((circ_av_edge < 0) || (circ_mv_edge < 0))
+	{
+		cout << "Error: the circulation needs exactly one aortic and one mitral valve edge\n";
+		exit(1);
+	}
+
 	// Make a new baroreflex object if it has been defined
 	if (!gsl_isnan(p_cmv_model->baro_S))
 	{
@@ -133,13 +240,56 @@ circulation::~circulation(void)
 	if (p_growth != NULL)
 		delete p_growth;
 
-	free(circ_resistance);
 	free(circ_compliance);
 	free(circ_slack_volume);
-	free(circ_inertance);
 	free(circ_pressure);
 	free(circ_volume);
+	free(circ_vol_calc);
+
+	free(circ_edge_from);
+	free(circ_edge_to);
+	free(p_edge_valve);
+	free(circ_resistance);
+	free(circ_inertance);
 	free(circ_flow);
+	free(circ_flow_calc);
+
+	if (p_circ_ode_driver != NULL)
+		gsl_odeiv2_driver_free(p_circ_ode_driver);
+
+	if ((circ_exponential) && (circ_report_counters))
+	{
+		cout << "Circulation propagator rebuilds: " << circ_exp_n_rebuilds << "\n";
+	}
+
+	if (circ_exp_propagator != NULL)
+		free(circ_exp_propagator);
+
+	if (circ_exp_key != NULL)
+		free(circ_exp_key);
+
+	if (circ_implicit)
+	{
+		if (circ_report_counters)
+		{
+			cout << "Circulation conjugate gradient iterations: " << circ_imp_n_iterations <<
+				" edge updates: " << circ_imp_n_edge_updates << "\n";
+		}
+
+		free(circ_csr_row_start);
+		free(circ_csr_diag);
+		free(circ_csr_col);
+		free(circ_csr_value);
+		free(circ_edge_csr_index);
+		free(circ_edge_conductance);
+		free(circ_imp_diag);
+		free(circ_imp_rhs);
+		free(circ_imp_p);
+		free(circ_imp_r);
+		free(circ_imp_z);
+		free(circ_imp_d);
+		free(circ_imp_q);
+	}
 }
 
 // Other functions
@@ -149,18 +299,73 @@ void circulation::initialise_simulation(void)
 	//! Code initialises simulation
 	
 	// Variables
+	double eps_abs = 1e-6;
+	double eps_rel = 1e-6;
+
+	int field_index;
 
 	// Code
 
 	// Set the options
 	p_cmv_options = p_parent_cmv_system->p_cmv_options;
 
+	// The options are deleted before the destructor runs
+	circ_report_counters = (p_cmv_options->report_counters == "True");
+
 	// Set the results
 	p_cmv_results_beat = p_parent_cmv_system->p_cmv_results_beat;
 
 	// Set the protocol
 	p_cmv_protocol = p_parent_cmv_system->p_cmv_protocol;
 
+	// Create the ODE driver once, it is reset at the start of each time-step
+	circ_ode_system = { circ_vol_derivs, NULL, (size_t)circ_no_of_compartments, this };
+
+	p_circ_ode_driver = gsl_odeiv2_driver_alloc_y_new(&circ_ode_system,
+		gsl_odeiv2_step_rkf45, 0.5 * p_cmv_protocol->time_step_s, eps_abs, eps_rel);
+
+	// Optionally set up the exponential propagator. The state is the
+	// vascular volumes plus the ventricular pressure, its slope, and 1
+	if (p_cmv_options->circ_integrator == "exponential")
+	{
+		circ_exponential = true;
+		circ_exp_size = (circ_no_of_compartments - 1) + 3;
+
+		if (circ_exp_size > MAX_MATRIX_EXPONENTIAL_SIZE)
+		{
+			cout << "Error: exponential circulation integrator needs " << circ_exp_size <<
+				" states, more than MAX_MATRIX_EXPONENTIAL_SIZE\n";
+			exit(1);
+		}
+
+		circ_exp_propagator = (double*)malloc(circ_exp_size * circ_exp_size * sizeof(double));
+		circ_exp_key = (double*)malloc(((2 * circ_no_of_compartments) + circ_no_of_edges + 3) *
+			sizeof(double));
+	}
+	else if (p_cmv_options->circ_integrator == "implicit")
+	{
+		// Assemble the sparse matrix and the work arrays once
+		circ_implicit = true;
+		build_implicit_matrix();
+	}
+	else if (p_cmv_options->circ_integrator != "rkf45")
+	{
+		cout << "Error: circulation integrator: " << p_cmv_options->circ_integrator <<
+			" not recognized\n";
+		exit(1);
+	}
+
+	// Only the implicit solver integrates the flows through inertances
+	for (int e = 0; e < circ_no_of_edges; e++)
+	{
+		if ((circ_inertance[e] > 0.0) && (!circ_implicit))
+		{
+			cout << "Error: circulation edge " << e <<
+				" has an inertance, which needs the implicit integrator\n";
+			exit(1);
+		}
+	}
+
 	// Now handle daughter objects
 	p_hemi_vent->initialise_simulation();
 
@@ -171,25 +376,58 @@ void circulation::initialise_simulation(void)
 		p_growth->initialise_simulation();
 
 	// Add data fields
-	p_cmv_results_beat->add_results_field("circ_blood_volume", &circ_blood_volume);
+	p_cmv_results_beat->add_results_field("circ_blood_volume", &circ_blood_volume, "liters");
 
+	// Keep the indices of the fields that the beat metrics use
+	// The veins fill the ventricle through the mitral valve
 	for (int i = 0; i < circ_no_of_compartments; i++)
 	{
 		string label = string("pressure_") + to_string(i);
-		p_cmv_results_beat->add_results_field(label, &circ_pressure[i]);
+		field_index = p_cmv_results_beat->add_results_field(label, &circ_pressure[i], "mmHg");
+
+		if (i == 0)
+			p_cmv_results_beat->pressure_vent_field_index = field_index;
+
+		if (i == circ_edge_from[circ_mv_edge])
+			p_cmv_results_beat->pressure_veins_field_index = field_index;
+
+		// The arteries are the compartment the baroreflex senses, or
+		// the one the aortic valve fills
+		if (p_baroreflex != NULL)
+		{
+			if (i == p_baroreflex->baro_P_compartment)
+				p_cmv_results_beat->pressure_arteries_field_index = field_index;
+		}
+		else if (i == circ_edge_to[circ_av_edge])
+			p_cmv_results_beat->pressure_arteries_field_index = field_index;
 	}
 
 	for (int i = 0; i < circ_no_of_compartments; i++)
 	{
 		string label = string("volume_") + to_string(i);
-		p_cmv_results_beat->add_results_field(label, &circ_volume[i]);
+		field_index = p_cmv_results_beat->add_results_field(label, &circ_volume[i], "liters");
+
+		if (i == 0)
+			p_cmv_results_beat->volume_vent_field_index = field_index;
 	}
 
-	for (int i = 0; i < circ_no_of_compartments; i++)
+	for (int e = 0; e < circ_no_of_edges; e++)
 	{
-		string label = string("flow_") + to_string(i);
-		p_cmv_results_beat->add_results_field(label, &circ_flow[i]);
+		string label = string("flow_") + to_string(e);
+		field_index = p_cmv_results_beat->add_results_field(label, &circ_flow[e], "liters s^-1");
+
+		if (e == circ_mv_edge)
+			p_cmv_results_beat->flow_mitral_valve_field_index = field_index;
+
+		if (e == circ_av_edge)
+			p_cmv_results_beat->flow_aortic_valve_field_index = field_index;
 	}
+
+	// Beat metrics
+	p_parent_cmv_system->p_cmv_results_beat_metrics->add_results_field(
+		"circ_pressure_arteries_max", &circ_pressure_arteries_max, "mmHg");
+	p_parent_cmv_system->p_cmv_results_beat_metrics->add_results_field(
+		"circ_pressure_arteries_min", &circ_pressure_arteries_min, "mmHg");
 }
 
 // This function is not a member of the circulation class but is used to interace
@@ -207,35 +445,28 @@ int circ_vol_derivs(double t, const double y[], double f[], void* params)
 	circulation* p_circ = (circulation*)params;
 									// Pointer to circulation
 
-	double* flow_calc = (double*)malloc(p_circ->circ_no_of_compartments * sizeof(double));
+	double* flow_calc = p_circ->circ_flow_calc;
 									// array of doubles to hold flows
 
 	// Code
 
-	// Zero flows
-	for (int i = 0; i < p_circ->circ_no_of_compartments; i++)
-	{
-		flow_calc[i] = 0.0;
-	}
-	
-	// Calculate the flows between the compartments
+	// Calculate the flows through the edges
 	p_circ->calculate_flows(y, flow_calc);
 
 	// Now adjust volumes
-	//! if compartments are
-	//! [0] - [1] - [2] - [3] - .... [n-1]
-	//! circ_flow[i] is flow from compartment [i-1] to compartment [i] through resistance i
-	//! rate of change of [i] is flow[i-1] - flow[i]
-	
-	for (int i = 0; i < (p_circ->circ_no_of_compartments-1) ; i++)
+	//! flow[e] runs from compartment circ_edge_from[e] to circ_edge_to[e]
+	//! so the rate of change of each compartment is the sum of the flows
+	//! into it minus the sum of the flows out of it
+	for (int i = 0; i < p_circ->circ_no_of_compartments; i++)
 	{
-		f[i] = flow_calc[i] - flow_calc[i+1];
+		f[i] = 0.0;
 	}
 
-	f[p_circ->circ_no_of_compartments-1] = flow_calc[p_circ->circ_no_of_compartments - 1] - flow_calc[0];
-
-	// Tidy up
-	free(flow_calc);
+	for (int e = 0; e < p_circ->circ_no_of_edges; e++)
+	{
+		f[p_circ->circ_edge_from[e]] = f[p_circ->circ_edge_from[e]] - flow_calc[e];
+		f[p_circ->circ_edge_to[e]] = f[p_circ->circ_edge_to[e]] + flow_calc[e];
+	}
 
 	// Return
 	return GSL_SUCCESS;
@@ -252,11 +483,8 @@ bool circulation::implement_time_step(double time_step_s)
 
 	double t_start_s = 0.0;
 	double t_stop_s = time_step_s;
-	
-	double eps_abs = 1e-6;
-	double eps_rel = 1e-6;
 
-	double* vol_calc = (double*)malloc(circ_no_of_compartments * sizeof(double));
+	double* vol_calc = circ_vol_calc;
 
 	// Code
 
@@ -274,23 +502,67 @@ bool circulation::implement_time_step(double time_step_s)
 	calculate_pressures(vol_calc, circ_pressure);
 
 	// Now adjust the compartment volumes by integrating flows.
-	gsl_odeiv2_system sys =
-		{ circ_vol_derivs, NULL, (size_t)circ_no_of_compartments, this };
+	if (circ_exponential)
+	{
+		exponential_volume_step(time_step_s);
+	}
+	else if (circ_implicit)
+	{
+		implicit_volume_step(time_step_s);
+	}
+	else
+	{
+		gsl_odeiv2_driver_reset_hstart(p_circ_ode_driver, 0.5 * time_step_s);
 
-	gsl_odeiv2_driver* d =
-		gsl_odeiv2_driver_alloc_y_new(&sys, gsl_odeiv2_step_rkf45,
-			0.5 * time_step_s, eps_abs, eps_rel);
+		status = gsl_odeiv2_driver_apply(p_circ_ode_driver, &t_start_s, t_stop_s, vol_calc);
 
-	status = gsl_odeiv2_driver_apply(d, &t_start_s, t_stop_s, vol_calc);
+		// Unpack the arrays
+		for (int i = 0; i < circ_no_of_compartments; i++)
+		{
+			circ_volume[i] = vol_calc[i];
+		}
+	}
 
-	gsl_odeiv2_driver_free(d);
+	update_after_volume_step();
 
-	// Unpack the arrays
-	for (int i = 0; i < circ_no_of_compartments; i++)
+	// Update the baroreflex, which includes updating the daughter objects
+	// The schedule can hold it for several time-steps, in which case it
+	// is advanced over all of them when it is next due
+	if ((p_baroreflex != NULL) &&
+		(p_parent_cmv_system->p_baro_schedule->advance(time_step_s, new_beat)))
 	{
-		circ_volume[i] = vol_calc[i];
+		p_baroreflex->baro_active = p_cmv_protocol->return_activation("baroreflex",
+			p_parent_cmv_system->cum_time_s);
+		p_baroreflex->implement_time_step(
+			p_parent_cmv_system->p_baro_schedule->us_time_step_s);
 	}
 
+	// Update the growth, which includes updating the daughter objects
+	if ((p_growth != NULL) &&
+		(p_parent_cmv_system->p_growth_schedule->advance(time_step_s, new_beat)))
+	{
+		p_growth->growth_active = p_cmv_protocol->return_activation("growth",
+			p_parent_cmv_system->cum_time_s);
+		p_growth->implement_time_step(
+			p_parent_cmv_system->p_growth_schedule->us_time_step_s,
+			p_parent_cmv_system->p_growth_schedule->us_new_beat);
+	}
+
+	// Return
+	return (new_beat);
+}
+
+void circulation::update_after_volume_step(void)
+{
+	//! Function passes the new compartment volumes to the ventricle,
+	//! checks the blood volume, and updates the flows
+
+	// Variables
+	double holder;
+	double adjustment;
+
+	// Code
+
 	// Update the hemi_vent with the new volume
 	p_hemi_vent->update_chamber_volume(circ_volume[0]);
 
@@ -301,14 +573,14 @@ bool circulation::implement_time_step(double time_step_s)
 		p_hemi_vent->return_chamber_height(p_hemi_vent->vent_chamber_radius);
 
 	// Make sure total volume remains constant
-	double holder = 0.0;
+	holder = 0.0;
 	for (int i = 0; i < circ_no_of_compartments; i++)
 	{
 		holder = holder + circ_volume[i];
 	}
 
 	// Any adjustment goes in veins
-	double adjustment = (circ_blood_volume - holder);
+	adjustment = (circ_blood_volume - holder);
 	circ_volume[circ_no_of_compartments - 1] = 
 		circ_volume[circ_no_of_compartments - 1] + adjustment;
 
@@ -321,28 +593,6 @@ bool circulation::implement_time_step(double time_step_s)
 
 	// Update data flows for data
 	calculate_flows(circ_volume, circ_flow);
-
-	// Update the baroreflex, which includes updating the daughter objects
-	if (p_baroreflex != NULL)
-	{
-		p_baroreflex->baro_active = p_cmv_protocol->return_activation("baroreflex",
-			p_parent_cmv_system->cum_time_s);
-		p_baroreflex->implement_time_step(time_step_s);
-	}
-
-	// Update the growth, which includes updating the daughter objects
-	if (p_growth != NULL)
-	{
-		p_growth->growth_active = p_cmv_protocol->return_activation("growth",
-			p_parent_cmv_system->cum_time_s);
-		p_growth->implement_time_step(time_step_s, new_beat);
-	}
-
-	// Tidy up
-	free(vol_calc);
-
-	// Return
-	return (new_beat);
 }
 
 void circulation::calculate_pressures(const double v[], double p[])
@@ -364,32 +614,580 @@ void circulation::calculate_flows(const double v[], double flow[])
 {
 	//! Function sets the values of circ_flows[] based on an
 	//! array of compartment volumes
-	//! if compartments are
-	//! [0] - [1] - [2] - [3] - .... [n-1]
-	//! circ_flow[i] is flow from compartment [i-1] to compartment [i] through resistance i
+	//! flow[e] is the flow from compartment circ_edge_from[e] to
+	//! circ_edge_to[e] through resistance e, scaled by the position of
+	//! the valve on the edge if there is one
+	//! Flows through edges with an inertance are state variables held
+	//! in circ_flow
 
 	// Variables
 	double p_diff;
 
-	double time_step_s = 0.001;
+	// Code
+
+	for (int e = 0; e < circ_no_of_edges; e++)
+	{
+		if (circ_inertance[e] > 0.0)
+		{
+			flow[e] = circ_flow[e];
+			continue;
+		}
+
+		p_diff = circ_pressure[circ_edge_from[e]] - circ_pressure[circ_edge_to[e]];
+
+		if (p_edge_valve[e] != NULL)
+			flow[e] = fabs(p_edge_valve[e]->valve_pos) * p_diff / circ_resistance[e];
+		else
+			flow[e] = p_diff / circ_resistance[e];
+	}
+}
+
+void circulation::exponential_volume_step(double time_step_s)
+{
+	//! Function advances the compartment volumes with the exponential
+	//! propagator. The vascular compartments are linear, so their volumes
+	//! are exact for a ventricular pressure that changes linearly over
+	//! the time-step. The slope comes from the chamber elastance and the
+	//! net flow into the ventricle. The ventricle takes the volume the
+	//! other compartments lose, so blood volume is conserved exactly
+	//! circ_pressure must hold the pressures at the start of the step
+
+	// Variables
+	int m = circ_no_of_compartments - 1;
+	int n_exp = circ_exp_size;
+
+	double* flow_calc = circ_flow_calc;
+
+	double z[MAX_MATRIX_EXPONENTIAL_SIZE];
+
+	double elastance;
+	double vent_inflow;
+
+	double new_volume;
+	double delta_vascular;
+
+	// Code
+
+	elastance = return_vent_elastance();
+
+	// Net flow into the ventricle at the start of the step
+	calculate_flows(circ_volume, flow_calc);
+
+	vent_inflow = 0.0;
+	for (int e = 0; e < circ_no_of_edges; e++)
+	{
+		if (circ_edge_to[e] == 0)
+			vent_inflow = vent_inflow + flow_calc[e];
+		if (circ_edge_from[e] == 0)
+			vent_inflow = vent_inflow - flow_calc[e];
+	}
+
+	// Rebuild the propagator if the resistances, compliances, valves
+	// or time-step have changed
+	if (!exponential_propagator_is_current(time_step_s))
+	{
+		build_exponential_propagator(time_step_s);
+	}
+
+	// Set the initial state
+	for (int i = 0; i < m; i++)
+	{
+		z[i] = circ_volume[i + 1];
+	}
+	z[m] = circ_pressure[0];
+	z[m + 1] = elastance * vent_inflow;
+	z[m + 2] = 1.0;
+
+	// Propagate, moving the volume lost by the vascular compartments into
+	// the ventricle
+	delta_vascular = 0.0;
+
+	for (int i = 0; i < m; i++)
+	{
+		new_volume = 0.0;
+		for (int j = 0; j < n_exp; j++)
+		{
+			new_volume = new_volume + (circ_exp_propagator[(i * n_exp) + j] * z[j]);
+		}
+
+		delta_vascular = delta_vascular + (new_volume - circ_volume[i + 1]);
+
+		circ_volume[i + 1] = new_volume;
+	}
+
+	circ_volume[0] = circ_volume[0] - delta_vascular;
+}
+
+bool circulation::exponential_propagator_is_current(double time_step_s)
+{
+	//! Function returns true if the propagator was built for the current
+	//! resistances, compliances, slack volumes, valve positions and time-step
+
+	// Variables
+	int n = circ_no_of_compartments;
+	int n_key = (2 * n) + circ_no_of_edges;
+
+	// Code
+	if (!circ_exp_valid)
+		return false;
+
+	for (int i = 0; i < n; i++)
+	{
+		if ((circ_exp_key[i] != circ_compliance[i]) ||
+			(circ_exp_key[n + i] != circ_slack_volume[i]))
+		{
+			return false;
+		}
+	}
+
+	for (int e = 0; e < circ_no_of_edges; e++)
+	{
+		if (circ_exp_key[(2 * n) + e] != circ_resistance[e])
+			return false;
+	}
+
+	if ((circ_exp_key[n_key] != fabs(p_av->valve_pos)) ||
+		(circ_exp_key[n_key + 1] != fabs(p_mv->valve_pos)) ||
+		(circ_exp_key[n_key + 2] != time_step_s))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void circulation::build_exponential_propagator(double time_step_s)
+{
+	//! Function builds exp(dt * A) where dz/dt = A z for
+	//! z = [V_1 ... V_n-1, p_0, dp_0/dt, 1]
+	//! flow e runs from compartment circ_edge_from[e] to circ_edge_to[e]
+	//! with conductance valve_pos / resistance e
+	//! The vascular pressures are (V_i - slack_i) / compliance_i
+
+	// Variables
+	int n = circ_no_of_compartments;
+	int m = circ_no_of_compartments - 1;
+	int n_exp = circ_exp_size;
+	int n_key = (2 * n) + circ_no_of_edges;
+
+	int col_p0 = m;
+	int col_p0_slope = m + 1;
+	int col_one = m + 2;
+
+	double A[MAX_MATRIX_EXPONENTIAL_SIZE * MAX_MATRIX_EXPONENTIAL_SIZE];
+
+	int up;
+	int down;
+	int row;
+	int k;
+	double conductance;
+	double sign;
+	double coefficient;
 
 	// Code
 
-	// Calculate the flows
-	// These are flows from the aorta through to the veins
-	for (int i = 2; i < circ_no_of_compartments; i++)
+	for (int i = 0; i < (n_exp * n_exp); i++)
+	{
+		A[i] = 0.0;
+	}
+
+	for (int e = 0; e < circ_no_of_edges; e++)
+	{
+		up = circ_edge_from[e];
+		down = circ_edge_to[e];
+
+		conductance = 1.0 / circ_resistance[e];
+		if (p_edge_valve[e] != NULL)
+			conductance = fabs(p_edge_valve[e]->valve_pos) * conductance;
+
+		// The flow fills the downstream compartment and empties the upstream
+		// one, which is the row for the compartment when it is vascular
+		for (int side = 0; side < 2; side++)
+		{
+			if (side == 0)
+			{
+				row = down - 1;
+				sign = 1.0;
+			}
+			else
+			{
+				row = up - 1;
+				sign = -1.0;
+			}
+
+			if (row < 0)
+				continue;
+
+			// flow = conductance * (p_up - p_down)
+			for (int term = 0; term < 2; term++)
+			{
+				k = (term == 0) ? up : down;
+				coefficient = (term == 0) ? (sign * conductance) : (-sign * conductance);
+
+				if (k == 0)
+				{
+					A[(row * n_exp) + col_p0] += coefficient;
+				}
+				else
+				{
+					A[(row * n_exp) + (k - 1)] += coefficient / circ_compliance[k];
+					A[(row * n_exp) + col_one] -= coefficient * circ_slack_volume[k] /
+						circ_compliance[k];
+				}
+			}
+		}
+	}
+
+	// The ventricular pressure changes at a constant rate over the step
+	A[(col_p0 * n_exp) + col_p0_slope] = 1.0;
+
+	// Scale by the time-step and take the exponential
+	for (int i = 0; i < (n_exp * n_exp); i++)
+	{
+		A[i] = time_step_s * A[i];
+	}
+
+	matrix_functions::exponential(A, circ_exp_propagator, n_exp);
+
+	// Store the key
+	for (int i = 0; i < n; i++)
+	{
+		circ_exp_key[i] = circ_compliance[i];
+		circ_exp_key[n + i] = circ_slack_volume[i];
+	}
+	for (int e = 0; e < circ_no_of_edges; e++)
 	{
-		p_diff = (circ_pressure[i - 1] - circ_pressure[i]);
-		flow[i] = p_diff / circ_resistance[i];
+		circ_exp_key[(2 * n) + e] = circ_resistance[e];
 	}
+	circ_exp_key[n_key] = fabs(p_av->valve_pos);
+	circ_exp_key[n_key + 1] = fabs(p_mv->valve_pos);
+	circ_exp_key[n_key + 2] = time_step_s;
 
-	// Special case for flow through mitral valve
-	p_diff = circ_pressure[circ_no_of_compartments - 1] - circ_pressure[0];
-	flow[0] = fabs(p_mv->valve_pos) * p_diff / circ_resistance[0];
+	circ_exp_valid = true;
+	circ_exp_n_rebuilds = circ_exp_n_rebuilds + 1;
+}
+
+double circulation::return_vent_elastance(void)
+{
+	//! Function returns the ventricular elastance in mmHg per liter from a
+	//! finite difference of the pressure-volume relationship
+	//! circ_pressure[0] must hold the pressure for circ_volume[0]
+
+	// Variables
+	double dV;
+	double p_perturbed;
+	double wall_thickness_holder;
+
+	// Code
+
+	// Restore the wall thickness set by the pressure at the start
+	wall_thickness_holder = p_hemi_vent->vent_wall_thickness;
+
+	dV = GSL_MAX(circ_elastance_dV * circ_volume[0], 1e-6);
+	p_perturbed = p_hemi_vent->return_pressure_for_chamber_volume(circ_volume[0] + dV);
 
-	// Special case for flow through aortic valve
-	p_diff = circ_pressure[0] - circ_pressure[1];
-	flow[1] = fabs(p_av->valve_pos) * p_diff / circ_resistance[1];
+	p_hemi_vent->vent_wall_thickness = wall_thickness_holder;
+
+	return ((p_perturbed - circ_pressure[0]) / dV);
+}
+
+void circulation::build_implicit_matrix(void)
+{
+	//! Function assembles the pattern of the conductance matrix in
+	//! compressed sparse row format, with an entry on the diagonal and
+	//! one for each pair of compartments joined by an edge, and allocates
+	//! the work arrays for the implicit step
+	//! The values start at zero and are filled by update_implicit_matrix
+
+	// Variables
+	int n = circ_no_of_compartments;
+
+	bool* joined;
+
+	int counter;
+	int from;
+	int to;
+
+	// Code
+	joined = (bool*)malloc(n * n * sizeof(bool));
+
+	for (int i = 0; i < (n * n); i++)
+		joined[i] = false;
+
+	for (int i = 0; i < n; i++)
+		joined[(i * n) + i] = true;
+
+	for (int e = 0; e < circ_no_of_edges; e++)
+	{
+		joined[(circ_edge_from[e] * n) + circ_edge_to[e]] = true;
+		joined[(circ_edge_to[e] * n) + circ_edge_from[e]] = true;
+	}
+
+	circ_csr_nnz = 0;
+	for (int i = 0; i < (n * n); i++)
+	{
+		if (joined[i])
+			circ_csr_nnz = circ_csr_nnz + 1;
+	}
+
+	circ_csr_row_start = (int*)malloc((n + 1) * sizeof(int));
+	circ_csr_diag = (int*)malloc(n * sizeof(int));
+	circ_csr_col = (int*)malloc(circ_csr_nnz * sizeof(int));
+	circ_csr_value = (double*)malloc(circ_csr_nnz * sizeof(double));
+
+	counter = 0;
+	for (int i = 0; i < n; i++)
+	{
+		circ_csr_row_start[i] = counter;
+		for (int j = 0; j < n; j++)
+		{
+			if (joined[(i * n) + j])
+			{
+				if (i == j)
+					circ_csr_diag[i] = counter;
+
+				circ_csr_col[counter] = j;
+				circ_csr_value[counter] = 0.0;
+				counter = counter + 1;
+			}
+		}
+	}
+	circ_csr_row_start[n] = counter;
+
+	free(joined);
+
+	// Note where each edge sits in the matrix
+	circ_edge_csr_index = (int*)malloc(4 * circ_no_of_edges * sizeof(int));
+	circ_edge_conductance = (double*)malloc(circ_no_of_edges * sizeof(double));
+
+	for (int e = 0; e < circ_no_of_edges; e++)
+	{
+		from = circ_edge_from[e];
+		to = circ_edge_to[e];
+
+		for (int k = circ_csr_row_start[from]; k < circ_csr_row_start[from + 1]; k++)
+		{
+			if (circ_csr_col[k] == from)
+				circ_edge_csr_index[(4 * e)] = k;
+			if (circ_csr_col[k] == to)
+				circ_edge_csr_index[(4 * e) + 2] = k;
+		}
+
+		for (int k = circ_csr_row_start[to]; k < circ_csr_row_start[to + 1]; k++)
+		{
+			if (circ_csr_col[k] == to)
+				circ_edge_csr_index[(4 * e) + 1] = k;
+			if (circ_csr_col[k] == from)
+				circ_edge_csr_index[(4 * e) + 3] = k;
+		}
+
+		circ_edge_conductance[e] = 0.0;
+	}
+
+	// Work arrays
+	circ_imp_diag = (double*)malloc(n * sizeof(double));
+	circ_imp_rhs = (double*)malloc(n * sizeof(double));
+	circ_imp_p = (double*)malloc(n * sizeof(double));
+	circ_imp_r = (double*)malloc(n * sizeof(double));
+	circ_imp_z = (double*)malloc(n * sizeof(double));
+	circ_imp_d = (double*)malloc(n * sizeof(double));
+	circ_imp_q = (double*)malloc(n * sizeof(double));
+
+	cout << "Circulation sparse matrix: " << n << " compartments, " <<
+		circ_no_of_edges << " edges, " << circ_csr_nnz << " entries\n";
+}
+
+void circulation::update_implicit_matrix(double time_step_s)
+{
+	//! Function updates the entries of the conductance matrix for edges
+	//! whose conductance has changed since the last step, for example
+	//! because a valve moved or a reflex or perturbation changed a
+	//! resistance
+	//! An edge with inertance L has conductance 1 / (R + L / dt) in the
+	//! backward Euler step
+
+	// Variables
+	double conductance;
+	double delta;
+
+	// Code
+	for (int e = 0; e < circ_no_of_edges; e++)
+	{
+		conductance = 1.0 / (circ_resistance[e] + (circ_inertance[e] / time_step_s));
+
+		if (p_edge_valve[e] != NULL)
+			conductance = fabs(p_edge_valve[e]->valve_pos) * conductance;
+
+		if (conductance == circ_edge_conductance[e])
+			continue;
+
+		delta = conductance - circ_edge_conductance[e];
+
+		circ_csr_value[circ_edge_csr_index[(4 * e)]] += delta;
+		circ_csr_value[circ_edge_csr_index[(4 * e) + 1]] += delta;
+		circ_csr_value[circ_edge_csr_index[(4 * e) + 2]] -= delta;
+		circ_csr_value[circ_edge_csr_index[(4 * e) + 3]] -= delta;
+
+		circ_edge_conductance[e] = conductance;
+
+		circ_imp_n_edge_updates = circ_imp_n_edge_updates + 1;
+	}
+}
+
+void circulation::implicit_multiply(const double x[], double y[])
+{
+	//! Function sets y = (diag + conductance matrix) * x
+
+	// Variables
+	double holder;
+
+	// Code
+	for (int i = 0; i < circ_no_of_compartments; i++)
+	{
+		holder = circ_imp_diag[i] * x[i];
+
+		for (int k = circ_csr_row_start[i]; k < circ_csr_row_start[i + 1]; k++)
+		{
+			holder = holder + (circ_csr_value[k] * x[circ_csr_col[k]]);
+		}
+
+		y[i] = holder;
+	}
+}
+
+void circulation::implicit_volume_step(double time_step_s)
+{
+	//! Function advances the compartment volumes and the flows through
+	//! inertances with a backward Euler step
+	//! The new flow through edge e is
+	//!		Q = a * Q_old + g * (p_from - p_to)
+	//! with g = valve_pos / (R + L / dt) and a = g * L / dt, so the new
+	//! pressures solve
+	//!		(C / dt + G) p = (C / dt) p_old + net inflow of a * Q_old
+	//! where G is the sparse conductance matrix. The ventricle is
+	//! linearized about its pressure at the start of the step, so its
+	//! compliance is 1 / elastance. The matrix is symmetric and positive
+	//! definite, and is solved by conjugate gradients with a Jacobi
+	//! preconditioner. The volumes then follow from the new flows, which
+	//! conserves blood volume exactly
+	//! circ_pressure must hold the pressures at the start of the step
+
+	// Variables
+	int n = circ_no_of_compartments;
+	int max_iterations = (2 * n) + 20;
+
+	double elastance;
+	double carry;
+	double flow;
+
+	double rhs_norm;
+	double r_norm;
+	double rz;
+	double rz_new;
+	double dq;
+	double alpha;
+	double beta;
+
+	// Code
+
+	// Bring the matrix up to date
+	update_implicit_matrix(time_step_s);
+
+	elastance = GSL_MAX(return_vent_elastance(), circ_imp_min_elastance);
+
+	// Diagonal and right hand side
+	circ_imp_diag[0] = 1.0 / (elastance * time_step_s);
+	for (int i = 1; i < n; i++)
+	{
+		circ_imp_diag[i] = circ_compliance[i] / time_step_s;
+	}
+
+	for (int i = 0; i < n; i++)
+	{
+		circ_imp_rhs[i] = circ_imp_diag[i] * circ_pressure[i];
+		circ_imp_p[i] = circ_pressure[i];
+	}
+
+	for (int e = 0; e < circ_no_of_edges; e++)
+	{
+		if (circ_inertance[e] > 0.0)
+		{
+			carry = circ_edge_conductance[e] * (circ_inertance[e] / time_step_s) *
+				circ_flow[e];
+
+			circ_imp_rhs[circ_edge_to[e]] += carry;
+			circ_imp_rhs[circ_edge_from[e]] -= carry;
+		}
+	}
+
+	// Conjugate gradients, starting from the old pressures
+	implicit_multiply(circ_imp_p, circ_imp_q);
+
+	rhs_norm = 0.0;
+	rz = 0.0;
+	for (int i = 0; i < n; i++)
+	{
+		circ_imp_r[i] = circ_imp_rhs[i] - circ_imp_q[i];
+		circ_imp_z[i] = circ_imp_r[i] /
+			(circ_imp_diag[i] + circ_csr_value[circ_csr_diag[i]]);
+		circ_imp_d[i] = circ_imp_z[i];
+
+		rhs_norm = rhs_norm + (circ_imp_rhs[i] * circ_imp_rhs[i]);
+		rz = rz + (circ_imp_r[i] * circ_imp_z[i]);
+	}
+	rhs_norm = sqrt(rhs_norm);
+
+	for (int iter = 0; iter < max_iterations; iter++)
+	{
+		r_norm = 0.0;
+		for (int i = 0; i < n; i++)
+			r_norm = r_norm + (circ_imp_r[i] * circ_imp_r[i]);
+
+		if (sqrt(r_norm) <= (circ_imp_tolerance * rhs_norm))
+			break;
+
+		circ_imp_n_iterations = circ_imp_n_iterations + 1;
+
+		implicit_multiply(circ_imp_d, circ_imp_q);
+
+		dq = 0.0;
+		for (int i = 0; i < n; i++)
+			dq = dq + (circ_imp_d[i] * circ_imp_q[i]);
+
+		alpha = rz / dq;
+
+		rz_new = 0.0;
+		for (int i = 0; i < n; i++)
+		{
+			circ_imp_p[i] = circ_imp_p[i] + (alpha * circ_imp_d[i]);
+			circ_imp_r[i] = circ_imp_r[i] - (alpha * circ_imp_q[i]);
+			circ_imp_z[i] = circ_imp_r[i] / (circ_imp_diag[i] + circ_csr_value[circ_csr_diag[i]]);
+			rz_new = rz_new + (circ_imp_r[i] * circ_imp_z[i]);
+		}
+
+		beta = rz_new / rz;
+		rz = rz_new;
+
+		for (int i = 0; i < n; i++)
+			circ_imp_d[i] = circ_imp_z[i] + (beta * circ_imp_d[i]);
+	}
+
+	// New flows, which set the new volumes
+	for (int e = 0; e < circ_no_of_edges; e++)
+	{
+		flow = circ_edge_conductance[e] *
+			(circ_imp_p[circ_edge_from[e]] - circ_imp_p[circ_edge_to[e]]);
+
+		if (circ_inertance[e] > 0.0)
+		{
+			flow = flow + (circ_edge_conductance[e] * (circ_inertance[e] / time_step_s) *
+				circ_flow[e]);
+			circ_flow[e] = flow;
+		}
+
+		circ_volume[circ_edge_from[e]] -= time_step_s * flow;
+		circ_volume[circ_edge_to[e]] += time_step_s * flow;
+	}
 }
 
 void circulation::update_beat_metrics(void)
@@ -397,29 +1195,23 @@ void circulation::update_beat_metrics(void)
 	//! Update beat metrics in daughter objects
 
 	// Variables
-	stats_structure* p_stats;
-	stats_structure* p_stats_2;
+	stats_structure stats;
 
 	// Code
-	
-	p_stats = new stats_structure;
-	p_stats_2 = new stats_structure;
-
 
 	if (p_cmv_results_beat->pressure_arteries_field_index >= 0)
 	{
 		p_cmv_results_beat->calculate_sub_vector_statistics(
 			p_cmv_results_beat->gsl_results_vectors[p_cmv_results_beat->pressure_arteries_field_index],
 			0, p_parent_cmv_system->beat_t_index,
-			p_stats);
+			&stats);
 
-		cout << "Arterial pressure: " << p_stats->max_value << " / " << p_stats->min_value << "\n";
+		circ_pressure_arteries_max = stats.max_value;
+		circ_pressure_arteries_min = stats.min_value;
+
+		cout << "Arterial pressure: " << stats.max_value << " / " << stats.min_value << "\n";
 	}
 
 	p_hemi_vent->update_beat_metrics();
-
-	// Tidy up
-	delete p_stats;
-	delete p_stats_2;
 }
 
@@ -12,6 +12,8 @@
 
 #include "global_definitions.h"
 
+#include "gsl_odeiv2.h"
+
 // Forward declararations
 class cmv_system;
 class cmv_model;
@@ -65,12 +67,43 @@ public:
 	double circ_blood_volume;							/**< double holding total blood volume
 																in liters */
 
+	double circ_pressure_arteries_max;					/**< double holding the maximum
+																arterial pressure in the
+																last beat in mmHg */
+
+	double circ_pressure_arteries_min;					/**< double holding the minimum
+																arterial pressure in the
+																last beat in mmHg */
+
 	int circ_no_of_compartments;						/**< integer holding number of
 																compartments */
 
+	int circ_no_of_edges;								/**< integer holding number of
+																edges between compartments */
+
+	int* circ_edge_from;								/**< Pointer to array of integers
+																holding the upstream
+																compartment of each edge */
+
+	int* circ_edge_to;									/**< Pointer to array of integers
+																holding the downstream
+																compartment of each edge */
+
+	valve** p_edge_valve;								/**< Pointer to array of pointers
+																to the valve on each edge,
+																NULL if there is not one */
+
+	int circ_av_edge;									/**< integer with the index of the
+																edge holding the aortic
+																valve */
+
+	int circ_mv_edge;									/**< integer with the index of the
+																edge holding the mitral
+																valve */
+
 	double* circ_resistance;							/**< Pointer to array of doubles
 																holding resistances for
-																each compartment */
+																each edge */
 
 	double* circ_compliance;							/**< Pointer to array of doubles
 																holding compliances for
@@ -82,7 +115,8 @@ public:
 
 	double* circ_inertance;								/**< Pointer to array of doubles
 																holding inertances for
-																each compartment */
+																each edge, 0 for a
+																resistive edge */
 
 	double* circ_pressure;								/**< Pointer to array of doubles
 																holding pressure in each
@@ -93,8 +127,10 @@ public:
 																compartment */
 
 	double* circ_flow;									/**< Pointer to array of doubles
-																holding flows between
-																compartments */
+																holding the flow through
+																each edge, a state variable
+																for edges with an
+																inertance */
 
 	double* circ_last_flow;								/**< Pointer to array of doubles
 																holding flows between
@@ -105,15 +141,167 @@ public:
 	double circ_total_slack_volume;						/**< double holding total slack
 																volume in liters */
 
+	double* circ_vol_calc;								/**< Pointer to array of doubles
+																used as the working copy
+																of circ_volume during a
+																time-step */
+
+	double* circ_flow_calc;								/**< Pointer to array of doubles
+																used as scratch space for
+																flows in circ_vol_derivs */
+
+	gsl_odeiv2_system circ_ode_system;					/**< gsl_odeiv2_system wrapping
+																circ_vol_derivs */
+
+	gsl_odeiv2_driver* p_circ_ode_driver;				/**< Pointer to a gsl_odeiv2_driver
+																created in
+																initialise_simulation and
+																reset every time-step */
+
+	bool circ_exponential;								/**< bool, true if the vascular
+																compartments are advanced
+																with the exponential
+																propagator */
+
+	int circ_exp_size;									/**< integer with the size of the
+																propagator, the vascular
+																compartments plus 3 input
+																states */
+
+	double* circ_exp_propagator;						/**< Pointer to array of doubles
+																holding exp(dt * A) for the
+																vascular compartments,
+																row-major */
+
+	double* circ_exp_key;								/**< Pointer to array of doubles
+																holding the resistances,
+																compliances, slack volumes,
+																valve positions and
+																time-step the propagator
+																was built for */
+
+	bool circ_exp_valid;								/**< bool, true once the propagator
+																has been built */
+
+	double circ_elastance_dV;							/**< double with the fractional
+																change in chamber volume
+																used to estimate the
+																ventricular elastance */
+
+	long long circ_exp_n_rebuilds;						/**< counter for rebuilds of the
+																propagator */
+
+	bool circ_report_counters;							/**< true if the solver counters
+																are printed by the
+																destructor */
+
+	bool circ_implicit;									/**< bool, true if the compartments
+																are advanced with the
+																implicit sparse solver */
+
+	int circ_csr_nnz;									/**< integer with the number of
+																entries in the sparse
+																matrix */
+
+	int* circ_csr_row_start;							/**< Pointer to array of integers
+																holding the first entry of
+																each row of the sparse
+																matrix, compressed sparse
+																row format */
+
+	int* circ_csr_diag;									/**< Pointer to array of integers
+																holding the diagonal entry
+																of each row */
+
+	int* circ_csr_col;									/**< Pointer to array of integers
+																holding the column of each
+																entry */
+
+	double* circ_csr_value;								/**< Pointer to array of doubles
+																holding the conductance
+																matrix, the graph Laplacian
+																of the edges */
+
+	int* circ_edge_csr_index;							/**< Pointer to array of integers
+																holding, for each edge, the
+																entries for (from, from),
+																(to, to), (from, to) and
+																(to, from) */
+
+	double* circ_edge_conductance;						/**< Pointer to array of doubles
+																holding the conductance of
+																each edge that is in the
+																sparse matrix */
+
+	double* circ_imp_diag;								/**< Pointer to array of doubles
+																holding compliance / dt for
+																each compartment */
+
+	double* circ_imp_rhs;								/**< Pointer to array of doubles
+																holding the right hand side
+																of the implicit step */
+
+	double* circ_imp_p;									/**< Pointer to array of doubles
+																holding the new pressures */
+
+	double* circ_imp_r;									/**< Pointer to array of doubles
+																used as the residual by the
+																conjugate gradient solver */
+
+	double* circ_imp_z;									/**< Pointer to array of doubles
+																used as the preconditioned
+																residual */
+
+	double* circ_imp_d;									/**< Pointer to array of doubles
+																used as the search
+																direction */
+
+	double* circ_imp_q;									/**< Pointer to array of doubles
+																used for matrix-vector
+																products */
+
+	double circ_imp_tolerance;							/**< double with the relative
+																tolerance for the
+																conjugate gradient solver */
+
+	double circ_imp_min_elastance;						/**< double with the smallest
+																ventricular elastance in
+																mmHg per liter used by the
+																implicit step */
+
+	long long circ_imp_n_iterations;					/**< counter for conjugate gradient
+																iterations */
+
+	long long circ_imp_n_edge_updates;					/**< counter for edges updated in
+																the sparse matrix */
+
 	// Functions
 
 	void initialise_simulation(void);
 
 	bool implement_time_step(double time_step_s);
 
+	void update_after_volume_step(void);
+
 	void calculate_pressures(const double v[], double p[]);
 
 	void calculate_flows(const double v[], double flow[]);
 
+	void exponential_volume_step(double time_step_s);
+
+	bool exponential_propagator_is_current(double time_step_s);
+
+	void build_exponential_propagator(double time_step_s);
+
+	double return_vent_elastance(void);
+
+	void build_implicit_matrix(void);
+
+	void update_implicit_matrix(double time_step_s);
+
+	void implicit_multiply(const double x[], double y[]);
+
+	void implicit_volume_step(double time_step_s);
+
 	void update_beat_metrics(void);
 };
\ No newline at end of file
@@ -66,11 +66,14 @@ cmv_model::cmv_model(string JSON_model_file_string)
 	// Set some known parameters
 	temperature_K = 315.0;
 
-	// Reserve space for compartment variables
-	circ_resistance = (double*)malloc(MAX_NO_OF_COMPARTMENTS * sizeof(double));
+	// Reserve space for compartment and edge variables
 	circ_compliance = (double*)malloc(MAX_NO_OF_COMPARTMENTS * sizeof(double));
 	circ_slack_volume = (double*)malloc(MAX_NO_OF_COMPARTMENTS * sizeof(double));
-	circ_inertance = (double*)malloc(MAX_NO_OF_COMPARTMENTS * sizeof(double));
+	circ_resistance = (double*)malloc(MAX_NO_OF_CIRCULATION_EDGES * sizeof(double));
+	circ_inertance = (double*)malloc(MAX_NO_OF_CIRCULATION_EDGES * sizeof(double));
+	circ_edge_from = (int*)malloc(MAX_NO_OF_CIRCULATION_EDGES * sizeof(int));
+	circ_edge_to = (int*)malloc(MAX_NO_OF_CIRCULATION_EDGES * sizeof(int));
+	circ_no_of_edges = 0;
 
 	// Create pointers
 	p_av = new cmv_model_valve_structure;
@@ -122,6 +125,8 @@ cmv_model::~cmv_model(void)
 	free(circ_compliance);
 	free(circ_slack_volume);
 	free(circ_inertance);
+	free(circ_edge_from);
+	free(circ_edge_to);
 }
 
 // Other functions
@@ -166,20 +171,18 @@ void cmv_model::initialise_model_from_JSON_file(string JSON_model_file_string)
 	const rapidjson::Value& comp = circ["compartments"];
 
 	// Pull arrays
-	JSON_functions::check_JSON_member_array(comp, "resistance");
-	const rapidjson::Value& r_array = comp["resistance"];
+	JSON_functions::check_JSON_member_array(comp, "compliance");
+	const rapidjson::Value& c_array = comp["compliance"];
 
-	circ_no_of_compartments = (int)r_array.Size();
+	circ_no_of_compartments = (int)c_array.Size();
 	cout << "circ_no_of_compartments: " << circ_no_of_compartments << "\n";
 
-	for (rapidjson::SizeType i = 0; i < r_array.Size(); i++)
+	if (circ_no_of_compartments > MAX_NO_OF_COMPARTMENTS)
 	{
-		circ_resistance[i] = r_array[i].GetDouble();
+		cout << "Error: more than MAX_NO_OF_COMPARTMENTS compartments\n";
+		exit(1);
 	}
 
-	JSON_functions::check_JSON_member_array(comp, "compliance");
-	const rapidjson::Value& c_array = comp["compliance"];
-
 	for (rapidjson::SizeType i = 0; i < c_array.Size(); i++)
 	{
 		circ_compliance[i] = c_array[i].GetDouble();
@@ -193,14 +196,88 @@ void cmv_model::initialise_model_from_JSON_file(string JSON_model_file_string)
 		circ_slack_volume[i] = sv_array[i].GetDouble();
 	}
 
-	JSON_functions::check_JSON_member_array(comp, "inertance");
-	const rapidjson::Value& in_array = comp["inertance"];
+	// The compartments are joined by edges. If these are not listed, the
+	// compartments form the original single loop
+	// [0] - [1] - [2] - [3] - .... [n-1] - [0]
+	// where compartment 0 is the ventricle, edge i runs into compartment i
+	// with resistance i, edge 0 holds the mitral valve and edge 1 the
+	// aortic valve. The loop is resistive, so its inertance array is not
+	// needed
+	if (JSON_functions::check_JSON_member_exists(circ, "edges"))
+	{
+		JSON_functions::check_JSON_member_array(circ, "edges");
+		const rapidjson::Value& edges = circ["edges"];
+
+		circ_no_of_edges = (int)edges.Size();
 
-	for (rapidjson::SizeType i = 0; i < sv_array.Size(); i++)
+		if (circ_no_of_edges > MAX_NO_OF_CIRCULATION_EDGES)
+		{
+			cout << "Error: more than MAX_NO_OF_CIRCULATION_EDGES edges\n";
+			exit(1);
+		}
+
+		// The edges hold the resistances and inertances, so arrays left in
+		// the compartments from the single loop would be ignored
+		const char* loop_arrays[] = { "resistance", "inertance" };
+
+		for (int j = 0; j < 2; j++)
+		{
+			if (JSON_functions::check_JSON_member_exists(comp, loop_arrays[j]))
+			{
+				cout << "Error: circulation has edges, so compartments " << loop_arrays[j] <<
+					" would be ignored. Set the " << loop_arrays[j] << " of each edge instead\n";
+				exit(1);
+			}
+		}
+
+		for (rapidjson::SizeType i = 0; i < edges.Size(); i++)
+		{
+			JSON_functions::check_JSON_member_int(edges[i], "from");
+			circ_edge_from[i] = edges[i]["from"].GetInt();
+
+			JSON_functions::check_JSON_member_int(edges[i], "to");
+			circ_edge_to[i] = edges[i]["to"].GetInt();
+
+			JSON_functions::check_JSON_member_number(edges[i], "resistance");
+			circ_resistance[i] = edges[i]["resistance"].GetDouble();
+
+			circ_inertance[i] = 0.0;
+			if (JSON_functions::check_JSON_member_exists(edges[i], "inertance"))
+			{
+				JSON_functions::check_JSON_member_number(edges[i], "inertance");
+				circ_inertance[i] = edges[i]["inertance"].GetDouble();
+			}
+
+			circ_edge_valve[i] = "";
+			if (JSON_functions::check_JSON_member_exists(edges[i], "valve"))
+			{
+				JSON_functions::check_JSON_member_string(edges[i], "valve");
+				circ_edge_valve[i] = edges[i]["valve"].GetString();
+			}
+		}
+	}
+	else
 	{
-		circ_inertance[i] = in_array[i].GetDouble();
+		JSON_functions::check_JSON_member_array(comp, "resistance");
+		const rapidjson::Value& r_array = comp["resistance"];
+
+		circ_no_of_edges = circ_no_of_compartments;
+
+		for (int i = 0; i < circ_no_of_edges; i++)
+		{
+			circ_edge_from[i] = (i == 0) ? (circ_no_of_compartments - 1) : (i - 1);
+			circ_edge_to[i] = i;
+			circ_resistance[i] = r_array[i].GetDouble();
+			circ_inertance[i] = 0.0;
+			circ_edge_valve[i] = "";
+		}
+
+		circ_edge_valve[0] = "mitral";
+		circ_edge_valve[1] = "aortic";
 	}
 
+	cout << "circ_no_of_edges: " << circ_no_of_edges << "\n";
+
 	// Load the ventricle object
 	JSON_functions::check_JSON_member_object(doc, "ventricle");
 	const rapidjson::Value& vent = doc["ventricle"];
@@ -52,8 +52,23 @@ public:
 
 	double circ_blood_volume;			/**< double holding total blood volume */
 
+	int circ_no_of_edges;				/**< integer holding number of edges
+												between compartments */
+
+	int* circ_edge_from;				/**< pointer to array of integers with
+												the upstream compartment of
+												each edge */
+
+	int* circ_edge_to;					/**< pointer to array of integers with
+												the downstream compartment of
+												each edge */
+
+	string circ_edge_valve[MAX_NO_OF_CIRCULATION_EDGES];
+										/**< strings with the valve on each
+												edge, aortic, mitral, or empty */
+
 	double* circ_resistance;			/**< pointer to array of doubles with
-												resistances to individual compartments */
+												the resistance of each edge */
 
 	double* circ_compliance;			/**< pointer to array of doubles with
 												compliance of individual compartments */
@@ -62,7 +77,7 @@ public:
 												slack volume of individual compartments */
 
 	double* circ_inertance;				/**< pointer to array of doubles holding
-												inertances of individual compartments */
+												the inertance of each edge */
 
 	// Baroreflex
 	double baro_P_set;					/**< double with baroreflex set point in mmHg */
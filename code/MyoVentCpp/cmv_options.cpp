@@ -83,6 +83,54 @@ void cmv_options::initialise_options_from_JSON_file(string options_file_string)
 	JSON_functions::check_JSON_member_number(myo, "max_rate");
 	max_rate = myo["max_rate"].GetDouble();
 
+	// Check for active bin windows, defaulting to off
+	if (JSON_functions::check_JSON_member_exists(myo, "active_bin_threshold"))
+	{
+		JSON_functions::check_JSON_member_number(myo, "active_bin_threshold");
+		active_bin_threshold = myo["active_bin_threshold"].GetDouble();
+	}
+	else
+	{
+		active_bin_threshold = 0.0;
+	}
+
+	// Check for the bin grid, defaulting to uniform
+	bin_grid_type = "uniform";
+	bin_fine_min = bin_min;
+	bin_fine_max = bin_max;
+	bin_coarse_width = bin_width;
+
+	if (JSON_functions::check_JSON_member_exists(myo, "bin_grid"))
+	{
+		const rapidjson::Value& bg = myo["bin_grid"];
+
+		JSON_functions::check_JSON_member_string(bg, "type");
+		bin_grid_type = bg["type"].GetString();
+
+		if (bin_grid_type == "non_uniform")
+		{
+			JSON_functions::check_JSON_member_number(bg, "fine_min");
+			bin_fine_min = bg["fine_min"].GetDouble();
+
+			JSON_functions::check_JSON_member_number(bg, "fine_max");
+			bin_fine_max = bg["fine_max"].GetDouble();
+
+			JSON_functions::check_JSON_member_number(bg, "coarse_bin_width");
+			bin_coarse_width = bg["coarse_bin_width"].GetDouble();
+		}
+	}
+
+	// Check for the stepper, defaulting to rkf45
+	if (JSON_functions::check_JSON_member_exists(myo, "ode_stepper"))
+	{
+		JSON_functions::check_JSON_member_string(myo, "ode_stepper");
+		myof_ode_stepper = myo["ode_stepper"].GetString();
+	}
+	else
+	{
+		myof_ode_stepper = "rkf45";
+	}
+
 	// Check for rates dump
 	if (JSON_functions::check_JSON_member_exists(myo, "rates_dump"))
 	{
@@ -106,7 +154,14 @@ void cmv_options::initialise_options_from_JSON_file(string options_file_string)
 		rates_dump_file_string = "";
 	}
 
-	// Check for cb dump
+	// Check for cb dump, where the default is a frame every time-step
+	cb_dump_time_step_s = 0.0;
+	cb_dump_no_of_windows = 0;
+	cb_dump_no_of_beat_phases = 0;
+	cb_dump_buffer_frames = 256;
+	cb_dump_codec = "none";
+	cb_dump_chunk_frames = 256;
+
 	if (JSON_functions::check_JSON_member_exists(myo, "cb_dump"))
 	{
 		const rapidjson::Value& cd = myo["cb_dump"];
@@ -122,6 +177,91 @@ void cmv_options::initialise_options_from_JSON_file(string options_file_string)
 
 		JSON_functions::check_JSON_member_string(cd, "file_string");
 		cb_dump_file_string = cd["file_string"].GetString();
+
+		if (JSON_functions::check_JSON_member_exists(cd, "time_step_s"))
+		{
+			JSON_functions::check_JSON_member_number(cd, "time_step_s");
+			cb_dump_time_step_s = cd["time_step_s"].GetDouble();
+		}
+
+		// Windows, as [start_s, stop_s] pairs
+		if (JSON_functions::check_JSON_member_exists(cd, "windows_s"))
+		{
+			JSON_functions::check_JSON_member_array(cd, "windows_s");
+			const rapidjson::Value& w_array = cd["windows_s"];
+
+			if ((int)w_array.Size() > MAX_NO_OF_CB_DUMP_WINDOWS)
+			{
+				cout << "Error: more than MAX_NO_OF_CB_DUMP_WINDOWS cb dump windows\n";
+				exit(1);
+			}
+
+			for (rapidjson::SizeType i = 0; i < w_array.Size(); i++)
+			{
+				if ((!w_array[i].IsArray()) || (w_array[i].Size() != 2) ||
+					(!w_array[i][0].IsNumber()) || (!w_array[i][1].IsNumber()))
+				{
+					cout << "Error: each cb_dump windows_s entry must be [start_s, stop_s]\n";
+					exit(1);
+				}
+
+				cb_dump_start_s[i] = w_array[i][0].GetDouble();
+				cb_dump_stop_s[i] = w_array[i][1].GetDouble();
+
+				if ((cb_dump_stop_s[i] < cb_dump_start_s[i]) ||
+					((i > 0) && (cb_dump_start_s[i] <= cb_dump_stop_s[i - 1])))
+				{
+					cout << "Error: cb_dump windows_s must be in order and must not overlap\n";
+					exit(1);
+				}
+			}
+
+			cb_dump_no_of_windows = (int)w_array.Size();
+		}
+
+		// Beat phases, which replace the time stride
+		if (JSON_functions::check_JSON_member_exists(cd, "beat_phases"))
+		{
+			JSON_functions::check_JSON_member_array(cd, "beat_phases");
+			const rapidjson::Value& p_array = cd["beat_phases"];
+
+			if ((int)p_array.Size() > MAX_NO_OF_CB_DUMP_PHASES)
+			{
+				cout << "Error: more than MAX_NO_OF_CB_DUMP_PHASES cb dump beat phases\n";
+				exit(1);
+			}
+
+			for (rapidjson::SizeType i = 0; i < p_array.Size(); i++)
+			{
+				if (!p_array[i].IsString())
+				{
+					cout << "Error: cb_dump beat_phases must be strings\n";
+					exit(1);
+				}
+
+				cb_dump_beat_phases[i] = p_array[i].GetString();
+			}
+
+			cb_dump_no_of_beat_phases = (int)p_array.Size();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(cd, "buffer_frames"))
+		{
+			JSON_functions::check_JSON_member_int(cd, "buffer_frames");
+			cb_dump_buffer_frames = cd["buffer_frames"].GetInt();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(cd, "codec"))
+		{
+			JSON_functions::check_JSON_member_string(cd, "codec");
+			cb_dump_codec = cd["codec"].GetString();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(cd, "chunk_frames"))
+		{
+			JSON_functions::check_JSON_member_int(cd, "chunk_frames");
+			cb_dump_chunk_frames = cd["chunk_frames"].GetInt();
+		}
 	}
 	else
 	{
@@ -136,6 +276,39 @@ void cmv_options::initialise_options_from_JSON_file(string options_file_string)
 	JSON_functions::check_JSON_member_string(hv, "thick_wall_approximation");
 	hv_thick_wall_approximation = hv["thick_wall_approximation"].GetString();
 
+	// Check for the circulation integrator, defaulting to rkf45
+	circ_integrator = "rkf45";
+
+	if (JSON_functions::check_JSON_member_exists(doc, "circulation"))
+	{
+		const rapidjson::Value& circ = doc["circulation"];
+
+		if (JSON_functions::check_JSON_member_exists(circ, "integrator"))
+		{
+			JSON_functions::check_JSON_member_string(circ, "integrator");
+			circ_integrator = circ["integrator"].GetString();
+		}
+	}
+
+	// Results are written as text unless binary is requested
+	results_output_format = "text";
+	results_binary_precision = "double";
+	results_binary_codec = "none";
+	results_binary_chunk_points = 4096;
+	results_stream_buffer_points = 4096;
+	results_live_file = "";
+	results_no_of_field_patterns = 0;
+	summary_time_step_s = 0.0;
+	summary_skip_points = -1;
+	summary_relative_tolerance = 0.0;
+	summary_absolute_tolerance = 0.0;
+	results_no_of_full_rate_windows = 0;
+	results_per_beat_output = "";
+	results_phase_average_beats = 0;
+	results_phase_average_step_beats = 0;
+	results_phase_average_bins = 100;
+	results_phase_average_only = "";
+
 	if (JSON_functions::check_JSON_member_exists(doc, "results"))
 	{
 		const rapidjson::Value& res = doc["results"];
@@ -143,7 +316,351 @@ void cmv_options::initialise_options_from_JSON_file(string options_file_string)
 		JSON_functions::check_JSON_member_number(res, "beat_length_s");
 		beat_length_s = res["beat_length_s"].GetDouble();
 
-		JSON_functions::check_JSON_member_number(res, "summary_time_step_s");
-		summary_time_step_s = res["summary_time_step_s"].GetDouble();
+		if (JSON_functions::check_JSON_member_exists(res, "summary_time_step_s"))
+		{
+			JSON_functions::check_JSON_member_number(res, "summary_time_step_s");
+			summary_time_step_s = res["summary_time_step_s"].GetDouble();
+		}
+
+		// Summary points that linear interpolation between the points
+		// that are kept reproduces within the tolerance are dropped
+		if (JSON_functions::check_JSON_member_exists(res, "summary_relative_tolerance"))
+		{
+			JSON_functions::check_JSON_member_number(res, "summary_relative_tolerance");
+			summary_relative_tolerance = res["summary_relative_tolerance"].GetDouble();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(res, "summary_absolute_tolerance"))
+		{
+			JSON_functions::check_JSON_member_number(res, "summary_absolute_tolerance");
+			summary_absolute_tolerance = res["summary_absolute_tolerance"].GetDouble();
+		}
+
+		// Windows, as [start_s, stop_s] pairs, where every time-step is
+		// written to a second file
+		if (JSON_functions::check_JSON_member_exists(res, "full_rate_windows_s"))
+		{
+			JSON_functions::check_JSON_member_array(res, "full_rate_windows_s");
+			const rapidjson::Value& w_array = res["full_rate_windows_s"];
+
+			if ((int)w_array.Size() > MAX_NO_OF_FULL_RATE_WINDOWS)
+			{
+				cout << "Error: more than MAX_NO_OF_FULL_RATE_WINDOWS full-rate windows\n";
+				exit(1);
+			}
+
+			for (rapidjson::SizeType i = 0; i < w_array.Size(); i++)
+			{
+				if ((!w_array[i].IsArray()) || (w_array[i].Size() != 2) ||
+					(!w_array[i][0].IsNumber()) || (!w_array[i][1].IsNumber()))
+				{
+					cout << "Error: each full_rate_windows_s entry must be [start_s, stop_s]\n";
+					exit(1);
+				}
+
+				results_full_rate_start_s[i] = w_array[i][0].GetDouble();
+				results_full_rate_stop_s[i] = w_array[i][1].GetDouble();
+
+				if ((results_full_rate_stop_s[i] < results_full_rate_start_s[i]) ||
+					((i > 0) && (results_full_rate_start_s[i] <= results_full_rate_stop_s[i - 1])))
+				{
+					cout << "Error: full_rate_windows_s must be in order and must not overlap\n";
+					exit(1);
+				}
+			}
+
+			results_no_of_full_rate_windows = (int)w_array.Size();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(res, "per_beat_output"))
+		{
+			JSON_functions::check_JSON_member_string(res, "per_beat_output");
+			results_per_beat_output = res["per_beat_output"].GetString();
+		}
+
+		// The last phase_average_beats beats averaged by phase, written
+		// every phase_average_step_beats beats
+		if (JSON_functions::check_JSON_member_exists(res, "phase_average_beats"))
+		{
+			JSON_functions::check_JSON_member_int(res, "phase_average_beats");
+			results_phase_average_beats = res["phase_average_beats"].GetInt();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(res, "phase_average_step_beats"))
+		{
+			JSON_functions::check_JSON_member_int(res, "phase_average_step_beats");
+			results_phase_average_step_beats = res["phase_average_step_beats"].GetInt();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(res, "phase_average_bins"))
+		{
+			JSON_functions::check_JSON_member_int(res, "phase_average_bins");
+			results_phase_average_bins = res["phase_average_bins"].GetInt();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(res, "phase_average_only"))
+		{
+			JSON_functions::check_JSON_member_string(res, "phase_average_only");
+			results_phase_average_only = res["phase_average_only"].GetString();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(res, "output_format"))
+		{
+			JSON_functions::check_JSON_member_string(res, "output_format");
+			results_output_format = res["output_format"].GetString();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(res, "binary_precision"))
+		{
+			JSON_functions::check_JSON_member_string(res, "binary_precision");
+			results_binary_precision = res["binary_precision"].GetString();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(res, "binary_codec"))
+		{
+			JSON_functions::check_JSON_member_string(res, "binary_codec");
+			results_binary_codec = res["binary_codec"].GetString();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(res, "binary_chunk_points"))
+		{
+			JSON_functions::check_JSON_member_int(res, "binary_chunk_points");
+			results_binary_chunk_points = res["binary_chunk_points"].GetInt();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(res, "stream_buffer_points"))
+		{
+			JSON_functions::check_JSON_member_int(res, "stream_buffer_points");
+			results_stream_buffer_points = res["stream_buffer_points"].GetInt();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(res, "live_file"))
+		{
+			JSON_functions::check_JSON_member_string(res, "live_file");
+			results_live_file = res["live_file"].GetString();
+		}
+
+		// Patterns selecting the fields that are written, all if there
+		// are none
+		if (JSON_functions::check_JSON_member_exists(res, "fields"))
+		{
+			JSON_functions::check_JSON_member_array(res, "fields");
+			const rapidjson::Value& f_array = res["fields"];
+
+			if ((int)f_array.Size() > MAX_NO_OF_RESULT_FIELD_PATTERNS)
+			{
+				cout << "Error: more than MAX_NO_OF_RESULT_FIELD_PATTERNS results fields patterns\n";
+				exit(1);
+			}
+
+			for (rapidjson::SizeType i = 0; i < f_array.Size(); i++)
+			{
+				if (!f_array[i].IsString())
+				{
+					cout << "Error: results fields must be strings\n";
+					exit(1);
+				}
+
+				results_field_patterns[i] = f_array[i].GetString();
+			}
+
+			results_no_of_field_patterns = (int)f_array.Size();
+		}
+	}
+
+	// Older options files set the decimation as the number of time-steps
+	// skipped between summary points
+	if (JSON_functions::check_JSON_member_exists(doc, "output"))
+	{
+		const rapidjson::Value& out = doc["output"];
+
+		if (JSON_functions::check_JSON_member_exists(out, "skip_points"))
+		{
+			JSON_functions::check_JSON_member_int(out, "skip_points");
+			summary_skip_points = out["skip_points"].GetInt();
+
+			if (summary_skip_points < 0)
+			{
+				cout << "Error: output skip_points must not be negative\n";
+				exit(1);
+			}
+		}
+	}
+
+	if ((results_output_format != "text") && (results_output_format != "binary"))
+	{
+		cout << "Error: results output_format " << results_output_format <<
+			" not recognized, use text or binary\n";
+		exit(1);
+	}
+
+	if ((results_binary_precision != "double") && (results_binary_precision != "float"))
+	{
+		cout << "Error: results binary_precision " << results_binary_precision <<
+			" not recognized, use double or float\n";
+		exit(1);
+	}
+
+	if ((results_binary_codec != "none") && (results_binary_codec != "lossless"))
+	{
+		cout << "Error: results binary_codec " << results_binary_codec <<
+			" not recognized, use none or lossless\n";
+		exit(1);
+	}
+
+	if ((summary_relative_tolerance < 0.0) || (summary_absolute_tolerance < 0.0))
+	{
+		cout << "Error: results summary tolerances must not be negative\n";
+		exit(1);
+	}
+
+	summary_adaptive = ((summary_relative_tolerance > 0.0) || (summary_absolute_tolerance > 0.0));
+
+	if (results_phase_average_beats < 0)
+	{
+		cout << "Error: results phase_average_beats must not be negative\n";
+		exit(1);
+	}
+
+	if (results_phase_average_step_beats == 0)
+		results_phase_average_step_beats = results_phase_average_beats;
+
+	if ((results_phase_average_beats > 0) &&
+		((results_phase_average_step_beats < 1) || (results_phase_average_bins < 1)))
+	{
+		cout << "Error: results phase_average_step_beats and phase_average_bins must be at least 1\n";
+		exit(1);
+	}
+
+	if ((results_phase_average_only == "True") && (results_phase_average_beats == 0))
+	{
+		cout << "Error: results phase_average_only needs phase_average_beats\n";
+		exit(1);
+	}
+
+	if ((results_phase_average_only == "True") && (results_live_file != ""))
+	{
+		cout << "Error: results live_file publishes the summary, which phase_average_only leaves out\n";
+		exit(1);
+	}
+
+	if (results_binary_chunk_points < 1)
+	{
+		cout << "Error: results binary_chunk_points must be at least 1\n";
+		exit(1);
+	}
+
+	if (results_stream_buffer_points < 1)
+	{
+		cout << "Error: results stream_buffer_points must be at least 1\n";
+		exit(1);
+	}
+
+	if (cb_dump_buffer_frames < 1)
+	{
+		cout << "Error: cb_dump buffer_frames must be at least 1\n";
+		exit(1);
+	}
+
+	if ((cb_dump_codec != "none") && (cb_dump_codec != "lossless"))
+	{
+		cout << "Error: cb_dump codec " << cb_dump_codec <<
+			" not recognized, use none or lossless\n";
+		exit(1);
+	}
+
+	if (cb_dump_chunk_frames < 1)
+	{
+		cout << "Error: cb_dump chunk_frames must be at least 1\n";
+		exit(1);
+	}
+
+	// Check for the coupled integrator, defaulting to the split scheme
+	coupled_integration = "";
+	coupled_ode_stepper = "rkf45";
+	coupled_eps_abs = 1e-6;
+	coupled_eps_rel = 1e-6;
+
+	if (JSON_functions::check_JSON_member_exists(doc, "coupled_integrator"))
+	{
+		const rapidjson::Value& ci = doc["coupled_integrator"];
+
+		JSON_functions::check_JSON_member_string(ci, "active");
+		coupled_integration = ci["active"].GetString();
+
+		if (JSON_functions::check_JSON_member_exists(ci, "ode_stepper"))
+		{
+			JSON_functions::check_JSON_member_string(ci, "ode_stepper");
+			coupled_ode_stepper = ci["ode_stepper"].GetString();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(ci, "eps_abs"))
+		{
+			JSON_functions::check_JSON_member_number(ci, "eps_abs");
+			coupled_eps_abs = ci["eps_abs"].GetDouble();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(ci, "eps_rel"))
+		{
+			JSON_functions::check_JSON_member_number(ci, "eps_rel");
+			coupled_eps_rel = ci["eps_rel"].GetDouble();
+		}
+	}
+
+	// Check for the update schedule of the slow modules, defaulting to
+	// every time-step
+	string sched_modules[3] = { "baroreflex", "growth", "mitochondria" };
+	string* p_sched_cadence[3] = { &baro_update_cadence, &growth_update_cadence,
+		&mito_update_cadence };
+	int* p_sched_n_steps[3] = { &baro_update_n_steps, &growth_update_n_steps,
+		&mito_update_n_steps };
+
+	for (int i = 0; i < 3; i++)
+	{
+		*p_sched_cadence[i] = "every_step";
+		*p_sched_n_steps[i] = 1;
+	}
+
+	if (JSON_functions::check_JSON_member_exists(doc, "update_schedule"))
+	{
+		const rapidjson::Value& us = doc["update_schedule"];
+
+		for (int i = 0; i < 3; i++)
+		{
+			if (!JSON_functions::check_JSON_member_exists(us, sched_modules[i].c_str()))
+				continue;
+
+			const rapidjson::Value& mod = us[sched_modules[i].c_str()];
+
+			JSON_functions::check_JSON_member_string(mod, "cadence");
+			*p_sched_cadence[i] = mod["cadence"].GetString();
+
+			if (*p_sched_cadence[i] == "every_n_steps")
+			{
+				JSON_functions::check_JSON_member_int(mod, "n_steps");
+				*p_sched_n_steps[i] = mod["n_steps"].GetInt();
+			}
+		}
+	}
+
+	// Check for diagnostics
+	check_allocations = "";
+	report_counters = "";
+
+	if (JSON_functions::check_JSON_member_exists(doc, "diagnostics"))
+	{
+		const rapidjson::Value& diag = doc["diagnostics"];
+
+		if (JSON_functions::check_JSON_member_exists(diag, "check_allocations"))
+		{
+			JSON_functions::check_JSON_member_string(diag, "check_allocations");
+			check_allocations = diag["check_allocations"].GetString();
+		}
+
+		if (JSON_functions::check_JSON_member_exists(diag, "report_counters"))
+		{
+			JSON_functions::check_JSON_member_string(diag, "report_counters");
+			report_counters = diag["report_counters"].GetString();
+		}
 	}
 }
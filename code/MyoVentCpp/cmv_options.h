@@ -10,6 +10,8 @@
 #include <iostream>
 #include <string>
 
+#include "global_definitions.h"
+
 // Definitions for JSON parsing
 #ifndef _RAPIDJSON_DOCUMENT
 #define _RAPIDJSON_DOCUMENT
@@ -46,6 +48,84 @@ public:
 	double max_rate;						/**< double with maximum rate for a
 													cross-bridge rate in s^-1 */
 
+	double active_bin_threshold;			/**< double with the population below
+													which bins are dropped from the
+													active window of an attached
+													state, also the smallest share
+													of an attachment that keeps a
+													bin active, 0 (default) keeps
+													every bin active */
+
+	string bin_grid_type;					/**< string defining the bin grid,
+													uniform (default) or non_uniform,
+													which uses bin_width between
+													bin_fine_min and bin_fine_max
+													and bin_coarse_width outside */
+
+	double bin_fine_min;					/**< double with the start of the fine
+													region of a non_uniform grid */
+
+	double bin_fine_max;					/**< double with the end of the fine
+													region of a non_uniform grid */
+
+	double bin_coarse_width;				/**< double with the width of the bins
+													outside the fine region of a
+													non_uniform grid */
+
+	string myof_ode_stepper;				/**< string defining the GSL stepper
+													used for the myofilaments
+													rkf45 (default), rk8pd, bsimp,
+													msbdf, auto, which switches
+													from rkf45 to bsimp when
+													steps are being rejected, or
+													exponential, which uses an
+													operator-split exact step
+													for the myosin populations */
+
+	string coupled_integration;				/**< string defining whether the
+													modules share one solver
+													If True, the valves, membranes,
+													myofilaments, compartment
+													volumes and baroreflex are
+													integrated as one system */
+
+	string coupled_ode_stepper;				/**< string defining the GSL stepper
+													for the coupled system, rkf45
+													(default), rk8pd, bsimp or
+													msbdf */
+
+	double coupled_eps_abs;					/**< double with the absolute error
+													tolerance for the coupled
+													system */
+
+	double coupled_eps_rel;					/**< double with the relative error
+													tolerance for the coupled
+													system */
+
+	string baro_update_cadence;				/**< string defining how often the
+													baroreflex is updated,
+													every_step (default),
+													every_n_steps or every_beat */
+
+	int baro_update_n_steps;				/**< int with the time-steps between
+													baroreflex updates for
+													every_n_steps */
+
+	string growth_update_cadence;			/**< string defining how often growth
+													is updated, as above */
+
+	int growth_update_n_steps;				/**< int with the time-steps between
+													growth updates for
+													every_n_steps */
+
+	string mito_update_cadence;				/**< string defining how often the
+													mitochondria are updated, as
+													above */
+
+	int mito_update_n_steps;				/**< int with the time-steps between
+													mitochondria updates for
+													every_n_steps */
+
 	string rates_dump_relative_to;			/**< string defining path type
 													for rates_dump file */
 
@@ -56,10 +136,60 @@ public:
 
 	string cb_dump_file_string;				/**< string with cb dump file */
 
+	double cb_dump_time_step_s;				/**< double defining the time in s
+													between cb dump frames, which
+													is rounded to a whole number
+													of time-steps, 0 for every
+													time-step */
+
+	double cb_dump_start_s[MAX_NO_OF_CB_DUMP_WINDOWS];
+											/**< array of doubles with the start
+													of each window in which cb
+													distributions are dumped */
+
+	double cb_dump_stop_s[MAX_NO_OF_CB_DUMP_WINDOWS];
+											/**< array of doubles with the end
+													of each cb dump window */
+
+	int cb_dump_no_of_windows;				/**< int defining the number of cb
+													dump windows, 0 for the whole
+													simulation */
+
+	string cb_dump_beat_phases[MAX_NO_OF_CB_DUMP_PHASES];
+											/**< array of strings with the beat
+													phases at which cb
+													distributions are dumped
+													instead of every time step,
+													end_diastole, peak_systole
+													or end_systole */
+
+	int cb_dump_no_of_beat_phases;			/**< int defining the number of beat
+													phases */
+
+	int cb_dump_buffer_frames;				/**< int defining the number of
+													frames that can wait to be
+													written */
+
+	string cb_dump_codec;					/**< string defining how the frames
+													are stored, none (default)
+													or lossless, which packs
+													chunks of frames with the
+													time_series_codec */
+
+	int cb_dump_chunk_frames;				/**< int defining the number of
+													frames in each chunk when
+													a codec is used */
+
 	string hv_thick_wall_approximation;		/**< string defining thick wall approximation
 													If True, use thick-wall approximation
 													otherwise, use thin-wall */
 
+	string circ_integrator;					/**< string defining how the compartment
+													volumes are integrated, rkf45
+													(default) or exponential, which
+													uses a cached propagator for
+													the vascular compartments */
+
 	double beat_length_s;					/**< double defining the length in s
 													of a cmv_results object
 													for a beat */
@@ -70,13 +200,125 @@ public:
 
 	double summary_time_step_s;				/**< double defining the time-step
 													in seconds between points in
-													the summary output */
+													the summary output, which
+													is rounded to a whole number
+													of simulation time-steps */
+
+	int summary_skip_points;				/**< int defining the number of
+													time-steps skipped between
+													summary points, -1 if it was
+													not set */
+
+	int summary_stride;						/**< int defining the number of
+													time-steps between summary
+													points, set by cmv_system */
+
+	double summary_relative_tolerance;		/**< double defining the error, as a
+													fraction of the largest
+													magnitude of each field so
+													far, allowed when summary
+													points are dropped, 0 to
+													keep every point */
+
+	double summary_absolute_tolerance;		/**< double defining the smallest
+													error allowed when summary
+													points are dropped */
+
+	bool summary_adaptive;					/**< true if either tolerance is set,
+													so that summary points are
+													dropped */
+
+	double results_full_rate_start_s[MAX_NO_OF_FULL_RATE_WINDOWS];
+											/**< array of doubles with the start
+													of each window in which every
+													time-step is written */
+
+	double results_full_rate_stop_s[MAX_NO_OF_FULL_RATE_WINDOWS];
+											/**< array of doubles with the end
+													of each full-rate window */
+
+	int results_no_of_full_rate_windows;	/**< int defining the number of
+													full-rate windows */
+
+	string results_per_beat_output;			/**< string defining whether the
+													first time-point of each beat
+													is written to a third file
+													If True, it is */
+
+	int results_phase_average_beats;		/**< int defining the number of beats
+													averaged by phase for a
+													fourth file, 0 for none */
+
+	int results_phase_average_step_beats;	/**< int defining the number of beats
+													between phase averages, which
+													is the number of beats
+													averaged unless it is set */
+
+	int results_phase_average_bins;			/**< int defining the number of phase
+													bins in a beat */
+
+	string results_phase_average_only;		/**< string defining whether the
+													summary is left out when
+													there are phase averages
+													If True, it is */
 
 	int summary_points;						/**< int defining the number of
 													time-points in the
 													cmv_results object for the
 													summary output */
 
+	string results_output_format;			/**< string defining how the summary
+													is written, text (default)
+													or binary */
+
+	string results_binary_precision;		/**< string defining whether binary
+													values are written as double
+													(default) or float */
+
+	string results_binary_codec;			/**< string defining how the chunks
+													of a binary file are stored,
+													none (default) or lossless,
+													which packs each field with
+													the time_series_codec */
+
+	int results_binary_chunk_points;		/**< int defining the number of
+													time-points in each chunk of
+													a binary results file */
+
+	int results_stream_buffer_points;		/**< int defining the number of
+													summary time-points that can
+													wait to be written, which
+													bounds the memory used for
+													the summary */
+
+	string results_live_file;				/**< string with the name of a
+													memory-mapped file the
+													summary is published to as
+													the simulation runs, none
+													if empty */
+
+	string results_field_patterns[MAX_NO_OF_RESULT_FIELD_PATTERNS];
+											/**< array of glob patterns, such as
+													pressure_* or !memb_J_*,
+													selecting the fields that
+													are recorded and written */
+
+	int results_no_of_field_patterns;		/**< int defining the number of
+													results field patterns, all
+													fields are written if 0 */
+
+	string check_allocations;				/**< string defining whether the
+													simulation loop is checked
+													for heap allocations
+													If True, the run fails if
+													memory is allocated after
+													initialisation */
+
+	string report_counters;					/**< string defining whether the
+													objects print how often
+													their fast paths were taken
+													when they are deleted */
+
 	/**
 	/* Function initialises protocol object from file
 	*/
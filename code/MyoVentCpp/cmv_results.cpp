@@ -5,17 +5,18 @@
 */
 
 #include <stdio.h>
+#include <string.h>
 #include <iostream>
-#include <filesystem>
 #include <string>
 
 #include "cmv_results.h"
 #include "cmv_system.h"
 #include "cmv_options.h"
 #include "cmv_model.h"
+#include "cmv_protocol.h"
 
 #include "circulation.h"
-#include "baroreflex.h"
+#include "results_writer.h"
 #include "hemi_vent.h"
 #include "half_sarcomere.h"
 #include "myofilaments.h"
@@ -25,7 +26,6 @@
 #include "gsl_const_mksa.h"
 
 using namespace std;
-using namespace std::filesystem;
 
 struct stats_structure {
 	double mean_value;
@@ -34,7 +34,6 @@ struct stats_structure {
 	double sum;
 };
 
-
 // Constructor
 cmv_results::cmv_results(cmv_system* set_p_parent_cmv_system, int set_no_of_time_points)
 {
@@ -47,13 +46,20 @@ cmv_results::cmv_results(cmv_system* set_p_parent_cmv_system, int set_no_of_time
 	p_cmv_options = p_parent_cmv_system->p_cmv_options;
 
 	no_of_defined_results_fields = 0;
+	no_of_output_fields = 0;
 
 	no_of_time_points = set_no_of_time_points;
 
 	no_of_beats = 0;
 
+	// The slab is allocated once the fields are known
+	results_slab = NULL;
+	results_row_stride = 0;
+	no_of_slab_grows = 0;
+
 	time_field_index = -1;
 	new_beat_field_index = -1;
+	t_index_field_index = -1;
 	pressure_vent_field_index = -1;
 	pressure_veins_field_index = -1;
 	volume_vent_field_index = -1;
@@ -61,14 +67,9 @@ cmv_results::cmv_results(cmv_system* set_p_parent_cmv_system, int set_no_of_time
 	flow_aortic_valve_field_index = -1;
 	hs_length_field_index = -1;
 	myof_stress_int_pas_field_index = -1;
+	myof_mean_stress_int_pas_field_index = -1;
 	myof_ATP_flux_field_index = -1;
-	vent_stroke_work_field_index = -1;
-	vent_stroke_energy_used_field_index = -1;
-	vent_efficiency_field_index = -1;
-	vent_ejection_fraction_field_index = -1;
 	vent_ATP_used_per_s_field_index = -1;
-	vent_stroke_volume_field_index = -1;
-	vent_cardiac_output_field_index = -1;
 
 	// Special case
 	pressure_arteries_field_index = -1;
@@ -79,168 +80,418 @@ cmv_results::~cmv_results(void)
 {
 	// Code
 
-	// Delete all of the defined vectors
-	for (int i = 0; i < no_of_defined_results_fields; i++)
+	if (no_of_slab_grows > 0)
 	{
-		gsl_vector_free(gsl_results_vectors[i]);
+		cout << "Results slab was enlarged " << no_of_slab_grows << " time(s) to " <<
+			no_of_time_points << " time-points\n";
 	}
+
+	// Delete the slab, the views point into it
+	if (results_slab != NULL)
+		_aligned_free(results_slab);
 }
 
 // Other functions
 
-void cmv_results::add_results_field(std::string field_name, double* p_double)
+int cmv_results::add_results_field(std::string field_name, double* p_double,
+	std::string field_units)
 {
-	//! Functions adds a field to the results object
+	//! Functions adds a field to the results object and returns its index
+	//! Objects that need a specific field later keep the index, rather
+	//! than the field being found from its name
 
 	// Variables
 	int new_index;			// index of new field
 
-	bool index_set;
-
 	// Code
 
+	if (results_slab != NULL)
+	{
+		cout << "Error: results field " << field_name << " added after the results were allocated\n";
+		exit(1);
+	}
+
+	if (no_of_defined_results_fields >= MAX_NO_OF_RESULT_FIELDS)
+	{
+		cout << "Error: too many results fields, MAX_NO_OF_RESULT_FIELDS is " <<
+			MAX_NO_OF_RESULT_FIELDS << "\n";
+		exit(1);
+	}
+
 	// Get the number of fields that have been defined already
 	new_index = no_of_defined_results_fields;
 
 	// Update the results_fields and the data source
 	results_fields[new_index] = field_name;
+	results_units[new_index] = field_units;
 	p_data_sources[new_index] = p_double;
 
-	// Create a gsl_vector to hold the data and initialise to NaN
-	gsl_results_vectors[new_index] = gsl_vector_alloc(no_of_time_points);
-	gsl_vector_set_all(gsl_results_vectors[new_index], GSL_NAN);
+	// Update the number of defined fields
+	no_of_defined_results_fields = no_of_defined_results_fields + 1;
 
-	// Check for specific indices
+	// Fields are written unless select_results_fields drops them
+	output_field_indices[no_of_output_fields] = new_index;
+	no_of_output_fields = no_of_output_fields + 1;
 
-	index_set = false;
+	return new_index;
+}
 
-	if (field_name == "time")
-	{
-		time_field_index = new_index;
-		index_set = true;
-	}
+// Returns true if text matches a glob pattern where * matches any run of
+// characters and ? matches one
+static bool glob_match(const char* p_pattern, const char* p_text)
+{
+	const char* p_star = NULL;
+	const char* p_star_text = NULL;
 
-	if (field_name == "hr_new_beat")
+	while (*p_text != '\0')
 	{
-		new_beat_field_index = new_index;
-		index_set = true;
+		if ((*p_pattern == '?') || (*p_pattern == *p_text))
+		{
+			p_pattern++;
+			p_text++;
+		}
+		else if (*p_pattern == '*')
+		{
+			p_star = p_pattern++;
+			p_star_text = p_text;
+		}
+		else if (p_star != NULL)
+		{
+			// Let the last star match one more character
+			p_pattern = p_star + 1;
+			p_text = ++p_star_text;
+		}
+		else
+		{
+			return false;
+		}
 	}
 
-	if (field_name == "pressure_0")
-	{
-		pressure_vent_field_index = new_index;
-		index_set = true;
-	}
+	while (*p_pattern == '*')
+		p_pattern++;
 
-	if (field_name == "volume_0")
-	{
-		volume_vent_field_index = new_index;
-		index_set = true;
-	}
+	return (*p_pattern == '\0');
+}
+
+bool cmv_results::field_is_selected(std::string field_name)
+{
+	//! Function applies the results field patterns in order, so the last
+	//! one that matches decides. A pattern starting with ! excludes the
+	//! fields it matches. If the first pattern excludes, the fields start
+	//! as selected, so that a list of exclusions keeps everything else
+
+	// Variables
+	bool selected;
+	bool exclude;
+
+	const char* p_pattern;
+
+	// Code
+	if (p_cmv_options->results_no_of_field_patterns == 0)
+		return true;
 
-	string venous_pressure = "pressure_" +
-		to_string(p_parent_cmv_system->p_cmv_model->circ_no_of_compartments - 1);
-	if (field_name == venous_pressure)
+	selected = (p_cmv_options->results_field_patterns[0].c_str()[0] == '!');
+
+	for (int i = 0; i < p_cmv_options->results_no_of_field_patterns; i++)
 	{
-		pressure_veins_field_index = new_index;
-		index_set = true;
+		p_pattern = p_cmv_options->results_field_patterns[i].c_str();
+
+		exclude = (p_pattern[0] == '!');
+		if (exclude)
+			p_pattern++;
+
+		if (glob_match(p_pattern, field_name.c_str()))
+			selected = !exclude;
 	}
 
-	if (field_name == "flow_0")
+	return selected;
+}
+
+int cmv_results::list_field_index_members(int* p_indices[])
+{
+	//! Function fills p_indices with pointers to the indices of the fields
+	//! the model uses after they have been recorded, and returns how many
+
+	// Variables
+	int n = 0;
+
+	// Code
+	p_indices[n++] = &time_field_index;
+	p_indices[n++] = &new_beat_field_index;
+	p_indices[n++] = &t_index_field_index;
+	p_indices[n++] = &pressure_vent_field_index;
+	p_indices[n++] = &volume_vent_field_index;
+	p_indices[n++] = &pressure_arteries_field_index;
+	p_indices[n++] = &pressure_veins_field_index;
+	p_indices[n++] = &flow_mitral_valve_field_index;
+	p_indices[n++] = &flow_aortic_valve_field_index;
+	p_indices[n++] = &hs_length_field_index;
+	p_indices[n++] = &myof_stress_int_pas_field_index;
+	p_indices[n++] = &myof_mean_stress_int_pas_field_index;
+	p_indices[n++] = &myof_ATP_flux_field_index;
+	p_indices[n++] = &vent_ATP_used_per_s_field_index;
+
+	return n;
+}
+
+void cmv_results::select_results_fields(void)
+{
+	//! Function keeps the fields selected by the results field patterns
+	//! and the fields the model needs, such as time and the ventricular
+	//! pressure and volume for the beat metrics. The fields the model needs
+	//! are recorded but only written if they are selected. The rest are
+	//! removed, so they are not copied each time-step, stored or written
+	//! The kept fields move down to fill the gaps, and the indices of the
+	//! specific fields are updated to match
+
+	// Variables
+	int* p_indices[MAX_NO_OF_RESULT_FIELDS];
+	int no_of_indices;
+
+	bool selected[MAX_NO_OF_RESULT_FIELDS];
+	bool needed[MAX_NO_OF_RESULT_FIELDS];
+
+	int new_index[MAX_NO_OF_RESULT_FIELDS];
+	int no_of_kept_fields;
+	int no_of_fields_before;
+
+	int no_of_matches;
+
+	// Code
+	if (results_slab != NULL)
 	{
-		flow_mitral_valve_field_index = new_index;
-		index_set = true;
+		cout << "Error: results fields selected after the results were allocated\n";
+		exit(1);
 	}
 
-	if (field_name == "flow_1")
+	if (p_cmv_options->results_no_of_field_patterns == 0)
+		return;
+
+	no_of_fields_before = no_of_defined_results_fields;
+
+	no_of_indices = list_field_index_members(p_indices);
+
+	for (int i = 0; i < no_of_defined_results_fields; i++)
 	{
-		flow_aortic_valve_field_index = new_index;
-		index_set = true;
+		selected[i] = field_is_selected(results_fields[i]);
+		needed[i] = false;
 	}
 
-	if (field_name == "hs_length")
+	for (int k = 0; k < no_of_indices; k++)
 	{
-		hs_length_field_index = new_index;
-		index_set = true;
+		if (*p_indices[k] >= 0)
+			needed[*p_indices[k]] = true;
 	}
 
-	if (field_name == "myof_stress_int_pas")
+	// Warn about patterns that do nothing, as they are likely to be typos
+	for (int p = 0; p < p_cmv_options->results_no_of_field_patterns; p++)
 	{
-		myof_stress_int_pas_field_index = new_index;
-		index_set = true;
+		const char* p_pattern = p_cmv_options->results_field_patterns[p].c_str();
+		if (p_pattern[0] == '!')
+			p_pattern++;
+
+		no_of_matches = 0;
+		for (int i = 0; i < no_of_defined_results_fields; i++)
+		{
+			if (glob_match(p_pattern, results_fields[i].c_str()))
+				no_of_matches = no_of_matches + 1;
+		}
+
+		if (no_of_matches == 0)
+		{
+			cout << "Warning: results field pattern " <<
+				p_cmv_options->results_field_patterns[p] << " does not match any field\n";
+		}
 	}
 
-	if (field_name == "myof_ATP_flux")
+	// Compact the fields
+	no_of_kept_fields = 0;
+	no_of_output_fields = 0;
+
+	for (int i = 0; i < no_of_defined_results_fields; i++)
 	{
-		myof_ATP_flux_field_index = new_index;
-		index_set = true;
+		new_index[i] = -1;
+
+		if ((!selected[i]) && (!needed[i]))
+			continue;
+
+		new_index[i] = no_of_kept_fields;
+
+		results_fields[no_of_kept_fields] = results_fields[i];
+		results_units[no_of_kept_fields] = results_units[i];
+		p_data_sources[no_of_kept_fields] = p_data_sources[i];
+
+		if (selected[i])
+		{
+			output_field_indices[no_of_output_fields] = no_of_kept_fields;
+			no_of_output_fields = no_of_output_fields + 1;
+		}
+
+		no_of_kept_fields = no_of_kept_fields + 1;
 	}
 
-	if (field_name == "vent_stroke_work_J")
+	no_of_defined_results_fields = no_of_kept_fields;
+
+	for (int k = 0; k < no_of_indices; k++)
 	{
-		vent_stroke_work_field_index = new_index;
-		index_set = true;
+		if (*p_indices[k] >= 0)
+			*p_indices[k] = new_index[*p_indices[k]];
 	}
 
-	if (field_name == "vent_stroke_energy_used_J")
+	cout << "Results fields: writing " << no_of_output_fields << " of " <<
+		no_of_fields_before << ", recording " <<
+		(no_of_defined_results_fields - no_of_output_fields) <<
+		" more for the model\n";
+}
+
+int cmv_results::return_output_index(int field_index)
+{
+	//! Function returns the position of a field among the fields that
+	//! are written, or -1 if it is not written
+
+	// Code
+	if (field_index < 0)
+		return -1;
+
+	for (int k = 0; k < no_of_output_fields; k++)
 	{
-		vent_stroke_energy_used_field_index = new_index;
-		index_set = true;
+		if (output_field_indices[k] == field_index)
+			return k;
 	}
 
-	if (field_name == "vent_efficiency")
+	return -1;
+}
+
+void cmv_results::allocate_results_slab(void)
+{
+	//! Function allocates one block for all of the data
+	//! Each time-point is a row of fields so that recording a step writes
+	//! to consecutive addresses, and each field is seen as a column
+	//! through a strided gsl_vector_view
+
+	// Variables
+	int doubles_per_alignment = RESULTS_SLAB_ALIGNMENT / sizeof(double);
+
+	// Code
+
+	// Pad the rows so that each one starts on an aligned address
+	results_row_stride = doubles_per_alignment *
+		((no_of_defined_results_fields + doubles_per_alignment - 1) / doubles_per_alignment);
+
+	if (results_row_stride == 0)
+		results_row_stride = doubles_per_alignment;
+
+	results_slab = (double*)_aligned_malloc(
+		(size_t)no_of_time_points * results_row_stride * sizeof(double),
+		RESULTS_SLAB_ALIGNMENT);
+
+	if (results_slab == NULL)
 	{
-		vent_efficiency_field_index = new_index;
-		index_set = true;
+		cout << "Error: results slab for " << no_of_time_points << " time-points could not be allocated\n";
+		exit(1);
 	}
 
-	if (field_name == "vent_ejection_fraction")
+	for (size_t i = 0; i < ((size_t)no_of_time_points * results_row_stride); i++)
+		results_slab[i] = GSL_NAN;
+
+	// Set the views
+	for (int i = 0; i < no_of_defined_results_fields; i++)
 	{
-		vent_ejection_fraction_field_index = new_index;
-		index_set = true;
+		results_views[i] = gsl_vector_view_array_with_stride(&results_slab[i],
+			results_row_stride, no_of_time_points);
+
+		gsl_results_vectors[i] = &results_views[i].vector;
 	}
+}
+
+void cmv_results::grow_results_slab(int min_time_points)
+{
+	//! Function enlarges the slab, keeping the data, so that a beat
+	//! longer than beat_length_s does not run off the end
+
+	// Variables
+	int new_no_of_time_points;
+
+	double* new_slab;
+
+	// Code
+	new_no_of_time_points = GSL_MAX(min_time_points, 2 * no_of_time_points);
+
+	new_slab = (double*)_aligned_malloc(
+		(size_t)new_no_of_time_points * results_row_stride * sizeof(double),
+		RESULTS_SLAB_ALIGNMENT);
 
-	if (field_name == "vent_ATP_used_per_s")
+	if (new_slab == NULL)
 	{
-		vent_ATP_used_per_s_field_index = new_index;
-		index_set = true;
+		cout << "Error: results slab for " << new_no_of_time_points << " time-points could not be allocated\n";
+		exit(1);
 	}
 
-	if (field_name == "vent_stroke_volume")
+	memcpy(new_slab, results_slab, (size_t)no_of_time_points * results_row_stride * sizeof(double));
+
+	for (size_t i = ((size_t)no_of_time_points * results_row_stride);
+		i < ((size_t)new_no_of_time_points * results_row_stride); i++)
 	{
-		vent_stroke_volume_field_index = new_index;
-		index_set = true;
+		new_slab[i] = GSL_NAN;
 	}
 
-	if (field_name == "vent_cardiac_output")
+	_aligned_free(results_slab);
+
+	results_slab = new_slab;
+	no_of_time_points = new_no_of_time_points;
+	no_of_slab_grows = no_of_slab_grows + 1;
+
+	// The views have to follow the data
+	for (int i = 0; i < no_of_defined_results_fields; i++)
 	{
-		vent_cardiac_output_field_index = new_index;
-		index_set = true;
+		results_views[i] = gsl_vector_view_array_with_stride(&results_slab[i],
+			results_row_stride, no_of_time_points);
 	}
+}
+
+void cmv_results::copy_field_indices(cmv_results* p_source)
+{
+	//! Function copies the indices of the specific fields from an object
+	//! whose written fields were added to this one in the same order
+	//! A field that p_source records but does not write is -1 here
+
+	// Variables
+	int* p_indices[MAX_NO_OF_RESULT_FIELDS];
+	int* p_source_indices[MAX_NO_OF_RESULT_FIELDS];
+	int no_of_indices;
+
+	// Code
+	no_of_indices = list_field_index_members(p_indices);
+	p_source->list_field_index_members(p_source_indices);
 
-	if (p_parent_cmv_system->p_circulation->p_baroreflex != NULL)
+	for (int k = 0; k < no_of_indices; k++)
 	{
-		string b_string = "pressure_" +
-			to_string(p_parent_cmv_system->p_circulation->p_baroreflex->
-				baro_P_compartment);
-		if (field_name == b_string)
-		{
-			pressure_arteries_field_index = new_index;
-			index_set = true;
-		}
+		*p_indices[k] = p_source->return_output_index(*p_source_indices[k]);
 	}
+}
 
-	// Update the number of defined fields
-	no_of_defined_results_fields = no_of_defined_results_fields + 1;
+double* cmv_results::return_row(int t_index)
+{
+	//! Function returns a pointer to the fields for a time-point
+
+	return &results_slab[(size_t)t_index * results_row_stride];
 }
 
 void cmv_results::update_results_vectors(int t_index)
 {
-	// Cycle through the defined data fields
+	// Variables
+	double* p_row;
+
+	// Code
+	if (t_index >= no_of_time_points)
+		grow_results_slab(t_index + 1);
+
+	// Copy the sources in to the row
+	p_row = &results_slab[(size_t)t_index * results_row_stride];
 
 	for (int i = 0; i < no_of_defined_results_fields; i++)
 	{
-		gsl_vector_set(gsl_results_vectors[i], t_index, *p_data_sources[i]);
+		p_row[i] = *p_data_sources[i];
 	}
 }
 
@@ -279,66 +530,54 @@ int cmv_results::write_data_to_file(std::string output_file_string)
 {
 	//! Function writes data to file
 
-	// Variables
-	FILE* output_file;
+	// Code
+	write_rows_with_writer(output_file_string, "text");
+
+	return(1);
+}
+
+int cmv_results::write_binary_data_to_file(std::string output_file_string)
+{
+	//! Function writes data to an indexed binary file, with the layout
+	//! described in results_writer::write_binary_header
 
 	// Code
-	cout << "Writing simulation results to: " << output_file_string << " points \n";
+	write_rows_with_writer(output_file_string, "binary");
 
-	// Make sure results directory exists
-	path output_file_path(output_file_string);
+	return(1);
+}
 
-	if (!(is_directory(output_file_path.parent_path())))
-	{
-		if (create_directories(output_file_path.parent_path()))
-		{
-			cout << "\nCreating folder: " << output_file_path.string() << "\n";
-		}
-		else
-		{
-			cout << "\nError: Results folder could not be created: " <<
-				output_file_path.parent_path().string() << "\n";
-			exit(1);
-		}
-	}
+void cmv_results::write_rows_with_writer(std::string output_file_string, std::string format)
+{
+	//! Function passes every row to a results_writer
 
-	// Check file can be opened, abort if not
-	errno_t err = fopen_s(&output_file, output_file_string.c_str(), "w");
-	if (err != 0)
-	{
-		cout << "Results file: " << output_file_string << " could not be opened\n";
-		exit(1);
-	}
+	// Variables
+	results_writer* p_writer;
 
-	// Write header
-	for (int i = 0; i < no_of_defined_results_fields; i++)
-	{
-		fprintf_s(output_file, "%s", results_fields[i].c_str());
-		if (i == (no_of_defined_results_fields - 1))
-			fprintf_s(output_file, "\n");
-		else
-			fprintf_s(output_file, "\t");
-	}
+	// Code
+	// The rows are written at every time-step
+	p_writer = new results_writer(this, output_file_string, format,
+		p_parent_cmv_system->p_cmv_protocol->time_step_s,
+		GSL_MAX(1, GSL_MIN(no_of_time_points, p_cmv_options->results_stream_buffer_points)),
+		no_of_time_points);
 
-	// Now data
-	for (int i = 0; i < no_of_time_points; i = i + 1)
+	for (int i = 0; i < no_of_time_points; i++)
 	{
-		for (int j = 0; j < no_of_defined_results_fields; j++)
-		{
-			fprintf_s(output_file, "%g", gsl_vector_get(gsl_results_vectors[j], i));
-			if (j == (no_of_defined_results_fields - 1))
-				fprintf_s(output_file, "\n");
-			else
-				fprintf_s(output_file, "\t");
-		}
+		double* p_row = return_row(i);
+		double* p_writer_row = p_writer->reserve_row();
+
+		for (int k = 0; k < no_of_output_fields; k++)
+			p_writer_row[k] = p_row[output_field_indices[k]];
+
+		p_writer->commit_row();
 	}
 
-	cout << "Closing output_file: " << output_file_string << "\n";
+	p_writer->finish();
 
-	// Tidy up
-	fclose(output_file);
+	if (p_writer->rw_write_error)
+		exit(1);
 
-	return(1);
+	delete p_writer;
 }
 
 double cmv_results::return_stroke_work(int start_t_index, int stop_t_index)
@@ -412,17 +651,3 @@ double cmv_results::return_energy_used(int start_t_index, int stop_t_index)
 
 	return energy_used;
 }
-
-void cmv_results::backfill_beat_data(gsl_vector* gsl_v, double value, int start_t_index, int stop_t_index)
-{
-	//! Backfills data for a cardiac cycle
-	
-	// Variables
-
-	// Code
-
-	for (int i = start_t_index; i <= stop_t_index; i++)
-	{
-		gsl_vector_set(gsl_v, i, value);
-	}
-}
@@ -44,8 +44,29 @@ public:
 											/**< array of strings defining the
 													data fields in a results object */
 
+	std::string results_units[MAX_NO_OF_RESULT_FIELDS];
+											/**< array of strings with the units
+													of each field, empty if they
+													were not given */
+
+	double* results_slab;					/**< pointer to one aligned block
+													holding all of the data, with
+													a row of fields for each
+													time-point */
+
+	int results_row_stride;					/**< integer with the number of
+													doubles in a row, padded so
+													that each row is aligned */
+
+	gsl_vector_view results_views[MAX_NO_OF_RESULT_FIELDS];
+											/**< array of strided views, each
+													showing one field of the
+													slab as a column */
+
 	gsl_vector* gsl_results_vectors[MAX_NO_OF_RESULT_FIELDS];
-											/**< array of gsl_vectors holding data */
+											/**< array of pointers to the
+													column views, valid once the
+													slab is allocated */
 
 	int no_of_defined_results_fields;		/**< integer defining the number of
 													results fields that have been defined */
@@ -54,8 +75,22 @@ public:
 											/**< array of pointers to doubles  holding
 													the sources of the data */
 
+	int no_of_output_fields;				/**< integer defining the number of
+													fields that are written */
+
+	int output_field_indices[MAX_NO_OF_RESULT_FIELDS];
+											/**< array of integers with the index
+													of each field that is written,
+													the rest are only kept for the
+													model */
+
 	int no_of_time_points;					/**< integer defining the number of
-													time-points in a result file */
+													time-points in a result file,
+													which grows if a beat is
+													longer than expected */
+
+	int no_of_slab_grows;					/**< integer counting the times the
+													slab has been enlarged */
 
 	int no_of_beats;						/**< integer counting number of beats
 													written to record */
@@ -66,6 +101,11 @@ public:
 	int new_beat_field_index;				/**< integer holding the index for the
 													new_beat field */
 
+	int t_index_field_index;				/**< integer holding the index for the
+													simulation index, which is
+													only recorded when summary
+													points can be dropped */
+
 	int pressure_vent_field_index;			/**< integer holding the index for the
 													ventricular pressure */
 
@@ -97,38 +137,67 @@ public:
 	int myof_ATP_flux_field_index;			/**< integer holding the index for the
 													myofilament ATPase field */
 
-	int vent_stroke_work_field_index;		/**< integer holding the index for the
-													vent stroke work field */
-
-	int vent_stroke_energy_used_field_index;		/**< integer holding the index for the
-													vent energy used field */
-
-	int vent_efficiency_field_index;		/**< integer holding the index for the
-													vent efficiency field */
-
-	int vent_ejection_fraction_field_index;	/**< integer holding the index for the
-													vent ejection fraction field */
-
 	int vent_ATP_used_per_s_field_index;	/**< integer holding the index for the
 													vent ATP used per s field */
 
-	int vent_stroke_volume_field_index;		/**< integer holding the index for the
-													vent stroke volume field */
-
-	int vent_cardiac_output_field_index;	/**< integer holding the index for the
-													vent cardiac output volume field */
-
 	// Functions
 
-	void add_results_field(std::string field_name, double* p_double);
+	int add_results_field(std::string field_name, double* p_double,
+			std::string field_units = "");
 											/**< function adds a double to the results
-													object */
+													object and returns its index,
+													which is the handle for the
+													field */
+
+	void select_results_fields(void);		/**< function drops the fields that
+													the options do not select and
+													the model does not need */
+
+	bool field_is_selected(std::string field_name);
+											/**< function returns true if the
+													results field patterns select
+													field_name */
+
+	int list_field_index_members(int* p_indices[]);
+											/**< function fills p_indices with
+													pointers to the indices of the
+													specific fields and returns
+													how many there are */
+
+	int return_output_index(int field_index);
+											/**< function returns the position of
+													a field among the fields that
+													are written, or -1 */
+
+	void allocate_results_slab(void);		/**< function allocates the slab once
+													all of the fields are added */
+
+	void grow_results_slab(int min_time_points);
+											/**< function enlarges the slab to
+													hold at least min_time_points */
+
+	void copy_field_indices(cmv_results* p_source);
+											/**< function copies the indices of
+													specific fields from a results
+													object whose written fields
+													were cloned to this one */
+
+	double* return_row(int t_index);		/**< function returns a pointer to
+													the fields for a time-point */
 
 	void update_results_vectors(int t_index);
 
 	int write_data_to_file(string output_file_string);
 											/**< write data to file */
 
+	int write_binary_data_to_file(string output_file_string);
+											/**< write data to an indexed
+													binary file */
+
+	void write_rows_with_writer(string output_file_string, string format);
+											/**< write every row through a
+													results_writer */
+
 	//void calculate_beat_metrics(int t_beat_index);
 
 	void calculate_sub_vector_statistics(gsl_vector* gsl_v,
@@ -139,7 +208,4 @@ public:
 
 	double return_energy_used(int start_t_index, int stop_t_index);
 
-	void backfill_beat_data(gsl_vector* gsl_v, double value,
-		int start_t_index, int stop_t_index);
-
 };
\ No newline at end of file
@@ -6,12 +6,16 @@
 
 #include "stdio.h"
 
+#include <string.h>
 #include <iostream>
 #include <iomanip>
 #include <cmath>
+#include <filesystem>
 
 #include "cmv_system.h"
 #include "circulation.h"
+#include "coupled_system.h"
+#include "update_schedule.h"
 #include "hemi_vent.h"
 #include "half_sarcomere.h"
 #include "membranes.h"
@@ -21,8 +25,17 @@
 #include "cmv_results.h"
 #include "cmv_protocol.h"
 #include "cmv_model.h"
+#include "allocation_monitor.h"
+#include "results_writer.h"
+#include "live_results.h"
+#include "adaptive_summary.h"
+#include "phase_average.h"
+#include "cb_dump_writer.h"
+
+#include "gsl_math.h"
 
 using namespace std;
+using namespace std::filesystem;
 
 struct stats_structure {
 	double mean_value;
@@ -47,14 +60,33 @@ cmv_system::cmv_system(string JSON_model_file_string, int set_system_id)
 	p_cmv_options = NULL;
 	p_cmv_protocol = NULL;
 	p_cmv_results_beat = NULL;
+	p_cmv_results_beat_metrics = NULL;
 	p_cmv_results_summary = NULL;
+	p_coupled_system = NULL;
+	p_results_writer = NULL;
+	p_live_results = NULL;
+	p_adaptive_summary = NULL;
+	p_full_rate_writer = NULL;
+	p_per_beat_writer = NULL;
+	p_beat_metrics_writer = NULL;
+	p_phase_average = NULL;
+	p_baro_schedule = NULL;
+	p_growth_schedule = NULL;
+	p_mito_schedule = NULL;
 
 	// Initialise variables
 	cum_time_s = 0.0;
+	results_t_index = 0.0;
+	beat_start_s = 0.0;
+	beat_rr_interval_s = 0.0;
 
 	sim_t_index = 0;
 	beat_t_index = 0;
 	summary_t_index = 0;
+	beat_start_t_index = 0;
+
+	no_of_full_rate_windows = 0;
+	full_rate_window = 0;
 
 	// Create constituent objects
 	p_circulation = new circulation(this);
@@ -81,6 +113,9 @@ void cmv_system::run_simulation(string options_file_string,
 	// Variables
 	bool new_beat = false;
 
+	bool check_allocations = false;
+	int first_allocation_t_index = -1;
+
 	// Code
 	
 	// Initialises an options object
@@ -89,6 +124,14 @@ void cmv_system::run_simulation(string options_file_string,
 	// Initialise the protocol object
 	p_cmv_protocol = new cmv_protocol(this, protocol_file_string);
 
+	// Set how often the slow modules are updated
+	p_baro_schedule = new update_schedule("baroreflex",
+		p_cmv_options->baro_update_cadence, p_cmv_options->baro_update_n_steps);
+	p_growth_schedule = new update_schedule("growth",
+		p_cmv_options->growth_update_cadence, p_cmv_options->growth_update_n_steps);
+	p_mito_schedule = new update_schedule("mitochondria",
+		p_cmv_options->mito_update_cadence, p_cmv_options->mito_update_n_steps);
+
 	// Initialise the cmv_results_beat object
 	p_cmv_options->beat_length_points = int(p_cmv_options->beat_length_s /
 		p_cmv_protocol->time_step_s);
@@ -99,45 +142,107 @@ void cmv_system::run_simulation(string options_file_string,
 	// Add in the results
 	add_fields_to_cmv_results_beat();
 
+	// The beat metrics have one row per beat, which is written as the
+	// beat ends, so the object only defines the fields
+	p_cmv_results_beat_metrics = new cmv_results(this, 0);
+
+	add_fields_to_cmv_results_beat_metrics();
+
 	// Initialise the circulation and daughter objects
-	// This adds data to the cmv_results_beat object
+	// This adds data to the cmv_results_beat and cmv_results_beat_metrics
+	// objects
 	p_circulation->initialise_simulation();
 
-	// Now we have to prepare the cmv_results_summary object
-
-	// First deduce how many points it needs
-	p_cmv_options->summary_points = 0;
-	double sim_t = 0.0;
-	for (sim_t_index = 0; sim_t_index < p_cmv_protocol->no_of_time_steps; sim_t_index++)
+	// Optionally build one state vector for the modules so that they
+	// are integrated together
+	if (p_cmv_options->coupled_integration == "True")
 	{
-		if (sim_time_dumps_to_summary(sim_t))
-		{
-			p_cmv_options->summary_points = p_cmv_options->summary_points + 1;
-		}
-
-		sim_t = sim_t + p_cmv_protocol->time_step_s;
+		p_coupled_system = new coupled_system(this);
+		p_coupled_system->initialise_simulation();
 	}
 
+	// All of the fields have been added, so drop the ones that are not
+	// wanted and allocate the data
+	p_cmv_results_beat->select_results_fields();
+	p_cmv_results_beat->allocate_results_slab();
+
+	// Now we have to prepare the cmv_results_summary object
+
+	// The summary points are every summary_stride time-steps, so the
+	// number of them follows from the protocol
+	initialise_output_resolutions();
+
 	cout << "Summary points: " << p_cmv_options->summary_points << "\n";
 
 	// Now create it
 	p_cmv_results_summary = new cmv_results(this, p_cmv_options->summary_points);
 
-	cout << "Made: " << p_cmv_results_summary->no_of_time_points << "\n";
-
 	// Now make sure that the summary object has the same fields as the beat object
 	clone_results_fields(p_cmv_results_beat, p_cmv_results_summary);
 
+	// The summary only defines the fields, its rows are streamed to the
+	// file as each beat finishes, so its slab is never allocated
+	// If rows are dropped, they are not evenly spaced
+	if (p_cmv_options->results_phase_average_only != "True")
+	{
+		p_results_writer = new results_writer(p_cmv_results_summary, results_file_string,
+			p_cmv_options->results_output_format,
+			(p_cmv_options->summary_adaptive ? 0.0 : p_cmv_options->summary_time_step_s),
+			p_cmv_options->results_stream_buffer_points,
+			p_cmv_options->summary_points);
+	}
+
+	// The other resolutions have the same fields
+	open_output_resolution_writers(results_file_string);
+
+	// Optionally let other programs watch the summary as it grows
+	if (p_cmv_options->results_live_file != "")
+	{
+		p_live_results = new live_results(p_cmv_results_summary,
+			p_cmv_options->results_live_file, p_cmv_options->summary_points);
+	}
+
+	// Optionally drop the summary rows that the rows either side
+	// reproduce within a tolerance
+	if ((p_results_writer != NULL) && (p_cmv_options->summary_adaptive))
+	{
+		p_adaptive_summary = new adaptive_summary(p_results_writer, p_live_results,
+			p_cmv_results_summary->no_of_output_fields,
+			p_cmv_options->summary_relative_tolerance,
+			p_cmv_options->summary_absolute_tolerance);
+	}
+
+	// Ctrl-C stops the loop and the rows so far are written
+	results_writer::install_signal_handlers();
+
 	// Simulation
 
 	// Set counters
 	beat_t_index = 0;
 	summary_t_index = 0;
+	beat_start_t_index = 0;
+	full_rate_window = 0;
+
+	// Everything the loop needs has been allocated by now, so optionally
+	// count heap allocations until the loop finishes
+	if (p_cmv_options->check_allocations == "True")
+	{
+		check_allocations = true;
+		allocation_monitor::start();
+	}
 
 	for (sim_t_index = 0; sim_t_index < p_cmv_protocol->no_of_time_steps; sim_t_index++)
 	{
+		if (results_writer::stop_requested)
+		{
+			cout << "Simulation stopped by signal at " << cum_time_s << " s\n";
+			break;
+		}
+
 		new_beat = implement_time_step(p_cmv_protocol->time_step_s);
 
+		results_t_index = sim_t_index;
+
 		p_cmv_results_beat->update_results_vectors(beat_t_index);
 
 		if (new_beat)
@@ -145,25 +250,157 @@ void cmv_system::run_simulation(string options_file_string,
 			// Update beat metrics
 			update_beat_metrics();
 
+			write_beat_metrics();
+
 			// Update p_cmv_results_summary with beat data
 			update_cmv_results_summary();
 
+			if (p_phase_average != NULL)
+				p_phase_average->add_beat(p_cmv_results_beat, beat_t_index);
+
 			// Update the counters
 			beat_t_index = 0;
+			beat_start_t_index = sim_t_index + 1;
 		}
 		else
 		{
 			beat_t_index = beat_t_index + 1;
 		}
+
+		if ((check_allocations) && (first_allocation_t_index < 0) &&
+			(allocation_monitor::return_no_of_allocations() > 0))
+		{
+			first_allocation_t_index = sim_t_index;
+		}
 	}
 
-	// Now save data to file
-	p_cmv_results_summary->write_data_to_file(results_file_string);
+	if (check_allocations)
+	{
+		allocation_monitor::stop();
+
+		if (!allocation_monitor::counts_malloc())
+		{
+			cout << "Allocation check only counts C++ new in this build\n";
+		}
+
+		if (allocation_monitor::return_no_of_allocations() > 0)
+		{
+			cout << "Error: " << allocation_monitor::return_no_of_allocations() <<
+				" heap allocation(s) in the simulation loop, the first at time-step " <<
+				first_allocation_t_index << "\n";
+			exit(1);
+		}
+
+		cout << "Allocation check passed: no heap allocations in the simulation loop\n";
+	}
+
+	// The rows of a beat are written when the next one starts, so write
+	// the part of the last beat that was simulated, whether the run
+	// finished or was stopped by a signal. It is not a complete beat, so
+	// it has no beat metrics and is not phase averaged. The binary header
+	// and the live file count the rows that were written
+	update_cmv_results_summary();
+
+	// The last summary row is always kept
+	if (p_adaptive_summary != NULL)
+	{
+		p_adaptive_summary->finish();
+
+		if (p_live_results != NULL)
+			p_live_results->commit();
+
+		delete p_adaptive_summary;
+		p_adaptive_summary = NULL;
+	}
+
+	// Wait for the file to be completed
+	if (p_results_writer != NULL)
+	{
+		p_results_writer->finish();
+
+		if (p_results_writer->rw_write_error)
+			exit(1);
+
+		delete p_results_writer;
+		p_results_writer = NULL;
+	}
+
+	if (p_full_rate_writer != NULL)
+	{
+		p_full_rate_writer->finish();
+
+		if (p_full_rate_writer->rw_write_error)
+			exit(1);
+
+		delete p_full_rate_writer;
+		p_full_rate_writer = NULL;
+	}
+
+	if (p_per_beat_writer != NULL)
+	{
+		p_per_beat_writer->finish();
+
+		if (p_per_beat_writer->rw_write_error)
+			exit(1);
+
+		delete p_per_beat_writer;
+		p_per_beat_writer = NULL;
+	}
+
+	p_beat_metrics_writer->finish();
+
+	if (p_beat_metrics_writer->rw_write_error)
+		exit(1);
+
+	delete p_beat_metrics_writer;
+	p_beat_metrics_writer = NULL;
+
+	if (p_phase_average != NULL)
+	{
+		p_phase_average->finish();
+
+		if (p_phase_average->p_writer->rw_write_error)
+			exit(1);
+
+		delete p_phase_average;
+		p_phase_average = NULL;
+	}
+
+	if (p_circulation->p_hemi_vent->p_cb_dump_writer != NULL)
+	{
+		p_circulation->p_hemi_vent->p_cb_dump_writer->finish();
+
+		if (p_circulation->p_hemi_vent->p_cb_dump_writer->cbw_write_error)
+			exit(1);
+
+		delete p_circulation->p_hemi_vent->p_cb_dump_writer;
+		p_circulation->p_hemi_vent->p_cb_dump_writer = NULL;
+	}
+
+	if (p_live_results != NULL)
+	{
+		delete p_live_results;
+		p_live_results = NULL;
+	}
 
 	// Tidying up
+	if (p_coupled_system != NULL)
+	{
+		delete p_coupled_system;
+		p_coupled_system = NULL;
+	}
+
+	delete p_baro_schedule;
+	delete p_growth_schedule;
+	delete p_mito_schedule;
+	p_baro_schedule = NULL;
+	p_growth_schedule = NULL;
+	p_mito_schedule = NULL;
+
 	delete p_cmv_options;
 	delete p_cmv_protocol;
 	delete p_cmv_results_beat;
+	delete p_cmv_results_beat_metrics;
 	delete p_cmv_results_summary;
 }
 
@@ -171,18 +408,25 @@ void cmv_system::clone_results_fields(cmv_results* p_source, cmv_results* p_clon
 {
 	// Function ensures p_clone has same fields as p_source where
 	// p_clone and p_source are both cmv_results objects
+	// Only the fields p_source writes are cloned
 
 	// Variables
+	int f;
 
 	// Code
-	
+
 	// Reset the clone
 	p_clone->no_of_defined_results_fields = 0;
+	p_clone->no_of_output_fields = 0;
 
-	for (int i = 0; i < p_source->no_of_defined_results_fields; i++)
+	for (int i = 0; i < p_source->no_of_output_fields; i++)
 	{
-		p_clone->add_results_field(p_source->results_fields[i], NULL);
+		f = p_source->output_field_indices[i];
+		p_clone->add_results_field(p_source->results_fields[f], NULL,
+			p_source->results_units[f]);
 	}
+
+	p_clone->copy_field_indices(p_source);
 }
 
 void cmv_system::add_fields_to_cmv_results_beat(void)
@@ -194,7 +438,28 @@ void cmv_system::add_fields_to_cmv_results_beat(void)
 	// Initialize
 
 	// Now add the results fields
-	p_cmv_results_beat->add_results_field("time", &cum_time_s);
+	p_cmv_results_beat->time_field_index =
+		p_cmv_results_beat->add_results_field("time", &cum_time_s, "s");
+
+	// When summary rows are dropped, the simulation index of each row
+	// that is kept is written with it
+	if (p_cmv_options->summary_adaptive)
+	{
+		p_cmv_results_beat->t_index_field_index =
+			p_cmv_results_beat->add_results_field("t_index", &results_t_index);
+	}
+}
+
+void cmv_system::add_fields_to_cmv_results_beat_metrics(void)
+{
+	//! Function adds the system fields to the beat metrics
+	//! The start of the beat is the time field, so a binary file is
+	//! indexed by it
+
+	// Code
+	p_cmv_results_beat_metrics->time_field_index =
+		p_cmv_results_beat_metrics->add_results_field("beat_start_s", &beat_start_s, "s");
+	p_cmv_results_beat_metrics->add_results_field("beat_rr_interval_s", &beat_rr_interval_s, "s");
 }
 
 bool cmv_system::implement_time_step(double time_step_s)
@@ -208,7 +473,10 @@ bool cmv_system::implement_time_step(double time_step_s)
 	// Impose perturbations
 	p_cmv_protocol->impose_perturbations(cum_time_s);
 
-	new_beat = p_circulation->implement_time_step(time_step_s);
+	if (p_coupled_system != NULL)
+		new_beat = p_coupled_system->implement_time_step(time_step_s);
+	else
+		new_beat = p_circulation->implement_time_step(time_step_s);
 
 	return new_beat;
 }
@@ -218,69 +486,275 @@ void cmv_system::update_beat_metrics(void)
 	//! Updates beat metrics in daughter objects
 
 	cout << "System [" << system_id << "], new beat at : " << cum_time_s << " s\n";
+
+	// The beat started at the first time-point in the beat object
+	beat_start_s = p_cmv_results_beat->return_row(0)[p_cmv_results_beat->time_field_index];
+	beat_rr_interval_s = cum_time_s - beat_start_s;
+
 	p_circulation->update_beat_metrics();
 }
 
+void cmv_system::write_beat_metrics(void)
+{
+	//! Function writes the current value of each beat metric as a row
+	//! The cost does not depend on the number of time-points in the beat
+
+	// Variables
+	double* p_row;
+
+	// Code
+	p_row = p_beat_metrics_writer->reserve_row();
+
+	for (int i = 0; i < p_cmv_results_beat_metrics->no_of_defined_results_fields; i++)
+		p_row[i] = *p_cmv_results_beat_metrics->p_data_sources[i];
+
+	p_beat_metrics_writer->commit_row();
+}
+
 void cmv_system::update_cmv_results_summary(void)
 {
-	//! Function copies data from cmv_results_beat to
-	//! the appropriate row on cmv_results_summary
+	//! Function copies the rows of the beat from cmv_results_beat to the
+	//! outputs, in one pass
+	//!		every summary_stride time-steps to the results_writer, and to
+	//!			the live_results if there is one, through the
+	//!			adaptive_summary if rows can be dropped
+	//!		every time-step in a full-rate window to p_full_rate_writer
+	//!		the first time-point of the beat to p_per_beat_writer
+	//! The outputs are chosen from the simulation index of each row, so
+	//! no times are compared
 	
 	// Variables
-
 	bool new_beat_flag = false;
+	bool full_rate_new_beat_flag = false;
+
+	int t_index;
+	int stride = p_cmv_options->summary_stride;
+
+	double* p_beat_row;
+	double* p_summary_row;
+	double* p_row;
 
 	// Code
 	
-	// We have to run through the entire beat to capture the fields that
-	// were back-filled to describe the cardiac cycle
+	// The rows for each output are picked in one pass through the beat
 
 	for (int b_ind = 0; b_ind < beat_t_index; b_ind++)
 	{
-		// Work out whether this is a time we need
-		if (sim_time_dumps_to_summary(
-				gsl_vector_get(p_cmv_results_beat->gsl_results_vectors[p_cmv_results_beat->time_field_index], b_ind)))
+		p_beat_row = p_cmv_results_beat->return_row(b_ind);
+
+		t_index = beat_start_t_index + b_ind;
+
+		// Summary, the row after every stride time-steps
+		if (((t_index + 1) % stride) == 0)
 		{
-			for (int f_ind = 0; f_ind < p_cmv_results_beat->no_of_defined_results_fields; f_ind++)
+			if (p_adaptive_summary != NULL)
 			{
-				if ((p_cmv_results_beat->results_fields[f_ind] == "hr_new_beat") &&
-					(new_beat_flag == false))
-				{
-					// Mark the new beat
-					gsl_vector_set(p_cmv_results_summary->gsl_results_vectors[f_ind],
-						summary_t_index, 1.0);
-					new_beat_flag = true;
-				}
-				else
-				{
-					// Update the array
-					double temp;
-
-					// Pull data from results_beat
-					temp = gsl_vector_get(p_cmv_results_beat->gsl_results_vectors[f_ind], b_ind);
-
-					// Write data to results_summary
-					gsl_vector_set(p_cmv_results_summary->gsl_results_vectors[f_ind],
-						summary_t_index, temp);
-				}
+				fill_output_row(p_adaptive_summary->reserve_row(), p_beat_row,
+					(new_beat_flag == false));
+				p_adaptive_summary->commit_row(t_index);
+			}
+			else if (p_results_writer != NULL)
+			{
+				p_summary_row = p_results_writer->reserve_row();
+				fill_output_row(p_summary_row, p_beat_row, (new_beat_flag == false));
+
+				if (p_live_results != NULL)
+					p_live_results->add_row(p_summary_row);
+
+				p_results_writer->commit_row();
 			}
 
+			new_beat_flag = true;
+
 			summary_t_index = summary_t_index + 1;
 		}
+
+		// Full rate, the windows are in order so only the next one has
+		// to be checked
+		if (p_full_rate_writer != NULL)
+		{
+			while ((full_rate_window < no_of_full_rate_windows) &&
+				(t_index > full_rate_last_t_index[full_rate_window]))
+			{
+				full_rate_window = full_rate_window + 1;
+			}
+
+			if ((full_rate_window < no_of_full_rate_windows) &&
+				(t_index >= full_rate_first_t_index[full_rate_window]))
+			{
+				p_row = p_full_rate_writer->reserve_row();
+				fill_output_row(p_row, p_beat_row, (full_rate_new_beat_flag == false));
+				full_rate_new_beat_flag = true;
+
+				p_full_rate_writer->commit_row();
+			}
+		}
+
+		// Per beat
+		if ((p_per_beat_writer != NULL) && (b_ind == 0))
+		{
+			p_row = p_per_beat_writer->reserve_row();
+			fill_output_row(p_row, p_beat_row, true);
+			p_per_beat_writer->commit_row();
+		}
 	}
+
+	// Readers of the live file see the beat once it is complete
+	if (p_live_results != NULL)
+		p_live_results->commit();
 }
 
-bool cmv_system::sim_time_dumps_to_summary(double sim_time)
+void cmv_system::fill_output_row(double* p_row, double* p_beat_row, bool mark_new_beat)
 {
-	//! Returns true if sim_time should be sumped to summary
-	//! False otherwise
-	
-	if (abs(remainder(sim_time, p_cmv_options->summary_time_step_s)) < 1e-6)
+	//! Function copies the fields the beat writes in to p_row, the next
+	//! row of an output, marking the new beat if required
+	//! The caller commits it
+
+	// Variables
+	int no_of_fields = p_cmv_results_beat->no_of_defined_results_fields;
+	int no_of_output_fields = p_cmv_results_beat->no_of_output_fields;
+	int* p_output_indices = p_cmv_results_beat->output_field_indices;
+
+	// Code
+	// The outputs have the fields the beat writes, so unless some are
+	// only recorded for the model the row is copied straight in
+	if (no_of_output_fields == no_of_fields)
 	{
-		return true;
+		memcpy(p_row, p_beat_row, no_of_fields * sizeof(double));
 	}
 	else
 	{
-		return false;
+		for (int k = 0; k < no_of_output_fields; k++)
+			p_row[k] = p_beat_row[p_output_indices[k]];
+	}
+
+	if ((mark_new_beat) && (p_cmv_results_summary->new_beat_field_index >= 0))
+		p_row[p_cmv_results_summary->new_beat_field_index] = 1.0;
+}
+
+void cmv_system::initialise_output_resolutions(void)
+{
+	//! Function sets the number of time-steps between summary points,
+	//! from summary_time_step_s or the older skip_points, and the
+	//! full-rate windows as ranges of simulation indices
+	//! The time after step t_index is (t_index + 1) * time_step_s, so
+	//! the summary holds the steps where (t_index + 1) is a multiple of
+	//! the stride and the number of points is known without simulating
+
+	// Variables
+	double dt = p_cmv_protocol->time_step_s;
+	double steps;
+
+	int n = p_cmv_protocol->no_of_time_steps;
+	int stride = 1;
+
+	// Code
+	if (p_cmv_options->summary_time_step_s > 0.0)
+	{
+		steps = p_cmv_options->summary_time_step_s / dt;
+		stride = (int)GSL_MAX(1.0, round(steps));
+
+		if (fabs(steps - stride) > (1e-6 * steps))
+		{
+			cout << "Error: summary_time_step_s " << p_cmv_options->summary_time_step_s <<
+				" is not a multiple of the time-step " << dt << "\n";
+			exit(1);
+		}
+	}
+
+	if (p_cmv_options->summary_skip_points >= 0)
+	{
+		if ((p_cmv_options->summary_time_step_s > 0.0) &&
+			(stride != (p_cmv_options->summary_skip_points + 1)))
+		{
+			cout << "Error: output skip_points " << p_cmv_options->summary_skip_points <<
+				" does not match summary_time_step_s " << p_cmv_options->summary_time_step_s << "\n";
+			exit(1);
+		}
+
+		stride = p_cmv_options->summary_skip_points + 1;
+	}
+
+	p_cmv_options->summary_stride = stride;
+	p_cmv_options->summary_time_step_s = stride * dt;
+	p_cmv_options->summary_points = n / stride;
+
+	// Full-rate windows, holding the steps whose end times are inside
+	no_of_full_rate_windows = 0;
+
+	for (int w = 0; w < p_cmv_options->results_no_of_full_rate_windows; w++)
+	{
+		int first = (int)ceil((p_cmv_options->results_full_rate_start_s[w] / dt) - 1e-6) - 1;
+		int last = (int)floor((p_cmv_options->results_full_rate_stop_s[w] / dt) + 1e-6) - 1;
+
+		first = GSL_MAX(first, 0);
+		last = GSL_MIN(last, n - 1);
+
+		if (last < first)
+		{
+			cout << "Warning: full-rate window " << w << " is outside the simulation\n";
+			continue;
+		}
+
+		full_rate_first_t_index[no_of_full_rate_windows] = first;
+		full_rate_last_t_index[no_of_full_rate_windows] = last;
+		no_of_full_rate_windows = no_of_full_rate_windows + 1;
+	}
+}
+
+void cmv_system::open_output_resolution_writers(string results_file_string)
+{
+	//! Function opens the writers for the full-rate and per-beat outputs,
+	//! the beat metrics and the phase averages, naming the files from the
+	//! results file, so that sim.txt gives sim_full_rate.txt,
+	//! sim_per_beat.txt, sim_beat_metrics.txt and sim_phase_average.txt
+
+	// Variables
+	path results_path(results_file_string);
+
+	long long full_rate_points = 0;
+
+	// Code
+	if (no_of_full_rate_windows > 0)
+	{
+		for (int w = 0; w < no_of_full_rate_windows; w++)
+		{
+			full_rate_points = full_rate_points +
+				(full_rate_last_t_index[w] - full_rate_first_t_index[w] + 1);
+		}
+
+		cout << "Full-rate points: " << full_rate_points << "\n";
+
+		p_full_rate_writer = new results_writer(p_cmv_results_summary,
+			(results_path.parent_path() /
+				(results_path.stem().string() + "_full_rate" + results_path.extension().string())).string(),
+			p_cmv_options->results_output_format, 0.0,
+			p_cmv_options->results_stream_buffer_points, full_rate_points);
+	}
+
+	// The number of beats is not known, as the heart rate can change,
+	// but there cannot be more than one per time-step, so the binary
+	// indices are sized for that and never grow
+	if (p_cmv_options->results_per_beat_output == "True")
+	{
+		p_per_beat_writer = new results_writer(p_cmv_results_summary,
+			(results_path.parent_path() /
+				(results_path.stem().string() + "_per_beat" + results_path.extension().string())).string(),
+			p_cmv_options->results_output_format, 0.0,
+			p_cmv_options->results_stream_buffer_points, p_cmv_protocol->no_of_time_steps);
+	}
+
+	// The beat metrics are always written
+	p_beat_metrics_writer = new results_writer(p_cmv_results_beat_metrics,
+		(results_path.parent_path() /
+			(results_path.stem().string() + "_beat_metrics" + results_path.extension().string())).string(),
+		p_cmv_options->results_output_format, 0.0,
+		p_cmv_options->results_stream_buffer_points, p_cmv_protocol->no_of_time_steps);
+
+	if (p_cmv_options->results_phase_average_beats > 0)
+	{
+		p_phase_average = new phase_average(this,
+			(results_path.parent_path() /
+				(results_path.stem().string() + "_phase_average" + results_path.extension().string())).string());
 	}
-}
\ No newline at end of file
+}
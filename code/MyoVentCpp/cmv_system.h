@@ -9,6 +9,8 @@
 #include "stdio.h"
 #include <string>
 
+#include "global_definitions.h"
+
 // Forward declarations
 class cmv_model;
 class cmv_options;
@@ -16,6 +18,12 @@ class cmv_protocol;
 class cmv_results;
 class circulation;
 class hemi_vent;
+class coupled_system;
+class update_schedule;
+class results_writer;
+class live_results;
+class adaptive_summary;
+class phase_average;
 
 using namespace std;
 
@@ -39,15 +47,67 @@ public:
 
 	cmv_protocol* p_cmv_protocol;			/**< Pointer to a cmv_protocol object */
 
-	cmv_results* p_cmv_results_summary;	/**< Pointer to cmv_results holding
-													down-sampled data for the
-													simulation */
+	cmv_results* p_cmv_results_summary;	/**< Pointer to cmv_results defining
+													the fields of the down-sampled
+													data for the simulation */
 
 	cmv_results* p_cmv_results_beat;		/**< Pointer to cmv_results holding
 													data for a beat */
 
+	cmv_results* p_cmv_results_beat_metrics;
+											/**< Pointer to cmv_results defining
+													the metrics written once
+													per beat */
+
+	results_writer* p_results_writer;		/**< Pointer to the results_writer
+													streaming the summary rows
+													to the results file, NULL if
+													only phase averages are
+													written */
+
+	live_results* p_live_results;			/**< Pointer to the live_results
+													publishing the summary rows
+													to a memory-mapped file, NULL
+													if there is none */
+
+	adaptive_summary* p_adaptive_summary;	/**< Pointer to the adaptive_summary
+													dropping the summary rows
+													that can be interpolated,
+													NULL if every row is kept */
+
+	results_writer* p_full_rate_writer;		/**< Pointer to the results_writer
+													for every time-step in the
+													full-rate windows, NULL if
+													there are none */
+
+	results_writer* p_per_beat_writer;		/**< Pointer to the results_writer
+													for the first time-point of
+													each beat, NULL if it is
+													not requested */
+
+	results_writer* p_beat_metrics_writer;	/**< Pointer to the results_writer
+													for the beat metrics */
+
+	phase_average* p_phase_average;			/**< Pointer to the phase_average
+													writing the fields averaged
+													by phase over a window of
+													beats, NULL if there is none */
+
 	circulation* p_circulation;				/**< Pointer to a circulation */
 
+	coupled_system* p_coupled_system;		/**< Pointer to a coupled_system that
+													integrates the modules together,
+													NULL for the split scheme */
+
+	update_schedule* p_baro_schedule;		/**< Pointer to the update_schedule
+													for the baroreflex */
+
+	update_schedule* p_growth_schedule;		/**< Pointer to the update_schedule
+													for growth */
+
+	update_schedule* p_mito_schedule;		/**< Pointer to the update_schedule
+													for the mitochondria */
+
 	int sim_t_index;						/**< integer holding index in the simulation */
 
 	int beat_t_index;						/**< integer holding index in the
@@ -56,8 +116,37 @@ public:
 	int summary_t_index;					/**< integer holding index in the
 													summary results object */
 
+	int beat_start_t_index;					/**< integer holding the simulation
+													index of the first time-point
+													in the beat */
+
+	int full_rate_first_t_index[MAX_NO_OF_FULL_RATE_WINDOWS];
+											/**< array of integers with the first
+													simulation index in each
+													full-rate window */
+
+	int full_rate_last_t_index[MAX_NO_OF_FULL_RATE_WINDOWS];
+											/**< array of integers with the last
+													simulation index in each
+													full-rate window */
+
+	int no_of_full_rate_windows;			/**< integer with the number of
+													full-rate windows */
+
+	int full_rate_window;					/**< integer with the first full-rate
+													window that has not ended */
+
 	double cum_time_s;						/**< double, with system time in s */
 
+	double results_t_index;					/**< double, with sim_t_index for the
+													t_index results field */
+
+	double beat_start_s;					/**< double, with the time in s at
+													the start of the last beat */
+
+	double beat_rr_interval_s;				/**< double, with the length in s of
+													the last beat */
+
 	int system_id;
 
 	// Functions
@@ -76,11 +165,35 @@ public:
 
 	void add_fields_to_cmv_results_beat();
 
+	void add_fields_to_cmv_results_beat_metrics();
+
 	bool implement_time_step(double time_step_s);
 
 	void update_beat_metrics();
 
 	void update_cmv_results_summary();
 
-	bool sim_time_dumps_to_summary(double sim_time);
+	/**
+	/* function writes one row of beat metrics
+	*/
+	void write_beat_metrics(void);
+
+	/**
+	/* function sets the summary stride and the full-rate windows as
+	* simulation indices and works out how many summary points there are
+	*/
+	void initialise_output_resolutions(void);
+
+	/**
+	/* function opens the writers for the full-rate windows, the
+	* per-beat points, the beat metrics and the phase averages, with
+	* names based on results_file_string
+	*/
+	void open_output_resolution_writers(string results_file_string);
+
+	/**
+	/* function fills p_row, the next row of an output, from a row of
+	* the beat
+	*/
+	void fill_output_row(double* p_row, double* p_beat_row, bool mark_new_beat);
 };
\ No newline at end of file
@@ -0,0 +1,618 @@
+/**
+/* @file		coupled_system.cpp
+/* @brief		Source file for a coupled_system object
+/* @author		Ken Campbell
+*/
+
+#include "stdio.h"
+
+#include "coupled_system.h"
+#include "cmv_system.h"
+#include "update_schedule.h"
+#include "cmv_model.h"
+#include "cmv_options.h"
+#include "cmv_protocol.h"
+#include "circulation.h"
+#include "hemi_vent.h"
+#include "half_sarcomere.h"
+#include "valve.h"
+#include "membranes.h"
+#include "mitochondria.h"
+#include "heart_rate.h"
+#include "myofilaments.h"
+#include "baroreflex.h"
+#include "reflex_control.h"
+#include "growth.h"
+
+#include "gsl_math.h"
+#include "gsl_errno.h"
+#include "gsl_odeiv2.h"
+
+// The coupled system is built from the GSL ODE functions that the modules
+// already provide for their own drivers. Each one advances a block of the
+// coupled state and reads the state of the other modules from their class
+// variables, which set_coupling_variables updates before every evaluation
+int valve_derivs(double t, const double y[], double f[], void* params);
+int memb_calculate_derivs(double t, const double y[], double f[], void* params);
+int myof_calculate_derivs(double t, const double y[], double f[], void* params);
+int myof_calculate_jacobian(double t, const double y[], double* dfdy, double dfdt[],
+	void* params);
+int circ_vol_derivs(double t, const double y[], double f[], void* params);
+int baro_calculate_derivs(double t, const double y[], double f[], void* params);
+
+// Forward declarations of the functions used by the GSL ODE system
+int coupled_calculate_derivs(double t, const double y[], double f[], void* params);
+int coupled_calculate_jacobian(double t, const double y[], double* dfdy, double dfdt[],
+	void* params);
+
+// Constructor
+coupled_system::coupled_system(cmv_system* set_p_parent_cmv_system)
+{
+	//! Constructor
+
+	// Code
+
+	// Set the pointers to the parent system and the modules
+	p_parent_cmv_system = set_p_parent_cmv_system;
+
+	p_circulation = p_parent_cmv_system->p_circulation;
+	p_hemi_vent = p_circulation->p_hemi_vent;
+	p_hs = p_hemi_vent->p_hs;
+	p_av = p_hemi_vent->p_av;
+	p_mv = p_hemi_vent->p_mv;
+	p_membranes = p_hs->p_membranes;
+	p_myofilaments = p_hs->p_myofilaments;
+	p_baroreflex = p_circulation->p_baroreflex;
+
+	// Set other pointers safe
+	p_cmv_options = NULL;
+	p_cmv_protocol = NULL;
+	cs_y = NULL;
+	cs_abs_scale = NULL;
+	cs_f_base = NULL;
+	cs_f_pert = NULL;
+	cs_y_pert = NULL;
+	cs_myof_dfdy = NULL;
+	cs_myof_dfdt = NULL;
+	p_cs_ode_driver = NULL;
+
+	// Initialise
+	no_of_blocks = 0;
+	cs_length = 0;
+
+	av_block = -1;
+	mv_block = -1;
+	memb_block = -1;
+	myof_block = -1;
+	circ_block = -1;
+	baro_block = -1;
+
+	cs_n_rhs_evaluations = 0;
+	cs_n_jacobian_evaluations = 0;
+	cs_report_counters = false;
+}
+
+// Destructor
+coupled_system::~coupled_system(void)
+{
+	//! Destructor
+
+	// Code
+
+	// Tidy up
+	if (p_cs_ode_driver != NULL)
+		gsl_odeiv2_driver_free(p_cs_ode_driver);
+
+	free(cs_y);
+	free(cs_abs_scale);
+	free(cs_f_base);
+	free(cs_f_pert);
+	free(cs_y_pert);
+	free(cs_myof_dfdy);
+	free(cs_myof_dfdt);
+
+	if (cs_report_counters)
+	{
+		cout << "coupled RHS evaluations: " << cs_n_rhs_evaluations <<
+			" Jacobian evaluations: " << cs_n_jacobian_evaluations << "\n";
+	}
+}
+
+// Other functions
+void coupled_system::initialise_simulation(void)
+{
+	//! Code builds the coupled state from the module blocks and creates
+	//! the driver. The modules must have been initialised already
+
+	// Variables
+	const gsl_odeiv2_step_type* p_step_type;
+
+	bool needs_jacobian = false;
+
+	size_t myof_length;
+
+	// Code
+
+	// Set the options and protocol
+	p_cmv_options = p_parent_cmv_system->p_cmv_options;
+	p_cmv_protocol = p_parent_cmv_system->p_cmv_protocol;
+
+	// The options are deleted before the destructor runs
+	cs_report_counters = (p_cmv_options->report_counters == "True");
+
+	// The chamber pressure is now evaluated at every stage of the solver,
+	// so the wall thickness must be smooth in the chamber volume for the
+	// error estimates and the differenced Jacobian
+	p_hemi_vent->vent_wall_thickness_tolerance = 1e-12;
+
+	// Build the blocks. Ca concentrations are of the order of the SR
+	// content, which sets the scale of their absolute error
+	av_block = add_block(2, 1.0, valve_derivs, p_av);
+
+	mv_block = add_block(2, 1.0, valve_derivs, p_mv);
+
+	memb_block = add_block(2, p_membranes->p_cmv_model->memb_Ca_content,
+		memb_calculate_derivs, p_membranes);
+
+	myof_block = add_block(p_myofilaments->y_length, 1.0,
+		myof_calculate_derivs, p_myofilaments);
+
+	circ_block = add_block((size_t)p_circulation->circ_no_of_compartments, 1.0,
+		circ_vol_derivs, p_circulation);
+
+	if ((p_circulation->circ_exponential) || (p_circulation->circ_implicit))
+	{
+		cout << "Coupled integrator: " << p_cmv_options->circ_integrator <<
+			" circulation integrator ignored\n";
+	}
+
+	for (int e = 0; e < p_circulation->circ_no_of_edges; e++)
+	{
+		if (p_circulation->circ_inertance[e] > 0.0)
+		{
+			cout << "Error: coupled integrator does not support circulation edges " <<
+				"with an inertance\n";
+			exit(1);
+		}
+	}
+
+	if (p_baroreflex != NULL)
+	{
+		baro_block = add_block((size_t)(1 + p_baroreflex->no_of_reflex_controls), 1.0,
+			baro_calculate_derivs, p_baroreflex);
+
+		// The baroreflex is now part of the solver state, so it is
+		// advanced with the other modules
+		if (p_cmv_options->baro_update_cadence != "every_step")
+		{
+			cout << "Coupled integrator: baroreflex update_schedule ignored\n";
+		}
+	}
+
+	// Allocate the state and the error scale for each entry
+	cs_y = (double*)malloc(cs_length * sizeof(double));
+	cs_abs_scale = (double*)malloc(cs_length * sizeof(double));
+
+	for (int b = 0; b < no_of_blocks; b++)
+	{
+		for (size_t i = 0; i < blocks[b].length; i++)
+		{
+			cs_abs_scale[blocks[b].offset + i] = blocks[b].abs_scale;
+		}
+	}
+
+	// Pick the stepper
+	if (p_cmv_options->coupled_ode_stepper == "rkf45")
+	{
+		p_step_type = gsl_odeiv2_step_rkf45;
+	}
+	else if (p_cmv_options->coupled_ode_stepper == "rk8pd")
+	{
+		p_step_type = gsl_odeiv2_step_rk8pd;
+	}
+	else if (p_cmv_options->coupled_ode_stepper == "bsimp")
+	{
+		p_step_type = gsl_odeiv2_step_bsimp;
+		needs_jacobian = true;
+	}
+	else if (p_cmv_options->coupled_ode_stepper == "msbdf")
+	{
+		p_step_type = gsl_odeiv2_step_msbdf;
+		needs_jacobian = true;
+	}
+	else
+	{
+		cout << "Error: coupled_integrator ode_stepper: " <<
+			p_cmv_options->coupled_ode_stepper << " not recognized\n";
+		exit(1);
+	}
+
+	// The implicit steppers need workspace for the Jacobian
+	if (needs_jacobian)
+	{
+		myof_length = blocks[myof_block].length;
+
+		cs_f_base = (double*)malloc(cs_length * sizeof(double));
+		cs_f_pert = (double*)malloc(cs_length * sizeof(double));
+		cs_y_pert = (double*)malloc(cs_length * sizeof(double));
+		cs_myof_dfdy = (double*)malloc(myof_length * myof_length * sizeof(double));
+		cs_myof_dfdt = (double*)malloc(myof_length * sizeof(double));
+	}
+
+	// Create the ODE driver once, it is reset at the start of each time-step
+	cs_ode_system = { coupled_calculate_derivs, coupled_calculate_jacobian, cs_length, this };
+
+	p_cs_ode_driver = gsl_odeiv2_driver_alloc_scaled_new(&cs_ode_system, p_step_type,
+		0.5 * p_cmv_protocol->time_step_s,
+		p_cmv_options->coupled_eps_abs, p_cmv_options->coupled_eps_rel,
+		1.0, 0.0, cs_abs_scale);
+
+	cout << "Coupled system: " << no_of_blocks << " blocks, " << cs_length <<
+		" variables, stepper: " << p_cmv_options->coupled_ode_stepper << "\n";
+}
+
+int coupled_system::add_block(size_t length, double abs_scale,
+	int (*derivs)(double t, const double y[], double f[], void* params),
+	void* params)
+{
+	//! Function appends a block to the coupled state and returns its index
+
+	// Code
+	if (no_of_blocks >= MAX_NO_OF_COUPLED_BLOCKS)
+	{
+		cout << "Error: too many blocks in the coupled system\n";
+		exit(1);
+	}
+
+	blocks[no_of_blocks].offset = cs_length;
+	blocks[no_of_blocks].length = length;
+	blocks[no_of_blocks].abs_scale = abs_scale;
+	blocks[no_of_blocks].derivs = derivs;
+	blocks[no_of_blocks].params = params;
+
+	cs_length = cs_length + length;
+
+	no_of_blocks = no_of_blocks + 1;
+
+	return (no_of_blocks - 1);
+}
+
+// These functions are not members of the coupled_system class but are used to
+// interface with the GSL ODE system. They communicate with the class through
+// a pointer to the class object
+
+int coupled_calculate_derivs(double t, const double y[], double f[], void* params)
+{
+	//! Function sets derivs for the whole system
+
+	// Variables
+	coupled_system* p_cs = (coupled_system*)params;
+
+	const coupled_block* p_block;
+
+	// Code
+
+	p_cs->cs_n_rhs_evaluations = p_cs->cs_n_rhs_evaluations + 1;
+
+	// Make the modules see the trial state
+	p_cs->set_coupling_variables(t, y);
+
+	// Now each module sets the derivs for its own block
+	for (int b = 0; b < p_cs->no_of_blocks; b++)
+	{
+		p_block = &p_cs->blocks[b];
+
+		p_block->derivs(t, &y[p_block->offset], &f[p_block->offset], p_block->params);
+	}
+
+	return GSL_SUCCESS;
+}
+
+int coupled_calculate_jacobian(double t, const double y[], double* dfdy, double dfdt[],
+	void* params)
+{
+	//! Function sets the Jacobian for the implicit steppers
+	//! dfdy[(i * n) + j] is df[i]/dy[j]
+	//! The columns for the small blocks come from forward differences of the
+	//! full system, which picks up the coupling through the pressures and the
+	//! Ca concentration. The myofilament block uses its analytic Jacobian. The
+	//! effect of a single bin on the chamber pressure is small and is left out,
+	//! which only slows the Newton iterations
+
+	// Variables
+	coupled_system* p_cs = (coupled_system*)params;
+
+	const coupled_block* p_myof_block = &p_cs->blocks[p_cs->myof_block];
+
+	size_t n = p_cs->cs_length;
+	size_t m = p_myof_block->length;
+	size_t offset = p_myof_block->offset;
+
+	double h;
+
+	// Code
+
+	p_cs->cs_n_jacobian_evaluations = p_cs->cs_n_jacobian_evaluations + 1;
+
+	// The system is autonomous within a time-step, apart from the switch
+	// in membrane activation
+	for (size_t i = 0; i < n; i++)
+	{
+		dfdt[i] = 0.0;
+	}
+
+	for (size_t i = 0; i < (n * n); i++)
+	{
+		dfdy[i] = 0.0;
+	}
+
+	coupled_calculate_derivs(t, y, p_cs->cs_f_base, params);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		p_cs->cs_y_pert[i] = y[i];
+	}
+
+	for (int b = 0; b < p_cs->no_of_blocks; b++)
+	{
+		if (b == p_cs->myof_block)
+			continue;
+
+		for (size_t j = p_cs->blocks[b].offset;
+			j < (p_cs->blocks[b].offset + p_cs->blocks[b].length); j++)
+		{
+			h = GSL_SQRT_DBL_EPSILON * GSL_MAX(fabs(y[j]), p_cs->cs_abs_scale[j]);
+
+			p_cs->cs_y_pert[j] = y[j] + h;
+
+			coupled_calculate_derivs(t, p_cs->cs_y_pert, p_cs->cs_f_pert, params);
+
+			for (size_t i = 0; i < n; i++)
+			{
+				dfdy[(i * n) + j] = (p_cs->cs_f_pert[i] - p_cs->cs_f_base[i]) / h;
+			}
+
+			p_cs->cs_y_pert[j] = y[j];
+		}
+	}
+
+	// Restore the modules to the unperturbed state and add the
+	// myofilament block
+	p_cs->set_coupling_variables(t, y);
+
+	myof_calculate_jacobian(t, &y[offset], p_cs->cs_myof_dfdy, p_cs->cs_myof_dfdt,
+		p_cs->p_myofilaments);
+
+	for (size_t r = 0; r < m; r++)
+	{
+		for (size_t c = 0; c < m; c++)
+		{
+			dfdy[((offset + r) * n) + offset + c] = p_cs->cs_myof_dfdy[(r * m) + c];
+		}
+	}
+
+	return GSL_SUCCESS;
+}
+
+void coupled_system::set_coupling_variables(double t, const double y[])
+{
+	//! Function sets the class variables that modules read from each other
+	//! to the values for a trial state at time t in the time-step
+
+	// Variables
+	const double* y_valve;
+
+	// Code
+
+	// The valves are held between their stops, as at the end of a step
+	y_valve = &y[blocks[av_block].offset];
+	p_av->valve_pos = GSL_MAX(p_av->valve_leak, GSL_MIN(1.0, y_valve[0]));
+
+	y_valve = &y[blocks[mv_block].offset];
+	p_mv->valve_pos = GSL_MAX(p_mv->valve_leak, GSL_MIN(1.0, y_valve[0]));
+
+	// Ca drives the thin filament, and the membranes close part way
+	// through a step
+	p_membranes->memb_Ca_cytosol = y[blocks[memb_block].offset];
+	p_membranes->memb_activation = p_membranes->return_activation(t);
+
+	// The myosin populations set the wall stress, and through it
+	// the chamber pressure
+	p_myofilaments->calculate_m_state_summaries(&y[blocks[myof_block].offset]);
+	p_myofilaments->calculate_stresses();
+
+	// Pressures for the valves, the flows and the baroreflex
+	p_circulation->calculate_pressures(&y[blocks[circ_block].offset],
+		p_circulation->circ_pressure);
+}
+
+void coupled_system::pack_state(double y[])
+{
+	//! Function copies the module variables into the coupled state
+
+	// Variables
+	double* y_block;
+
+	// Code
+	y_block = &y[blocks[av_block].offset];
+	y_block[0] = p_av->valve_pos;
+	y_block[1] = p_av->valve_vel;
+
+	y_block = &y[blocks[mv_block].offset];
+	y_block[0] = p_mv->valve_pos;
+	y_block[1] = p_mv->valve_vel;
+
+	y_block = &y[blocks[memb_block].offset];
+	y_block[0] = p_membranes->memb_Ca_cytosol;
+	y_block[1] = p_membranes->memb_Ca_sr;
+
+	// The myofilaments work on y_calc, filled by prepare_time_step
+	y_block = &y[blocks[myof_block].offset];
+	for (size_t i = 0; i < blocks[myof_block].length; i++)
+	{
+		y_block[i] = p_myofilaments->y_calc[i];
+	}
+
+	y_block = &y[blocks[circ_block].offset];
+	for (size_t i = 0; i < blocks[circ_block].length; i++)
+	{
+		y_block[i] = p_circulation->circ_volume[i];
+	}
+
+	if (baro_block >= 0)
+	{
+		y_block = &y[blocks[baro_block].offset];
+		y_block[0] = p_baroreflex->baro_B;
+
+		for (int i = 0; i < p_baroreflex->no_of_reflex_controls; i++)
+		{
+			y_block[1 + i] = p_baroreflex->p_rc[i]->rc_baro_C;
+		}
+	}
+}
+
+void coupled_system::unpack_state(const double y[])
+{
+	//! Function copies the coupled state back to the module variables
+
+	// Variables
+	const double* y_block;
+
+	// Code
+	y_block = &y[blocks[av_block].offset];
+	p_av->valve_pos = y_block[0];
+	p_av->valve_vel = y_block[1];
+
+	y_block = &y[blocks[mv_block].offset];
+	p_mv->valve_pos = y_block[0];
+	p_mv->valve_vel = y_block[1];
+
+	y_block = &y[blocks[memb_block].offset];
+	p_membranes->memb_Ca_cytosol = y_block[0];
+	p_membranes->memb_Ca_sr = y_block[1];
+
+	y_block = &y[blocks[myof_block].offset];
+	for (size_t i = 0; i < blocks[myof_block].length; i++)
+	{
+		p_myofilaments->y_calc[i] = y_block[i];
+	}
+
+	y_block = &y[blocks[circ_block].offset];
+	for (size_t i = 0; i < blocks[circ_block].length; i++)
+	{
+		p_circulation->circ_volume[i] = y_block[i];
+	}
+
+	if (baro_block >= 0)
+	{
+		y_block = &y[blocks[baro_block].offset];
+		p_baroreflex->baro_B = y_block[0];
+
+		for (int i = 0; i < p_baroreflex->no_of_reflex_controls; i++)
+		{
+			p_baroreflex->p_rc[i]->rc_baro_C = y_block[1 + i];
+		}
+	}
+}
+
+bool coupled_system::implement_time_step(double time_step_s)
+{
+	//! Code advances the whole system by a time-step with one solver
+	//! The heart beat, the rate table and the controlled parameters are
+	//! updated between steps, as in the split scheme
+
+	// Variables
+	bool new_beat = false;
+
+	int status;
+
+	double t_start_s = 0.0;
+	double t_stop_s = time_step_s;
+
+	double cum_time_s = p_parent_cmv_system->cum_time_s;
+
+	// Code
+
+	// Discrete updates at the start of the step
+	new_beat = p_hs->p_heart_rate->implement_time_step(time_step_s);
+
+	p_membranes->update_activation(time_step_s, new_beat);
+
+	if (p_parent_cmv_system->p_mito_schedule->advance(time_step_s, new_beat))
+	{
+		p_hs->p_mitochondria->implement_time_step(
+			p_parent_cmv_system->p_mito_schedule->us_time_step_s);
+	}
+
+	// Rates, f_overlap and the bin windows are held over the step
+	p_myofilaments->prepare_time_step();
+
+	if (p_baroreflex != NULL)
+	{
+		p_baroreflex->baro_active = p_cmv_protocol->return_activation("baroreflex",
+			cum_time_s);
+	}
+
+	// Integrate
+	pack_state(cs_y);
+
+	gsl_odeiv2_driver_reset_hstart(p_cs_ode_driver, 0.5 * time_step_s);
+
+	status = gsl_odeiv2_driver_apply(p_cs_ode_driver, &t_start_s, t_stop_s, cs_y);
+
+	if (status != GSL_SUCCESS)
+	{
+		cout << "Integration problem in coupled_system::implement_time_step\n";
+		exit(1);
+	}
+
+	// Unpack, and then let each module tidy up as it does after its own step
+	unpack_state(cs_y);
+
+	p_av->impose_limits();
+	p_mv->impose_limits();
+
+	p_membranes->memb_activation = p_membranes->return_activation(0.0);
+	p_membranes->calculate_fluxes(&cs_y[blocks[memb_block].offset]);
+
+	p_myofilaments->finish_time_step();
+
+	p_hs->calculate_hs_ATP_concentration(time_step_s);
+
+	p_hemi_vent->calculate_vent_ATP_used_per_s();
+
+	// Pressures at the end of the step, then the ventricle follows
+	// the new volume
+	p_circulation->calculate_pressures(p_circulation->circ_volume,
+		p_circulation->circ_pressure);
+
+	p_circulation->update_after_volume_step();
+
+	if (p_baroreflex != NULL)
+	{
+		p_baroreflex->baro_B = GSL_MAX(0.0, GSL_MIN(1.0, p_baroreflex->baro_B));
+
+		p_baroreflex->calculate_B_a();
+
+		for (int i = 0; i < p_baroreflex->no_of_reflex_controls; i++)
+		{
+			p_baroreflex->p_rc[i]->rc_baro_C =
+				GSL_MAX(0.0, GSL_MIN(1.0, p_baroreflex->p_rc[i]->rc_baro_C));
+
+			p_baroreflex->p_rc[i]->update_controlled_variable();
+		}
+	}
+
+	// Growth works on beat-to-beat signals and stays outside the solver
+	if ((p_circulation->p_growth != NULL) &&
+		(p_parent_cmv_system->p_growth_schedule->advance(time_step_s, new_beat)))
+	{
+		p_circulation->p_growth->growth_active =
+			p_cmv_protocol->return_activation("growth", cum_time_s);
+		p_circulation->p_growth->implement_time_step(
+			p_parent_cmv_system->p_growth_schedule->us_time_step_s,
+			p_parent_cmv_system->p_growth_schedule->us_new_beat);
+	}
+
+	return (new_beat);
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+/**
+/* @file		coupled_system.h
+/* @brief		Header file for a coupled_system object
+/* @author		Ken Campbell
+*/
+
+#include "stdio.h"
+
+#include <iostream>
+
+#include "global_definitions.h"
+
+#include "gsl_odeiv2.h"
+
+// Forward declararations
+class cmv_system;
+class cmv_options;
+class cmv_protocol;
+
+class circulation;
+class hemi_vent;
+class half_sarcomere;
+class valve;
+class membranes;
+class myofilaments;
+class baroreflex;
+
+struct coupled_block
+{
+	size_t offset;									/**< index of the first entry of
+															the block in the coupled
+															state */
+
+	size_t length;									/**< number of entries in the block */
+
+	double abs_scale;								/**< typical size of the entries, used
+															to scale the absolute error
+															tolerance */
+
+	int (*derivs)(double t, const double y[], double f[], void* params);
+													/**< the module's GSL derivs function,
+															called with y and f offset to
+															the block */
+
+	void* params;									/**< pointer passed to derivs, the
+															module itself */
+};
+
+class coupled_system
+{
+public:
+	/**
+	 * Constructor
+	 */
+	coupled_system(cmv_system* set_p_parent_cmv_system);
+
+	/**
+	* Destructor
+	*/
+	~coupled_system(void);
+
+	// Variables
+
+	cmv_system* p_parent_cmv_system;				/**< Pointer to the parent cmv_system */
+
+	cmv_options* p_cmv_options;						/**< Pointer to cmv_options */
+
+	cmv_protocol* p_cmv_protocol;					/**< Pointer to the cmv_protocol */
+
+	circulation* p_circulation;						/**< Pointer to the circulation */
+
+	hemi_vent* p_hemi_vent;							/**< Pointer to the hemi_vent */
+
+	half_sarcomere* p_hs;							/**< Pointer to the half-sarcomere */
+
+	valve* p_av;									/**< Pointer to the aortic valve */
+
+	valve* p_mv;									/**< Pointer to the mitral valve */
+
+	membranes* p_membranes;							/**< Pointer to the membranes */
+
+	myofilaments* p_myofilaments;					/**< Pointer to the myofilaments */
+
+	baroreflex* p_baroreflex;						/**< Pointer to the baroreflex, NULL
+															if there is not one */
+
+	int no_of_blocks;								/**< integer with the number of blocks */
+
+	coupled_block blocks[MAX_NO_OF_COUPLED_BLOCKS];	/**< array of blocks, each one the
+															state of a module */
+
+	int av_block;									/**< index in blocks of the aortic valve */
+
+	int mv_block;									/**< index in blocks of the mitral valve */
+
+	int memb_block;									/**< index in blocks of the membranes */
+
+	int myof_block;									/**< index in blocks of the myofilaments */
+
+	int circ_block;									/**< index in blocks of the compartment
+															volumes */
+
+	int baro_block;									/**< index in blocks of the baroreflex,
+															-1 if there is not one */
+
+	size_t cs_length;								/**< integer with the length of the
+															coupled state */
+
+	double* cs_y;									/**< array of doubles holding the
+															coupled state during a
+															time-step */
+
+	double* cs_abs_scale;							/**< array of doubles with the
+															abs_scale of each entry */
+
+	double* cs_f_base;								/**< array of doubles holding the derivs
+															at the state passed to the
+															Jacobian, NULL for the explicit
+															steppers */
+
+	double* cs_f_pert;								/**< array of doubles holding the derivs
+															for a perturbed state */
+
+	double* cs_y_pert;								/**< array of doubles holding a
+															perturbed state */
+
+	double* cs_myof_dfdy;							/**< array of doubles holding the
+															analytic Jacobian of the
+															myofilament block */
+
+	double* cs_myof_dfdt;							/**< array of doubles used as dfdt
+															for the myofilament block */
+
+	gsl_odeiv2_system cs_ode_system;				/**< gsl_odeiv2_system wrapping
+															coupled_calculate_derivs and
+															coupled_calculate_jacobian */
+
+	gsl_odeiv2_driver* p_cs_ode_driver;				/**< Pointer to a gsl_odeiv2_driver
+															created in
+															initialise_simulation and
+															reset every time-step */
+
+	long long cs_n_rhs_evaluations;					/**< counter for calls to
+															coupled_calculate_derivs */
+
+	long long cs_n_jacobian_evaluations;			/**< counter for calls to
+															coupled_calculate_jacobian */
+
+	bool cs_report_counters;						/**< true if the counters are
+															printed by the destructor */
+
+	// Functions
+
+	void initialise_simulation(void);
+
+	bool implement_time_step(double time_step_s);
+
+	int add_block(size_t length, double abs_scale,
+		int (*derivs)(double t, const double y[], double f[], void* params),
+		void* params);
+
+	void pack_state(double y[]);
+
+	void unpack_state(const double y[]);
+
+	void set_coupling_variables(double t, const double y[]);
+};
@@ -6,7 +6,11 @@
 /* @author		Ken Campbell
 */
 
-#define MAX_NO_OF_RESULT_FIELDS 200
+#define MAX_NO_OF_RESULT_FIELDS 400
+
+#define MAX_NO_OF_RESULT_FIELD_PATTERNS 50
+
+#define MAX_NO_OF_FULL_RATE_WINDOWS 20
 
 #define MAX_NO_OF_KINETIC_STATES 10
 
@@ -14,7 +18,9 @@
 
 #define MAX_NO_OF_RATE_PARAMETERS 10
 
-#define MAX_NO_OF_COMPARTMENTS 10
+#define MAX_NO_OF_COMPARTMENTS 50
+
+#define MAX_NO_OF_CIRCULATION_EDGES 100
 
 #define MAX_NO_OF_ACTIVATIONS 10
 
@@ -24,5 +30,68 @@
 
 #define MAX_NO_OF_GROWTH_CONTROLS 10
 
+#define BIN_ARRAY_ALIGNMENT 32
+
+#define MAX_MATRIX_EXPONENTIAL_SIZE (MAX_NO_OF_COMPARTMENTS + 2)
+
+#define MAX_NO_OF_COUPLED_BLOCKS 10
+
+#define VENT_GEOMETRY_CACHE_SIZE 4
+
+#define RESULTS_SLAB_ALIGNMENT 64
+
+#define RESULTS_BINARY_MAGIC "MVRESBIN"
+
+#define RESULTS_BINARY_VERSION 2
+
+#define RESULTS_BINARY_HEADER_BYTES 72
+
+#define RESULTS_BINARY_V1_HEADER_BYTES 64
+
+#define RESULTS_BINARY_INDEX_ENTRY_BYTES 40
+
+#define MAX_NO_OF_RESULTS_WRITERS 8
+
+#define LIVE_RESULTS_MAGIC "MVRESLIV"
+
+#define LIVE_RESULTS_VERSION 1
+
+#define LIVE_RESULTS_HEADER_BYTES 64
+
+#define LIVE_RESULTS_PAGE_POINTS 1024
+
+#define LIVE_RESULTS_DATA_ALIGNMENT 4096
+
+#define CB_DUMP_MAGIC "MVCBDUMP"
+
+#define CB_DUMP_VERSION 2
+
+#define CB_DUMP_HEADER_BYTES 56
+
+#define CB_DUMP_FRAME_HEADER_BYTES 16
+
+#define MAX_NO_OF_CB_DUMP_WINDOWS 20
+
+#define MAX_NO_OF_CB_DUMP_PHASES 3
+
+#define CB_DUMP_PHASE_NONE 0
+
+#define CB_DUMP_PHASE_END_DIASTOLE 1
+
+#define CB_DUMP_PHASE_PEAK_SYSTOLE 2
+
+#define CB_DUMP_PHASE_END_SYSTOLE 3
+
+#define CB_DUMP_NO_OF_PHASE_CODES 4
+
+#define TIME_SERIES_CODEC_XOR 0
+
+#define TIME_SERIES_CODEC_DELTA 1
+
+#define TIME_SERIES_CODEC_DELTA_2 2
+
+#define TIME_SERIES_CODEC_NO_OF_MODES 3
 
+#define RESULTS_CODEC_NONE 0
 
+#define RESULTS_CODEC_LOSSLESS 1
@@ -146,6 +146,10 @@ void growth_control::initialise_simulation(void)
 
 	temp_string = "gc_" + to_string(gc_number) + "_slope";
 	p_cmv_results_beat->add_results_field(temp_string, &gc_slope);
+
+	// The output at the end of each beat
+	temp_string = "gc_" + to_string(gc_number) + "_output";
+	p_parent_cmv_system->p_cmv_results_beat_metrics->add_results_field(temp_string, &gc_output);
 }
 
 void growth_control::implement_time_step(double time_step_s, bool new_beat)
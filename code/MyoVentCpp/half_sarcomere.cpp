@@ -9,6 +9,8 @@
 #include "cmv_model.h"
 #include "half_sarcomere.h"
 #include "hemi_vent.h"
+#include "cmv_system.h"
+#include "update_schedule.h"
 #include "cmv_results.h"
 #include "membranes.h"
 #include "mitochondria.h"
@@ -59,6 +61,10 @@ half_sarcomere::half_sarcomere(hemi_vent* set_p_parent_hemi_vent)
 	hs_ATP_concentration = p_cmv_model->hs_initial_ATP_concentration;
 	hs_prop_fibrosis = p_cmv_model->hs_prop_fibrosis;
 	hs_prop_myofilaments = p_cmv_model->hs_prop_myofilaments;
+
+	// Allocate the length solver
+	p_hsl_stress_solver = gsl_root_fsolver_alloc(gsl_root_fsolver_brent);
+	hs_last_equilibrium_delta_hsl = GSL_NAN;
 }
 
 // Destructor
@@ -73,6 +79,8 @@ half_sarcomere::~half_sarcomere(void)
 	delete p_membranes;
 	delete p_mitochondria;
 	delete p_myofilaments;
+
+	gsl_root_fsolver_free(p_hsl_stress_solver);
 }
 
 // Other functions
@@ -92,8 +100,9 @@ void half_sarcomere::initialise_simulation(void)
 	p_cmv_results_beat = p_parent_hemi_vent->p_cmv_results_beat;
 
 	// Now add the results fields
-	p_cmv_results_beat->add_results_field("hs_length", &hs_length);
-	p_cmv_results_beat->add_results_field("hs_stress", &hs_stress);
+	p_cmv_results_beat->hs_length_field_index =
+		p_cmv_results_beat->add_results_field("hs_length", &hs_length, "nm");
+	p_cmv_results_beat->add_results_field("hs_stress", &hs_stress, "N m^-2");
 	p_cmv_results_beat->add_results_field("hs_ATP_used_per_liter_per_s", &hs_ATP_used_per_liter_per_s);
 	p_cmv_results_beat->add_results_field("hs_ATP_concentration", &hs_ATP_concentration);
 
@@ -128,7 +137,11 @@ bool half_sarcomere::implement_time_step(double time_step_s)
 	
 	p_membranes->implement_time_step(time_step_s, new_beat);
 
-	p_mitochondria->implement_time_step(time_step_s);
+	if (p_parent_hemi_vent->p_parent_cmv_system->p_mito_schedule->advance(time_step_s, new_beat))
+	{
+		p_mitochondria->implement_time_step(
+			p_parent_hemi_vent->p_parent_cmv_system->p_mito_schedule->us_time_step_s);
+	}
 
 	p_myofilaments->implement_time_step(time_step_s);
 
@@ -202,14 +215,18 @@ double hsl_stress_root_finder(double x, void* params)
 double half_sarcomere::return_hs_length_for_stress(double target_stress)
 {
 	//! Code returns the hs_length at which force is equal to the target
+	//! The bracket starts narrow around the last solution and is widened
+	//! until it straddles the root, up to the full +/- 500 nm
 
 	// Variables
-	double x_lo = -500;
-	double x_hi = 500;
+	double x_limit = 500;
+	double x_center = 0.0;
+	double half_width = 10.0;
+	double x_lo = -x_limit;
+	double x_hi = x_limit;
 	double r;
 
-	const gsl_root_fsolver_type* T;
-	gsl_root_fsolver* s;
+	gsl_root_fsolver* s = p_hsl_stress_solver;
 
 	gsl_function F;
 	struct gsl_root_params params = { this, target_stress };
@@ -226,8 +243,21 @@ double half_sarcomere::return_hs_length_for_stress(double target_stress)
 	F.function = &hsl_stress_root_finder;
 	F.params = &params;
 
-	T = gsl_root_fsolver_brent;
-	s = gsl_root_fsolver_alloc(T);
+	// Warm-start the bracket
+	if (!gsl_isnan(hs_last_equilibrium_delta_hsl))
+	{
+		x_center = GSL_MAX(-x_limit, GSL_MIN(x_limit, hs_last_equilibrium_delta_hsl));
+
+		do
+		{
+			x_lo = GSL_MAX(-x_limit, x_center - half_width);
+			x_hi = GSL_MIN(x_limit, x_center + half_width);
+			half_width = 2.0 * half_width;
+		}
+		while ((GSL_FN_EVAL(&F, x_lo) * GSL_FN_EVAL(&F, x_hi) > 0.0) &&
+			((x_lo > -x_limit) || (x_hi < x_limit)));
+	}
+
 	gsl_root_fsolver_set(s, &F, x_lo, x_hi);
 
 	do
@@ -242,7 +272,7 @@ double half_sarcomere::return_hs_length_for_stress(double target_stress)
 
 	} while ((status == GSL_CONTINUE) && (iter < max_iter));
 
-	gsl_root_fsolver_free(s);
+	hs_last_equilibrium_delta_hsl = r;
 
 	// Calculate the length
 
@@ -279,21 +309,16 @@ void half_sarcomere::update_beat_metrics(void)
 	//! Update beat metrics
 
 	// Variables
-	stats_structure* p_stats;
+	stats_structure stats;
 
 	// Code
 
-	p_stats = new stats_structure;
-
 	if (p_cmv_results_beat->hs_length_field_index >= 0)
 	{
 		p_cmv_results_beat->calculate_sub_vector_statistics(
 			p_cmv_results_beat->gsl_results_vectors[p_cmv_results_beat->hs_length_field_index],
 			0, p_parent_hemi_vent->p_parent_cmv_system->beat_t_index,
-			p_stats);
+			&stats);
 	}
-
-	// Tidy up
-	delete p_stats;
 }
 
@@ -12,6 +12,8 @@
 
 #include "global_definitions.h"
 
+#include "gsl_roots.h"
+
 // Forward declararations
 class cmv_system;
 class cmv_model;
@@ -82,6 +84,15 @@ public:
 	double hs_delta_G_ATP;							/**< double with energy in Joules
 															per mole of ATP */
 
+	gsl_root_fsolver* p_hsl_stress_solver;			/**< Pointer to the Brent solver
+															used to find the length for
+															a stress, allocated once */
+
+	double hs_last_equilibrium_delta_hsl;			/**< double with the length change
+															found by the last solve, used
+															to center the next bracket,
+															or GSL_NAN before the first */
+
 	/**
 	/* function adds data fields and vectors to the results objet
 	*/
@@ -43,7 +43,8 @@ void heart_rate::initialise_simulation(void)
 	p_cmv_results_beat = p_parent_hs->p_cmv_results_beat;
 
 	// Now add the results fields
-	p_cmv_results_beat->add_results_field("hr_new_beat", &hr_new_beat);
+	p_cmv_results_beat->new_beat_field_index =
+		p_cmv_results_beat->add_results_field("hr_new_beat", &hr_new_beat);
 	p_cmv_results_beat->add_results_field("hr_heart_rate_bpm", &hr_heart_rate_bpm);
 }
 
@@ -16,6 +16,7 @@
 #include "myofilaments.h"
 #include "cmv_results.h"
 #include "cmv_options.h"
+#include "cb_dump_writer.h"
 
 #include "gsl_errno.h"
 #include "gsl_roots.h"
@@ -45,7 +46,23 @@ hemi_vent::hemi_vent(circulation* set_p_parent_circulation)
 
 	// Initialise with safe options
 	p_cmv_results_beat = NULL;
+	p_cmv_results_beat_metrics = NULL;
 	p_cmv_options = NULL;
+	p_cb_dump_writer = NULL;
+
+	// The root finder is called several times each time-step so
+	// allocate it once here
+	p_wall_thickness_solver = gsl_root_fsolver_alloc(gsl_root_fsolver_brent);
+	vent_wall_thickness_tolerance = 1e-5;
+
+	// The geometry cache starts empty
+	vent_geom_no_of_entries = 0;
+	vent_geom_last_entry = -1;
+	vent_geom_n_hits = 0;
+	vent_geom_n_misses = 0;
+	vent_geom_n_newton_iterations = 0;
+	vent_geom_n_brent_fallbacks = 0;
+	vent_report_counters = false;
 
 	vent_wall_density = p_cmv_model->vent_wall_density;
 	vent_wall_volume = p_cmv_model->vent_wall_volume;
@@ -79,9 +96,21 @@ hemi_vent::~hemi_vent(void)
 	//! hemi_vent destructor
 
 	// Tidy up
+	if (p_cb_dump_writer != NULL)
+		delete p_cb_dump_writer;
+
 	delete p_hs;
 	delete p_av;
 	delete p_mv;
+
+	gsl_root_fsolver_free(p_wall_thickness_solver);
+
+	if (vent_report_counters)
+	{
+		cout << "Geometry cache hits: " << vent_geom_n_hits << " misses: " << vent_geom_n_misses <<
+			" Newton iterations: " << vent_geom_n_newton_iterations <<
+			" Brent fallbacks: " << vent_geom_n_brent_fallbacks << "\n";
+	}
 }
 
 // Other functions
@@ -99,6 +128,9 @@ void hemi_vent::initialise_simulation(void)
 	else
 		vent_thick_wall_multiplier = 0.0;
 
+	// The options are deleted before the destructor runs
+	vent_report_counters = (p_cmv_options->report_counters == "True");
+
 	// Now add in the results
 	p_cmv_results_beat = p_parent_circulation->p_cmv_results_beat;
 
@@ -109,6 +141,10 @@ void hemi_vent::initialise_simulation(void)
 
 	p_hs->initialise_simulation();
 
+	// The dump needs the bins of the myofilaments
+	if (!p_cmv_options->cb_dump_file_string.empty())
+		p_cb_dump_writer = new cb_dump_writer(this);
+
 	// Deduce the slack circumference of the ventricle and
 	// set the number of half-sarcomeres
 	// The p_hs->initialisation set hs_length so that stress was 0
@@ -131,13 +167,19 @@ void hemi_vent::initialise_simulation(void)
 	p_cmv_results_beat->add_results_field("vent_chamber_radius", &vent_chamber_radius);
 	p_cmv_results_beat->add_results_field("vent_chamber_height", &vent_chamber_height);
 	p_cmv_results_beat->add_results_field("vent_n_hs", &vent_n_hs);
-	p_cmv_results_beat->add_results_field("vent_stroke_work_J", &vent_stroke_work_J);
-	p_cmv_results_beat->add_results_field("vent_stroke_energy_used_J", &vent_stroke_energy_used_J);
-	p_cmv_results_beat->add_results_field("vent_efficiency", &vent_efficiency);
-	p_cmv_results_beat->add_results_field("vent_ejection_fraction", &vent_ejection_fraction);
-	p_cmv_results_beat->add_results_field("vent_ATP_used_per_s", &vent_ATP_used_per_s);
-	p_cmv_results_beat->add_results_field("vent_stroke_volume", &vent_stroke_volume);
-	p_cmv_results_beat->add_results_field("vent_cardiac_output", &vent_cardiac_output);
+	p_cmv_results_beat->vent_ATP_used_per_s_field_index =
+		p_cmv_results_beat->add_results_field("vent_ATP_used_per_s", &vent_ATP_used_per_s);
+
+	// The beat metrics have one value per beat, so they go in the
+	// beat metrics table
+	p_cmv_results_beat_metrics = p_parent_cmv_system->p_cmv_results_beat_metrics;
+
+	p_cmv_results_beat_metrics->add_results_field("vent_stroke_work_J", &vent_stroke_work_J, "J");
+	p_cmv_results_beat_metrics->add_results_field("vent_stroke_energy_used_J", &vent_stroke_energy_used_J, "J");
+	p_cmv_results_beat_metrics->add_results_field("vent_efficiency", &vent_efficiency);
+	p_cmv_results_beat_metrics->add_results_field("vent_ejection_fraction", &vent_ejection_fraction);
+	p_cmv_results_beat_metrics->add_results_field("vent_stroke_volume", &vent_stroke_volume, "liters");
+	p_cmv_results_beat_metrics->add_results_field("vent_cardiac_output", &vent_cardiac_output, "liters min^-1");
 }
 
 bool hemi_vent::implement_time_step(double time_step_s)
@@ -219,8 +261,7 @@ double hemi_vent::wall_thickness_root_finder(double cv)
 	double x_hi = 0.05;
 	double x;
 
-	const gsl_root_fsolver_type* T;
-	gsl_root_fsolver* s;
+	gsl_root_fsolver* s = p_wall_thickness_solver;
 
 	gsl_function F;
 	struct gsl_thickness_root_params params = { this, cv, vent_wall_volume };
@@ -229,16 +270,14 @@ double hemi_vent::wall_thickness_root_finder(double cv)
 	int iter = 0;
 	int max_iter = 100;
 
-	double epsabs = 1e-5;
-	double epsrel = 1e-5;
+	double epsabs = vent_wall_thickness_tolerance;
+	double epsrel = vent_wall_thickness_tolerance;
 
 	// Code
 
 	F.function = &hemi_vent_thickness_root_finder;
 	F.params = &params;
 
-	T = gsl_root_fsolver_brent;
-	s = gsl_root_fsolver_alloc(T);
 	gsl_root_fsolver_set(s, &F, x_lo, x_hi);
 
 	do
@@ -252,12 +291,124 @@ double hemi_vent::wall_thickness_root_finder(double cv)
 		status = gsl_root_test_interval(x_lo, x_hi, epsabs, epsrel);
 	} while ((status == GSL_CONTINUE) && (iter < max_iter));
 
-	gsl_root_fsolver_free(s);
-
 	// Return thickness
 	return x;
 }
 
+int hemi_vent::return_geometry_index(double cv)
+{
+	//! Function returns the index of the geometry cache entry for a
+	//! chamber volume at the current hs_length and wall volume, solving
+	//! for the geometry if it is not already held
+	//! The entries are replaced in turn, and a new solve starts from the
+	//! wall thickness of the last entry
+
+	// Variables
+	int index;
+
+	double r;
+	double h;
+	double thickness;
+
+	// Code
+	for (int i = 0; i < vent_geom_no_of_entries; i++)
+	{
+		if ((vent_geom_volume[i] == cv) &&
+			(vent_geom_hs_length[i] == p_hs->hs_length) &&
+			(vent_geom_wall_volume[i] == vent_wall_volume))
+		{
+			vent_geom_n_hits = vent_geom_n_hits + 1;
+			return i;
+		}
+	}
+
+	vent_geom_n_misses = vent_geom_n_misses + 1;
+
+	// Solve
+	r = return_internal_radius_for_chamber_volume(cv);
+	h = return_chamber_height(r);
+
+	if (!newton_wall_thickness(cv, r, h, &thickness))
+	{
+		thickness = wall_thickness_root_finder(cv);
+		vent_geom_n_brent_fallbacks = vent_geom_n_brent_fallbacks + 1;
+	}
+
+	// Store
+	if (vent_geom_no_of_entries < VENT_GEOMETRY_CACHE_SIZE)
+	{
+		index = vent_geom_no_of_entries;
+		vent_geom_no_of_entries = vent_geom_no_of_entries + 1;
+	}
+	else
+	{
+		index = (vent_geom_last_entry + 1) % VENT_GEOMETRY_CACHE_SIZE;
+	}
+
+	vent_geom_volume[index] = cv;
+	vent_geom_hs_length[index] = p_hs->hs_length;
+	vent_geom_wall_volume[index] = vent_wall_volume;
+	vent_geom_thickness[index] = thickness;
+	vent_geom_radius[index] = r;
+	vent_geom_height[index] = h;
+	vent_geom_circumference[index] = 2.0 * M_PI * (r + (0.5 * thickness));
+
+	vent_geom_last_entry = index;
+
+	return index;
+}
+
+bool hemi_vent::newton_wall_thickness(double cv, double r, double h, double* p_thickness)
+{
+	//! Function solves for the wall thickness x with Newton's method,
+	//! starting from the last thickness that was found
+	//! The wall volume is
+	//!		f(x) = k * (r + x)^2 * (h + x) - cv
+	//! with k = 1000 * (2 / 3) * pi, and
+	//!		f'(x) = k * (2 * (r + x) * (h + x) + (r + x)^2)
+	//! f is increasing and convex for x >= 0, so the iterates converge
+	//! quickly from a nearby start. Returns false if they leave the
+	//! bracket used by the Brent root finder, or do not converge
+
+	// Variables
+	double k = 1000.0 * (2.0 / 3.0) * M_PI;
+
+	double x;
+	double dx;
+	double f;
+	double df;
+
+	int max_iter = 20;
+
+	// Code
+	if (vent_geom_last_entry < 0)
+		return false;
+
+	x = vent_geom_thickness[vent_geom_last_entry];
+
+	for (int iter = 0; iter < max_iter; iter++)
+	{
+		vent_geom_n_newton_iterations = vent_geom_n_newton_iterations + 1;
+
+		f = (k * (r + x) * (r + x) * (h + x)) - cv - vent_wall_volume;
+		df = k * ((2.0 * (r + x) * (h + x)) + ((r + x) * (r + x)));
+
+		dx = f / df;
+		x = x - dx;
+
+		if ((x <= 0.0) || (x >= 0.05) || (gsl_isnan(x)))
+			return false;
+
+		if (fabs(dx) <= (vent_wall_thickness_tolerance * vent_wall_thickness_tolerance * x))
+		{
+			*p_thickness = x;
+			return true;
+		}
+	}
+
+	return false;
+}
+
 double hemi_vent::return_wall_thickness_for_chamber_volume(double cv)
 {
 	//! Code sets object value of wall thickness
@@ -269,7 +420,7 @@ double hemi_vent::return_wall_thickness_for_chamber_volume(double cv)
 
 	// Code
 
-	thickness = wall_thickness_root_finder(cv);
+	thickness = vent_geom_thickness[return_geometry_index(cv)];
 
 	/*
 
@@ -300,14 +451,10 @@ double hemi_vent::return_lv_circumference_for_chamber_volume(double cv)
 	//! based on 2 * pi * (internal_r + wall_thickness)
 
 	// Variables
-	double thickness;
 	double lv_circum;
 
 	// Code
-	thickness = return_wall_thickness_for_chamber_volume(cv);
-
-	lv_circum = 2.0 * M_PI *
-		(return_internal_radius_for_chamber_volume(cv) + (0.5 * thickness));
+	lv_circum = vent_geom_circumference[return_geometry_index(cv)];
 
 	return lv_circum;
 }
@@ -347,8 +494,12 @@ double hemi_vent::return_pressure_for_chamber_volume(double cv)
 	double P_in_Pascals;
 	double P_in_mmHg;
 
+	int geom_index;
+
 	// Code
-	new_lv_circumference = return_lv_circumference_for_chamber_volume(cv);
+	geom_index = return_geometry_index(cv);
+
+	new_lv_circumference = vent_geom_circumference[geom_index];
 
 	new_hs_length = 1.0e9 * new_lv_circumference / vent_n_hs;
 
@@ -359,9 +510,9 @@ double hemi_vent::return_pressure_for_chamber_volume(double cv)
 
 	new_stress = GSL_MAX(-1000.0, new_stress);
 
-	internal_r = return_internal_radius_for_chamber_volume(cv);
+	internal_r = vent_geom_radius[geom_index];
 
-	vent_wall_thickness = return_wall_thickness_for_chamber_volume(cv);
+	vent_wall_thickness = vent_geom_thickness[geom_index];
 
 	// Pressure from Laplace's law
 	// https://www.annalsthoracicsurgery.org/action/showPdf?pii=S0003-4975%2810%2901981-8
@@ -410,8 +561,8 @@ void hemi_vent::update_chamber_volume(double new_volume)
 	vent_circumference = new_circumference;
 
 	// Dump if necessary
-	if (!p_cmv_options->cb_dump_file_string.empty())
-		p_hs->p_myofilaments->dump_cb_distributions();
+	if (p_cb_dump_writer != NULL)
+		p_cb_dump_writer->update(p_parent_cmv_system->cum_time_s, p_parent_cmv_system->sim_t_index);
 }
 
 void hemi_vent::update_beat_metrics()
@@ -427,51 +578,25 @@ void hemi_vent::update_beat_metrics()
 	vent_efficiency = -vent_stroke_work_J / vent_stroke_energy_used_J;
 
 	// Calculate the ejection fraction
-	stats_structure* p_v_stats = new stats_structure;
+	stats_structure v_stats;
 
 	// Calculate stroke volume
 	p_cmv_results_beat->calculate_sub_vector_statistics(
 		p_cmv_results_beat->gsl_results_vectors[p_cmv_results_beat->volume_vent_field_index],
-		0, p_parent_cmv_system->beat_t_index, p_v_stats);
+		0, p_parent_cmv_system->beat_t_index, &v_stats);
 
-	vent_stroke_volume = p_v_stats->max_value - p_v_stats->min_value;
+	vent_stroke_volume = v_stats.max_value - v_stats.min_value;
 
-	vent_ejection_fraction = vent_stroke_volume / p_v_stats->max_value;
+	vent_ejection_fraction = vent_stroke_volume / v_stats.max_value;
 
 	// Calculate period of cardiac cycle to get cardiac output
-	cardiac_cycle_s = p_parent_cmv_system->cum_time_s -
-		gsl_vector_get(p_cmv_results_beat->gsl_results_vectors[p_cmv_results_beat->time_field_index], 0);
+	cardiac_cycle_s = p_parent_cmv_system->beat_rr_interval_s;
 
 	if (cardiac_cycle_s > 0.0)
 	{
 		vent_cardiac_output = 60.0 * vent_stroke_volume / cardiac_cycle_s;
 	}
 
-	// Backfill results
-	p_cmv_results_beat->backfill_beat_data(
-		p_cmv_results_beat->gsl_results_vectors[p_cmv_results_beat->vent_stroke_work_field_index],
-		vent_stroke_work_J, 0, p_parent_cmv_system->beat_t_index);
-
-	p_cmv_results_beat->backfill_beat_data(
-		p_cmv_results_beat->gsl_results_vectors[p_cmv_results_beat->vent_stroke_energy_used_field_index],
-		vent_stroke_energy_used_J, 0, p_parent_cmv_system->beat_t_index);
-
-	p_cmv_results_beat->backfill_beat_data(
-		p_cmv_results_beat->gsl_results_vectors[p_cmv_results_beat->vent_efficiency_field_index],
-		vent_efficiency, 0, p_parent_cmv_system->beat_t_index);
-
-	p_cmv_results_beat->backfill_beat_data(
-		p_cmv_results_beat->gsl_results_vectors[p_cmv_results_beat->vent_ejection_fraction_field_index],
-		vent_ejection_fraction, 0, p_parent_cmv_system->beat_t_index);
-
-	p_cmv_results_beat->backfill_beat_data(
-		p_cmv_results_beat->gsl_results_vectors[p_cmv_results_beat->vent_stroke_volume_field_index],
-		vent_stroke_volume, 0, p_parent_cmv_system->beat_t_index);
-
-	p_cmv_results_beat->backfill_beat_data(
-		p_cmv_results_beat->gsl_results_vectors[p_cmv_results_beat->vent_cardiac_output_field_index],
-		vent_cardiac_output, 0, p_parent_cmv_system->beat_t_index);
-
 	// Update hs metrics
 	p_hs->update_beat_metrics();
 }
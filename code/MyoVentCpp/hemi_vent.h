@@ -12,6 +12,8 @@
 
 #include "global_definitions.h"
 
+#include "gsl_roots.h"
+
 // Forward declararations
 class cmv_model;
 class cmv_system;
@@ -21,6 +23,7 @@ class circulation;
 
 class cmv_results;
 class cmv_options;
+class cb_dump_writer;
 
 class hemi_vent
 {
@@ -46,6 +49,11 @@ public:
 													resolution for the last
 													beat */
 
+	cmv_results* p_cmv_results_beat_metrics;
+											/**< pointer to cmv_results object
+													defining the metrics that
+													are written once per beat */
+
 	cmv_options* p_cmv_options;				/**< pointer to cmv_options object */
 
 	circulation* p_parent_circulation;		/**< pointer the parent circulation */
@@ -56,6 +64,10 @@ public:
 
 	half_sarcomere* p_hs;					/**< pointer to child half-sarcomere */
 
+	cb_dump_writer* p_cb_dump_writer;		/**< pointer to the cb_dump_writer,
+													NULL if the cb distributions
+													are not dumped */
+
 	double vent_wall_density;				/**< double with wall density in kg m^-3 */
 
 	double vent_wall_volume;				/**< double with wall volume in liters */
@@ -88,6 +100,66 @@ public:
 													1.0 if using thick wall approximation
 													0.0 if not */
 
+	gsl_root_fsolver* p_wall_thickness_solver;
+											/**< pointer to the Brent solver used
+													by wall_thickness_root_finder,
+													allocated once and re-used */
+
+	double vent_wall_thickness_tolerance;	/**< double with the absolute and
+													relative tolerance for the
+													wall thickness root finder */
+
+	double vent_geom_volume[VENT_GEOMETRY_CACHE_SIZE];
+											/**< doubles with the chamber volume
+													of each geometry cache entry */
+
+	double vent_geom_hs_length[VENT_GEOMETRY_CACHE_SIZE];
+											/**< doubles with the hs_length of
+													each geometry cache entry */
+
+	double vent_geom_wall_volume[VENT_GEOMETRY_CACHE_SIZE];
+											/**< doubles with the wall volume of
+													each geometry cache entry */
+
+	double vent_geom_thickness[VENT_GEOMETRY_CACHE_SIZE];
+											/**< doubles with the wall thickness
+													in m for each entry */
+
+	double vent_geom_radius[VENT_GEOMETRY_CACHE_SIZE];
+											/**< doubles with the internal radius
+													in m for each entry */
+
+	double vent_geom_height[VENT_GEOMETRY_CACHE_SIZE];
+											/**< doubles with the chamber height
+													in m for each entry */
+
+	double vent_geom_circumference[VENT_GEOMETRY_CACHE_SIZE];
+											/**< doubles with the circumference
+													in m for each entry */
+
+	int vent_geom_no_of_entries;			/**< integer with the number of
+													entries in the cache */
+
+	int vent_geom_last_entry;				/**< integer with the index of the
+													last entry that was added,
+													which warm-starts the next
+													solve */
+
+	long long vent_geom_n_hits;				/**< counter for geometry cache hits */
+
+	long long vent_geom_n_misses;			/**< counter for geometry cache misses */
+
+	long long vent_geom_n_newton_iterations;
+											/**< counter for Newton iterations
+													for the wall thickness */
+
+	long long vent_geom_n_brent_fallbacks;	/**< counter for wall thickness
+													solves that fell back to
+													the Brent root finder */
+
+	bool vent_report_counters;				/**< true if the counters are
+													printed by the destructor */
+
 	double vent_stroke_work_J;				/**< double with stroke work in J for a cardiac cycle */
 
 	double vent_stroke_energy_used_J;		/**< double with energy_used in J for a cardiac cycle */
@@ -113,6 +185,10 @@ public:
 
 	double wall_thickness_root_finder(double cv);
 
+	int return_geometry_index(double cv);
+
+	bool newton_wall_thickness(double cv, double r, double h, double* p_thickness);
+
 	double return_internal_radius_for_chamber_volume(double cv);
 
 	double return_chamber_height(double r);
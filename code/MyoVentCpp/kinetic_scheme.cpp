@@ -19,6 +19,8 @@
 #include "JSON_functions.h"
 #include "rapidjson\document.h"
 
+#include "gsl_math.h"
+
 using namespace std::filesystem;
 using namespace std;
 
@@ -35,6 +37,13 @@ kinetic_scheme::kinetic_scheme(const rapidjson::Value& m_ks, cmv_model* set_p_cm
 	// Set other options safely
 	p_cmv_options = NULL;
 	p_parent_myofilaments = NULL;
+	rate_table = NULL;
+
+	no_of_compiled_transitions = 0;
+
+	rate_table_hs_stress = GSL_NAN;
+	rate_table_hs_length = GSL_NAN;
+	invalidate_rate_table();
 
 	// Pull no_of_states
 	JSON_functions::check_JSON_member_int(m_ks, "no_of_states");
@@ -93,6 +102,11 @@ kinetic_scheme::~kinetic_scheme(void)
 	{
 		delete p_m_states[state_counter];
 	}
+
+	if (rate_table != NULL)
+	{
+		gsl_matrix_free(rate_table);
+	}
 }
 
 // Functions
@@ -203,12 +217,324 @@ void kinetic_scheme::initialise_simulation(myofilaments* set_p_parent_myofilamen
 		}
 	}
 
+	// Allocate the rate table, one row for each possible transition,
+	// one column for each bin position
+	if (rate_table != NULL)
+	{
+		gsl_matrix_free(rate_table);
+	}
+
+	rate_table = gsl_matrix_alloc((size_t)(no_of_states * max_no_of_transitions),
+		(size_t)p_parent_myofilaments->no_of_bin_positions);
+	gsl_matrix_set_zero(rate_table);
+
+	// Make sure it is calculated on the first time-step
+	invalidate_rate_table();
+
+	// Flatten the scheme for the derivative loop
+	compile_transitions();
+
+	// The rate table is filled by the batch kernels, so make sure they
+	// agree with the reference calculation before the simulation starts
+	check_rate_kernels();
+
 	if (p_cmv_options->rates_dump_file_string != "")
 	{
 		write_rate_functions_to_file();
 	}
 }
 
+void kinetic_scheme::compile_transitions(void)
+{
+	//! Builds a flat list of the allowed transitions with their types and
+	//! y indices resolved so that the derivative loop does not have to walk
+	//! the states. Needs the m_y_indices of the parent myofilaments
+
+	// Variables
+	int new_state;
+	int attached_counter;
+
+	int attached_position[MAX_NO_OF_KINETIC_STATES];
+
+	bool from_attached;
+	bool to_attached;
+
+	compiled_transition* p_ct;
+	transition* p_trans;
+
+	gsl_matrix_int* p_y_indices = p_parent_myofilaments->m_y_indices;
+
+	// Code
+
+	no_of_compiled_transitions = 0;
+	attached_counter = 0;
+
+	// Work out where each attached state sits in the attached ranges
+	for (int state_counter = 0; state_counter < no_of_states; state_counter++)
+	{
+		if ((p_m_states[state_counter]->state_type != 'S') &&
+			(p_m_states[state_counter]->state_type != 'D'))
+		{
+			attached_position[state_counter] = attached_counter;
+			attached_counter = attached_counter + 1;
+		}
+		else
+		{
+			attached_position[state_counter] = -1;
+		}
+	}
+
+	attached_counter = 0;
+
+	for (int state_counter = 0; state_counter < no_of_states; state_counter++)
+	{
+		from_attached = ((p_m_states[state_counter]->state_type != 'S') &&
+			(p_m_states[state_counter]->state_type != 'D'));
+
+		if (from_attached)
+		{
+			attached_y_start[attached_counter] = gsl_matrix_int_get(p_y_indices, state_counter, 0);
+			attached_y_stop[attached_counter] = gsl_matrix_int_get(p_y_indices, state_counter, 1);
+			attached_counter = attached_counter + 1;
+		}
+
+		for (int t_counter = 0; t_counter < max_no_of_transitions; t_counter++)
+		{
+			p_trans = p_m_states[state_counter]->p_transitions[t_counter];
+			new_state = p_trans->new_state;
+
+			if (new_state == 0)
+			{
+				// Transition is not allowed - skip out
+				continue;
+			}
+
+			to_attached = ((p_m_states[new_state - 1]->state_type != 'S') &&
+				(p_m_states[new_state - 1]->state_type != 'D'));
+
+			p_ct = &compiled_transitions[no_of_compiled_transitions];
+
+			if (from_attached)
+			{
+				if (to_attached)
+					p_ct->type = ct_A_to_A;
+				else
+					p_ct->type = ct_A_to_D;
+			}
+			else
+			{
+				if (to_attached)
+					p_ct->type = ct_D_to_A;
+				else
+					p_ct->type = ct_D_to_D;
+			}
+
+			p_ct->rate_row = (state_counter * max_no_of_transitions) + t_counter;
+			p_ct->from_index = gsl_matrix_int_get(p_y_indices, state_counter, 0);
+			p_ct->to_index = gsl_matrix_int_get(p_y_indices, new_state - 1, 0);
+			p_ct->ATP_required = (p_trans->ATP_required == 'y');
+			p_ct->from_attached = attached_position[state_counter];
+			p_ct->to_attached = attached_position[new_state - 1];
+
+			no_of_compiled_transitions = no_of_compiled_transitions + 1;
+		}
+	}
+
+	if (attached_counter != no_of_attached_states)
+	{
+		cout << "Error: kinetic_scheme has states that are neither S, D, nor A\n";
+		exit(1);
+	}
+}
+
+void kinetic_scheme::update_rate_table(double hs_stress, double hs_length)
+{
+	//! Recalculates the rows of the rate table that are out of date
+	//! Rates that only depend on bin position are calculated once and
+	//! then re-used until the rate parameters change
+
+	// Variables
+	bool stress_changed;
+	bool length_changed;
+
+	int row_index;
+	int new_state;
+
+	double x_ext;
+
+	m_state* p_m_state;
+	transition* p_trans;
+
+	double* rate_row;
+
+	int no_of_bins = p_parent_myofilaments->no_of_bin_positions;
+
+	const double* x_bins = gsl_vector_const_ptr(p_parent_myofilaments->x, 0);
+
+	// Code
+
+	stress_changed = (hs_stress != rate_table_hs_stress);
+	length_changed = (hs_length != rate_table_hs_length);
+
+	for (int state_counter = 0; state_counter < no_of_states; state_counter++)
+	{
+		p_m_state = p_m_states[state_counter];
+
+		for (int t_counter = 0; t_counter < max_no_of_transitions; t_counter++)
+		{
+			p_trans = p_m_state->p_transitions[t_counter];
+			new_state = p_trans->new_state;
+
+			if (new_state == 0)
+			{
+				// Transition is not allowed - skip out
+				continue;
+			}
+
+			row_index = (state_counter * max_no_of_transitions) + t_counter;
+
+			if ((rate_table_row_valid[row_index]) &&
+				(!(stress_changed && p_trans->rate_depends_on_force)) &&
+				(!(length_changed && p_trans->rate_depends_on_hs_length)))
+			{
+				// Row is up to date
+				continue;
+			}
+
+			rate_row = gsl_matrix_ptr(rate_table, row_index, 0);
+
+			if ((p_m_state->state_type != 'A') &&
+				(p_m_states[new_state - 1]->state_type != 'A'))
+			{
+				// Detached to detached transitions do not depend on x
+				double rate = p_trans->calculate_rate(0, 0, hs_stress, hs_length);
+
+				for (int bin_index = 0; bin_index < no_of_bins; bin_index++)
+				{
+					rate_row[bin_index] = rate;
+				}
+			}
+			else
+			{
+				x_ext = p_m_state->extension;
+
+				// Fill the row in a single pass
+				p_trans->calculate_rates(x_bins, rate_row, no_of_bins,
+					x_ext, hs_stress, hs_length);
+			}
+
+			rate_table_row_valid[row_index] = true;
+		}
+	}
+
+	// Note the values the table now corresponds to
+	rate_table_hs_stress = hs_stress;
+	rate_table_hs_length = hs_length;
+}
+
+void kinetic_scheme::check_rate_kernels(void)
+{
+	//! Compares transition::calculate_rates() with the reference
+	//! transition::calculate_rate() for every allowed transition at each
+	//! bin position, and stops the run if they differ
+	//! Each transition is checked at a few values of force and length,
+	//! and with NaN inputs, which must give NaN from both, so that a bad
+	//! value is not hidden by the clamp to max_rate
+	//! Runs once, before the simulation loop
+
+	// Variables
+	int no_of_bins = p_parent_myofilaments->no_of_bin_positions;
+	int no_of_x = no_of_bins + 1;
+
+	double test_force[] = { 0.0, 1e5, GSL_NAN };
+	double test_length[] = { 1100.0, 900.0, GSL_NAN };
+	int no_of_tests = 3;
+
+	double* x_test;
+	double* batch_rates;
+
+	double reference;
+	double x_ext;
+
+	bool match;
+
+	transition* p_trans;
+
+	// Code
+	x_test = (double*)malloc(no_of_x * sizeof(double));
+	batch_rates = (double*)malloc(no_of_x * sizeof(double));
+
+	// The bin positions followed by a NaN
+	for (int i = 0; i < no_of_bins; i++)
+		x_test[i] = gsl_vector_get(p_parent_myofilaments->x, i);
+
+	x_test[no_of_bins] = GSL_NAN;
+
+	for (int state_counter = 0; state_counter < no_of_states; state_counter++)
+	{
+		x_ext = p_m_states[state_counter]->extension;
+
+		for (int t_counter = 0; t_counter < max_no_of_transitions; t_counter++)
+		{
+			p_trans = p_m_states[state_counter]->p_transitions[t_counter];
+
+			if (p_trans->new_state == 0)
+				continue;
+
+			for (int test = 0; test < no_of_tests; test++)
+			{
+				p_trans->calculate_rates(x_test, batch_rates, no_of_x, x_ext,
+					test_force[test], test_length[test]);
+
+				for (int i = 0; i < no_of_x; i++)
+				{
+					reference = p_trans->calculate_rate(x_test[i], x_ext,
+						test_force[test], test_length[test]);
+
+					if (gsl_isnan(reference) || gsl_isnan(batch_rates[i]))
+						match = (gsl_isnan(reference) && gsl_isnan(batch_rates[i]));
+					else
+						match = (fabs(reference - batch_rates[i]) <=
+							(1e-9 * GSL_MAX(1.0, fabs(reference))));
+
+					if (!match)
+					{
+						cout << "Error: rate mismatch for state " << (state_counter + 1) <<
+							" transition " << (t_counter + 1) << " (" << p_trans->rate_type <<
+							") at x: " << x_test[i] << " force: " << test_force[test] <<
+							" hs_length: " << test_length[test] <<
+							" reference: " << reference << " batch: " << batch_rates[i] << "\n";
+						exit(1);
+					}
+				}
+			}
+		}
+	}
+
+	free(x_test);
+	free(batch_rates);
+}
+
+void kinetic_scheme::invalidate_rate_table(int state_index, int transition_index)
+{
+	//! Marks rows of the rate table for recalculation
+	//! Called with no arguments, all of the rows are invalidated
+
+	// Code
+
+	if ((state_index < 0) || (transition_index < 0))
+	{
+		for (int i = 0; i < (MAX_NO_OF_KINETIC_STATES * MAX_NO_OF_TRANSITIONS); i++)
+		{
+			rate_table_row_valid[i] = false;
+		}
+	}
+	else
+	{
+		rate_table_row_valid[(state_index * max_no_of_transitions) + transition_index] = false;
+	}
+}
+
 void kinetic_scheme::write_rate_functions_to_file(void)
 {
 	//! Writes rate functions to output file based on data in p_cmv_options
@@ -12,6 +12,7 @@
 #include "JSON_functions.h"
 
 #include "gsl_vector.h"
+#include "gsl_matrix.h"
 
 #include "global_definitions.h"
 
@@ -23,6 +24,33 @@ class myofilaments;
 
 using namespace std;
 
+/**
+* enum for the type of a compiled transition, named by the
+* states the cross-bridges leave and arrive at
+*/
+enum compiled_transition_type { ct_D_to_D, ct_D_to_A, ct_A_to_D, ct_A_to_A };
+
+/**
+* struct holding a transition with everything the derivative
+* loop needs already resolved
+*/
+struct compiled_transition {
+	compiled_transition_type type;			/**< type of the transition */
+	int rate_row;							/**< row in the rate_table */
+	int from_index;							/**< first index in y of the
+													state being left */
+	int to_index;							/**< first index in y of the
+													state being entered */
+	int from_attached;						/**< position of the state being
+													left in the attached ranges,
+													-1 if it is detached */
+	int to_attached;						/**< position of the state being
+													entered in the attached ranges,
+													-1 if it is detached */
+	bool ATP_required;						/**< true if the transition
+													needs ATP */
+};
+
 class kinetic_scheme
 {
 public:
@@ -51,6 +79,39 @@ public:
 	m_state* p_m_states[MAX_NO_OF_KINETIC_STATES];
 											/**< pointer to an array of m_state objects */
 
+	gsl_matrix* rate_table;					/**< gsl_matrix holding the rate of each
+													transition at each bin position
+													row is (state_index *
+														max_no_of_transitions) +
+														transition_index
+													column is bin index */
+
+	bool rate_table_row_valid[MAX_NO_OF_KINETIC_STATES * MAX_NO_OF_TRANSITIONS];
+											/**< array of bools, false if the
+													corresponding row of the rate_table
+													has to be recalculated */
+
+	double rate_table_hs_stress;			/**< double with the hs_stress used to
+													calculate force-dependent rows */
+
+	double rate_table_hs_length;			/**< double with the hs_length used to
+													calculate length-dependent rows */
+
+	compiled_transition compiled_transitions[MAX_NO_OF_KINETIC_STATES * MAX_NO_OF_TRANSITIONS];
+											/**< array of the allowed transitions,
+													built by compile_transitions */
+
+	int no_of_compiled_transitions;			/**< int with the number of entries
+													in compiled_transitions */
+
+	int attached_y_start[MAX_NO_OF_KINETIC_STATES];
+											/**< array of ints with the first index
+													in y for each attached state */
+
+	int attached_y_stop[MAX_NO_OF_KINETIC_STATES];
+											/**< array of ints with the last index
+													in y for each attached state */
+
 	// Functions
 
 	/**
@@ -79,6 +140,40 @@ public:
 	*/
 	void initialise_simulation(myofilaments* set_p_parent_myofilaments);
 
+	/**
+	* void compile_transitions(void)
+	* builds compiled_transitions and the attached ranges from the states
+	* and the y indices of the parent myofilaments
+	* @return void
+	*/
+	void compile_transitions(void);
+
+	/**
+	* void update_rate_table(double hs_stress, double hs_length)
+	* recalculates rows of the rate_table that have been invalidated or
+	* that depend on hs_stress or hs_length if those values have changed
+	* @return void
+	*/
+	void update_rate_table(double hs_stress, double hs_length);
+
+	/**
+	* void check_rate_kernels(void)
+	* checks the batch rate calculation against the reference for every
+	* allowed transition at each bin position, including NaN inputs, and
+	* exits with an error if they differ
+	* @return void
+	*/
+	void check_rate_kernels(void);
+
+	/**
+	* void invalidate_rate_table(int state_index, int transition_index)
+	* marks a row of the rate table for recalculation, or all rows if
+	* called with the default arguments. Must be called whenever
+	* rate_parameters are changed
+	* @return void
+	*/
+	void invalidate_rate_table(int state_index = -1, int transition_index = -1);
+
 	/**
 	* void write_kinetic_scheme_to_file(char output_file_string)
 	* writes kinetic_scheme to specified file in JSON format
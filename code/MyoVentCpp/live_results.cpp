@@ -0,0 +1,296 @@
+/**
+/* @file		live_results.cpp
+/* @brief		Source file for a live_results object
+/* @author		Ken Campbell
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <filesystem>
+#include <string>
+#include <atomic>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include "live_results.h"
+#include "cmv_results.h"
+#include "cmv_system.h"
+#include "cmv_options.h"
+
+using namespace std;
+using namespace std::filesystem;
+
+// Constructor
+live_results::live_results(cmv_results* set_p_layout, string set_file_string,
+	long long set_capacity_points)
+{
+	//! Constructor
+	//! The file is mapped in the byte order of the machine, which is
+	//! little-endian on the platforms the model runs on. It holds
+	//!		a header of LIVE_RESULTS_HEADER_BYTES
+	//!			char[8] LIVE_RESULTS_MAGIC, uint32 version,
+	//!			uint32 no_of_fields, uint32 page_points,
+	//!			uint32 complete (0 while running, 1 when the run has ended),
+	//!			uint64 capacity in time-points, uint64 committed time-points,
+	//!			int32 system_id, uint32 unused, double summary time-step in s
+	//!			(0 if the rows are not evenly spaced), uint64 offset of the
+	//!			first page
+	//!		for each field, uint32 length and name, uint32 length and units
+	//!		the pages, starting on a LIVE_RESULTS_DATA_ALIGNMENT boundary,
+	//!			each holding page_points doubles for each field in turn
+	//! Time-point i of field f is at
+	//!		offset + 8 * (((i / page_points) * no_of_fields + f) * page_points
+	//!			+ (i % page_points))
+	//! Rows below the committed counter are final. A reader polls the
+	//! counter and reads the new rows in place
+
+	// Variables
+	unsigned char* p_header;
+	unsigned char* p_fields;
+
+	unsigned int uint_value;
+	unsigned long long ull_value;
+	int int_value;
+	double double_value;
+
+	int f;
+
+	long long fields_bytes;
+
+	cmv_system* p_cmv_system;
+
+	// Code
+	p_layout = set_p_layout;
+	lr_file_string = set_file_string;
+
+	p_cmv_system = p_layout->p_parent_cmv_system;
+
+	lr_no_of_fields = p_layout->no_of_output_fields;
+	lr_capacity_points = (set_capacity_points > 0) ? set_capacity_points : 1;
+
+	lr_rows_added = 0;
+	lr_rows_dropped = 0;
+	lr_n_commits = 0;
+
+	p_map = NULL;
+	p_data = NULL;
+	p_committed_rows = NULL;
+
+	// Work out the size
+	fields_bytes = 0;
+	for (int i = 0; i < lr_no_of_fields; i++)
+	{
+		f = p_layout->output_field_indices[i];
+		fields_bytes = fields_bytes + 8 + p_layout->results_fields[f].length() +
+			p_layout->results_units[f].length();
+	}
+
+	lr_data_offset = LIVE_RESULTS_HEADER_BYTES + fields_bytes;
+	lr_data_offset = LIVE_RESULTS_DATA_ALIGNMENT *
+		((lr_data_offset + LIVE_RESULTS_DATA_ALIGNMENT - 1) / LIVE_RESULTS_DATA_ALIGNMENT);
+
+	lr_no_of_pages = (lr_capacity_points + LIVE_RESULTS_PAGE_POINTS - 1) / LIVE_RESULTS_PAGE_POINTS;
+
+	lr_file_bytes = lr_data_offset +
+		(lr_no_of_pages * lr_no_of_fields * LIVE_RESULTS_PAGE_POINTS * (long long)sizeof(double));
+
+	// Make sure the directory exists
+	path live_file_path(lr_file_string);
+
+	if ((live_file_path.has_parent_path()) &&
+		(!(is_directory(live_file_path.parent_path()))))
+	{
+		if (!(create_directories(live_file_path.parent_path())))
+		{
+			cout << "\nError: Live results folder could not be created: " <<
+				live_file_path.parent_path().string() << "\n";
+			exit(1);
+		}
+	}
+
+	// Create and map the file
+#ifdef _WIN32
+	h_file = CreateFileA(lr_file_string.c_str(), GENERIC_READ | GENERIC_WRITE,
+		FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (h_file == INVALID_HANDLE_VALUE)
+	{
+		cout << "Live results file: " << lr_file_string << " could not be opened\n";
+		exit(1);
+	}
+
+	h_mapping = CreateFileMappingA(h_file, NULL, PAGE_READWRITE,
+		(DWORD)(lr_file_bytes >> 32), (DWORD)(lr_file_bytes & 0xFFFFFFFF), NULL);
+
+	if (h_mapping != NULL)
+		p_map = (unsigned char*)MapViewOfFile(h_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+#else
+	fd = open(lr_file_string.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	if (fd < 0)
+	{
+		cout << "Live results file: " << lr_file_string << " could not be opened\n";
+		exit(1);
+	}
+
+	if (ftruncate(fd, (off_t)lr_file_bytes) == 0)
+	{
+		p_map = (unsigned char*)mmap(NULL, (size_t)lr_file_bytes, PROT_READ | PROT_WRITE,
+			MAP_SHARED, fd, 0);
+
+		if (p_map == (unsigned char*)MAP_FAILED)
+			p_map = NULL;
+	}
+#endif
+
+	if (p_map == NULL)
+	{
+		cout << "Live results file: " << lr_file_string << " could not be mapped with " <<
+			lr_file_bytes << " bytes\n";
+		exit(1);
+	}
+
+	// The file is new, so the data and the counter are zero
+
+	// Header
+	p_header = p_map;
+
+	memcpy(&p_header[0], LIVE_RESULTS_MAGIC, 8);
+	uint_value = LIVE_RESULTS_VERSION;
+	memcpy(&p_header[8], &uint_value, 4);
+	uint_value = lr_no_of_fields;
+	memcpy(&p_header[12], &uint_value, 4);
+	uint_value = LIVE_RESULTS_PAGE_POINTS;
+	memcpy(&p_header[16], &uint_value, 4);
+	ull_value = lr_capacity_points;
+	memcpy(&p_header[24], &ull_value, 8);
+	int_value = p_cmv_system->system_id;
+	memcpy(&p_header[40], &int_value, 4);
+	// The time-step is 0 if summary rows are dropped, as the rows are
+	// not evenly spaced
+	double_value = (p_cmv_system->p_cmv_options->summary_adaptive ? 0.0 :
+		p_cmv_system->p_cmv_options->summary_time_step_s);
+	memcpy(&p_header[48], &double_value, 8);
+	ull_value = lr_data_offset;
+	memcpy(&p_header[56], &ull_value, 8);
+
+	// Field names and units
+	p_fields = &p_map[LIVE_RESULTS_HEADER_BYTES];
+
+	for (int i = 0; i < lr_no_of_fields; i++)
+	{
+		f = p_layout->output_field_indices[i];
+
+		uint_value = (unsigned int)p_layout->results_fields[f].length();
+		memcpy(p_fields, &uint_value, 4);
+		memcpy(p_fields + 4, p_layout->results_fields[f].c_str(), uint_value);
+		p_fields = p_fields + 4 + uint_value;
+
+		uint_value = (unsigned int)p_layout->results_units[f].length();
+		memcpy(p_fields, &uint_value, 4);
+		memcpy(p_fields + 4, p_layout->results_units[f].c_str(), uint_value);
+		p_fields = p_fields + 4 + uint_value;
+	}
+
+	p_committed_rows = (volatile unsigned long long*)&p_map[32];
+	p_data = (double*)&p_map[lr_data_offset];
+
+	cout << "Publishing live results to: " << lr_file_string << "\n";
+}
+
+// Destructor
+live_results::~live_results(void)
+{
+	//! Destructor
+
+	// Code
+	close();
+
+	cout << "Live results: " << lr_rows_added << " rows in " << lr_n_commits <<
+		" commit(s), " << lr_rows_dropped << " row(s) dropped\n";
+}
+
+// Other functions
+void live_results::add_row(const double* p_row)
+{
+	//! Function scatters a row into its page
+	//! Readers do not see it until commit is called
+
+	// Variables
+	double* p_page;
+	int i;
+
+	// Code
+	if ((p_map == NULL) || (lr_rows_added >= lr_capacity_points))
+	{
+		lr_rows_dropped = lr_rows_dropped + 1;
+		return;
+	}
+
+	p_page = &p_data[(lr_rows_added / LIVE_RESULTS_PAGE_POINTS) *
+		lr_no_of_fields * LIVE_RESULTS_PAGE_POINTS];
+	i = (int)(lr_rows_added % LIVE_RESULTS_PAGE_POINTS);
+
+	for (int f = 0; f < lr_no_of_fields; f++)
+		p_page[(f * LIVE_RESULTS_PAGE_POINTS) + i] = p_row[f];
+
+	lr_rows_added = lr_rows_added + 1;
+}
+
+void live_results::commit(void)
+{
+	//! Function publishes the rows added so far
+	//! This is the only point of contact with readers. The fence makes
+	//! sure the rows are visible before the counter that covers them
+
+	// Code
+	if ((p_map == NULL) || (*p_committed_rows == (unsigned long long)lr_rows_added))
+		return;
+
+	std::atomic_thread_fence(std::memory_order_release);
+	*p_committed_rows = (unsigned long long)lr_rows_added;
+
+	lr_n_commits = lr_n_commits + 1;
+}
+
+void live_results::close(void)
+{
+	//! Function commits the last rows, marks the file as complete and
+	//! releases the mapping
+
+	// Variables
+	unsigned int complete = 1;
+
+	// Code
+	if (p_map == NULL)
+		return;
+
+	commit();
+
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(&p_map[20], &complete, 4);
+
+#ifdef _WIN32
+	FlushViewOfFile(p_map, 0);
+	UnmapViewOfFile(p_map);
+	CloseHandle(h_mapping);
+	CloseHandle(h_file);
+#else
+	msync(p_map, (size_t)lr_file_bytes, MS_SYNC);
+	munmap(p_map, (size_t)lr_file_bytes);
+	::close(fd);
+#endif
+
+	p_map = NULL;
+	p_data = NULL;
+	p_committed_rows = NULL;
+}
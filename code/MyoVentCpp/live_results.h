@@ -0,0 +1,91 @@
+#pragma once
+
+/**
+/* @file		live_results.h
+/* @brief		Header file for a live_results object
+/* @author		Ken Campbell
+*/
+
+#include "stdio.h"
+#include <iostream>
+#include <string>
+
+#include "global_definitions.h"
+
+using namespace std;
+
+class cmv_results;
+
+class live_results
+{
+public:
+	/**
+	 * Constructor
+	 * Creates a memory-mapped file large enough for set_capacity_points
+	 * rows of the fields p_layout writes and writes the header
+	 */
+	live_results(cmv_results* set_p_layout, string set_file_string,
+		long long set_capacity_points);
+
+	/**
+	* Destructor
+	*/
+	~live_results(void);
+
+	// Variables
+	cmv_results* p_layout;					/**< pointer to the cmv_results object
+													defining the fields */
+
+	string lr_file_string;					/**< string with the file name */
+
+	int lr_no_of_fields;					/**< integer with the number of
+													fields in a row */
+
+	long long lr_capacity_points;			/**< number of rows the file can
+													hold */
+
+	long long lr_no_of_pages;				/**< number of pages in the file */
+
+	long long lr_data_offset;				/**< offset of the first page from
+													the start of the file */
+
+	long long lr_file_bytes;				/**< size of the file in bytes */
+
+	unsigned char* p_map;					/**< pointer to the start of the
+													mapped file */
+
+	double* p_data;							/**< pointer to the first page */
+
+	volatile unsigned long long* p_committed_rows;
+											/**< pointer to the counter in the
+													header that readers poll */
+
+	long long lr_rows_added;				/**< number of rows stored, some of
+													which may not be committed */
+
+	long long lr_rows_dropped;				/**< number of rows that did not
+													fit in the file */
+
+	long long lr_n_commits;					/**< number of counter updates */
+
+#ifdef _WIN32
+	void* h_file;							/**< handle of the file */
+
+	void* h_mapping;						/**< handle of the file mapping */
+#else
+	int fd;									/**< file descriptor */
+#endif
+
+	// Functions
+
+	void add_row(const double* p_row);		/**< function stores a row in the
+													mapped pages without
+													publishing it */
+
+	void commit(void);						/**< function makes the rows added
+													so far visible to readers */
+
+	void close(void);						/**< function commits the remaining
+													rows, marks the file complete
+													and unmaps it */
+};
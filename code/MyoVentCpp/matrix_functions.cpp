@@ -0,0 +1,126 @@
+/**
+ * @file    matrix_functions.cpp
+ * @brief   Source file for functions that work on small dense matrices
+ * @author  Ken Campbell
+ */
+
+#include <iostream>
+#include <cmath>
+
+#include "matrix_functions.h"
+
+using namespace std;
+
+namespace matrix_functions {
+
+    //! Sets C = A * B for n x n row-major matrices
+    void multiply(const double A[], const double B[], double C[], const int n)
+    {
+        double holder;
+
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                holder = 0.0;
+                for (int k = 0; k < n; k++)
+                {
+                    holder = holder + (A[(i * n) + k] * B[(k * n) + j]);
+                }
+                C[(i * n) + j] = holder;
+            }
+        }
+    }
+
+    //! Sets eA = exp(A). A is scaled by 2^-s so that its norm is below 0.5,
+    //! the Taylor series is summed until the terms stop contributing, and
+    //! the result is squared s times
+    void exponential(const double A[], double eA[], const int n)
+    {
+        // Variables
+        double X[MAX_MATRIX_EXPONENTIAL_SIZE * MAX_MATRIX_EXPONENTIAL_SIZE];
+        double term[MAX_MATRIX_EXPONENTIAL_SIZE * MAX_MATRIX_EXPONENTIAL_SIZE];
+        double temp[MAX_MATRIX_EXPONENTIAL_SIZE * MAX_MATRIX_EXPONENTIAL_SIZE];
+
+        int n_squarings;
+        int max_order = 20;
+
+        double norm;
+        double row_sum;
+        double scale;
+        double term_max;
+        double result_max;
+
+        // Code
+
+        if ((n < 1) || (n > MAX_MATRIX_EXPONENTIAL_SIZE))
+        {
+            cout << "Error: matrix_functions::exponential, matrix size " << n <<
+                " is outside 1 to " << MAX_MATRIX_EXPONENTIAL_SIZE << "\n";
+            exit(1);
+        }
+
+        // Infinity norm
+        norm = 0.0;
+        for (int i = 0; i < n; i++)
+        {
+            row_sum = 0.0;
+            for (int j = 0; j < n; j++)
+            {
+                row_sum = row_sum + fabs(A[(i * n) + j]);
+            }
+            if (row_sum > norm)
+                norm = row_sum;
+        }
+
+        n_squarings = 0;
+        if (norm > 0.5)
+        {
+            n_squarings = (int)ceil(log2(norm / 0.5));
+        }
+        scale = ldexp(1.0, -n_squarings);
+
+        // Start with eA = I + X and term = X
+        for (int i = 0; i < (n * n); i++)
+        {
+            X[i] = scale * A[i];
+            term[i] = X[i];
+            eA[i] = X[i];
+        }
+        for (int i = 0; i < n; i++)
+        {
+            eA[(i * n) + i] = eA[(i * n) + i] + 1.0;
+        }
+
+        for (int order = 2; order <= max_order; order++)
+        {
+            multiply(term, X, temp, n);
+
+            term_max = 0.0;
+            result_max = 0.0;
+            for (int i = 0; i < (n * n); i++)
+            {
+                term[i] = temp[i] / (double)order;
+                eA[i] = eA[i] + term[i];
+
+                if (fabs(term[i]) > term_max)
+                    term_max = fabs(term[i]);
+                if (fabs(eA[i]) > result_max)
+                    result_max = fabs(eA[i]);
+            }
+
+            if (term_max <= (1e-17 * result_max))
+                break;
+        }
+
+        // Undo the scaling
+        for (int s = 0; s < n_squarings; s++)
+        {
+            multiply(eA, eA, temp, n);
+            for (int i = 0; i < (n * n); i++)
+            {
+                eA[i] = temp[i];
+            }
+        }
+    }
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+/**
+ * @file    matrix_functions.h
+ * @brief   header file for functions that work on small dense matrices
+ * @author  Ken Campbell
+ */
+
+#include "global_definitions.h"
+
+namespace matrix_functions {
+
+    /**
+    * a function that calculates the exponential of a small square matrix
+    * using scaling and squaring with a Taylor series. Works on the stack
+    * so that it can be called from the simulation loop without allocating
+    * @param A pointer to the n x n matrix, stored row-major
+    * @param eA pointer to an n x n array that is set to exp(A), row-major
+    * @param n integer, the size of the matrix, which must not be greater
+    *        than MAX_MATRIX_EXPONENTIAL_SIZE
+    * @return void
+    */
+    void exponential(const double A[], double eA[], const int n);
+
+    /**
+    * a function that multiplies two small square matrices, C = A * B
+    * @param A pointer to the n x n matrix A, row-major
+    * @param B pointer to the n x n matrix B, row-major
+    * @param C pointer to an n x n array, which must not overlap A or B
+    * @param n integer, the size of the matrices
+    * @return void
+    */
+    void multiply(const double A[], const double B[], double C[], const int n);
+
+};
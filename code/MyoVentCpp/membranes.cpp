@@ -8,13 +8,14 @@
 
 #include "membranes.h"
 #include "half_sarcomere.h"
+#include "cmv_system.h"
 #include "cmv_model.h"
+#include "cmv_protocol.h"
 #include "cmv_options.h"
 #include "cmv_results.h"
 
 #include "gsl_errno.h"
-#include "gsl_odeiv2.h"
-
+#include "gsl_math.h"
 
 // Constructor
 membranes::membranes(half_sarcomere* set_p_parent_hs)
@@ -60,8 +61,6 @@ void membranes::initialise_simulation(void)
 {
 	//! Function adds data fields to main results object
 
-	// Variables
-
 	// Initialize
 
 	// Set the options
@@ -71,8 +70,8 @@ void membranes::initialise_simulation(void)
 	p_cmv_results_beat = p_parent_hs->p_cmv_results_beat;
 
 	// Now add the results fields
-	p_cmv_results_beat->add_results_field("memb_Ca_cytosol", &memb_Ca_cytosol);
-	p_cmv_results_beat->add_results_field("memb_Ca_sr", &memb_Ca_sr);
+	p_cmv_results_beat->add_results_field("memb_Ca_cytosol", &memb_Ca_cytosol, "M");
+	p_cmv_results_beat->add_results_field("memb_Ca_sr", &memb_Ca_sr, "M");
 	p_cmv_results_beat->add_results_field("memb_activation", &memb_activation);
 	p_cmv_results_beat->add_results_field("memb_t_open_left_s", &memb_t_open_left_s);
 	p_cmv_results_beat->add_results_field("memb_k_serca", &memb_k_serca);
@@ -85,9 +84,8 @@ void membranes::initialise_simulation(void)
 }
 
 // This function is not a member of the membranes class but is used to interace
-// with the GSL ODE system. It must appear before the membranes class members
-// that calls it, and communicates with the membrane class through a pointer to
-// the class object
+// with the GSL ODE system in the coupled integrator, and communicates with the
+// membrane class through a pointer to the class object
 
 int memb_calculate_derivs(double t, const double y[], double f[], void* params)
 {
@@ -115,17 +113,50 @@ int memb_calculate_derivs(double t, const double y[], double f[], void* params)
 void membranes::implement_time_step(double time_step_s, bool new_beat)
 {
 	//! Function updates membrane object by a time-step
+	//! memb_activation is held for the step, so Ca moves between two pools
+	//! with constant rate constants k_release and k_serca, and the total
+	//! is conserved. The cytosolic Ca relaxes exponentially to
+	//!		Ca_eq = k_release * Ca_total / (k_release + k_serca)
+	//! with rate k_release + k_serca
 
 	// Variables
-	double eps_abs = 1e-6;
-	double eps_rel = 1e-6;
+	double k_release;
+	double k_total;
+	double Ca_total;
+	double Ca_cytosol_eq;
+	double relaxed;
 
-	int status;
+	double y[2];
 
-	double t_start_s = 0.0;
-	double t_stop_s = time_step_s;
+	// Code
+	update_activation(time_step_s, new_beat);
+
+	k_release = memb_k_leak + (memb_activation * memb_k_active);
+	k_total = k_release + memb_k_serca;
+
+	if (k_total > 0.0)
+	{
+		Ca_total = memb_Ca_cytosol + memb_Ca_sr;
+		Ca_cytosol_eq = k_release * Ca_total / k_total;
 
-	double y[2] = { memb_Ca_cytosol, memb_Ca_sr };
+		// Proportion of the way to equilibrium, accurate for small steps
+		relaxed = -expm1(-k_total * time_step_s);
+
+		memb_Ca_cytosol = memb_Ca_cytosol + (relaxed * (Ca_cytosol_eq - memb_Ca_cytosol));
+		memb_Ca_sr = Ca_total - memb_Ca_cytosol;
+	}
+
+	// Fluxes at the end of the step
+	y[0] = memb_Ca_cytosol;
+	y[1] = memb_Ca_sr;
+
+	calculate_fluxes(y);
+}
+
+void membranes::update_activation(double time_step_s, bool new_beat)
+{
+	//! Function updates the open time left, which is then the time
+	//! left at the start of the time-step, and the activation
 
 	// Code
 	if (new_beat)
@@ -137,34 +168,22 @@ void membranes::implement_time_step(double time_step_s, bool new_beat)
 		memb_t_open_left_s = memb_t_open_left_s - time_step_s;
 	}
 
-	if (memb_t_open_left_s > 0.0)
-	{
-		memb_activation = 1.0;
-	}
-	else
-	{
-		memb_activation = 0.0;
-	}
-
-	gsl_odeiv2_system sys = { memb_calculate_derivs, NULL, 2, this };
-
-	gsl_odeiv2_driver* d =
-		gsl_odeiv2_driver_alloc_y_new(&sys, gsl_odeiv2_step_rkf45,
-			0.5*time_step_s, eps_abs, eps_rel);
-
-	status = gsl_odeiv2_driver_apply(d, &t_start_s, t_stop_s, y);
+	memb_activation = return_activation(0.0);
+}
 
-	gsl_odeiv2_driver_free(d);
+double membranes::return_activation(double t)
+{
+	//! Function returns the activation at time t within the time-step
+	//! The split integrators hold it at the t = 0 value for the step
 
-	if (status != GSL_SUCCESS)
+	// Code
+	if ((memb_t_open_left_s - t) > 0.0)
 	{
-		std::cout << "Integration problem in membranes::implement_time_step\n";
+		return 1.0;
 	}
 	else
 	{
-		//Unpack
-		memb_Ca_cytosol = y[0];
-		memb_Ca_sr = y[1];
+		return 0.0;
 	}
 }
 
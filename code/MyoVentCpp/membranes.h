@@ -77,7 +77,6 @@ public:
 	double memb_J_uptake;				/**< double describing Ca uptake flux
 												 in M s^-1 */
 
-
 	/**
 	/* function adds data fields and vectors to the results objet
 	*/
@@ -88,6 +87,17 @@ public:
 	*/
 	void implement_time_step(double time_step_s, bool new_beat);
 
+	/**
+	/* function counts down the open time and sets memb_activation
+	* for the start of the time-step
+	*/
+	void update_activation(double time_step_s, bool new_beat);
+
+	/**
+	/* function returns the activation t seconds into the time-step
+	*/
+	double return_activation(double t);
+
 	/**
 	/*
 	* function calculates derivs
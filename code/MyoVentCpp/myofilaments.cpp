@@ -6,6 +6,7 @@
 
 #include <iostream>
 #include <filesystem>
+#include <malloc.h>
 
 #include "myofilaments.h"
 #include "half_sarcomere.h"
@@ -18,9 +19,13 @@
 #include "membranes.h"
 #include "cmv_model.h"
 #include "cmv_options.h"
+#include "cmv_protocol.h"
 #include "cmv_results.h"
+#include "bin_kernels.h"
+#include "matrix_functions.h"
 
 #include "gsl_errno.h"
+#include "gsl_math.h"
 #include "gsl_odeiv2.h"
 #include "gsl_interp.h"
 #include "gsl_spline.h"
@@ -35,6 +40,12 @@ struct stats_structure {
 	double sum;
 };
 
+// Forward declaration of the function used by the GSL ODE system, so that
+// initialise_simulation can build the persistent driver
+int myof_calculate_derivs(double t, const double y[], double f[], void* params);
+int myof_calculate_jacobian(double t, const double y[], double* dfdy, double dfdt[],
+	void* params);
+
 // Constructor
 myofilaments::myofilaments(half_sarcomere* set_p_parent_hs)
 {
@@ -57,6 +68,20 @@ myofilaments::myofilaments(half_sarcomere* set_p_parent_hs)
 	m_y_indices = NULL;
 	m_state_pops = NULL;
 	m_state_stresses = NULL;
+	p_myof_ode_driver = NULL;
+	p_myof_implicit_ode_driver = NULL;
+	y_calc = NULL;
+	bin_x = NULL;
+	bin_w = NULL;
+	bin_edges = NULL;
+	move_y = NULL;
+	move_y_temp = NULL;
+	p_move_acc = NULL;
+	p_move_spline = NULL;
+	exp_y_start = NULL;
+	exp_bin_propagators = NULL;
+	exp_bin_start = 0;
+	exp_bin_stop = -1;
 
 	// Initialize
 	myof_cb_number_density = p_cmv_model->myof_cb_number_density;
@@ -101,8 +126,19 @@ myofilaments::myofilaments(half_sarcomere* set_p_parent_hs)
 	max_shift = 0.0;
 	n_max_sub_steps = 0;
 
-	cb_dump_file_string;
-	cb_dump_file_defined = false;
+	myof_ode_auto = false;
+	myof_ode_implicit_steps_left = 0;
+	myof_ode_exponential = false;
+	exp_no_of_detached_states = 0;
+
+	myof_uniform_grid = true;
+	myof_active_bin_threshold = 0.0;
+	myof_active_bin_count = 0;
+	myof_window_updates = 0;
+
+	myof_n_rhs_evaluations = 0;
+	myof_n_jacobian_evaluations = 0;
+	myof_report_counters = false;
 
 	myof_ATP_flux = 0.0;
 }
@@ -136,10 +172,71 @@ myofilaments::~myofilaments(void)
 		gsl_vector_free(m_state_stresses);
 	}
 
+	if (p_myof_ode_driver != NULL)
+	{
+		gsl_odeiv2_driver_free(p_myof_ode_driver);
+	}
+	if (p_myof_implicit_ode_driver != NULL)
+	{
+		gsl_odeiv2_driver_free(p_myof_implicit_ode_driver);
+	}
+	if (p_move_spline != NULL)
+	{
+		gsl_spline_free(p_move_spline);
+	}
+	if (p_move_acc != NULL)
+	{
+		gsl_interp_accel_free(p_move_acc);
+	}
+
 	std::free(m_pops_array);
 	std::free(m_stresses_array);
+	std::free(bin_edges);
+
+	// These were allocated with _aligned_malloc
+	if (y_calc != NULL)
+	{
+		_aligned_free(y_calc);
+	}
+	if (bin_x != NULL)
+	{
+		_aligned_free(bin_x);
+	}
+	if (bin_w != NULL)
+	{
+		_aligned_free(bin_w);
+	}
+	if (move_y != NULL)
+	{
+		_aligned_free(move_y);
+	}
+	if (move_y_temp != NULL)
+	{
+		_aligned_free(move_y_temp);
+	}
+	if (exp_y_start != NULL)
+	{
+		_aligned_free(exp_y_start);
+	}
+	if (exp_bin_propagators != NULL)
+	{
+		_aligned_free(exp_bin_propagators);
+	}
 
 	cout << "max_shift: " << max_shift << " n_max_sub_steps: " << n_max_sub_steps << "\n";
+	if (myof_report_counters)
+	{
+		cout << "myofilament RHS evaluations: " << myof_n_rhs_evaluations <<
+			" Jacobian evaluations: " << myof_n_jacobian_evaluations << "\n";
+	}
+
+	if ((myof_report_counters) && (myof_window_updates > 0))
+	{
+		cout << "mean active bins per attached state: " <<
+			(double)myof_active_bin_count /
+				(double)(myof_window_updates * p_m_scheme->no_of_attached_states) <<
+			" of " << no_of_bin_positions << "\n";
+	}
 }
 
 // Other functions
@@ -148,27 +245,26 @@ void myofilaments::initialise_simulation(void)
 	//! Function adds data fields to main results object
 
 	// Variables
+	double eps_abs = 1e-6;
+	double eps_rel = 1e-6;
+
+	double h_start;
+
+	const gsl_odeiv2_step_type* p_step_type;
 
 	// Code
 
 	// Set the options
 	p_cmv_options = p_parent_hs->p_cmv_options;
 
-	// Now update the daughter kinetic_scheme
-	p_m_scheme->initialise_simulation(this);
+	// The options are deleted before the destructor runs
+	myof_report_counters = (p_cmv_options->report_counters == "True");
 
 	// Now do lots of stuff specific to this class
 	// Code
-	no_of_bin_positions = 1 + (int)((p_cmv_options->bin_max - p_cmv_options->bin_min) /
-		p_cmv_options->bin_width);
-
-	// Assign x
-	x = gsl_vector_alloc(no_of_bin_positions);
 
-	for (int i = 0; i < no_of_bin_positions; i++)
-	{
-		gsl_vector_set(x, i, p_cmv_options->bin_min + ((double)i * p_cmv_options->bin_width));
-	}
+	// Set the bin positions, widths, and edges
+	build_bin_grid();
 
 	// Now set the length of the system from the kinetic scheme + 2 for thin filament
 	y_length = (size_t)p_m_scheme->no_of_detached_states +
@@ -216,6 +312,20 @@ void myofilaments::initialise_simulation(void)
 		cout << gsl_matrix_int_get(m_y_indices, i, 0) << "   " << gsl_matrix_int_get(m_y_indices, i, 1) << "\n";
 	}
 
+	// Now update the daughter kinetic_scheme, which needs the bin positions
+	// to build its rate table and the y indices to compile its transitions
+	p_m_scheme->initialise_simulation(this);
+
+	// Start with every bin active. If there is a threshold, the windows
+	// are narrowed at the start of each time-step
+	myof_active_bin_threshold = p_cmv_options->active_bin_threshold;
+
+	for (int a_counter = 0; a_counter < p_m_scheme->no_of_attached_states; a_counter++)
+	{
+		bin_window_start[a_counter] = 0;
+		bin_window_stop[a_counter] = no_of_bin_positions - 1;
+	}
+
 	// Initialise and set the bin populations
 	m_state_pops = gsl_vector_alloc(p_m_scheme->no_of_states);
 	gsl_vector_set_zero(m_state_pops);
@@ -229,6 +339,69 @@ void myofilaments::initialise_simulation(void)
 	myof_a_off = gsl_vector_get(y, a_off_index);
 	myof_a_on = gsl_vector_get(y, a_on_index);
 
+	// Build the workspaces used during the time-steps so that the
+	// simulation loop does not need to allocate memory. The arrays that
+	// are swept bin by bin are aligned for the vector units
+	y_calc = (double*)_aligned_malloc(y_length * sizeof(double), BIN_ARRAY_ALIGNMENT);
+
+	// The Jacobian is only used by the implicit steppers
+	myof_ode_system = { myof_calculate_derivs, myof_calculate_jacobian, y_length, this };
+
+	h_start = 0.5 * p_cmv_system->p_cmv_protocol->time_step_s;
+
+	if ((p_cmv_options->myof_ode_stepper == "rkf45") ||
+		(p_cmv_options->myof_ode_stepper == "auto"))
+	{
+		p_step_type = gsl_odeiv2_step_rkf45;
+	}
+	else if (p_cmv_options->myof_ode_stepper == "rk8pd")
+	{
+		p_step_type = gsl_odeiv2_step_rk8pd;
+	}
+	else if (p_cmv_options->myof_ode_stepper == "bsimp")
+	{
+		p_step_type = gsl_odeiv2_step_bsimp;
+	}
+	else if (p_cmv_options->myof_ode_stepper == "msbdf")
+	{
+		p_step_type = gsl_odeiv2_step_msbdf;
+	}
+	else if (p_cmv_options->myof_ode_stepper == "exponential")
+	{
+		// Does not need a GSL driver
+		p_step_type = NULL;
+		myof_ode_exponential = true;
+		initialise_exponential_propagator();
+	}
+	else
+	{
+		cout << "Error: myofilaments ode_stepper: " << p_cmv_options->myof_ode_stepper <<
+			" not recognized\n";
+		exit(1);
+	}
+
+	if (p_step_type != NULL)
+	{
+		p_myof_ode_driver = gsl_odeiv2_driver_alloc_y_new(&myof_ode_system,
+			p_step_type, h_start, eps_abs, eps_rel);
+	}
+
+	if (p_cmv_options->myof_ode_stepper == "auto")
+	{
+		myof_ode_auto = true;
+
+		p_myof_implicit_ode_driver = gsl_odeiv2_driver_alloc_y_new(&myof_ode_system,
+			gsl_odeiv2_step_bsimp, h_start, eps_abs, eps_rel);
+	}
+
+	move_y = (double*)_aligned_malloc(no_of_bin_positions * sizeof(double),
+		BIN_ARRAY_ALIGNMENT);
+	move_y_temp = (double*)_aligned_malloc(no_of_bin_positions * sizeof(double),
+		BIN_ARRAY_ALIGNMENT);
+
+	p_move_acc = gsl_interp_accel_alloc();
+	p_move_spline = gsl_spline_alloc(gsl_interp_linear, no_of_bin_positions);
+
 	// Set the pointer to the results object
 	p_cmv_results_beat = p_parent_hs->p_cmv_results_beat;
 
@@ -237,7 +410,8 @@ void myofilaments::initialise_simulation(void)
 	p_cmv_results_beat->add_results_field("myof_a_on", &myof_a_on);
 	p_cmv_results_beat->add_results_field("myof_f_overlap", &myof_f_overlap);
 	p_cmv_results_beat->add_results_field("myof_m_bound", &myof_m_bound);
-	p_cmv_results_beat->add_results_field("myof_ATP_flux", &myof_ATP_flux);
+	p_cmv_results_beat->myof_ATP_flux_field_index =
+		p_cmv_results_beat->add_results_field("myof_ATP_flux", &myof_ATP_flux);
 
 	for (int i = 0; i < p_m_scheme->no_of_states; i++)
 	{
@@ -252,7 +426,8 @@ void myofilaments::initialise_simulation(void)
 	}
 
 	p_cmv_results_beat->add_results_field("myof_stress_cb", &myof_stress_cb);
-	p_cmv_results_beat->add_results_field("myof_stress_int_pas", &myof_stress_int_pas);
+	p_cmv_results_beat->myof_stress_int_pas_field_index =
+		p_cmv_results_beat->add_results_field("myof_stress_int_pas", &myof_stress_int_pas);
 	p_cmv_results_beat->add_results_field("myof_stress_ext_pas", &myof_stress_ext_pas);
 	p_cmv_results_beat->add_results_field("myof_stress_myof", &myof_stress_myof);
 	p_cmv_results_beat->add_results_field("myof_stress_total", &myof_stress_total);
@@ -272,38 +447,31 @@ int myof_calculate_derivs(double t, const double y[], double f[], void* params)
 
 	myofilaments* p_myof = (myofilaments*)params;
 
-	double rate;
+	kinetic_scheme* p_scheme = p_myof->p_m_scheme;
 
-	double hs_stress;
-	double hs_length;
+	const compiled_transition* p_ct;
 
-	double x_pos;
-	double x_ext;
+	const double* rate_row;
 
-	double f_overlap;
 	double m_bound;
 
-	double J_on;
-	double J_off;
+	double free_sites;
+	double attach_factor;
 
 	double flux;
+	double flux_sum;
+
+	int from_ind;
+	int to_ind;
 
-	int current_ind;
-	int new_ind;
+	int lo;				// first active bin
+	int n_active;		// number of active bins
 	
 	// Code
 
-	// Calculat f_overlap
-	p_myof->calculate_f_overlap();
-	f_overlap = p_myof->myof_f_overlap;
-
-	// Calculate state populations
-	p_myof->calculate_m_state_pops(y);
-	m_bound = p_myof->myof_m_bound;
+	p_myof->myof_n_rhs_evaluations = p_myof->myof_n_rhs_evaluations + 1;
 
-	// Set state variables
-	hs_stress = p_myof->myof_stress_myof;
-	hs_length = p_myof->p_parent_hs->hs_length;
+	m_bound = p_myof->return_m_bound(y);
 
 	// Initalise derivs
 	for (int i = 0; i < p_myof->y_length; i++)
@@ -311,178 +479,275 @@ int myof_calculate_derivs(double t, const double y[], double f[], void* params)
 		f[i] = 0.0;
 	}
 
-	// Zero the flux
-	p_myof->myof_ATP_flux = 0.0;
+	// Attachment is proportional to the available binding sites
+	free_sites = y[p_myof->a_on_index] - m_bound;
+	attach_factor = p_myof->p_cmv_options->bin_width * free_sites;
 
-	// Start with myosin
-
-	// Work through the states
-	for (int state_counter = 0; state_counter < p_myof->p_m_scheme->no_of_states;
-		state_counter++)
+	// Start with myosin, working through the compiled transitions
+	for (int ct_counter = 0; ct_counter < p_scheme->no_of_compiled_transitions;
+		ct_counter++)
 	{
-		char current_state_type = p_myof->p_m_scheme->p_m_states[state_counter]->state_type;
+		p_ct = &p_scheme->compiled_transitions[ct_counter];
 
-		// Now through the transitions
-		for (int t_counter = 0; t_counter < p_myof->p_m_scheme->max_no_of_transitions;
-			t_counter++)
+		// Pull the cached rates for this transition
+		rate_row = gsl_matrix_const_ptr(p_scheme->rate_table, p_ct->rate_row, 0);
+
+		from_ind = p_ct->from_index;
+		to_ind = p_ct->to_index;
+
+		switch (p_ct->type)
 		{
-			int new_state = p_myof->p_m_scheme->p_m_states[state_counter]->
-					p_transitions[t_counter]->new_state;
+			case ct_D_to_D:
+			{
+				flux = rate_row[0] * y[from_ind];
+
+				f[from_ind] = f[from_ind] - flux;
+				f[to_ind] = f[to_ind] + flux;
+				break;
+			}
 
-			if (new_state == 0)
+			case ct_D_to_A:
 			{
-				// Transition is not allowed out - skip out
-				continue;
+				lo = p_myof->bin_window_start[p_ct->to_attached];
+				n_active = p_myof->bin_window_stop[p_ct->to_attached] - lo + 1;
+
+				if (p_myof->myof_uniform_grid)
+				{
+					flux_sum = bin_kernels::attach(&f[to_ind + lo], &rate_row[lo],
+						attach_factor * y[from_ind], n_active);
+				}
+				else
+				{
+					flux_sum = bin_kernels::attach_weighted(&f[to_ind + lo], &rate_row[lo],
+						&p_myof->bin_w[lo], free_sites * y[from_ind], n_active);
+				}
+
+				f[from_ind] = f[from_ind] - flux_sum;
+				break;
 			}
 
-			char new_state_type = p_myof->p_m_scheme->p_m_states[new_state - 1]->state_type;
+			case ct_A_to_D:
+			{
+				lo = p_myof->bin_window_start[p_ct->from_attached];
+				n_active = p_myof->bin_window_stop[p_ct->from_attached] - lo + 1;
+
+				flux_sum = bin_kernels::detach(&f[from_ind + lo], &y[from_ind + lo],
+					&rate_row[lo], n_active);
+
+				f[to_ind] = f[to_ind] + flux_sum;
+				break;
+			}
 
-			if ((current_state_type == 'S') || (current_state_type == 'D'))
+			case ct_A_to_A:
 			{
-				// Deatched state
-				if ((new_state_type == 'S') || (new_state_type == 'D'))
-				{
-					// Detached to detached
-					rate = p_myof->p_m_scheme->p_m_states[state_counter]->p_transitions[t_counter]->
-						calculate_rate(0, 0, hs_stress, hs_length);
+				lo = p_myof->bin_window_start[p_ct->from_attached];
+				n_active = p_myof->bin_window_stop[p_ct->from_attached] - lo + 1;
 
-					// Find current index
-					current_ind = gsl_matrix_int_get(p_myof->m_y_indices, state_counter, 0);
+				bin_kernels::transfer(&f[from_ind + lo], &f[to_ind + lo], &y[from_ind + lo],
+					&rate_row[lo], n_active);
+				break;
+			}
+		}
+	}
 
-					// Find flux
-					flux = rate * y[current_ind];
+	// Now handle the actin
+	f[p_myof->a_on_index] = p_myof->return_actin_flux(y[p_myof->a_on_index], m_bound);
+	f[p_myof->a_off_index] = -f[p_myof->a_on_index];
 
-					// Cross-bridges leaving current state
-					f[current_ind] = f[current_ind] - flux;
+	return GSL_SUCCESS;
+}
 
-					// Cross-bridges arriving at new state
-					new_ind = gsl_matrix_int_get(p_myof->m_y_indices, new_state - 1, 0);
+int myof_calculate_jacobian(double t, const double y[], double* dfdy, double dfdt[],
+	void* params)
+{
+	// Function sets the Jacobian for the implicit steppers
+	// dfdy[(i * y_length) + j] is df[i]/dy[j]
+	// The matrix is block-sparse. Each transition couples a state to its
+	// partner bin by bin, and attachment couples to actin and, through
+	// m_bound, to every attached bin. Bins outside the active windows are
+	// constant, matching myof_calculate_derivs
 
-					f[new_ind] = f[new_ind] + flux;
-				}
-				else
-				{
-					// Detached to attached
-					current_ind = gsl_matrix_int_get(p_myof->m_y_indices, state_counter, 0);
+	// Variables
+	(void)(t);
 
-					// Cycle through the bins
-					for (int bin_index = 0; bin_index < p_myof->no_of_bin_positions;
-						bin_index++)
-					{
-						// Get x position
-						x_pos = gsl_vector_get(p_myof->x, bin_index);
-						x_ext = p_myof->p_m_scheme->p_m_states[state_counter]->extension;
+	myofilaments* p_myof = (myofilaments*)params;
 
-						// Calculate rate
-						rate = 	p_myof->p_m_scheme->p_m_states[state_counter]->
-							p_transitions[t_counter]->calculate_rate(x_pos, x_ext, hs_stress, hs_length);
+	kinetic_scheme* p_scheme = p_myof->p_m_scheme;
 
-						flux = p_myof->p_cmv_options->bin_width *
-							rate * y[current_ind] * (y[p_myof->a_on_index] - m_bound);
+	const compiled_transition* p_ct;
 
-						new_ind = gsl_matrix_int_get(p_myof->m_y_indices, new_state - 1, 0) +
-							bin_index;
+	size_t n = p_myof->y_length;
 
-						// Cross-bridges leaving this state
-						f[current_ind] = f[current_ind] - flux;
+	const double* rate_row;
 
-						// Cross-bridges arriving at new state
-						f[new_ind] = f[new_ind] + flux;
-					}
-				}
-			}
-			else
-			{
-				// We are in an attached state
-				if ((new_state_type == 'S') || (new_state_type == 'D'))
-				{
-					// Attached to detached
-					new_ind = gsl_matrix_int_get(p_myof->m_y_indices, new_state - 1, 0);
+	double k;
+	double k_sum;
 
-					// Cycle through the bins
-					for (int bin_index = 0; bin_index < p_myof->no_of_bin_positions;
-						bin_index++)
-					{
-						// Get x position
-						x_pos = gsl_vector_get(p_myof->x, bin_index);
-						x_ext = p_myof->p_m_scheme->p_m_states[state_counter]->extension;
+	double f_overlap;
+	double m_bound;
+	double a_on;
+	double g;
+
+	double dJ_on_da;
+	double dJ_off_da;
+	double dJ_off_dm;
+
+	size_t from_ind;
+	size_t to_ind;
+	size_t row;
+	size_t col;
+	size_t a_on_ind = p_myof->a_on_index;
+	size_t a_off_ind = p_myof->a_off_index;
+
+	// Code
+
+	p_myof->myof_n_jacobian_evaluations = p_myof->myof_n_jacobian_evaluations + 1;
+
+	f_overlap = p_myof->myof_f_overlap;
+
+	m_bound = p_myof->return_m_bound(y);
+
+	a_on = y[a_on_ind];
+
+	// The system is autonomous within a time-step
+	for (size_t i = 0; i < n; i++)
+	{
+		dfdt[i] = 0.0;
+	}
+
+	for (size_t i = 0; i < (n * n); i++)
+	{
+		dfdy[i] = 0.0;
+	}
+
+	for (int ct_counter = 0; ct_counter < p_scheme->no_of_compiled_transitions;
+		ct_counter++)
+	{
+		p_ct = &p_scheme->compiled_transitions[ct_counter];
+
+		rate_row = gsl_matrix_const_ptr(p_scheme->rate_table, p_ct->rate_row, 0);
+
+		from_ind = p_ct->from_index;
+		to_ind = p_ct->to_index;
 
-						current_ind = gsl_matrix_int_get(p_myof->m_y_indices, state_counter, 0) + bin_index;
+		switch (p_ct->type)
+		{
+			case ct_D_to_D:
+			{
+				// flux = k * y[from]
+				k = rate_row[0];
+
+				dfdy[(from_ind * n) + from_ind] -= k;
+				dfdy[(to_ind * n) + from_ind] += k;
+				break;
+			}
 
-						// Calculate rate
-						rate = p_myof->p_m_scheme->p_m_states[state_counter]->
-							p_transitions[t_counter]->calculate_rate(x_pos, x_ext, hs_stress, hs_length);
+			case ct_D_to_A:
+			{
+				// flux[b] = w * k[b] * y[from] * (a_on - m_bound)
+				g = a_on - m_bound;
+				k_sum = 0.0;
 
-						flux =	rate * y[current_ind];
+				for (int bin_index = p_myof->bin_window_start[p_ct->to_attached];
+					bin_index <= p_myof->bin_window_stop[p_ct->to_attached]; bin_index++)
+				{
+					k = p_myof->bin_w[bin_index] * rate_row[bin_index];
+					k_sum = k_sum + k;
 
-						// Cross-bridges leaving this state
-						f[current_ind] = f[current_ind] - flux;
+					row = to_ind + bin_index;
 
-						// Cross-bridges arriving at new state
-						f[new_ind] = f[new_ind] + flux;
+					dfdy[(row * n) + from_ind] += k * g;
+					dfdy[(row * n) + a_on_ind] += k * y[from_ind];
 
-						// Check for ATP
-						if (p_myof->p_m_scheme->p_m_states[state_counter]->p_transitions[t_counter]->ATP_required == 'y')
+					// m_bound is the sum of all active attached bins
+					for (int a_counter = 0; a_counter < p_scheme->no_of_attached_states;
+						a_counter++)
+					{
+						for (int j = p_scheme->attached_y_start[a_counter] +
+								p_myof->bin_window_start[a_counter];
+							j <= p_scheme->attached_y_start[a_counter] +
+								p_myof->bin_window_stop[a_counter]; j++)
 						{
-							p_myof->myof_ATP_flux = p_myof->myof_ATP_flux + flux;
+							dfdy[(row * n) + j] -= k * y[from_ind];
 						}
 					}
 				}
-				else
-				{
-					// Cross-bridges transitioning between bound states
-
-					// Cycle through the bins
-					for (int bin_index = 0; bin_index < p_myof->no_of_bin_positions;
-						bin_index++)
-					{
-						// Get x position
-						x_pos = gsl_vector_get(p_myof->x, bin_index);
-						x_ext = p_myof->p_m_scheme->p_m_states[state_counter]->extension;
 
-						current_ind = gsl_matrix_int_get(p_myof->m_y_indices, state_counter, 0) +
-							bin_index;
+				dfdy[(from_ind * n) + from_ind] -= k_sum * g;
+				dfdy[(from_ind * n) + a_on_ind] -= k_sum * y[from_ind];
 
-						// Calculate rate
-						rate = p_myof->p_m_scheme->p_m_states[state_counter]->
-							p_transitions[t_counter]->calculate_rate(x_pos, x_ext, hs_stress, hs_length);
+				for (int a_counter = 0; a_counter < p_scheme->no_of_attached_states;
+					a_counter++)
+				{
+					for (int j = p_scheme->attached_y_start[a_counter] +
+							p_myof->bin_window_start[a_counter];
+						j <= p_scheme->attached_y_start[a_counter] +
+							p_myof->bin_window_stop[a_counter]; j++)
+					{
+						dfdy[(from_ind * n) + j] += k_sum * y[from_ind];
+					}
+				}
+				break;
+			}
 
-						new_ind = gsl_matrix_int_get(p_myof->m_y_indices, new_state - 1, 0) +
-							bin_index;
+			case ct_A_to_D:
+			case ct_A_to_A:
+			{
+				// flux[b] = k[b] * y[from + b], detachment collects into
+				// a single state, attached to attached keeps the bin
+				for (int bin_index = p_myof->bin_window_start[p_ct->from_attached];
+					bin_index <= p_myof->bin_window_stop[p_ct->from_attached]; bin_index++)
+				{
+					k = rate_row[bin_index];
 
-						flux = rate * y[current_ind];
+					col = from_ind + bin_index;
+					row = to_ind;
 
-						// Cross-bridges leaving this state
-						f[current_ind] = f[current_ind] - flux;
+					if (p_ct->type == ct_A_to_A)
+						row = to_ind + bin_index;
 
-						// Cross-bridgse arriving at new state
-						f[new_ind] = f[new_ind] + flux;
-					}
+					dfdy[(col * n) + col] -= k;
+					dfdy[(row * n) + col] += k;
 				}
+				break;
 			}
 		}
 	}
 
-	// Now handle the actin
+	// Now the actin, see myof_calculate_derivs for J_on and J_off
 	if (f_overlap > 0.0)
 	{
-		J_on = p_myof->myof_a_k_on *
-			(p_myof->p_parent_hs->p_membranes->memb_Ca_cytosol) *
-			(f_overlap - y[p_myof->a_on_index]) *
-			(1.0 + (p_myof->myof_a_k_coop * (y[p_myof->a_on_index] / f_overlap)));
+		dJ_on_da = p_myof->myof_a_k_on * p_myof->p_parent_hs->p_membranes->memb_Ca_cytosol *
+			(-(1.0 + (p_myof->myof_a_k_coop * (a_on / f_overlap))) +
+				((f_overlap - a_on) * p_myof->myof_a_k_coop / f_overlap));
 
-		J_off = p_myof->myof_a_k_off *
-			(y[p_myof->a_on_index] - m_bound) *
-			(1.0 + (p_myof->myof_a_k_coop * ((f_overlap - y[p_myof->a_on_index]) / f_overlap)));
+		dJ_off_da = p_myof->myof_a_k_off *
+			((1.0 + (p_myof->myof_a_k_coop * ((f_overlap - a_on) / f_overlap))) -
+				((a_on - m_bound) * p_myof->myof_a_k_coop / f_overlap));
+
+		dJ_off_dm = -p_myof->myof_a_k_off *
+			(1.0 + (p_myof->myof_a_k_coop * ((f_overlap - a_on) / f_overlap)));
 	}
 	else
 	{
-		J_on = 0.0;
-		J_off = p_myof->myof_a_k_off * (y[p_myof->a_on_index] - m_bound);
+		dJ_on_da = 0.0;
+		dJ_off_da = p_myof->myof_a_k_off;
+		dJ_off_dm = -p_myof->myof_a_k_off;
 	}
 
-	f[p_myof->a_off_index] = -J_on + J_off;
-	f[p_myof->a_on_index] = -f[p_myof->a_off_index];
+	// f[a_off] = -J_on + J_off and f[a_on] = -f[a_off]
+	dfdy[(a_off_ind * n) + a_on_ind] = -dJ_on_da + dJ_off_da;
+	dfdy[(a_on_ind * n) + a_on_ind] = dJ_on_da - dJ_off_da;
+
+	for (int a_counter = 0; a_counter < p_scheme->no_of_attached_states; a_counter++)
+	{
+		for (int j = p_scheme->attached_y_start[a_counter] + p_myof->bin_window_start[a_counter];
+			j <= p_scheme->attached_y_start[a_counter] + p_myof->bin_window_stop[a_counter]; j++)
+		{
+			dfdy[(a_off_ind * n) + j] = dJ_off_dm;
+			dfdy[(a_on_ind * n) + j] = -dJ_off_dm;
+		}
+	}
 
 	return GSL_SUCCESS;
 }
@@ -492,225 +757,1033 @@ void myofilaments::implement_time_step(double time_step_s)
 	//! Code advances the simulation by time_step
 
 	// Variables
-	double eps_abs = 1e-6;
-	double eps_rel = 1e-6;
-
 	int status;
 
 	double t_start_s = 0.0;
 	double t_stop_s = time_step_s;
 
-	double* y_calc = NULL;
+	gsl_odeiv2_driver* p_driver = p_myof_ode_driver;
 
-	double holder;
-	double adjustment;
+	double rejection_threshold = 0.2;	// switch when more than this
+										// proportion of attempts fail
+	int implicit_hold_steps = 50;		// then stay implicit for this
+										// many time-steps
 	
 	// Code
 
-	// Allocate memory for y
-	y_calc = (double*)malloc(y_length * sizeof(double));
-	
-	// Fill y_calc
-	for (size_t i = 0; i < y_length; i++)
+	prepare_time_step();
+
+	if (myof_ode_exponential)
 	{
-		y_calc[i] = gsl_vector_get(y, i);
+		// Advance y_calc in place, this cannot fail
+		implement_exponential_step(time_step_s);
+		status = GSL_SUCCESS;
 	}
+	else
+	{
+		// Pick the driver
+		if ((myof_ode_auto) && (myof_ode_implicit_steps_left > 0))
+		{
+			p_driver = p_myof_implicit_ode_driver;
+			myof_ode_implicit_steps_left = myof_ode_implicit_steps_left - 1;
+		}
 
-	gsl_odeiv2_system sys = { myof_calculate_derivs, NULL, y_length, this };
-
-	gsl_odeiv2_driver* d =
-		gsl_odeiv2_driver_alloc_y_new(&sys, gsl_odeiv2_step_rkf45,
-			0.5*time_step_s, eps_abs, eps_rel);
+		// Reset the persistent driver so that each time-step starts with
+		// the same initial step as a freshly allocated driver
+		gsl_odeiv2_driver_reset_hstart(p_driver, 0.5 * time_step_s);
 
-	status = gsl_odeiv2_driver_apply(d, &t_start_s, t_stop_s, y_calc);
+		status = gsl_odeiv2_driver_apply(p_driver, &t_start_s, t_stop_s, y_calc);
 
-	gsl_odeiv2_driver_free(d);
+		// The explicit stepper struggles when the system is stiff, which shows
+		// up as rejected steps. Move to the implicit stepper for a while
+		// count holds accepted steps, failed_steps the rejected attempts
+		if ((myof_ode_auto) && (p_driver == p_myof_ode_driver) && (p_driver->e->count > 0))
+		{
+			if (((double)p_driver->e->failed_steps /
+				(double)(p_driver->e->count + p_driver->e->failed_steps)) > rejection_threshold)
+			{
+				myof_ode_implicit_steps_left = implicit_hold_steps;
+			}
+		}
+	}
 
 	if (status != GSL_SUCCESS)
 	{
 		std::cout << "Integration problem in myofilaments::implement_time_step\n";
 		exit(1);
 	}
-	else
-	{
-		//Unpack, noting how many bridges we have
-		holder = 0.0;
-		for (int i = 0; i < y_length; i++)
-		{
-			if (y_calc[i] < 0.0)
-				y_calc[i] = 0.0;
 
-			gsl_vector_set(y, i, y_calc[i]);
+	finish_time_step();
+}
 
-			if (i < (y_length - 2))
-			{
-				holder = holder + y_calc[i];
-			}
-		}
+void myofilaments::prepare_time_step(void)
+{
+	//! Code sets the quantities that are held constant over a time-step
+	//! and fills y_calc, which the integrators then advance
 
-		adjustment = 1.0 - holder;
+	// Code
 
-		// Add back to first DRX state
-		int DRX_index = gsl_matrix_int_get(m_y_indices, p_m_scheme->first_DRX_state - 1, 0);
-		y_calc[DRX_index] = y_calc[DRX_index] + adjustment;
-		gsl_vector_set(y, DRX_index, y_calc[DRX_index]);
-		if (fabs(adjustment) > 0.001)
-		{
-			double t = p_parent_hs->p_cmv_system->cum_time_s;
-			cout << "t: " << t << " fast sliding : " << adjustment << "\n";
-		}
-	}
+	// Make sure the cached rates match the current state of the
+	// half-sarcomere. These are constant over the time-step
+	p_m_scheme->update_rate_table(myof_stress_myof, p_parent_hs->hs_length);
 
-	// Update class variables
+	// f_overlap is also constant over the time-step
+	calculate_f_overlap();
 
-	// Populations
-	calculate_m_state_pops(y_calc);
-	for (int i = 0; i < p_m_scheme->no_of_states; i++)
+	// Fill y_calc
+	for (size_t i = 0; i < y_length; i++)
 	{
-		m_pops_array[i] = gsl_vector_get(m_state_pops, i);
+		y_calc[i] = gsl_vector_get(y, i);
 	}
 
-	myof_a_off = gsl_vector_get(y, a_off_index);
-	myof_a_on = gsl_vector_get(y, a_on_index);
-
-	// Forces
-	calculate_m_state_stresses();
-	for (int i = 0; i < p_m_scheme->no_of_states; i++)
+	// Skip bins that are effectively empty
+	if (myof_active_bin_threshold > 0.0)
 	{
-		m_stresses_array[i] = gsl_vector_get(m_state_stresses, i);
+		update_bin_windows();
 	}
-
-	calculate_stresses();
-
-	// Tidy up
-	free(y_calc);
 }
 
-void myofilaments::calculate_m_state_pops(const double y_calc[])
+void myofilaments::finish_time_step(void)
 {
-	//! Function returns m_bound
+	//! Code copies the advanced y_calc back to y, keeping the populations
+	//! positive and the number of myosins constant, and then updates the
+	//! summaries and stresses
 
 	// Variables
 	double holder;
-	double bound_holder;
+	double adjustment;
 
-	// Code
+	int DRX_index;
 
-	bound_holder = 0.0;
+	// Code
 
-	for (int state_counter = 0; state_counter < p_m_scheme->no_of_states;
-		state_counter++)
+	//Unpack, noting how many bridges we have
+	holder = 0.0;
+	for (int i = 0; i < y_length; i++)
 	{
-		holder = 0.0;
+		if (y_calc[i] < 0.0)
+			y_calc[i] = 0.0;
+
+		gsl_vector_set(y, i, y_calc[i]);
 
-		for (int i = gsl_matrix_int_get(m_y_indices, state_counter, 0);
-			i <= gsl_matrix_int_get(m_y_indices, state_counter, 1); i++)
+		if (i < (y_length - 2))
 		{
 			holder = holder + y_calc[i];
 		}
-		gsl_vector_set(m_state_pops, state_counter, holder);
+	}
 
-		if (p_m_scheme->p_m_states[state_counter]->state_type == 'A')
-		{
-			bound_holder = bound_holder + holder;
-		}
+	adjustment = 1.0 - holder;
+
+	// Add back to first DRX state
+	DRX_index = gsl_matrix_int_get(m_y_indices, p_m_scheme->first_DRX_state - 1, 0);
+	y_calc[DRX_index] = y_calc[DRX_index] + adjustment;
+	gsl_vector_set(y, DRX_index, y_calc[DRX_index]);
+	if (fabs(adjustment) > 0.001)
+	{
+		double t = p_parent_hs->p_cmv_system->cum_time_s;
+		cout << "t: " << t << " fast sliding : " << adjustment << "\n";
 	}
 
-	myof_m_bound = bound_holder;
+	// Update class variables
+
+	myof_a_off = gsl_vector_get(y, a_off_index);
+	myof_a_on = gsl_vector_get(y, a_on_index);
+
+	// Populations, m_bound, state stresses and ATP flux
+	calculate_m_state_summaries(y_calc);
+
+	calculate_stresses();
 }
 
-void myofilaments::calculate_f_overlap(void)
+void myofilaments::initialise_exponential_propagator(void)
 {
-	//! Calculate f_overlap
-	//! 
-	//!     <-- Thin--->
-	//!    |------------         |
-	//!    |                     |
-	//!    |      --------|------|
-	//!           <--Thick------>|
-	//!                    <Bare>|
+	//! Sets up the look-up tables used by the exponential propagator
+	//! Attached states are numbered in the order of the kinetic scheme's
+	//! attached ranges, detached states in the order they appear in y
 
 	// Variables
-	double x_no_overlap;
-	double x_overlap;
-	double max_x_overlap;
-	double protrusion;
+	int a_slot[MAX_NO_OF_KINETIC_STATES];		// slot for each state in its
+	int d_slot[MAX_NO_OF_KINETIC_STATES];		// block, -1 for the other block
+	int start_ind;
+	int no_of_attached;
+
+	const compiled_transition* p_ct;
 
 	// Code
 
-	x_no_overlap = p_parent_hs->hs_length - myof_thick_fil_length;
-	x_overlap = myof_thin_fil_length - x_no_overlap;
-	max_x_overlap = myof_thick_fil_length - myof_bare_zone_length;
-	protrusion = myof_thin_fil_length - p_parent_hs->hs_length;
+	exp_no_of_detached_states = 0;
+	no_of_attached = 0;
+
+	for (int state_counter = 0; state_counter < p_m_scheme->no_of_states; state_counter++)
+	{
+		start_ind = gsl_matrix_int_get(m_y_indices, state_counter, 0);
+
+		if (p_m_scheme->p_m_states[state_counter]->state_type == 'A')
+		{
+			a_slot[state_counter] = no_of_attached;
+			d_slot[state_counter] = -1;
+			no_of_attached = no_of_attached + 1;
+		}
+		else
+		{
+			exp_detached_y_index[exp_no_of_detached_states] = start_ind;
+			d_slot[state_counter] = exp_no_of_detached_states;
+			a_slot[state_counter] = -1;
+			exp_no_of_detached_states = exp_no_of_detached_states + 1;
+		}
+	}
+
+	// Each bin block holds the attached states plus an accumulator for
+	// each detached state, and the detached block holds the states plus
+	// their integrals
+	if (((no_of_attached + exp_no_of_detached_states) > MAX_MATRIX_EXPONENTIAL_SIZE) ||
+		((2 * exp_no_of_detached_states) > MAX_MATRIX_EXPONENTIAL_SIZE))
+	{
+		cout << "Error: kinetic scheme is too large for the exponential ode_stepper\n";
+		exit(1);
+	}
+
+	// Now map the compiled transitions, which hold y indices, onto slots
+	for (int ct_counter = 0; ct_counter < p_m_scheme->no_of_compiled_transitions;
+		ct_counter++)
+	{
+		p_ct = &p_m_scheme->compiled_transitions[ct_counter];
+
+		exp_from_slot[ct_counter] = -1;
+		exp_to_slot[ct_counter] = -1;
+
+		for (int state_counter = 0; state_counter < p_m_scheme->no_of_states; state_counter++)
+		{
+			start_ind = gsl_matrix_int_get(m_y_indices, state_counter, 0);
+
+			if (p_ct->from_index == start_ind)
+			{
+				if (a_slot[state_counter] >= 0)
+					exp_from_slot[ct_counter] = a_slot[state_counter];
+				else
+					exp_from_slot[ct_counter] = d_slot[state_counter];
+			}
+
+			if (p_ct->to_index == start_ind)
+			{
+				if (a_slot[state_counter] >= 0)
+					exp_to_slot[ct_counter] = a_slot[state_counter];
+				else
+					exp_to_slot[ct_counter] = d_slot[state_counter];
+			}
+		}
+	}
+
+	// Workspaces
+	exp_y_start = (double*)_aligned_malloc(y_length * sizeof(double), BIN_ARRAY_ALIGNMENT);
+
+	exp_bin_propagators = (double*)_aligned_malloc((size_t)no_of_bin_positions *
+		(size_t)(no_of_attached + exp_no_of_detached_states) *
+		(size_t)(no_of_attached + exp_no_of_detached_states) * sizeof(double),
+		BIN_ARRAY_ALIGNMENT);
+}
+
+void myofilaments::implement_exponential_step(double time_step_s)
+{
+	//! Advances y_calc by time_step_s using Strang splitting
+	//! The thin filament is advanced for half a step with the myosin
+	//! populations frozen. The myosin populations are then linear in y
+	//! and are advanced exactly, detached block for half a step, attached
+	//! bin blocks for a full step, detached block for half a step, with
+	//! the binding sites frozen. The thin filament finishes the step
+	//! The free binding sites change as myosins attach, so the myosin step
+	//! is predicted with the sites at the start of the step and repeated
+	//! with the average of the start and predicted values. The attached
+	//! propagators do not depend on the sites and are shared
+
+	// Variables
+	double free_sites_start;
+	double free_sites_end;
+
+	// Code
+
+	exponential_actin_step(0.5 * time_step_s);
+
+	// The bin blocks only need to span the active windows
+	exp_bin_start = no_of_bin_positions;
+	exp_bin_stop = -1;
+	for (int a_counter = 0; a_counter < p_m_scheme->no_of_attached_states; a_counter++)
+	{
+		if (bin_window_stop[a_counter] >= bin_window_start[a_counter])
+		{
+			exp_bin_start = GSL_MIN(exp_bin_start, bin_window_start[a_counter]);
+			exp_bin_stop = GSL_MAX(exp_bin_stop, bin_window_stop[a_counter]);
+		}
+	}
+
+	update_exponential_propagators(time_step_s);
+
+	// Predict
+	for (size_t i = 0; i < y_length; i++)
+	{
+		exp_y_start[i] = y_calc[i];
+	}
+
+	free_sites_start = return_free_binding_sites(y_calc);
+
+	exponential_detached_step(0.5 * time_step_s, free_sites_start);
+	exponential_attached_step();
+	exponential_detached_step(0.5 * time_step_s, free_sites_start);
+
+	free_sites_end = return_free_binding_sites(y_calc);
+
+	// Correct
+	for (size_t i = 0; i < y_length; i++)
+	{
+		y_calc[i] = exp_y_start[i];
+	}
+
+	exponential_detached_step(0.5 * time_step_s,
+		0.5 * (free_sites_start + free_sites_end));
+	exponential_attached_step();
+	exponential_detached_step(0.5 * time_step_s,
+		0.5 * (free_sites_start + free_sites_end));
+
+	exponential_actin_step(0.5 * time_step_s);
+}
+
+double myofilaments::return_free_binding_sites(const double y_calc[])
+{
+	//! Returns the proportion of binding sites that are on and free
+
+	// Variables
+	double free_sites;
+
+	// Code
+	free_sites = y_calc[a_on_index] - return_m_bound(y_calc);
+
+	if (free_sites < 0.0)
+		free_sites = 0.0;
+
+	return free_sites;
+}
+
+void myofilaments::exponential_detached_step(double dt, double free_sites)
+{
+	//! Advances the detached states exactly over dt, with transitions
+	//! between them and attachment as the only loss. The block is augmented
+	//! with the integral of each state so that the attachment into every
+	//! bin, which is proportional to that integral, is also exact
+	//! Attachment into a bin is weighted by the bin width
+
+	// Variables
+	int n;
+	int nd = exp_no_of_detached_states;
+
+	int from_slot;
+	int to_slot;
+
+	double K[MAX_MATRIX_EXPONENTIAL_SIZE * MAX_MATRIX_EXPONENTIAL_SIZE];
+	double E[MAX_MATRIX_EXPONENTIAL_SIZE * MAX_MATRIX_EXPONENTIAL_SIZE];
+
+	double d_old[MAX_NO_OF_KINETIC_STATES];
+	double d_integral[MAX_NO_OF_KINETIC_STATES];
+
+	double rate;
+	double holder;
+
+	int lo;
+	int n_active;
+
+	const double* rate_row;
+	const compiled_transition* p_ct;
+
+	// Code
+
+	n = 2 * nd;
+
+	for (int i = 0; i < (n * n); i++)
+	{
+		K[i] = 0.0;
+	}
+
+	for (int ct_counter = 0; ct_counter < p_m_scheme->no_of_compiled_transitions;
+		ct_counter++)
+	{
+		p_ct = &p_m_scheme->compiled_transitions[ct_counter];
+
+		rate_row = gsl_matrix_const_ptr(p_m_scheme->rate_table, p_ct->rate_row, 0);
+
+		from_slot = exp_from_slot[ct_counter];
+		to_slot = exp_to_slot[ct_counter];
+
+		if (p_ct->type == ct_D_to_D)
+		{
+			rate = rate_row[0] * dt;
+			K[(from_slot * n) + from_slot] -= rate;
+			K[(to_slot * n) + from_slot] += rate;
+		}
+		else if (p_ct->type == ct_D_to_A)
+		{
+			lo = bin_window_start[p_ct->to_attached];
+			n_active = bin_window_stop[p_ct->to_attached] - lo + 1;
+
+			rate = free_sites * bin_kernels::flux(&bin_w[lo], &rate_row[lo], n_active) * dt;
+			K[(from_slot * n) + from_slot] -= rate;
+		}
+	}
+
+	// The integrals
+	for (int i = 0; i < nd; i++)
+	{
+		K[((nd + i) * n) + i] = dt;
+	}
+
+	matrix_functions::exponential(K, E, n);
+
+	for (int i = 0; i < nd; i++)
+	{
+		d_old[i] = y_calc[exp_detached_y_index[i]];
+	}
+
+	for (int i = 0; i < nd; i++)
+	{
+		holder = 0.0;
+		for (int j = 0; j < nd; j++)
+		{
+			holder = holder + (E[(i * n) + j] * d_old[j]);
+		}
+		y_calc[exp_detached_y_index[i]] = holder;
+
+		holder = 0.0;
+		for (int j = 0; j < nd; j++)
+		{
+			holder = holder + (E[((nd + i) * n) + j] * d_old[j]);
+		}
+		d_integral[i] = holder;
+	}
+
+	// Distribute the attached myosins across the bins
+	for (int ct_counter = 0; ct_counter < p_m_scheme->no_of_compiled_transitions;
+		ct_counter++)
+	{
+		p_ct = &p_m_scheme->compiled_transitions[ct_counter];
+
+		if (p_ct->type == ct_D_to_A)
+		{
+			rate_row = gsl_matrix_const_ptr(p_m_scheme->rate_table, p_ct->rate_row, 0);
+
+			lo = bin_window_start[p_ct->to_attached];
+			n_active = bin_window_stop[p_ct->to_attached] - lo + 1;
+
+			bin_kernels::attach_weighted(&y_calc[p_ct->to_index + lo], &rate_row[lo],
+				&bin_w[lo], free_sites * d_integral[exp_from_slot[ct_counter]], n_active);
+		}
+	}
+}
+
+void myofilaments::update_exponential_propagators(double dt)
+{
+	//! Calculates the propagator for each bin block over dt
+	//! Within a bin the attached states only exchange with each other and
+	//! lose myosins to the detached states, which are tracked by
+	//! accumulators added to the block
+
+	// Variables
+	int n;
+	int na = p_m_scheme->no_of_attached_states;
+
+	int from_slot;
+	int to_slot;
+
+	double K[MAX_MATRIX_EXPONENTIAL_SIZE * MAX_MATRIX_EXPONENTIAL_SIZE];
+
+	double rate;
+
+	const compiled_transition* p_ct;
+
+	// Code
+
+	n = na + exp_no_of_detached_states;
+
+	for (int bin_index = exp_bin_start; bin_index <= exp_bin_stop; bin_index++)
+	{
+		for (int i = 0; i < (n * n); i++)
+		{
+			K[i] = 0.0;
+		}
+
+		for (int ct_counter = 0; ct_counter < p_m_scheme->no_of_compiled_transitions;
+			ct_counter++)
+		{
+			p_ct = &p_m_scheme->compiled_transitions[ct_counter];
+
+			if ((p_ct->type != ct_A_to_A) && (p_ct->type != ct_A_to_D))
+				continue;
+
+			rate = gsl_matrix_get(p_m_scheme->rate_table, p_ct->rate_row, bin_index) * dt;
+
+			from_slot = exp_from_slot[ct_counter];
+			to_slot = exp_to_slot[ct_counter];
+
+			// Detached states sit after the attached states
+			if (p_ct->type == ct_A_to_D)
+				to_slot = na + to_slot;
+
+			K[(from_slot * n) + from_slot] -= rate;
+			K[(to_slot * n) + from_slot] += rate;
+		}
+
+		matrix_functions::exponential(K, &exp_bin_propagators[bin_index * n * n], n);
+	}
+}
+
+void myofilaments::exponential_attached_step(void)
+{
+	//! Advances the attached states with the bin propagators calculated
+	//! by update_exponential_propagators
+
+	// Variables
+	int n;
+	int na = p_m_scheme->no_of_attached_states;
+	int nd = exp_no_of_detached_states;
+
+	const double* E;
+
+	double a_old[MAX_NO_OF_KINETIC_STATES];
+	double d_gain[MAX_NO_OF_KINETIC_STATES];
+
+	double holder;
+
+	// Code
+
+	n = na + nd;
+
+	for (int i = 0; i < nd; i++)
+	{
+		d_gain[i] = 0.0;
+	}
+
+	for (int bin_index = exp_bin_start; bin_index <= exp_bin_stop; bin_index++)
+	{
+		E = &exp_bin_propagators[bin_index * n * n];
+
+		for (int i = 0; i < na; i++)
+		{
+			a_old[i] = y_calc[p_m_scheme->attached_y_start[i] + bin_index];
+		}
+
+		for (int i = 0; i < na; i++)
+		{
+			holder = 0.0;
+			for (int j = 0; j < na; j++)
+			{
+				holder = holder + (E[(i * n) + j] * a_old[j]);
+			}
+			y_calc[p_m_scheme->attached_y_start[i] + bin_index] = holder;
+		}
+
+		for (int i = 0; i < nd; i++)
+		{
+			for (int j = 0; j < na; j++)
+			{
+				d_gain[i] = d_gain[i] + (E[((na + i) * n) + j] * a_old[j]);
+			}
+		}
+	}
+
+	for (int i = 0; i < nd; i++)
+	{
+		y_calc[exp_detached_y_index[i]] = y_calc[exp_detached_y_index[i]] + d_gain[i];
+	}
+}
+
+void myofilaments::exponential_actin_step(double dt)
+{
+	//! Advances the thin filament over dt with the myosin populations
+	//! frozen. The system is a single non-linear equation so it is
+	//! integrated with RK4, sub-dividing the step when it is stiff
+
+	// Variables
+	double m_bound;
+	double a_on;
+	double a_total;
+
+	double k1, k2, k3, k4;
+	double h;
+	double lambda;
+
+	int n_sub_steps;
+
+	// Code
+
+	m_bound = return_m_bound(y_calc);
+
+	a_on = y_calc[a_on_index];
+	a_total = y_calc[a_off_index] + a_on;
+
+	// Upper bound for the magnitude of d(flux)/d(a_on), keep h * lambda
+	// well inside the RK4 stability region
+	lambda = (1.0 + (2.0 * myof_a_k_coop)) *
+		((myof_a_k_on * p_parent_hs->p_membranes->memb_Ca_cytosol) + myof_a_k_off);
+
+	n_sub_steps = 1 + (int)(lambda * dt / 0.5);
+	h = dt / (double)n_sub_steps;
+
+	for (int i = 0; i < n_sub_steps; i++)
+	{
+		k1 = return_actin_flux(a_on, m_bound);
+		k2 = return_actin_flux(a_on + (0.5 * h * k1), m_bound);
+		k3 = return_actin_flux(a_on + (0.5 * h * k2), m_bound);
+		k4 = return_actin_flux(a_on + (h * k3), m_bound);
+
+		a_on = a_on + ((h / 6.0) * (k1 + (2.0 * k2) + (2.0 * k3) + k4));
+	}
+
+	y_calc[a_on_index] = a_on;
+	y_calc[a_off_index] = a_total - a_on;
+}
+
+double myofilaments::return_actin_flux(double a_on, double m_bound)
+{
+	//! Returns d(a_on)/dt, the rate at which binding sites switch on,
+	//! for the current Ca concentration and f_overlap
+
+	// Variables
+	double f_overlap = myof_f_overlap;
+
+	double J_on;
+	double J_off;
+
+	// Code
+	if (f_overlap > 0.0)
+	{
+		J_on = myof_a_k_on * (p_parent_hs->p_membranes->memb_Ca_cytosol) *
+			(f_overlap - a_on) *
+			(1.0 + (myof_a_k_coop * (a_on / f_overlap)));
+
+		J_off = myof_a_k_off * (a_on - m_bound) *
+			(1.0 + (myof_a_k_coop * ((f_overlap - a_on) / f_overlap)));
+	}
+	else
+	{
+		J_on = 0.0;
+		J_off = myof_a_k_off * (a_on - m_bound);
+	}
+
+	return (J_on - J_off);
+}
+
+void myofilaments::calculate_m_state_summaries(const double y_calc[])
+{
+	//! Function makes a single pass through y_calc and sets the state
+	//! populations, myof_m_bound, the state stresses, and the ATP flux
+	//! The stress in an attached state is proportional to
+	//! sum(pop * (x + extension)), which is the first moment about the
+	//! bin positions plus the extension times the population
+	//! Only the active bins are visited, the others are empty
+
+	// Variables
+	int start_ind;
+	int a_counter;
+	int lo;
+	int n_active;
+
+	double pop;
+	double moment;
+	double atp_flux;
+	double stress;
+
+	double bound_holder;
+	double atp_holder;
+
+	double stress_factor;
+
+	const double* p_atp_rates;
+
+	const compiled_transition* p_ct;
+
+	// Code
+
+	// Adjust for fibrosis, myofilament area, and units
+	stress_factor = (1.0 - p_parent_hs->hs_prop_fibrosis) *
+		p_parent_hs->hs_prop_myofilaments *
+		myof_cb_number_density * 1e-9 * myof_k_cb;
+
+	bound_holder = 0.0;
+	atp_holder = 0.0;
+	a_counter = 0;
+
+	for (int state_counter = 0; state_counter < p_m_scheme->no_of_states;
+		state_counter++)
+	{
+		start_ind = gsl_matrix_int_get(m_y_indices, state_counter, 0);
+
+		if (p_m_scheme->p_m_states[state_counter]->state_type == 'A')
+		{
+			lo = bin_window_start[a_counter];
+			n_active = bin_window_stop[a_counter] - lo + 1;
+
+			// Find the first ATP-requiring detachment from this state so that
+			// its flux can be picked up in the same sweep
+			p_atp_rates = NULL;
+			for (int ct_counter = 0; ct_counter < p_m_scheme->no_of_compiled_transitions;
+				ct_counter++)
+			{
+				p_ct = &p_m_scheme->compiled_transitions[ct_counter];
+
+				if ((p_ct->type == ct_A_to_D) && (p_ct->ATP_required) &&
+					(p_ct->from_attached == a_counter))
+				{
+					if (p_atp_rates == NULL)
+					{
+						p_atp_rates = gsl_matrix_const_ptr(p_m_scheme->rate_table,
+							p_ct->rate_row, 0) + lo;
+					}
+					else
+					{
+						// Unusual, a second ATP-requiring detachment
+						atp_holder = atp_holder + bin_kernels::flux(&y_calc[start_ind + lo],
+							gsl_matrix_const_ptr(p_m_scheme->rate_table, p_ct->rate_row, 0) + lo,
+							n_active);
+					}
+				}
+			}
+
+			bin_kernels::summarise(&y_calc[start_ind + lo], &bin_x[lo], p_atp_rates,
+				n_active, &pop, &moment, &atp_flux);
+
+			a_counter = a_counter + 1;
+
+			stress = stress_factor *
+				(moment + (p_m_scheme->p_m_states[state_counter]->extension * pop));
+
+			bound_holder = bound_holder + pop;
+			atp_holder = atp_holder + atp_flux;
+		}
+		else
+		{
+			pop = y_calc[start_ind];
+			stress = 0.0;
+		}
+
+		gsl_vector_set(m_state_pops, state_counter, pop);
+		gsl_vector_set(m_state_stresses, state_counter, stress);
+
+		m_pops_array[state_counter] = pop;
+		m_stresses_array[state_counter] = stress;
+	}
+
+	myof_m_bound = bound_holder;
+	myof_ATP_flux = atp_holder;
+}
+
+double myofilaments::return_m_bound(const double y_calc[])
+{
+	//! Function returns the proportion of myosins that are bound
+	//! without updating the state populations
+
+	// Variables
+	double holder = 0.0;
+
+	// Code
+	// Bins outside the active windows are empty
+	for (int a_counter = 0; a_counter < p_m_scheme->no_of_attached_states; a_counter++)
+	{
+		holder = holder + bin_kernels::sum(&y_calc[p_m_scheme->attached_y_start[a_counter] +
+				bin_window_start[a_counter]],
+			bin_window_stop[a_counter] - bin_window_start[a_counter] + 1);
+	}
 
-	if (x_overlap == 0.0)
-		myof_f_overlap = 0.0;
+	return holder;
+}
 
-	if ((x_overlap > 0.0) && (x_overlap <= max_x_overlap))
-		myof_f_overlap = x_overlap / max_x_overlap;
+void myofilaments::build_bin_grid(void)
+{
+	//! Sets no_of_bin_positions, x, and the bin widths and edges
+	//! Each bin covers the interval between its edges and x holds the
+	//! centres. The uniform grid has bin_width bins centred on bin_min,
+	//! bin_min + bin_width, ... up to bin_max. The non_uniform grid uses
+	//! bin_width between bin_fine_min and bin_fine_max, where the rates
+	//! peak, and bin_coarse_width outside, extending the coarse bins until
+	//! bin_min and bin_max are covered
 
-	if (x_overlap > max_x_overlap)
-		myof_f_overlap = 1.0;
+	// Variables
+	int n_left;
+	int n_fine;
+	int n_right;
 
-	if (protrusion > 0.0)
+	double fine_w = p_cmv_options->bin_width;
+	double coarse_w = p_cmv_options->bin_coarse_width;
+
+	// Code
+
+	if (p_cmv_options->bin_grid_type == "uniform")
 	{
-		x_overlap = max_x_overlap - protrusion;
-		myof_f_overlap = x_overlap / max_x_overlap;
+		myof_uniform_grid = true;
+
+		no_of_bin_positions = 1 + (int)((p_cmv_options->bin_max - p_cmv_options->bin_min) /
+			p_cmv_options->bin_width);
+
+		bin_edges = (double*)malloc((no_of_bin_positions + 1) * sizeof(double));
+
+		for (int i = 0; i <= no_of_bin_positions; i++)
+		{
+			bin_edges[i] = p_cmv_options->bin_min + (((double)i - 0.5) * fine_w);
+		}
+	}
+	else if (p_cmv_options->bin_grid_type == "non_uniform")
+	{
+		myof_uniform_grid = false;
+
+		if ((p_cmv_options->bin_fine_min < p_cmv_options->bin_min) ||
+			(p_cmv_options->bin_fine_max > p_cmv_options->bin_max) ||
+			(p_cmv_options->bin_fine_max <= p_cmv_options->bin_fine_min) ||
+			(coarse_w < fine_w))
+		{
+			cout << "Error: non_uniform bin_grid needs bin_min <= fine_min < fine_max <= bin_max " <<
+				"and coarse_bin_width >= bin_width\n";
+			exit(1);
+		}
+
+		n_fine = (int)ceil(((p_cmv_options->bin_fine_max - p_cmv_options->bin_fine_min) /
+			fine_w) - 1e-9);
+		n_left = (int)ceil(((p_cmv_options->bin_fine_min - p_cmv_options->bin_min) /
+			coarse_w) - 1e-9);
+		n_right = (int)ceil(((p_cmv_options->bin_max -
+			(p_cmv_options->bin_fine_min + (n_fine * fine_w))) / coarse_w) - 1e-9);
+
+		if (n_right < 0)
+			n_right = 0;
+
+		no_of_bin_positions = n_left + n_fine + n_right;
+
+		bin_edges = (double*)malloc((no_of_bin_positions + 1) * sizeof(double));
+
+		bin_edges[0] = p_cmv_options->bin_fine_min - (n_left * coarse_w);
+
+		for (int i = 0; i < no_of_bin_positions; i++)
+		{
+			if ((i < n_left) || (i >= (n_left + n_fine)))
+				bin_edges[i + 1] = bin_edges[i] + coarse_w;
+			else
+				bin_edges[i + 1] = bin_edges[i] + fine_w;
+		}
+	}
+	else
+	{
+		cout << "Error: bin_grid type: " << p_cmv_options->bin_grid_type <<
+			" not recognized\n";
+		exit(1);
+	}
+
+	// Assign x and the widths
+	x = gsl_vector_alloc(no_of_bin_positions);
+
+	bin_x = (double*)_aligned_malloc(no_of_bin_positions * sizeof(double),
+		BIN_ARRAY_ALIGNMENT);
+	bin_w = (double*)_aligned_malloc(no_of_bin_positions * sizeof(double),
+		BIN_ARRAY_ALIGNMENT);
+
+	for (int i = 0; i < no_of_bin_positions; i++)
+	{
+		if (myof_uniform_grid)
+		{
+			// Keep the positions exactly as they have always been
+			bin_x[i] = p_cmv_options->bin_min + ((double)i * fine_w);
+			bin_w[i] = fine_w;
+		}
+		else
+		{
+			bin_x[i] = 0.5 * (bin_edges[i] + bin_edges[i + 1]);
+			bin_w[i] = bin_edges[i + 1] - bin_edges[i];
+		}
+
+		gsl_vector_set(x, i, bin_x[i]);
 	}
 }
 
-void myofilaments::calculate_m_state_stresses(void)
+void myofilaments::update_bin_windows(void)
 {
-	//| Function calculates cross-bridge stresses
+	//! Narrows the active window of each attached state to the bins that
+	//! matter for the coming time-step, which are
+	//!   bins holding more than the threshold population
+	//!   bins receiving more than the threshold share of an attachment
+	//!   bins that can be filled from another attached state's window
+	//! Populations left outside the windows are below the threshold and
+	//! are returned to the first DRX state so that mass is conserved.
+	//! Works on y_calc
 
 	// Variables
+	int na = p_m_scheme->no_of_attached_states;
 
-	int bin_index;
+	int start_ind;
+	int lo;
+	int hi;
+	int from_a;
+	int to_a;
 
-	double x_bin;
-	double x_ext;
-	double bin_pop;
+	int DRX_index;
 
-	double holder;
+	double threshold = myof_active_bin_threshold;
+	double total;
+	double returned;
+
+	const double* rate_row;
+
+	const compiled_transition* p_ct;
 
 	// Code
 
-	// Cycle through through the states
-	for (int state_counter = 0; state_counter < p_m_scheme->no_of_states;
-		state_counter++)
+	myof_window_updates = myof_window_updates + 1;
+
+	// Bins that hold population
+	for (int a_counter = 0; a_counter < na; a_counter++)
 	{
-		char state_type = p_m_scheme->p_m_states[state_counter]->state_type;
+		start_ind = p_m_scheme->attached_y_start[a_counter];
 
-		holder = 0.0;
+		lo = 0;
+		while ((lo < no_of_bin_positions) && (y_calc[start_ind + lo] <= threshold))
+			lo = lo + 1;
+
+		hi = no_of_bin_positions - 1;
+		while ((hi >= lo) && (y_calc[start_ind + hi] <= threshold))
+			hi = hi - 1;
+
+		bin_window_start[a_counter] = lo;
+		bin_window_stop[a_counter] = hi;
+	}
+
+	// Bins that myosins attach to
+	for (int ct_counter = 0; ct_counter < p_m_scheme->no_of_compiled_transitions;
+		ct_counter++)
+	{
+		p_ct = &p_m_scheme->compiled_transitions[ct_counter];
+
+		if (p_ct->type != ct_D_to_A)
+			continue;
+
+		rate_row = gsl_matrix_const_ptr(p_m_scheme->rate_table, p_ct->rate_row, 0);
+
+		total = bin_kernels::flux(bin_w, rate_row, no_of_bin_positions);
+
+		lo = 0;
+		while ((lo < no_of_bin_positions) && ((bin_w[lo] * rate_row[lo]) <= (threshold * total)))
+			lo = lo + 1;
+
+		hi = no_of_bin_positions - 1;
+		while ((hi >= lo) && ((bin_w[hi] * rate_row[hi]) <= (threshold * total)))
+			hi = hi - 1;
+
+		to_a = p_ct->to_attached;
+
+		if (hi >= lo)
+		{
+			if (bin_window_stop[to_a] < bin_window_start[to_a])
+			{
+				bin_window_start[to_a] = lo;
+				bin_window_stop[to_a] = hi;
+			}
+			else
+			{
+				bin_window_start[to_a] = GSL_MIN(bin_window_start[to_a], lo);
+				bin_window_stop[to_a] = GSL_MAX(bin_window_stop[to_a], hi);
+			}
+		}
+	}
 
-		if (state_type == 'A')
+	// Attached to attached transitions keep the bin, so each state's window
+	// has to cover the windows of the states that feed it. Chains are at
+	// most na long
+	for (int pass = 0; pass < na; pass++)
+	{
+		for (int ct_counter = 0; ct_counter < p_m_scheme->no_of_compiled_transitions;
+			ct_counter++)
 		{
-			x_ext = p_m_scheme->p_m_states[state_counter]->extension;
+			p_ct = &p_m_scheme->compiled_transitions[ct_counter];
+
+			if (p_ct->type != ct_A_to_A)
+				continue;
+
+			from_a = p_ct->from_attached;
+			to_a = p_ct->to_attached;
 
-			// Set the bin index
-			bin_index = gsl_matrix_int_get(m_y_indices, state_counter, 0);
+			if (bin_window_stop[from_a] < bin_window_start[from_a])
+				continue;
 
-			for (int i = 0; i < no_of_bin_positions; i++)
+			if (bin_window_stop[to_a] < bin_window_start[to_a])
+			{
+				bin_window_start[to_a] = bin_window_start[from_a];
+				bin_window_stop[to_a] = bin_window_stop[from_a];
+			}
+			else
 			{
-				// Get bin position
-				x_bin = gsl_vector_get(x, i);
+				bin_window_start[to_a] = GSL_MIN(bin_window_start[to_a], bin_window_start[from_a]);
+				bin_window_stop[to_a] = GSL_MAX(bin_window_stop[to_a], bin_window_stop[from_a]);
+			}
+		}
+	}
+
+	// Return what is left outside the windows
+	DRX_index = gsl_matrix_int_get(m_y_indices, p_m_scheme->first_DRX_state - 1, 0);
 
-				/// Get population
-				bin_pop = gsl_vector_get(y, bin_index);
+	returned = 0.0;
 
-				// Add force to holder
-				holder = holder + (bin_pop * (x_bin + x_ext));
+	for (int a_counter = 0; a_counter < na; a_counter++)
+	{
+		start_ind = p_m_scheme->attached_y_start[a_counter];
 
-				bin_index = bin_index + 1;
+		for (int i = 0; i < no_of_bin_positions; i++)
+		{
+			if ((i < bin_window_start[a_counter]) || (i > bin_window_stop[a_counter]))
+			{
+				returned = returned + y_calc[start_ind + i];
+				y_calc[start_ind + i] = 0.0;
 			}
 		}
 
-		// Adjust for fibrosis, myofilament area, and units
-		holder = (1.0 - p_parent_hs->hs_prop_fibrosis) * 
-			p_parent_hs->hs_prop_myofilaments *
-			myof_cb_number_density * 1e-9 * myof_k_cb * holder;
+		if (bin_window_stop[a_counter] >= bin_window_start[a_counter])
+		{
+			myof_active_bin_count = myof_active_bin_count +
+				(bin_window_stop[a_counter] - bin_window_start[a_counter] + 1);
+		}
+	}
+
+	y_calc[DRX_index] = y_calc[DRX_index] + returned;
+}
+
+void myofilaments::calculate_f_overlap(void)
+{
+	//! Calculate f_overlap
+	//! 
+	//!     <-- Thin--->
+	//!    |------------         |
+	//!    |                     |
+	//!    |      --------|------|
+	//!           <--Thick------>|
+	//!                    <Bare>|
+
+	// Variables
+	double x_no_overlap;
+	double x_overlap;
+	double max_x_overlap;
+	double protrusion;
+
+	// Code
+
+	x_no_overlap = p_parent_hs->hs_length - myof_thick_fil_length;
+	x_overlap = myof_thin_fil_length - x_no_overlap;
+	max_x_overlap = myof_thick_fil_length - myof_bare_zone_length;
+	protrusion = myof_thin_fil_length - p_parent_hs->hs_length;
+
+	if (x_overlap == 0.0)
+		myof_f_overlap = 0.0;
+
+	if ((x_overlap > 0.0) && (x_overlap <= max_x_overlap))
+		myof_f_overlap = x_overlap / max_x_overlap;
+
+	if (x_overlap > max_x_overlap)
+		myof_f_overlap = 1.0;
 
-		gsl_vector_set(m_state_stresses, state_counter, holder);
+	if (protrusion > 0.0)
+	{
+		x_overlap = max_x_overlap - protrusion;
+		myof_f_overlap = x_overlap / max_x_overlap;
 	}
 }
 
@@ -840,21 +1913,17 @@ void myofilaments::move_cb_populations(double delta_hsl)
 	//! Code displaces cross-bridge populations
 
 	// Variables
-	bool x_defined = false;
-
-	double* x_calc = NULL;
-	double* y_calc = NULL;
-	double* y_temp;
-
 	double x_shift;
 
 	int n_sub_steps;
 	double s;
 	bool keep_going;
-	
-	const gsl_interp_type* interp_type = gsl_interp_linear;
-	gsl_interp_accel* acc = NULL;
-	gsl_spline* spline = NULL;
+
+	int start_ind;
+	int i_new;
+	int i_old;
+	double lo;
+	double hi;
 
 	// Code
 
@@ -864,57 +1933,87 @@ void myofilaments::move_cb_populations(double delta_hsl)
 		return;
 	}
 
-	// Allocate memory for y_calc
-	x_calc = (double*)malloc(no_of_bin_positions * sizeof(double));
-	y_calc = (double*)malloc(no_of_bin_positions * sizeof(double));
-	y_temp = (double*)malloc(no_of_bin_positions * sizeof(double));
-	
-	// Cycle through states
-	for (size_t state_counter = 0; state_counter < (size_t)(p_m_scheme->no_of_states) ; state_counter++)
+	// Work out the shift
+	x_shift = myof_fil_compliance_factor * delta_hsl;
+
+	if (!myof_uniform_grid)
 	{
-		if (p_m_scheme->p_m_states[state_counter]->state_type == 'A')
+		// Interpolating between bins of different widths does not conserve
+		// mass. Instead, treat each bin as holding its population evenly
+		// between its edges, shift the bins, and share each one with the
+		// bins it now overlaps. This is exact for any shift so the move is
+		// not sub-divided. As for the uniform grid, populations shifted off
+		// the grid are lost and restored to the DRX state in the next
+		// time-step
+		for (int a_counter = 0; a_counter < p_m_scheme->no_of_attached_states; a_counter++)
 		{
-			// We need to move populations
+			start_ind = p_m_scheme->attached_y_start[a_counter];
 
-			// Set x_calc
-			if (x_defined == false)
+			for (int ind = 0; ind < no_of_bin_positions; ind++)
 			{
-				// First time
-				// Set x
-				for (size_t ind = 0; ind < no_of_bin_positions; ind++)
-				{
-					x_calc[ind] = gsl_vector_get(x, ind);
-				}
-
-				// Initialise for interpolation
-				acc = gsl_interp_accel_alloc();
-				spline = gsl_spline_alloc(interp_type, no_of_bin_positions);
-
-				// Work out the shift
-				x_shift = myof_fil_compliance_factor * delta_hsl;
-
-				// Note we are set up
-				x_defined = true;
+				move_y[ind] = gsl_vector_get(y, start_ind + ind);
+				move_y_temp[ind] = 0.0;
 			}
 
-			// Subdivide if necessary
-			n_sub_steps = 1;
-			s = x_shift;
-			keep_going = true;
-
-			while (keep_going)
+			// Sweep through the new bins and the shifted old bins together
+			i_new = 0;
+			i_old = 0;
+			while ((i_new < no_of_bin_positions) && (i_old < no_of_bin_positions))
 			{
-				if (fabs(s) < 1.0)
+				lo = GSL_MAX(bin_edges[i_new], bin_edges[i_old] + x_shift);
+				hi = GSL_MIN(bin_edges[i_new + 1], bin_edges[i_old + 1] + x_shift);
+
+				if (hi > lo)
 				{
-					keep_going = false;
+					move_y_temp[i_new] = move_y_temp[i_new] +
+						(move_y[i_old] * (hi - lo) / bin_w[i_old]);
 				}
+
+				if (bin_edges[i_new + 1] < (bin_edges[i_old + 1] + x_shift))
+					i_new = i_new + 1;
 				else
-				{
-					n_sub_steps = n_sub_steps + 1;
-					s = x_shift / (double)(n_sub_steps);
-				}
+					i_old = i_old + 1;
+			}
+
+			for (int ind = 0; ind < no_of_bin_positions; ind++)
+			{
+				gsl_vector_set(y, start_ind + ind, move_y_temp[ind]);
 			}
+		}
+
+		if ((fabs(x_shift) > fabs(max_shift)) && (p_parent_hs->p_cmv_system->cum_time_s > 0.001))
+		{
+			max_shift = x_shift;
+			n_max_sub_steps = 1;
+		}
+
+		return;
+	}
+
+	// Subdivide if necessary
+	n_sub_steps = 1;
+	s = x_shift;
+	keep_going = true;
+
+	while (keep_going)
+	{
+		if (fabs(s) < 1.0)
+		{
+			keep_going = false;
+		}
+		else
+		{
+			n_sub_steps = n_sub_steps + 1;
+			s = x_shift / (double)(n_sub_steps);
+		}
+	}
 
+	// Cycle through states
+	for (size_t state_counter = 0; state_counter < (size_t)(p_m_scheme->no_of_states) ; state_counter++)
+	{
+		if (p_m_scheme->p_m_states[state_counter]->state_type == 'A')
+		{
+			// We need to move populations
 			for (int repeat = 1 ; repeat <= n_sub_steps ; repeat++)
 			{
 				if ((repeat == 1) && (n_sub_steps > n_max_sub_steps))
@@ -925,26 +2024,29 @@ void myofilaments::move_cb_populations(double delta_hsl)
 				{
 					if (repeat == 1)
 					{
-						y_calc[ind] = gsl_vector_get(y, ind + gsl_matrix_int_get(m_y_indices, state_counter, 0));
+						move_y[ind] = gsl_vector_get(y, ind + gsl_matrix_int_get(m_y_indices, state_counter, 0));
 					}
 					else
 					{
-						y_calc[ind] = y_temp[ind];
+						move_y[ind] = move_y_temp[ind];
 					}
 				}
 
-				gsl_spline_init(spline, x_calc, y_calc, no_of_bin_positions);
+				// The spline and accelerator were allocated in initialise_simulation
+				// and are re-used here
+				gsl_spline_init(p_move_spline, bin_x, move_y, no_of_bin_positions);
+				gsl_interp_accel_reset(p_move_acc);
 			
 				// Calculate at the new positions
 				for (size_t ind = 0; ind < no_of_bin_positions; ind++)
 				{
-					double new_pos = x_calc[ind] - s;
+					double new_pos = bin_x[ind] - s;
 
 					if ((new_pos < p_cmv_options->bin_min) || (new_pos > p_cmv_options->bin_max))
-						y_temp[ind] = 0.0;
+						move_y_temp[ind] = 0.0;
 					else
 					{
-						y_temp[ind] = gsl_spline_eval(spline, new_pos, acc);
+						move_y_temp[ind] = gsl_spline_eval(p_move_spline, new_pos, p_move_acc);
 					}
 				}
 			}
@@ -953,7 +2055,7 @@ void myofilaments::move_cb_populations(double delta_hsl)
 			{
 				// Assign 
 				gsl_vector_set(y, gsl_matrix_int_get(m_y_indices, state_counter, 0) + ind,
-					y_temp[ind]);
+					move_y_temp[ind]);
 			}
 		}
 	}
@@ -963,148 +2065,31 @@ void myofilaments::move_cb_populations(double delta_hsl)
 		max_shift = x_shift;
 		n_max_sub_steps = n_sub_steps;
 	}
-
-	// Tidy up
-	gsl_spline_free(spline);
-	gsl_interp_accel_free(acc);
-
-	free(x_calc);
-	free(y_calc);
-	free(y_temp);
-
 }
 
-void myofilaments::dump_cb_distributions(void)
+void myofilaments::copy_cb_distributions(float* p_values)
 {
-	//! Code dumps cb distributions
-	
-	// Variables
-
-	FILE* output_file;
-
-	path options_file_path;		// path for options file
-	path output_file_path;		// path for output file
-
-	string open_mode;
+	//! Code copies the populations in each bin of each attached state,
+	//! one state after another, to p_values
 
-	int attached_state_counter;
+	// Variables
+	int attached_state_counter = 0;
+	int y_index;
 
 	// Code
-
-	// Adjust the rates file
-	if (cb_dump_file_defined == false)
-	{
-		// First time through, set the class member value
-		path base_dir;
-
-		if (p_cmv_options->cb_dump_relative_to == "this_file")
-		{
-			options_file_path = path(p_cmv_options->options_file_string);
-			base_dir = options_file_path.parent_path();
-		}
-		else
-		{
-			base_dir = path(p_cmv_options->rates_dump_relative_to);
-		}
-
-		output_file_path = base_dir / p_cmv_options->cb_dump_file_string;
-		cb_dump_file_string = output_file_path.string();
-	}
-	
-	// Make sure directory exists
-	output_file_path = absolute(path(cb_dump_file_string));
-
-	if (!(is_directory(output_file_path.parent_path())))
-	{
-		if (create_directories(output_file_path.parent_path()))
-		{
-			std::cout << "\nCreating folder: " << output_file_path.string() << "\n";
-		}
-		else
-		{
-			std::cout << "\nError: Folder for cb dump file could not be created: " <<
-				output_file_path.parent_path().string() << "\n";
-			exit(1);
-		}
-	}
-
-	if (cb_dump_file_defined == false)
-		open_mode = "w";
-	else
-		open_mode = "a";
-
-	// Check file can be opened, abort if not
-	errno_t err = fopen_s(&output_file, cb_dump_file_string.c_str(), open_mode.c_str());
-
-	if (err != 0)
-	{
-		printf("dump_cb_distributions_to_file(): %s\ncould not be opened\n",
-			cb_dump_file_string.c_str());
-		exit(1);
-	}
-	else
-	{
-		if (cb_dump_file_defined == false)
-			cout << "Writing cb distributions to: " << cb_dump_file_string << "\n";
-	}
-
-	if (cb_dump_file_defined == false)
-	{
-		// Write the header
-		attached_state_counter = 0;
-		for (int state_counter = 0; state_counter < p_m_scheme->no_of_states; state_counter++)
-		{
-			if (p_m_scheme->p_m_states[state_counter]->state_type == 'A')
-			{
-				attached_state_counter = attached_state_counter + 1;
-
-				for (int ind = 0; ind < no_of_bin_positions; ind++)
-				{
-					fprintf(output_file, "M%i_%.0f", attached_state_counter, 10 * gsl_vector_get(x, ind));
-					if ((ind == (no_of_bin_positions - 1)) &&
-						(attached_state_counter == p_m_scheme->no_of_attached_states))
-					{
-						fprintf(output_file, "\n");
-					}
-					else
-					{
-						fprintf(output_file, "\t");
-					}
-				}
-			}
-		}
-	}
-
-	// Now write data
-	// Write the header
-	attached_state_counter = 0;
 	for (int state_counter = 0; state_counter < p_m_scheme->no_of_states; state_counter++)
 	{
 		if (p_m_scheme->p_m_states[state_counter]->state_type == 'A')
 		{
-			attached_state_counter = attached_state_counter + 1;
+			y_index = gsl_matrix_int_get(m_y_indices, state_counter, 0);
 
 			for (int ind = 0; ind < no_of_bin_positions; ind++)
 			{
-				fprintf(output_file, "%.5f", gsl_vector_get(y,
-					(gsl_matrix_int_get(m_y_indices, state_counter, 0) + ind)));
-
-				if ((ind == (no_of_bin_positions - 1)) &&
-					(attached_state_counter == p_m_scheme->no_of_attached_states))
-				{
-					fprintf(output_file, "\n");
-				}
-				else
-				{
-					fprintf(output_file, "\t");
-				}
+				p_values[(attached_state_counter * no_of_bin_positions) + ind] =
+					(float)gsl_vector_get(y, y_index + ind);
 			}
+
+			attached_state_counter = attached_state_counter + 1;
 		}
 	}
-
-	// Tidy up
-	fclose(output_file);
-
-	// Update
-	cb_dump_file_defined = true;
 }
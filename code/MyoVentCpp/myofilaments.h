@@ -11,6 +11,8 @@
 
 #include "gsl_vector.h"
 #include "gsl_matrix.h"
+#include "gsl_odeiv2.h"
+#include "gsl_spline.h"
 
 #include "global_definitions.h"
 
@@ -101,7 +103,42 @@ public:
 													distributions are evaluated
 													at */
 
-	gsl_vector* x;							/**< gsl_vector with bin positions */
+	gsl_vector* x;							/**< gsl_vector with bin positions,
+													the centre of each bin */
+
+	bool myof_uniform_grid;					/**< bool, true if every bin has
+													the same width */
+
+	double* bin_w;							/**< aligned array of doubles holding
+													the width of each bin */
+
+	double* bin_edges;						/**< array of doubles, length
+													no_of_bin_positions + 1, holding
+													the edges of the bins */
+
+	double myof_active_bin_threshold;		/**< double with the population below
+													which bins leave the active
+													windows, 0 if the windows
+													always span the grid */
+
+	int bin_window_start[MAX_NO_OF_KINETIC_STATES];
+											/**< array of ints with the first
+													active bin for each attached
+													state, in the order of the
+													kinetic scheme's attached
+													ranges */
+
+	int bin_window_stop[MAX_NO_OF_KINETIC_STATES];
+											/**< array of ints with the last
+													active bin for each attached
+													state, start - 1 when the
+													window is empty */
+
+	long long myof_active_bin_count;		/**< counter for active bins summed
+													over states and time-steps */
+
+	long long myof_window_updates;			/**< counter for calls to
+													update_bin_windows */
 
 	size_t y_length;						/**< integer with the length of the
 													system */
@@ -163,12 +200,100 @@ public:
 	double max_shift;
 	int n_max_sub_steps;
 
+	gsl_odeiv2_system myof_ode_system;		/**< gsl_odeiv2_system wrapping
+													myof_calculate_derivs and
+													myof_calculate_jacobian */
+
+	gsl_odeiv2_driver* p_myof_ode_driver;	/**< pointer to a gsl_odeiv2_driver
+													created once in
+													initialise_simulation and
+													reset every time-step */
+
+	gsl_odeiv2_driver* p_myof_implicit_ode_driver;
+											/**< pointer to the bsimp driver
+													used when the stepper is
+													auto, NULL otherwise */
+
+	bool myof_ode_auto;						/**< bool, true if the stepper
+													switches between the explicit
+													and implicit drivers */
+
+	int myof_ode_implicit_steps_left;		/**< integer with the number of
+													time-steps the auto stepper
+													stays on the implicit driver */
+
+	bool myof_ode_exponential;				/**< bool, true if the populations are
+													advanced with the operator-split
+													exponential propagator instead
+													of a GSL driver */
+
+	int exp_no_of_detached_states;			/**< integer with the number of
+													detached states, the size of
+													the detached block */
+
+	int exp_detached_y_index[MAX_NO_OF_KINETIC_STATES];
+											/**< array of ints with the index
+													in y of each detached state */
+
+	int exp_from_slot[MAX_NO_OF_KINETIC_STATES * MAX_NO_OF_TRANSITIONS];
+											/**< array of ints with the position
+													of the from state of each
+													compiled transition in its
+													attached or detached block */
+
+	int exp_to_slot[MAX_NO_OF_KINETIC_STATES * MAX_NO_OF_TRANSITIONS];
+											/**< array of ints with the position
+													of the to state of each
+													compiled transition */
+
+	double* exp_y_start;					/**< aligned array of doubles, length
+													y_length, holding y_calc at the
+													start of the exponential step */
+
+	double* exp_bin_propagators;			/**< aligned array of doubles holding
+													the propagator for each bin
+													block, row-major */
+
+	int exp_bin_start;						/**< integer with the first bin that
+													is active in any attached state */
+
+	int exp_bin_stop;						/**< integer with the last bin that
+													is active in any attached state */
+
+	long long myof_n_rhs_evaluations;		/**< counter for calls to
+													myof_calculate_derivs */
+
+	long long myof_n_jacobian_evaluations;	/**< counter for calls to
+													myof_calculate_jacobian */
+
+	bool myof_report_counters;				/**< true if the counters are
+													printed by the destructor */
+
+	double* y_calc;							/**< aligned array of doubles, length
+													y_length, used as the working
+													copy of y during a time-step */
+
+	double* bin_x;							/**< aligned array of doubles holding
+													the bin positions, used by the
+													bin kernels and
+													move_cb_populations */
+
+	double* move_y;							/**< array of doubles holding the
+													distribution being moved */
+
+	double* move_y_temp;					/**< array of doubles holding the
+													interpolated distribution */
+
+	gsl_interp_accel* p_move_acc;			/**< pointer to interpolation
+													accelerator used by
+													move_cb_populations */
+
+	gsl_spline* p_move_spline;				/**< pointer to spline used by
+													move_cb_populations */
+
 	double myof_mean_stress_int_pas;	/**< double holding the mean pas int
 												stress over a cardiac cycle */
 
-	string cb_dump_file_string;			/**< string hold cb dump file */
-	bool cb_dump_file_defined;
-
 	// Functions
 
 	void prepare_for_cmv_results(void);
@@ -179,11 +304,35 @@ public:
 
 	void implement_time_step(double time_step_s);
 
+	void prepare_time_step(void);
+
+	void finish_time_step(void);
+
+	void build_bin_grid(void);
+
+	void update_bin_windows(void);
+
 	void calculate_f_overlap(void);
 
-	void calculate_m_state_pops(const double y[]);
+	void initialise_exponential_propagator(void);
+
+	void implement_exponential_step(double time_step_s);
+
+	void exponential_detached_step(double dt, double free_sites);
+
+	void update_exponential_propagators(double dt);
+
+	void exponential_attached_step(void);
+
+	double return_free_binding_sites(const double y[]);
+
+	void exponential_actin_step(double dt);
+
+	double return_actin_flux(double a_on, double m_bound);
+
+	void calculate_m_state_summaries(const double y[]);
 
-	void calculate_m_state_stresses(void);
+	double return_m_bound(const double y[]);
 
 	void calculate_stresses(bool check_only = false);
 
@@ -197,5 +346,5 @@ public:
 
 	void move_cb_populations(double delta_hsl);
 
-	void dump_cb_distributions(void);
+	void copy_cb_distributions(float* p_values);
 };
@@ -56,6 +56,20 @@ perturbation::perturbation(cmv_protocol* set_p_cmv_protocol, perturbation_struct
 
 	increment = total_change / n_steps;
 
+	// Extract any indices embedded in the variable name now, rather than
+	// running a regex every time-step
+	for (int i = 0; i < 3; i++)
+		variable_digits[i] = 0;
+
+	extract_digits(variable, variable_digits, 3);
+
+	// Circulation variables can have numbers larger than 9
+	size_t number_start = variable.find_last_not_of("0123456789") + 1;
+
+	variable_number = 0;
+	if (number_start < variable.length())
+		variable_number = atoi(variable.substr(number_start).c_str());
+
 	cout << "n_steps: " << n_steps << " total_change: " << total_change << " increment " << increment << "\n";
 }
 
@@ -98,16 +112,9 @@ void perturbation::impose(double sim_time_s)
 			if (variable.rfind("resistance", 0) == 0)
 			{
 				// Starts with resistance
-				int no_of_digits = 1;
-				int digits[1];
 				int compartment_index;
 
-				for (int i = 0; i < no_of_digits; i++)
-					digits[i] = 0;
-
-				extract_digits(variable, digits, 1);
-
-				compartment_index = digits[0] - 1;
+				compartment_index = variable_number - 1;
 
 				p_double = &(p_cmv_protocol->p_cmv_system->p_circulation->circ_resistance[compartment_index]);
 
@@ -116,17 +123,10 @@ void perturbation::impose(double sim_time_s)
 
 			if (variable.rfind("compliance", 0) == 0)
 			{
-				// Starts with resistance
-				int no_of_digits = 1;
-				int digits[1];
+				// Starts with compliance
 				int compartment_index;
 
-				for (int i = 0; i < no_of_digits; i++)
-					digits[i] = 0;
-
-				extract_digits(variable, digits, 1);
-
-				compartment_index = digits[0] - 1;
+				compartment_index = variable_number - 1;
 
 				p_double = &(p_cmv_protocol->p_cmv_system->p_circulation->circ_compliance[compartment_index]);
 
@@ -280,20 +280,13 @@ void perturbation::impose(double sim_time_s)
 			if (variable.rfind("m_state", 0) == 0)
 			{
 				// Starts with m_state
-				int no_of_digits = 3;
-				int digits[3];
 				int state_index;
 				int transition_index;
 				int parameter_index;
 
-				for (int i = 0; i < no_of_digits; i++)
-					digits[i] = 0;
-
-				extract_digits(variable, digits, 3);
-
-				state_index = digits[0] - 1;
-				transition_index = digits[1] - 1;
-				parameter_index = digits[2] - 1;
+				state_index = variable_digits[0] - 1;
+				transition_index = variable_digits[1] - 1;
+				parameter_index = variable_digits[2] - 1;
 
 				// This is tricky because the variable is stored in a gsl_vector
 				gsl_vector* p_gsl_v = p_cmv_protocol->p_cmv_system->p_circulation->p_hemi_vent->
@@ -301,6 +294,11 @@ void perturbation::impose(double sim_time_s)
 				
 				gsl_vector_set(p_gsl_v, parameter_index,
 					gsl_vector_get(p_gsl_v, parameter_index) + increment);
+
+				// The cached rates for this transition are now out of date
+				p_cmv_protocol->p_cmv_system->p_circulation->p_hemi_vent->
+					p_hs->p_myofilaments->p_m_scheme->invalidate_rate_table(state_index,
+						transition_index);
 			}
 
 			if (variable == "a_k_on")
@@ -353,7 +351,7 @@ void perturbation::extract_digits(string test_string, int digits[], int no_of_di
 	auto digits_end = sregex_iterator();
 
 	counter = 0;
-	for (regex_iterator i = digits_begin; i != digits_end; i++)
+	for (regex_iterator i = digits_begin; (i != digits_end) && (counter < no_of_digits); i++)
 	{
 		smatch match = *i;
 		digits[counter] = atoi((match.str().c_str()));
@@ -51,6 +51,16 @@ public:
 
 	 double increment;						/**< change per time-step */
 
+	 int variable_digits[3];				/**< integers holding the digits in
+													variable, e.g. state, transition
+													and parameter for m_state
+													perturbations, extracted once
+													in the constructor */
+
+	 int variable_number;					/**< the number at the end of
+													variable, e.g. the edge for
+													resistance_12, or 0 */
+
 	 // Functions
 
 	 int return_status(string test_type, double t_test_s);
@@ -0,0 +1,279 @@
+/**
+/* @file		phase_average.cpp
+/* @brief		Source file for a phase_average object
+/* @author		Ken Campbell
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <iostream>
+
+#include "phase_average.h"
+#include "cmv_system.h"
+#include "cmv_options.h"
+#include "cmv_protocol.h"
+#include "cmv_results.h"
+#include "results_writer.h"
+
+#include "gsl_math.h"
+
+using namespace std;
+
+// Constructor
+phase_average::phase_average(cmv_system* set_p_parent_cmv_system, string set_file_string)
+{
+	//! Constructor
+	//! Each beat is split into no_of_bins equal bins of phase, from 0 at
+	//! the start of the beat to 1 at the end, and the rows in each bin
+	//! are averaged. Once a window of no_of_beats beats is complete, and
+	//! then every step_beats beats, a row is written for each bin with
+	//!		window_end_s, the time of the last row in the window
+	//!		phase, the middle of the bin
+	//!		phase_time_s, the phase times the mean length of the beats
+	//!		for each field the summary writes, other than the time, the
+	//!			new_beat marker and the simulation index, the mean over
+	//!			the beats of the bin averages and their standard
+	//!			deviation as <field>_sd
+
+	// Variables
+	cmv_options* p_cmv_options;
+	cmv_results* p_summary;
+	cmv_results* p_beat;
+
+	int f;
+
+	long long max_no_of_windows;
+
+	// Code
+	p_parent_cmv_system = set_p_parent_cmv_system;
+
+	p_cmv_options = p_parent_cmv_system->p_cmv_options;
+	p_summary = p_parent_cmv_system->p_cmv_results_summary;
+	p_beat = p_parent_cmv_system->p_cmv_results_beat;
+
+	pa_no_of_beats = p_cmv_options->results_phase_average_beats;
+	pa_step_beats = p_cmv_options->results_phase_average_step_beats;
+	pa_no_of_bins = p_cmv_options->results_phase_average_bins;
+
+	pa_beats_added = 0;
+	pa_no_of_windows = 0;
+
+	// The fields written, which the results_writer takes its layout from
+	p_cmv_results_phase_average = new cmv_results(p_parent_cmv_system, 0);
+
+	p_cmv_results_phase_average->time_field_index =
+		p_cmv_results_phase_average->add_results_field("window_end_s", NULL, "s");
+	p_cmv_results_phase_average->add_results_field("phase", NULL);
+	p_cmv_results_phase_average->add_results_field("phase_time_s", NULL, "s");
+
+	pa_no_of_fields = 0;
+
+	for (int k = 0; k < p_summary->no_of_output_fields; k++)
+	{
+		f = p_summary->output_field_indices[k];
+
+		if ((f == p_summary->time_field_index) || (f == p_summary->new_beat_field_index) ||
+			(f == p_summary->t_index_field_index))
+		{
+			continue;
+		}
+
+		if ((p_cmv_results_phase_average->no_of_defined_results_fields + 2) > MAX_NO_OF_RESULT_FIELDS)
+		{
+			cout << "Error: too many fields for the phase average, MAX_NO_OF_RESULT_FIELDS is " <<
+				MAX_NO_OF_RESULT_FIELDS << "\n";
+			exit(1);
+		}
+
+		p_cmv_results_phase_average->add_results_field(p_summary->results_fields[f], NULL,
+			p_summary->results_units[f]);
+		p_cmv_results_phase_average->add_results_field(p_summary->results_fields[f] + "_sd", NULL,
+			p_summary->results_units[f]);
+
+		// The summary fields are the ones the beat writes, in order
+		pa_beat_indices[pa_no_of_fields] = p_beat->output_field_indices[k];
+		pa_no_of_fields = pa_no_of_fields + 1;
+	}
+
+	// All of the storage is allocated here, so the beats do not
+	// allocate in the simulation loop
+	pa_bin_sums = (double*)malloc((size_t)pa_no_of_bins * GSL_MAX(pa_no_of_fields, 1) *
+		sizeof(double));
+	pa_bin_counts = (int*)malloc(pa_no_of_bins * sizeof(int));
+	pa_beat_means = (double*)malloc((size_t)pa_no_of_beats * pa_no_of_bins *
+		GSL_MAX(pa_no_of_fields, 1) * sizeof(double));
+	pa_beat_lengths_s = (double*)malloc(pa_no_of_beats * sizeof(double));
+
+	// The number of windows is not known, but there is at most one beat
+	// per time-step, so the binary index is sized for that and never
+	// grows
+	max_no_of_windows = (p_parent_cmv_system->p_cmv_protocol->no_of_time_steps / pa_step_beats) + 1;
+
+	p_writer = new results_writer(p_cmv_results_phase_average, set_file_string,
+		p_cmv_options->results_output_format, 0.0,
+		p_cmv_options->results_stream_buffer_points, max_no_of_windows * pa_no_of_bins);
+
+	cout << "Phase averages of " << pa_no_of_fields << " fields over " << pa_no_of_beats <<
+		" beats in " << pa_no_of_bins << " bins\n";
+}
+
+// Destructor
+phase_average::~phase_average(void)
+{
+	//! Destructor
+
+	// Code
+	cout << "Phase average: " << pa_no_of_windows << " window(s) from " << pa_beats_added <<
+		" beats\n";
+
+	delete p_writer;
+	delete p_cmv_results_phase_average;
+
+	free(pa_bin_sums);
+	free(pa_bin_counts);
+	free(pa_beat_means);
+	free(pa_beat_lengths_s);
+}
+
+// Functions
+
+void phase_average::add_beat(cmv_results* p_beat, int no_of_rows)
+{
+	//! Function averages the first no_of_rows rows of p_beat in each bin
+	//! and stores the averages in the ring. A bin with no rows, which
+	//! only happens if the beat has fewer rows than there are bins,
+	//! takes the row nearest its middle
+
+	// Variables
+	int slot;
+	int bin;
+	int row;
+
+	double* p_row;
+	double* p_means;
+
+	// Code
+	if (no_of_rows < 1)
+		return;
+
+	for (int i = 0; i < (pa_no_of_bins * pa_no_of_fields); i++)
+		pa_bin_sums[i] = 0.0;
+
+	for (int b = 0; b < pa_no_of_bins; b++)
+		pa_bin_counts[b] = 0;
+
+	for (int r = 0; r < no_of_rows; r++)
+	{
+		p_row = p_beat->return_row(r);
+		bin = (int)(((long long)r * pa_no_of_bins) / no_of_rows);
+
+		for (int f = 0; f < pa_no_of_fields; f++)
+			pa_bin_sums[(bin * pa_no_of_fields) + f] += p_row[pa_beat_indices[f]];
+
+		pa_bin_counts[bin] = pa_bin_counts[bin] + 1;
+	}
+
+	slot = (int)(pa_beats_added % pa_no_of_beats);
+	p_means = &pa_beat_means[(size_t)slot * pa_no_of_bins * pa_no_of_fields];
+
+	for (int b = 0; b < pa_no_of_bins; b++)
+	{
+		if (pa_bin_counts[b] > 0)
+		{
+			for (int f = 0; f < pa_no_of_fields; f++)
+			{
+				p_means[(b * pa_no_of_fields) + f] =
+					pa_bin_sums[(b * pa_no_of_fields) + f] / pa_bin_counts[b];
+			}
+		}
+		else
+		{
+			row = (int)((((2LL * b) + 1) * no_of_rows) / (2LL * pa_no_of_bins));
+			p_row = p_beat->return_row(row);
+
+			for (int f = 0; f < pa_no_of_fields; f++)
+				p_means[(b * pa_no_of_fields) + f] = p_row[pa_beat_indices[f]];
+		}
+	}
+
+	pa_beat_lengths_s[slot] = no_of_rows * p_parent_cmv_system->p_cmv_protocol->time_step_s;
+
+	pa_beats_added = pa_beats_added + 1;
+
+	// The first window ends once the ring is full, then one ends every
+	// step_beats beats
+	if ((pa_beats_added >= pa_no_of_beats) &&
+		(((pa_beats_added - pa_no_of_beats) % pa_step_beats) == 0))
+	{
+		write_window(p_beat->return_row(no_of_rows - 1)[p_beat->time_field_index]);
+	}
+}
+
+void phase_average::write_window(double window_end_s)
+{
+	//! Function writes a row for each bin with the mean and the sample
+	//! standard deviation over the beats in the ring
+	//! The sums are taken from the ring each time, rather than kept as
+	//! running totals, so rounding does not build up over a long run
+
+	// Variables
+	double mean_length_s = 0.0;
+	double mean;
+	double sum_squares;
+	double d;
+	double phase;
+
+	double* p_row;
+
+	size_t beat_stride = (size_t)pa_no_of_bins * pa_no_of_fields;
+
+	// Code
+	for (int j = 0; j < pa_no_of_beats; j++)
+		mean_length_s = mean_length_s + pa_beat_lengths_s[j];
+
+	mean_length_s = mean_length_s / pa_no_of_beats;
+
+	for (int b = 0; b < pa_no_of_bins; b++)
+	{
+		phase = (b + 0.5) / pa_no_of_bins;
+
+		p_row = p_writer->reserve_row();
+
+		p_row[0] = window_end_s;
+		p_row[1] = phase;
+		p_row[2] = phase * mean_length_s;
+
+		for (int f = 0; f < pa_no_of_fields; f++)
+		{
+			mean = 0.0;
+			for (int j = 0; j < pa_no_of_beats; j++)
+				mean = mean + pa_beat_means[(j * beat_stride) + (b * pa_no_of_fields) + f];
+
+			mean = mean / pa_no_of_beats;
+
+			sum_squares = 0.0;
+			for (int j = 0; j < pa_no_of_beats; j++)
+			{
+				d = pa_beat_means[(j * beat_stride) + (b * pa_no_of_fields) + f] - mean;
+				sum_squares = sum_squares + (d * d);
+			}
+
+			p_row[3 + (2 * f)] = mean;
+			p_row[4 + (2 * f)] = (pa_no_of_beats > 1) ?
+				sqrt(sum_squares / (pa_no_of_beats - 1)) : 0.0;
+		}
+
+		p_writer->commit_row();
+	}
+
+	pa_no_of_windows = pa_no_of_windows + 1;
+}
+
+void phase_average::finish(void)
+{
+	//! Function waits for the writer to complete the file
+
+	// Code
+	p_writer->finish();
+}
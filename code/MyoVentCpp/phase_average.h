@@ -0,0 +1,93 @@
+#pragma once
+
+/**
+/* @file		phase_average.h
+/* @brief		Header file for a phase_average object
+/* @author		Ken Campbell
+*/
+
+#include "stdio.h"
+#include <iostream>
+#include <string>
+
+#include "global_definitions.h"
+
+using namespace std;
+
+class cmv_system;
+class cmv_results;
+class results_writer;
+
+class phase_average
+{
+public:
+	/**
+	 * Constructor
+	 * Sets up the averages of the fields the summary writes, and opens
+	 * the results_writer for them
+	 */
+	phase_average(cmv_system* set_p_parent_cmv_system, string set_file_string);
+
+	/**
+	* Destructor
+	*/
+	~phase_average(void);
+
+	// Variables
+	cmv_system* p_parent_cmv_system;		/**< pointer to the parent cmv_system */
+
+	cmv_results* p_cmv_results_phase_average;
+											/**< pointer to the cmv_results object
+													defining the fields that are
+													written */
+
+	results_writer* p_writer;				/**< pointer to the results_writer
+													for the averages */
+
+	int pa_no_of_beats;						/**< integer with the number of
+													beats in a window */
+
+	int pa_step_beats;						/**< integer with the number of
+													beats between windows */
+
+	int pa_no_of_bins;						/**< integer with the number of
+													phase bins in a beat */
+
+	int pa_no_of_fields;					/**< integer with the number of
+													fields that are averaged */
+
+	int pa_beat_indices[MAX_NO_OF_RESULT_FIELDS];
+											/**< array of integers with the index
+													in a row of the beat of each
+													field that is averaged */
+
+	double* pa_bin_sums;					/**< pointer to the sum of each field
+													in each bin of the beat */
+
+	int* pa_bin_counts;						/**< pointer to the number of rows in
+													each bin of the beat */
+
+	double* pa_beat_means;					/**< pointer to the mean of each field
+													in each bin for the beats in
+													the window, used as a ring */
+
+	double* pa_beat_lengths_s;				/**< pointer to the length of each
+													beat in the window */
+
+	long long pa_beats_added;				/**< number of beats added */
+
+	long long pa_no_of_windows;				/**< number of windows written */
+
+	// Functions
+
+	void add_beat(cmv_results* p_beat, int no_of_rows);
+											/**< function bins the rows of a
+													beat by phase, and writes a
+													window if one is due */
+
+	void write_window(double window_end_s);	/**< function writes the mean and
+													standard deviation of each
+													bin over the window */
+
+	void finish(void);						/**< function completes the file */
+};
@@ -68,6 +68,10 @@ reflex_control::reflex_control(baroreflex* set_p_parent_baroreflex, int set_rc_n
 	rc_k_recov = p_struct->k_recov;
 	rc_para_factor = p_struct->para_factor;
 	rc_symp_factor = p_struct->symp_factor;
+
+	// Set when the controlled variable is assigned
+	rc_m_state_index = -1;
+	rc_m_transition_index = -1;
 }
 
 // Destructor
@@ -100,6 +104,10 @@ void reflex_control::initialise_simulation(void)
 
 	temp_string = "rc_" + rc_level + "_" + rc_variable;
 	p_cmv_results_beat->add_results_field(temp_string, p_controlled_variable);
+
+	// The value at the end of each beat
+	p_parent_cmv_system->p_cmv_results_beat_metrics->add_results_field(temp_string,
+		p_controlled_variable);
 }
 
 void reflex_control::implement_time_step(double time_step_s)
@@ -113,10 +121,26 @@ void reflex_control::implement_time_step(double time_step_s)
 	// Calculate the baro_C signal, and then the output via the mapping function
 	calculate_baro_C(time_step_s);
 
+	update_controlled_variable();
+}
+
+void reflex_control::update_controlled_variable(void)
+{
+	//! Sets the controlled variable from the current baro_C signal
+	
+	// Code
+
 	calculate_output();
 
 	// Now update controlled value
 	*p_controlled_variable = rc_output;
+
+	// Rate parameters are cached by the kinetic scheme
+	if (rc_m_state_index >= 0)
+	{
+		p_parent_circulation->p_hemi_vent->p_hs->p_myofilaments->p_m_scheme->
+			invalidate_rate_table(rc_m_state_index, rc_m_transition_index);
+	}
 }
 
 void reflex_control::calculate_baro_C(double time_step_s)
@@ -126,34 +150,44 @@ void reflex_control::calculate_baro_C(double time_step_s)
 	// Variables
 	double delta;
 
-	double baro_active = p_parent_baroreflex->baro_active;
-	double baro_B = p_parent_baroreflex->baro_B;
-
 	// Code
 
 	// Caculate the derivitive
-	if (baro_active > 0.0)
+	delta = return_baro_C_rate(p_parent_baroreflex->baro_B, rc_baro_C);
+
+	// Update over the time-step
+	rc_baro_C = rc_baro_C + (delta * time_step_s);
+
+	// Limit
+	rc_baro_C = GSL_MIN(rc_baro_C, 1.0);
+	rc_baro_C = GSL_MAX(rc_baro_C, 0.0);
+}
+
+double reflex_control::return_baro_C_rate(double baro_B, double C)
+{
+	//! Function returns dC/dt for a given B signal and C
+	
+	// Variables
+	double delta;
+
+	// Code
+	if (p_parent_baroreflex->baro_active > 0.0)
 	{
 		if (baro_B > 0.5)
 		{
-			delta = rc_k_control * (baro_B - 0.5) * (1.0 - rc_baro_C);
+			delta = rc_k_control * (baro_B - 0.5) * (1.0 - C);
 		}
 		else
 		{
-			delta = rc_k_control * (baro_B - 0.5) * rc_baro_C;
+			delta = rc_k_control * (baro_B - 0.5) * C;
 		}
 	}
 	else
 	{
-		delta = -rc_k_control * (rc_baro_C - 0.5);
+		delta = -rc_k_control * (C - 0.5);
 	}
 
-	// Update over the time-step
-	rc_baro_C = rc_baro_C + (delta * time_step_s);
-
-	// Limit
-	rc_baro_C = GSL_MIN(rc_baro_C, 1.0);
-	rc_baro_C = GSL_MAX(rc_baro_C, 0.0);
+	return delta;
 }
 
 void reflex_control::extract_digits(string test_string, int digits[], int no_of_digits)
@@ -242,6 +276,10 @@ void reflex_control::set_controlled_variable(void)
 			gsl_vector* p_gsl_v = p_parent_circulation->p_hemi_vent->p_hs->p_myofilaments->p_m_scheme->p_m_states[state_index]->p_transitions[transition_index]->rate_parameters;
 			p_controlled_variable = p_gsl_v->data + (parameter_index) * sizeof(p_gsl_v->stride);
 
+			// Note the transition so that the cached rates can be updated
+			rc_m_state_index = state_index;
+			rc_m_transition_index = transition_index;
+
 			reflex_assigned = true;
 		}
 	}
@@ -250,16 +288,11 @@ void reflex_control::set_controlled_variable(void)
 	{
 		if (rc_variable.rfind("resistance", 0) == 0)
 		{
-			int no_of_digits = 1;
-			int digits[1];
+			// The number can be larger than 9 for a graph circulation
 			int compartment_index;
 
-			for (int i = 0; i < no_of_digits; i++)
-				digits[i] = 0;
-
-			extract_digits(rc_variable, digits, 1);
-
-			compartment_index = digits[0] - 1;
+			compartment_index = atoi(rc_variable.substr(
+				rc_variable.find_last_not_of("0123456789") + 1).c_str()) - 1;
 
 			p_controlled_variable = &p_parent_circulation->circ_resistance[compartment_index];
 
@@ -268,16 +301,11 @@ void reflex_control::set_controlled_variable(void)
 
 		if (rc_variable.rfind("compliance", 0) == 0)
 		{
-			int no_of_digits = 1;
-			int digits[1];
+			// The number can be larger than 9 for a graph circulation
 			int compartment_index;
 
-			for (int i = 0; i < no_of_digits; i++)
-				digits[i] = 0;
-
-			extract_digits(rc_variable, digits, 1);
-
-			compartment_index = digits[0] - 1;
+			compartment_index = atoi(rc_variable.substr(
+				rc_variable.find_last_not_of("0123456789") + 1).c_str()) - 1;
 
 			p_controlled_variable = &p_parent_circulation->circ_compliance[compartment_index];
 
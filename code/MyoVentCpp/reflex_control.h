@@ -89,6 +89,14 @@ public:
 	double* p_controlled_variable;			/**< double to the variable managed
 													by the reflex control */
 
+	int rc_m_state_index;					/**< int with the index of the m_state
+													whose rate parameter is controlled,
+													-1 if the control is not a
+													rate parameter */
+
+	int rc_m_transition_index;				/**< int with the index of the controlled
+													transition, -1 as above */
+
 	// Other functions
 	void initialise_simulation(void);
 
@@ -100,5 +108,9 @@ public:
 
 	void calculate_baro_C(double time_step_s);
 
+	double return_baro_C_rate(double baro_B, double C);
+
+	void update_controlled_variable(void);
+
 	void calculate_output(void);
 };
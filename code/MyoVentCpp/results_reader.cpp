@@ -0,0 +1,404 @@
+/**
+/* @file		results_reader.cpp
+/* @brief		Source file for a results_reader object
+/* @author		Ken Campbell
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <string>
+
+#include "results_reader.h"
+#include "time_series_codec.h"
+
+#include "gsl_matrix.h"
+#include "gsl_math.h"
+
+using namespace std;
+
+// The file is little-endian whatever the machine, so values are
+// assembled a byte at a time
+static unsigned long long get_little_endian(const unsigned char* p_bytes, int no_of_bytes)
+{
+	unsigned long long value = 0;
+
+	for (int i = no_of_bytes - 1; i >= 0; i--)
+	{
+		value = (value << 8) | p_bytes[i];
+	}
+
+	return value;
+}
+
+static double get_little_endian_double(const unsigned char* p_bytes)
+{
+	unsigned long long bits = get_little_endian(p_bytes, 8);
+	double value;
+
+	memcpy(&value, &bits, sizeof(double));
+	return value;
+}
+
+static double get_little_endian_float(const unsigned char* p_bytes)
+{
+	unsigned int bits = (unsigned int)get_little_endian(p_bytes, 4);
+	float value;
+
+	memcpy(&value, &bits, sizeof(float));
+	return (double)value;
+}
+
+// Constructor
+results_reader::results_reader(string set_file_string)
+{
+	//! Constructor
+
+	// Variables
+	unsigned char header[RESULTS_BINARY_HEADER_BYTES];
+	unsigned char entry[RESULTS_BINARY_INDEX_ENTRY_BYTES];
+	unsigned char length_bytes[4];
+
+	char* p_string;
+	int string_length;
+
+	long long index_offset;
+
+	// Code
+	file_string = set_file_string;
+
+	errno_t err = fopen_s(&p_file, file_string.c_str(), "rb");
+	if (err != 0)
+	{
+		cout << "Results file: " << file_string << " could not be opened\n";
+		exit(1);
+	}
+
+	// Header, which is shorter in version 1 files
+	if ((fread(header, 1, RESULTS_BINARY_V1_HEADER_BYTES, p_file) != RESULTS_BINARY_V1_HEADER_BYTES) ||
+		(memcmp(header, RESULTS_BINARY_MAGIC, 8) != 0))
+	{
+		cout << "Error: " << file_string << " is not a binary results file\n";
+		exit(1);
+	}
+
+	codec = RESULTS_CODEC_NONE;
+
+	if ((int)get_little_endian(&header[8], 4) == RESULTS_BINARY_VERSION)
+	{
+		if (fread(&header[RESULTS_BINARY_V1_HEADER_BYTES], 1,
+			RESULTS_BINARY_HEADER_BYTES - RESULTS_BINARY_V1_HEADER_BYTES, p_file) !=
+			(RESULTS_BINARY_HEADER_BYTES - RESULTS_BINARY_V1_HEADER_BYTES))
+		{
+			cout << "Error: " << file_string << " has a truncated header\n";
+			exit(1);
+		}
+
+		codec = (int)get_little_endian(&header[64], 4);
+	}
+	else if ((int)get_little_endian(&header[8], 4) != 1)
+	{
+		cout << "Error: " << file_string << " has binary results version " <<
+			get_little_endian(&header[8], 4) << ", expected 1 to " << RESULTS_BINARY_VERSION << "\n";
+		exit(1);
+	}
+
+	value_bytes = (int)get_little_endian(&header[12], 4);
+	no_of_fields = (int)get_little_endian(&header[16], 4);
+	chunk_time_points = (int)get_little_endian(&header[20], 4);
+	no_of_time_points = (int)get_little_endian(&header[24], 8);
+	no_of_chunks = (int)get_little_endian(&header[32], 4);
+	system_id = (int)get_little_endian(&header[36], 4);
+	time_step_s = get_little_endian_double(&header[40]);
+	sim_time_step_s = get_little_endian_double(&header[48]);
+	index_offset = (long long)get_little_endian(&header[56], 8);
+
+	if (((value_bytes != 4) && (value_bytes != 8)) ||
+		(no_of_fields > MAX_NO_OF_RESULT_FIELDS) ||
+		((codec != RESULTS_CODEC_NONE) && (codec != RESULTS_CODEC_LOSSLESS)))
+	{
+		cout << "Error: " << file_string << " has an invalid header\n";
+		exit(1);
+	}
+
+	// Field names and units
+	time_field_index = -1;
+
+	for (int i = 0; i < no_of_fields; i++)
+	{
+		for (int j = 0; j < 2; j++)
+		{
+			fread(length_bytes, 1, 4, p_file);
+			string_length = (int)get_little_endian(length_bytes, 4);
+
+			p_string = (char*)malloc(string_length + 1);
+			fread(p_string, 1, string_length, p_file);
+			p_string[string_length] = '\0';
+
+			if (j == 0)
+				field_names[i] = p_string;
+			else
+				field_units[i] = p_string;
+
+			free(p_string);
+		}
+
+		if (field_names[i] == "time")
+			time_field_index = i;
+	}
+
+	// Chunk index
+	chunk_first_point = (long long*)malloc(no_of_chunks * sizeof(long long));
+	chunk_no_of_points = (long long*)malloc(no_of_chunks * sizeof(long long));
+	chunk_t_first = (double*)malloc(no_of_chunks * sizeof(double));
+	chunk_t_last = (double*)malloc(no_of_chunks * sizeof(double));
+	chunk_offset = (long long*)malloc(no_of_chunks * sizeof(long long));
+
+	_fseeki64(p_file, index_offset, SEEK_SET);
+
+	for (int c = 0; c < no_of_chunks; c++)
+	{
+		if (fread(entry, 1, RESULTS_BINARY_INDEX_ENTRY_BYTES, p_file) != RESULTS_BINARY_INDEX_ENTRY_BYTES)
+		{
+			cout << "Error: " << file_string << " has a truncated chunk index\n";
+			exit(1);
+		}
+
+		chunk_first_point[c] = (long long)get_little_endian(&entry[0], 8);
+		chunk_no_of_points[c] = (long long)get_little_endian(&entry[8], 8);
+		chunk_t_first[c] = get_little_endian_double(&entry[16]);
+		chunk_t_last[c] = get_little_endian_double(&entry[24]);
+		chunk_offset[c] = (long long)get_little_endian(&entry[32], 8);
+	}
+}
+
+// Destructor
+results_reader::~results_reader(void)
+{
+	//! Destructor
+
+	// Tidy up
+	free(chunk_first_point);
+	free(chunk_no_of_points);
+	free(chunk_t_first);
+	free(chunk_t_last);
+	free(chunk_offset);
+
+	fclose(p_file);
+}
+
+// Other functions
+int results_reader::return_field_index(string field_name)
+{
+	//! Function returns the index of a field, or -1 if it is not in the file
+
+	for (int i = 0; i < no_of_fields; i++)
+	{
+		if (field_names[i] == field_name)
+			return i;
+	}
+
+	return -1;
+}
+
+void results_reader::read_chunk_field(int chunk, int field, double* p_values)
+{
+	//! Function reads one field of a chunk in to p_values, which must
+	//! hold chunk_no_of_points[chunk] doubles
+	//! The fields in a chunk are stored one after another, so this is
+	//! one seek and one read, after the table of field sizes if the
+	//! chunk was written with the codec
+
+	// Variables
+	int n = (int)chunk_no_of_points[chunk];
+
+	long long field_offset;
+	long long field_bytes;
+
+	unsigned char* p_bytes;
+	unsigned char* p_table;
+	unsigned char* p_work;
+	unsigned long long* p_words;
+
+	double d_value;
+	float f_value;
+	unsigned int f_bits;
+
+	// Code
+	if (codec == RESULTS_CODEC_LOSSLESS)
+	{
+		p_table = (unsigned char*)malloc((size_t)no_of_fields * 4);
+
+		_fseeki64(p_file, chunk_offset[chunk], SEEK_SET);
+
+		if (fread(p_table, 4, no_of_fields, p_file) != (size_t)no_of_fields)
+		{
+			cout << "Error: " << file_string << " is truncated in chunk " << chunk << "\n";
+			exit(1);
+		}
+
+		field_offset = chunk_offset[chunk] + (4 * (long long)no_of_fields);
+		for (int j = 0; j < field; j++)
+			field_offset = field_offset + (long long)get_little_endian(&p_table[j * 4], 4);
+
+		field_bytes = (long long)get_little_endian(&p_table[field * 4], 4);
+
+		free(p_table);
+
+		p_bytes = (unsigned char*)malloc((size_t)field_bytes + 1);
+		p_words = (unsigned long long*)malloc((size_t)GSL_MAX(n, 1) * sizeof(unsigned long long));
+		p_work = (unsigned char*)malloc(time_series_codec::return_work_bytes(n, value_bytes));
+
+		_fseeki64(p_file, field_offset, SEEK_SET);
+
+		if ((fread(p_bytes, 1, (size_t)field_bytes, p_file) != (size_t)field_bytes) ||
+			(!time_series_codec::decode(p_bytes, (size_t)field_bytes, n, value_bytes, p_words, p_work)))
+		{
+			cout << "Error: " << file_string << " has a damaged field in chunk " << chunk << "\n";
+			exit(1);
+		}
+
+		for (int i = 0; i < n; i++)
+		{
+			if (value_bytes == 8)
+			{
+				memcpy(&d_value, &p_words[i], sizeof(double));
+				p_values[i] = d_value;
+			}
+			else
+			{
+				f_bits = (unsigned int)p_words[i];
+				memcpy(&f_value, &f_bits, sizeof(float));
+				p_values[i] = (double)f_value;
+			}
+		}
+
+		free(p_bytes);
+		free(p_words);
+		free(p_work);
+
+		return;
+	}
+
+	p_bytes = (unsigned char*)malloc((size_t)n * value_bytes);
+
+	_fseeki64(p_file, chunk_offset[chunk] + ((long long)field * n * value_bytes), SEEK_SET);
+
+	if (fread(p_bytes, value_bytes, n, p_file) != (size_t)n)
+	{
+		cout << "Error: " << file_string << " is truncated in chunk " << chunk << "\n";
+		exit(1);
+	}
+
+	for (int i = 0; i < n; i++)
+	{
+		if (value_bytes == 8)
+			p_values[i] = get_little_endian_double(&p_bytes[i * 8]);
+		else
+			p_values[i] = get_little_endian_float(&p_bytes[i * 4]);
+	}
+
+	free(p_bytes);
+}
+
+gsl_matrix* results_reader::read_window(double t_start_s, double t_stop_s,
+	int no_of_selected_fields, int selected_field_indices[])
+{
+	//! Function returns the selected fields for the time-points from
+	//! t_start_s to t_stop_s as a matrix with a row for each time-point
+	//! Only the chunks that overlap the window are read. If the file
+	//! has no time field, every time-point is returned
+	//! Returns NULL if there are no time-points or fields to return
+
+	// Variables
+	int no_of_rows = 0;
+	int row;
+	int n;
+
+	bool* p_keep;
+	double* p_values;
+
+	gsl_matrix* p_data;
+
+	// Code
+	for (int j = 0; j < no_of_selected_fields; j++)
+	{
+		if ((selected_field_indices[j] < 0) || (selected_field_indices[j] >= no_of_fields))
+		{
+			cout << "Error: field index " << selected_field_indices[j] << " is not in " <<
+				file_string << "\n";
+			exit(1);
+		}
+	}
+
+	p_keep = (bool*)malloc((size_t)no_of_time_points * sizeof(bool) + 1);
+	p_values = (double*)malloc((size_t)chunk_time_points * sizeof(double));
+
+	// Work out which time-points are in the window
+	for (int c = 0; c < no_of_chunks; c++)
+	{
+		n = (int)chunk_no_of_points[c];
+
+		if ((time_field_index >= 0) &&
+			((chunk_t_last[c] < t_start_s) || (chunk_t_first[c] > t_stop_s)))
+		{
+			for (int i = 0; i < n; i++)
+				p_keep[chunk_first_point[c] + i] = false;
+			continue;
+		}
+
+		if (time_field_index >= 0)
+			read_chunk_field(c, time_field_index, p_values);
+
+		for (int i = 0; i < n; i++)
+		{
+			p_keep[chunk_first_point[c] + i] = (time_field_index < 0) ||
+				((p_values[i] >= t_start_s) && (p_values[i] <= t_stop_s));
+
+			if (p_keep[chunk_first_point[c] + i])
+				no_of_rows = no_of_rows + 1;
+		}
+	}
+
+	if ((no_of_rows == 0) || (no_of_selected_fields == 0))
+	{
+		free(p_keep);
+		free(p_values);
+		return NULL;
+	}
+
+	p_data = gsl_matrix_alloc(no_of_rows, no_of_selected_fields);
+
+	// Now read the selected fields from the chunks that are needed
+	for (int j = 0; j < no_of_selected_fields; j++)
+	{
+		row = 0;
+
+		for (int c = 0; c < no_of_chunks; c++)
+		{
+			n = (int)chunk_no_of_points[c];
+
+			if ((time_field_index >= 0) &&
+				((chunk_t_last[c] < t_start_s) || (chunk_t_first[c] > t_stop_s)))
+			{
+				continue;
+			}
+
+			read_chunk_field(c, selected_field_indices[j], p_values);
+
+			for (int i = 0; i < n; i++)
+			{
+				if (p_keep[chunk_first_point[c] + i])
+				{
+					gsl_matrix_set(p_data, row, j, p_values[i]);
+					row = row + 1;
+				}
+			}
+		}
+	}
+
+	free(p_keep);
+	free(p_values);
+
+	return p_data;
+}
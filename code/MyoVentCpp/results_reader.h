@@ -0,0 +1,115 @@
+#pragma once
+
+/**
+/* @file		results_reader.h
+/* @brief		Header file for a results_reader object
+/* @author		Ken Campbell
+*/
+
+#include "stdio.h"
+#include <iostream>
+#include <string>
+
+#include "global_definitions.h"
+
+#include "gsl_matrix.h"
+
+using namespace std;
+
+class results_reader
+{
+public:
+	/**
+	 * Constructor
+	 * Opens a binary results file written by
+	 * a results_writer and loads the header and
+	 * the chunk index
+	 */
+	results_reader(string set_file_string);
+
+	/**
+	* Destructor
+	*/
+	~results_reader(void);
+
+	// Variables
+	string file_string;						/**< string with the file name */
+
+	FILE* p_file;							/**< pointer to the open file */
+
+	int value_bytes;						/**< integer with the bytes per value,
+													8 for double, 4 for float */
+
+	int codec;								/**< integer with the codec for the
+													chunks, RESULTS_CODEC_NONE or
+													RESULTS_CODEC_LOSSLESS */
+
+	int no_of_fields;						/**< integer with the number of
+													fields */
+
+	string field_names[MAX_NO_OF_RESULT_FIELDS];
+											/**< array of strings with the
+													field names */
+
+	string field_units[MAX_NO_OF_RESULT_FIELDS];
+											/**< array of strings with the
+													field units */
+
+	int chunk_time_points;					/**< integer with the time-points in
+													a full chunk */
+
+	int no_of_time_points;					/**< integer with the time-points in
+													the file */
+
+	int no_of_chunks;						/**< integer with the number of
+													chunks */
+
+	int system_id;							/**< integer with the id of the
+													system that was simulated */
+
+	double time_step_s;						/**< double with the time-step in s
+													between rows */
+
+	double sim_time_step_s;					/**< double with the time-step in s
+													of the simulation */
+
+	int time_field_index;					/**< integer with the index of the
+													time field, or -1 */
+
+	long long* chunk_first_point;			/**< pointer to an array with the
+													first time-point of each
+													chunk */
+
+	long long* chunk_no_of_points;			/**< pointer to an array with the
+													number of time-points in each
+													chunk */
+
+	double* chunk_t_first;					/**< pointer to an array with the
+													first time in each chunk */
+
+	double* chunk_t_last;					/**< pointer to an array with the
+													last time in each chunk */
+
+	long long* chunk_offset;				/**< pointer to an array with the
+													file offset of the data in
+													each chunk */
+
+	// Functions
+
+	int return_field_index(string field_name);
+											/**< function returns the index of a
+													field, or -1 */
+
+	gsl_matrix* read_window(double t_start_s, double t_stop_s,
+		int no_of_selected_fields, int selected_field_indices[]);
+											/**< function returns a matrix with
+													a row for each time-point
+													from t_start_s to t_stop_s and
+													a column for each selected
+													field, which the caller frees,
+													or NULL if it would be empty */
+
+	void read_chunk_field(int chunk, int field, double* p_values);
+											/**< function reads one field of a
+													chunk */
+};
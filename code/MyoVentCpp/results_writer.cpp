@@ -0,0 +1,727 @@
+/**
+/* @file		results_writer.cpp
+/* @brief		Source file for a results_writer object
+/* @author		Ken Campbell
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <iostream>
+#include <filesystem>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <csignal>
+
+#include "results_writer.h"
+#include "cmv_results.h"
+#include "cmv_system.h"
+#include "cmv_options.h"
+#include "cmv_protocol.h"
+#include "time_series_codec.h"
+
+#include "gsl_math.h"
+
+using namespace std;
+using namespace std::filesystem;
+
+volatile sig_atomic_t results_writer::stop_requested = 0;
+results_writer* results_writer::p_active_writers[MAX_NO_OF_RESULTS_WRITERS] = { NULL };
+
+// Binary results files are little-endian whatever the machine, so values
+// are written a byte at a time
+static void put_little_endian(unsigned char* p_bytes, unsigned long long value, int no_of_bytes)
+{
+	for (int i = 0; i < no_of_bytes; i++)
+	{
+		p_bytes[i] = (unsigned char)(value & 0xFF);
+		value = value >> 8;
+	}
+}
+
+static void put_little_endian_double(unsigned char* p_bytes, double value)
+{
+	unsigned long long bits;
+
+	memcpy(&bits, &value, sizeof(double));
+	put_little_endian(p_bytes, bits, 8);
+}
+
+static void put_little_endian_float(unsigned char* p_bytes, double value)
+{
+	float f_value = (float)value;
+	unsigned int bits;
+
+	memcpy(&bits, &f_value, sizeof(float));
+	put_little_endian(p_bytes, bits, 4);
+}
+
+// Constructor
+results_writer::results_writer(cmv_results* set_p_layout, string set_file_string,
+	string set_format, double set_row_time_step_s, int set_buffer_points,
+	long long set_expected_points)
+{
+	//! Constructor
+
+	// Variables
+	cmv_options* p_cmv_options;
+
+	// Code
+	p_layout = set_p_layout;
+	rw_file_string = set_file_string;
+	rw_format = set_format;
+	rw_row_time_step_s = set_row_time_step_s;
+
+	p_cmv_options = p_layout->p_parent_cmv_system->p_cmv_options;
+
+	rw_no_of_fields = p_layout->no_of_output_fields;
+	rw_time_field_index = p_layout->return_output_index(p_layout->time_field_index);
+	rw_buffer_points = GSL_MAX(set_buffer_points, 1);
+
+	rw_finished = false;
+	rw_write_error = false;
+	rw_rows_written = 0;
+	rw_n_producer_waits = 0;
+
+	rw_head = 0;
+	rw_tail = 0;
+	rw_done = false;
+
+	// The queue is the only storage that grows with the rows, and its
+	// size is fixed here
+	rw_queue = (double*)malloc((size_t)rw_buffer_points * GSL_MAX(rw_no_of_fields, 1) * sizeof(double));
+
+	// Binary buffers
+	rw_value_bytes = (p_cmv_options->results_binary_precision == "float") ? 4 : 8;
+	rw_chunk_points = p_cmv_options->results_binary_chunk_points;
+	rw_chunk = NULL;
+	rw_chunk_length = 0;
+	rw_column_bytes = NULL;
+	rw_codec = (p_cmv_options->results_binary_codec == "lossless") ?
+		RESULTS_CODEC_LOSSLESS : RESULTS_CODEC_NONE;
+	rw_words = NULL;
+	rw_encoded = NULL;
+	rw_codec_work = NULL;
+	rw_data_end = 0;
+	rw_no_of_chunks = 0;
+	rw_index_capacity = 0;
+	rw_index_area_offset = 0;
+	rw_index_area_entries = 0;
+	rw_index_entries_written = 0;
+	rw_index_first_point = NULL;
+	rw_index_no_of_points = NULL;
+	rw_index_t_first = NULL;
+	rw_index_t_last = NULL;
+	rw_index_offset = NULL;
+
+	if (rw_format == "binary")
+	{
+		rw_chunk = (double*)malloc((size_t)rw_chunk_points * GSL_MAX(rw_no_of_fields, 1) * sizeof(double));
+		rw_column_bytes = (unsigned char*)malloc((size_t)rw_chunk_points * rw_value_bytes);
+
+		if (rw_codec == RESULTS_CODEC_LOSSLESS)
+		{
+			rw_words = (unsigned long long*)malloc((size_t)rw_chunk_points * sizeof(unsigned long long));
+			rw_encoded = (unsigned char*)malloc(
+				time_series_codec::return_max_encoded_bytes(rw_chunk_points, rw_value_bytes));
+			rw_codec_work = (unsigned char*)malloc(
+				time_series_codec::return_work_bytes(rw_chunk_points, rw_value_bytes));
+		}
+
+		// Size the index for the expected rows so that it rarely grows
+		rw_index_capacity = (int)GSL_MAX(1, (set_expected_points / rw_chunk_points) + 2);
+		rw_index_first_point = (long long*)malloc(rw_index_capacity * sizeof(long long));
+		rw_index_no_of_points = (long long*)malloc(rw_index_capacity * sizeof(long long));
+		rw_index_t_first = (double*)malloc(rw_index_capacity * sizeof(double));
+		rw_index_t_last = (double*)malloc(rw_index_capacity * sizeof(double));
+		rw_index_offset = (long long*)malloc(rw_index_capacity * sizeof(long long));
+	}
+
+	// Make sure results directory exists
+	path output_file_path(rw_file_string);
+
+	if (!(is_directory(output_file_path.parent_path())))
+	{
+		if (create_directories(output_file_path.parent_path()))
+		{
+			cout << "\nCreating folder: " << output_file_path.string() << "\n";
+		}
+		else
+		{
+			cout << "\nError: Results folder could not be created: " <<
+				output_file_path.parent_path().string() << "\n";
+			exit(1);
+		}
+	}
+
+	// Check file can be opened, abort if not
+	errno_t err = fopen_s(&p_file, rw_file_string.c_str(), (rw_format == "binary") ? "wb" : "w");
+	if (err != 0)
+	{
+		cout << "Results file: " << rw_file_string << " could not be opened\n";
+		exit(1);
+	}
+
+	cout << "Writing simulation results to: " << rw_file_string << "\n";
+
+	// Write header
+	if (rw_format == "binary")
+	{
+		write_binary_header();
+	}
+	else
+	{
+		for (int i = 0; i < rw_no_of_fields; i++)
+		{
+			fprintf_s(p_file, "%s",
+				p_layout->results_fields[p_layout->output_field_indices[i]].c_str());
+			if (i == (rw_no_of_fields - 1))
+				fprintf_s(p_file, "\n");
+			else
+				fprintf_s(p_file, "\t");
+		}
+	}
+
+	fflush(p_file);
+
+	// The file is completed if the program exits before finish is called
+	{
+		static bool at_exit_registered = false;
+
+		if (!at_exit_registered)
+		{
+			atexit(finish_at_exit);
+			at_exit_registered = true;
+		}
+
+		for (int i = 0; i < MAX_NO_OF_RESULTS_WRITERS; i++)
+		{
+			if (p_active_writers[i] == NULL)
+			{
+				p_active_writers[i] = this;
+				break;
+			}
+		}
+	}
+
+	// Start the writer
+	rw_thread = std::thread(&results_writer::write_loop, this);
+}
+
+// Destructor
+results_writer::~results_writer(void)
+{
+	//! Destructor
+
+	// Code
+	finish();
+
+	// Tidy up
+	free(rw_queue);
+
+	if (rw_chunk != NULL)
+	{
+		free(rw_chunk);
+		free(rw_column_bytes);
+		free(rw_index_first_point);
+		free(rw_index_no_of_points);
+		free(rw_index_t_first);
+		free(rw_index_t_last);
+		free(rw_index_offset);
+	}
+
+	if (rw_words != NULL)
+	{
+		free(rw_words);
+		free(rw_encoded);
+		free(rw_codec_work);
+	}
+}
+
+// Other functions
+double* results_writer::reserve_row(void)
+{
+	//! Function returns the next slot in the queue
+	//! Only the simulation thread calls this. If the writer has fallen
+	//! a whole buffer behind, the simulation waits, so the memory used
+	//! does not depend on the length of the run
+
+	// Variables
+	long long tail = rw_tail.load(std::memory_order_relaxed);
+
+	// Code
+	if ((tail - rw_head.load(std::memory_order_acquire)) >= rw_buffer_points)
+	{
+		rw_n_producer_waits = rw_n_producer_waits + 1;
+
+		while ((tail - rw_head.load(std::memory_order_acquire)) >= rw_buffer_points)
+			std::this_thread::yield();
+	}
+
+	return &rw_queue[(size_t)(tail % rw_buffer_points) * rw_no_of_fields];
+}
+
+void results_writer::commit_row(void)
+{
+	//! Function makes the reserved row visible to the writer thread
+
+	rw_tail.store(rw_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void results_writer::finish(void)
+{
+	//! Function waits for the writer thread to write the remaining rows
+	//! and complete the file, then closes it
+
+	// Code
+	if (rw_finished)
+		return;
+
+	rw_finished = true;
+
+	rw_done.store(true, std::memory_order_release);
+
+	if (rw_thread.joinable())
+		rw_thread.join();
+
+	fclose(p_file);
+
+	for (int i = 0; i < MAX_NO_OF_RESULTS_WRITERS; i++)
+	{
+		if (p_active_writers[i] == this)
+			p_active_writers[i] = NULL;
+	}
+
+	cout << "Closing output_file: " << rw_file_string << ", " << rw_rows_written <<
+		" rows, the simulation waited for the writer " << rw_n_producer_waits << " time(s)\n";
+
+	// The caller decides whether to stop, as this can run inside exit
+	if (rw_write_error)
+		cout << "Error: results file " << rw_file_string << " could not be written\n";
+}
+
+void results_writer::write_loop(void)
+{
+	//! Function run by the writer thread
+	//! Rows are taken from the queue in batches. The file is flushed
+	//! after each batch, and a binary file has its index rewritten after
+	//! each new chunk, so the file on disk is readable as it stands
+	//! This thread does not call exit, as the at-exit handler joins it
+
+	// Variables
+	long long head;
+	long long tail;
+
+	int no_of_chunks_at_flush = 0;
+
+	// Code
+	while (true)
+	{
+		head = rw_head.load(std::memory_order_relaxed);
+		tail = rw_tail.load(std::memory_order_acquire);
+
+		if (tail == head)
+		{
+			if (rw_done.load(std::memory_order_acquire))
+			{
+				// Rows committed before done was set are visible now
+				if (rw_tail.load(std::memory_order_acquire) == head)
+					break;
+				continue;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+
+		for (long long r = head; r < tail; r++)
+		{
+			write_row(&rw_queue[(size_t)(r % rw_buffer_points) * rw_no_of_fields]);
+		}
+
+		// The slots can be reused
+		rw_head.store(tail, std::memory_order_release);
+
+		if ((rw_format == "binary") && (rw_no_of_chunks > no_of_chunks_at_flush))
+		{
+			write_binary_index();
+			no_of_chunks_at_flush = rw_no_of_chunks;
+		}
+
+		if (fflush(p_file) != 0)
+			rw_write_error = true;
+	}
+
+	// Complete the file
+	if (rw_format == "binary")
+	{
+		if (rw_chunk_length > 0)
+			write_binary_chunk();
+
+		write_binary_index();
+	}
+
+	if (fflush(p_file) != 0)
+		rw_write_error = true;
+}
+
+void results_writer::write_row(const double* p_row)
+{
+	//! Function writes a text row, or adds a row to the binary chunk
+
+	// Code
+	if (rw_format == "binary")
+	{
+		memcpy(&rw_chunk[(size_t)rw_chunk_length * rw_no_of_fields], p_row,
+			rw_no_of_fields * sizeof(double));
+		rw_chunk_length = rw_chunk_length + 1;
+		rw_rows_written = rw_rows_written + 1;
+
+		if (rw_chunk_length == rw_chunk_points)
+			write_binary_chunk();
+	}
+	else
+	{
+		for (int j = 0; j < rw_no_of_fields; j++)
+		{
+			fprintf_s(p_file, "%g", p_row[j]);
+			if (j == (rw_no_of_fields - 1))
+				fprintf_s(p_file, "\n");
+			else
+				fprintf_s(p_file, "\t");
+		}
+
+		rw_rows_written = rw_rows_written + 1;
+	}
+}
+
+void results_writer::write_binary_header(void)
+{
+	//! Function writes the header and the fields of a binary file
+	//! All numbers are little-endian. The file holds
+	//!		a header of RESULTS_BINARY_HEADER_BYTES
+	//!			char[8] RESULTS_BINARY_MAGIC, uint32 version,
+	//!			uint32 bytes per value (8 for double, 4 for float),
+	//!			uint32 no_of_fields, uint32 chunk_time_points,
+	//!			uint64 no_of_time_points, uint32 no_of_chunks,
+	//!			int32 system_id, double time-step in s between rows (0 if
+	//!			they are not evenly spaced),
+	//!			double simulation time-step in s, uint64 offset of the index,
+	//!			uint32 codec (RESULTS_CODEC_NONE or RESULTS_CODEC_LOSSLESS),
+	//!			uint32 unused
+	//!		for each field, uint32 length and name, uint32 length and units
+	//!		the chunks, each holding chunk_time_points rows (fewer in the
+	//!			last one) stored field by field
+	//!			with the lossless codec, a chunk starts with a uint32 for
+	//!			each field holding its number of bytes, and each field is
+	//!			a column written by time_series_codec::encode with the
+	//!			bits of the doubles or floats as its words
+	//!		the index, with an entry of RESULTS_BINARY_INDEX_ENTRY_BYTES per
+	//!			chunk holding uint64 first time-point, uint64 no_of_time_points,
+	//!			double first time, double last time, uint64 offset of the data
+	//! Version 1 files have the same layout without the codec and unused
+	//! words, so their header is RESULTS_BINARY_V1_HEADER_BYTES
+	//! A reader can pick the chunks for a time window from the index and
+	//! seek straight to the fields it needs in each one
+	//! The index is kept in an area reserved for it, which starts after
+	//! the fields and holds the chunks the writer expects. If there are
+	//! more, a larger area is started after the last chunk. The counts and
+	//! the index offset are updated as chunks are written, so the file can
+	//! be read as it stands
+
+	// Variables
+	unsigned char length_bytes[4];
+
+	int f;
+
+	cmv_system* p_cmv_system = p_layout->p_parent_cmv_system;
+
+	// Code
+	rw_index_area_offset = RESULTS_BINARY_HEADER_BYTES;
+	for (int i = 0; i < rw_no_of_fields; i++)
+	{
+		f = p_layout->output_field_indices[i];
+		rw_index_area_offset = rw_index_area_offset + 8 + p_layout->results_fields[f].length() +
+			p_layout->results_units[f].length();
+	}
+
+	memset(rw_header, 0, RESULTS_BINARY_HEADER_BYTES);
+	memcpy(rw_header, RESULTS_BINARY_MAGIC, 8);
+	put_little_endian(&rw_header[8], RESULTS_BINARY_VERSION, 4);
+	put_little_endian(&rw_header[12], rw_value_bytes, 4);
+	put_little_endian(&rw_header[16], rw_no_of_fields, 4);
+	put_little_endian(&rw_header[20], rw_chunk_points, 4);
+	put_little_endian(&rw_header[24], 0, 8);
+	put_little_endian(&rw_header[32], 0, 4);
+	put_little_endian(&rw_header[36], (unsigned int)p_cmv_system->system_id, 4);
+	put_little_endian_double(&rw_header[40], rw_row_time_step_s);
+	put_little_endian_double(&rw_header[48], p_cmv_system->p_cmv_protocol->time_step_s);
+	put_little_endian(&rw_header[56], rw_index_area_offset, 8);
+	put_little_endian(&rw_header[64], rw_codec, 4);
+
+	fwrite(rw_header, 1, RESULTS_BINARY_HEADER_BYTES, p_file);
+
+	// Field names and units
+	for (int i = 0; i < rw_no_of_fields; i++)
+	{
+		f = p_layout->output_field_indices[i];
+
+		put_little_endian(length_bytes, p_layout->results_fields[f].length(), 4);
+		fwrite(length_bytes, 1, 4, p_file);
+		fwrite(p_layout->results_fields[f].c_str(), 1, p_layout->results_fields[f].length(), p_file);
+
+		put_little_endian(length_bytes, p_layout->results_units[f].length(), 4);
+		fwrite(length_bytes, 1, 4, p_file);
+		fwrite(p_layout->results_units[f].c_str(), 1, p_layout->results_units[f].length(), p_file);
+	}
+
+	// The index follows the fields, and the chunks start after it
+	reserve_index_area(rw_index_area_offset, rw_index_capacity);
+}
+
+void results_writer::write_binary_chunk(void)
+{
+	//! Function writes the buffered rows as a chunk, one field at a time,
+	//! at the end of the file, where it cannot overwrite the index
+
+	// Variables
+	int new_capacity;
+
+	// Code
+
+	// Record the chunk
+	if (rw_no_of_chunks == rw_index_capacity)
+	{
+		new_capacity = 2 * rw_index_capacity;
+
+		rw_index_first_point = (long long*)realloc(rw_index_first_point, new_capacity * sizeof(long long));
+		rw_index_no_of_points = (long long*)realloc(rw_index_no_of_points, new_capacity * sizeof(long long));
+		rw_index_t_first = (double*)realloc(rw_index_t_first, new_capacity * sizeof(double));
+		rw_index_t_last = (double*)realloc(rw_index_t_last, new_capacity * sizeof(double));
+		rw_index_offset = (long long*)realloc(rw_index_offset, new_capacity * sizeof(long long));
+
+		rw_index_capacity = new_capacity;
+	}
+
+	rw_index_first_point[rw_no_of_chunks] = rw_rows_written - rw_chunk_length;
+	rw_index_no_of_points[rw_no_of_chunks] = rw_chunk_length;
+	rw_index_t_first[rw_no_of_chunks] = GSL_NAN;
+	rw_index_t_last[rw_no_of_chunks] = GSL_NAN;
+	if (rw_time_field_index >= 0)
+	{
+		rw_index_t_first[rw_no_of_chunks] = rw_chunk[rw_time_field_index];
+		rw_index_t_last[rw_no_of_chunks] =
+			rw_chunk[((size_t)(rw_chunk_length - 1) * rw_no_of_fields) + rw_time_field_index];
+	}
+	rw_index_offset[rw_no_of_chunks] = rw_data_end;
+
+	// Write the data
+	_fseeki64(p_file, rw_data_end, SEEK_SET);
+
+	if (rw_codec == RESULTS_CODEC_LOSSLESS)
+	{
+		write_encoded_chunk_fields();
+	}
+	else
+	{
+		for (int j = 0; j < rw_no_of_fields; j++)
+		{
+			for (int i = 0; i < rw_chunk_length; i++)
+			{
+				if (rw_value_bytes == 8)
+					put_little_endian_double(&rw_column_bytes[i * 8], rw_chunk[((size_t)i * rw_no_of_fields) + j]);
+				else
+					put_little_endian_float(&rw_column_bytes[i * 4], rw_chunk[((size_t)i * rw_no_of_fields) + j]);
+			}
+
+			if (fwrite(rw_column_bytes, rw_value_bytes, rw_chunk_length, p_file) != (size_t)rw_chunk_length)
+				rw_write_error = true;
+		}
+
+		rw_data_end = rw_data_end + ((long long)rw_chunk_length * rw_no_of_fields * rw_value_bytes);
+	}
+	rw_no_of_chunks = rw_no_of_chunks + 1;
+	rw_chunk_length = 0;
+}
+
+void results_writer::write_encoded_chunk_fields(void)
+{
+	//! Function writes the fields of the buffered chunk with the codec,
+	//! after a table with the number of bytes in each one, and moves
+	//! rw_data_end past them
+	//! The table is filled in once the fields are written
+
+	// Variables
+	unsigned char length_bytes[4];
+
+	long long table_offset = rw_data_end;
+	long long field_offset;
+
+	float f_value;
+	unsigned int f_bits;
+
+	size_t encoded_bytes;
+
+	// Code
+	memset(length_bytes, 0, 4);
+	for (int j = 0; j < rw_no_of_fields; j++)
+		fwrite(length_bytes, 1, 4, p_file);
+
+	field_offset = table_offset + (4 * (long long)rw_no_of_fields);
+
+	for (int j = 0; j < rw_no_of_fields; j++)
+	{
+		for (int i = 0; i < rw_chunk_length; i++)
+		{
+			if (rw_value_bytes == 8)
+			{
+				memcpy(&rw_words[i], &rw_chunk[((size_t)i * rw_no_of_fields) + j], sizeof(double));
+			}
+			else
+			{
+				f_value = (float)rw_chunk[((size_t)i * rw_no_of_fields) + j];
+				memcpy(&f_bits, &f_value, sizeof(float));
+				rw_words[i] = f_bits;
+			}
+		}
+
+		encoded_bytes = time_series_codec::encode(rw_words, rw_chunk_length, rw_value_bytes,
+			rw_encoded, rw_codec_work);
+
+		if (fwrite(rw_encoded, 1, encoded_bytes, p_file) != encoded_bytes)
+			rw_write_error = true;
+
+		// Fill in the table
+		_fseeki64(p_file, table_offset + (4 * (long long)j), SEEK_SET);
+		put_little_endian(length_bytes, encoded_bytes, 4);
+		fwrite(length_bytes, 1, 4, p_file);
+
+		field_offset = field_offset + (long long)encoded_bytes;
+		_fseeki64(p_file, field_offset, SEEK_SET);
+	}
+
+	rw_data_end = field_offset;
+}
+
+void results_writer::reserve_index_area(long long area_offset, int no_of_entries)
+{
+	//! Function fills an area for no_of_entries index entries at
+	//! area_offset with zeros, and moves rw_data_end past it
+
+	// Variables
+	unsigned char entry[RESULTS_BINARY_INDEX_ENTRY_BYTES];
+
+	// Code
+	memset(entry, 0, RESULTS_BINARY_INDEX_ENTRY_BYTES);
+
+	_fseeki64(p_file, area_offset, SEEK_SET);
+
+	for (int c = 0; c < no_of_entries; c++)
+	{
+		if (fwrite(entry, 1, RESULTS_BINARY_INDEX_ENTRY_BYTES, p_file) != RESULTS_BINARY_INDEX_ENTRY_BYTES)
+			rw_write_error = true;
+	}
+
+	rw_index_area_offset = area_offset;
+	rw_index_area_entries = no_of_entries;
+	rw_index_entries_written = 0;
+
+	rw_data_end = area_offset + ((long long)no_of_entries * RESULTS_BINARY_INDEX_ENTRY_BYTES);
+}
+
+void results_writer::write_binary_index(void)
+{
+	//! Function adds the entries for the new chunks to the index and then
+	//! updates the counts and the index offset in the header
+	//! The entries already in the header's index are never overwritten,
+	//! and the header is rewritten in one write once the new entries are
+	//! on disk, so a reader sees either the old index or the new one,
+	//! whenever the program stops
+
+	// Variables
+	unsigned char entry[RESULTS_BINARY_INDEX_ENTRY_BYTES];
+
+	long long no_of_points = 0;
+
+	// Code
+
+	// If the area is full, the whole index goes into a new one after the
+	// last chunk, and the header moves to it once it is complete
+	if (rw_no_of_chunks > rw_index_area_entries)
+		reserve_index_area(rw_data_end, rw_index_capacity);
+
+	_fseeki64(p_file, rw_index_area_offset +
+		((long long)rw_index_entries_written * RESULTS_BINARY_INDEX_ENTRY_BYTES), SEEK_SET);
+
+	for (int c = rw_index_entries_written; c < rw_no_of_chunks; c++)
+	{
+		put_little_endian(&entry[0], rw_index_first_point[c], 8);
+		put_little_endian(&entry[8], rw_index_no_of_points[c], 8);
+		put_little_endian_double(&entry[16], rw_index_t_first[c]);
+		put_little_endian_double(&entry[24], rw_index_t_last[c]);
+		put_little_endian(&entry[32], rw_index_offset[c], 8);
+
+		if (fwrite(entry, 1, RESULTS_BINARY_INDEX_ENTRY_BYTES, p_file) != RESULTS_BINARY_INDEX_ENTRY_BYTES)
+			rw_write_error = true;
+	}
+
+	rw_index_entries_written = rw_no_of_chunks;
+
+	for (int c = 0; c < rw_no_of_chunks; c++)
+		no_of_points = no_of_points + rw_index_no_of_points[c];
+
+	// The header is updated after the index is on disk
+	if (fflush(p_file) != 0)
+		rw_write_error = true;
+
+	put_little_endian(&rw_header[24], no_of_points, 8);
+	put_little_endian(&rw_header[32], rw_no_of_chunks, 4);
+	put_little_endian(&rw_header[56], rw_index_area_offset, 8);
+
+	_fseeki64(p_file, 0, SEEK_SET);
+	if (fwrite(rw_header, 1, RESULTS_BINARY_HEADER_BYTES, p_file) != RESULTS_BINARY_HEADER_BYTES)
+		rw_write_error = true;
+}
+
+void results_writer::install_signal_handlers(void)
+{
+	//! Function sets the handlers for SIGINT and SIGTERM
+
+	signal(SIGINT, handle_signal);
+	signal(SIGTERM, handle_signal);
+}
+
+void results_writer::handle_signal(int signal_number)
+{
+	//! Function asks the simulation loop to stop, which then completes
+	//! the results file. A second signal ends the program at once
+
+	stop_requested = 1;
+
+	signal(signal_number, SIG_DFL);
+}
+
+void results_writer::finish_at_exit(void)
+{
+	//! Function completes the files of the writers that are still open
+	//! when the program exits, for example from an exit(1) after an error
+
+	// Variables
+	results_writer* p_writer;
+
+	// Code
+	for (int i = 0; i < MAX_NO_OF_RESULTS_WRITERS; i++)
+	{
+		p_writer = p_active_writers[i];
+
+		if (p_writer != NULL)
+		{
+			p_active_writers[i] = NULL;
+
+			cout << "Completing results file before exit\n";
+			p_writer->finish();
+		}
+	}
+}
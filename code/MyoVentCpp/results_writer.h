@@ -0,0 +1,215 @@
+#pragma once
+
+/**
+/* @file		results_writer.h
+/* @brief		Header file for a results_writer object
+/* @author		Ken Campbell
+*/
+
+#include "stdio.h"
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <csignal>
+
+#include "global_definitions.h"
+
+using namespace std;
+
+class cmv_results;
+
+class results_writer
+{
+public:
+	/**
+	 * Constructor
+	 * Opens the file, writes the header for the fields p_layout writes, and
+	 * starts the thread that writes rows as they are committed
+	 */
+	results_writer(cmv_results* set_p_layout, string set_file_string,
+		string set_format, double set_row_time_step_s, int set_buffer_points,
+		long long set_expected_points);
+
+	/**
+	* Destructor
+	*/
+	~results_writer(void);
+
+	// Variables
+	cmv_results* p_layout;					/**< pointer to the cmv_results object
+													defining the fields */
+
+	string rw_file_string;					/**< string with the file name */
+
+	string rw_format;						/**< string with the format, text
+													or binary */
+
+	FILE* p_file;							/**< pointer to the output file */
+
+	int rw_no_of_fields;					/**< integer with the number of
+													fields in a row */
+
+	double rw_row_time_step_s;				/**< double with the time-step in s
+													between rows, 0 if they are
+													not evenly spaced */
+
+	int rw_time_field_index;				/**< integer with the index of the
+													time field, or -1 */
+
+	int rw_buffer_points;					/**< integer with the number of rows
+													the queue can hold, which
+													bounds the memory used */
+
+	double* rw_queue;						/**< pointer to the rows waiting to
+													be written, used as a ring */
+
+	std::atomic<long long> rw_head;			/**< number of rows taken from the
+													queue by the writer thread */
+
+	std::atomic<long long> rw_tail;			/**< number of rows committed to the
+													queue by the simulation */
+
+	std::atomic<bool> rw_done;				/**< set when no more rows will be
+													committed */
+
+	std::thread rw_thread;					/**< the thread writing the rows */
+
+	bool rw_finished;						/**< true once the file is complete */
+
+	bool rw_write_error;					/**< set by the writer thread if
+													the file could not be
+													written */
+
+	long long rw_rows_written;				/**< number of rows in the file */
+
+	long long rw_n_producer_waits;			/**< number of times the simulation
+													waited for space in a full
+													queue */
+
+	int rw_value_bytes;						/**< integer with the bytes per value
+													in a binary file */
+
+	int rw_chunk_points;					/**< integer with the rows in a full
+													binary chunk */
+
+	double* rw_chunk;						/**< pointer to the rows of the chunk
+													being filled */
+
+	int rw_chunk_length;					/**< integer with the rows in the
+													chunk being filled */
+
+	unsigned char* rw_column_bytes;			/**< pointer to the bytes for one
+													field of a chunk */
+
+	int rw_codec;							/**< integer with the codec for the
+													chunks, RESULTS_CODEC_NONE or
+													RESULTS_CODEC_LOSSLESS */
+
+	unsigned long long* rw_words;			/**< pointer to the bit patterns of
+													one field of a chunk, for the
+													codec */
+
+	unsigned char* rw_encoded;				/**< pointer to the encoded bytes
+													for one field of a chunk */
+
+	unsigned char* rw_codec_work;			/**< pointer to the work space for
+													the codec */
+
+	unsigned char rw_header[RESULTS_BINARY_HEADER_BYTES];
+											/**< array with the header of a
+													binary file, which is
+													rewritten as a whole */
+
+	long long rw_data_end;					/**< file offset of the end of the
+													last chunk or index area,
+													where the next chunk starts */
+
+	int rw_no_of_chunks;					/**< integer with the chunks written */
+
+	int rw_index_capacity;					/**< integer with the chunks the
+													index arrays can hold */
+
+	long long* rw_index_first_point;		/**< pointer to the first row of
+													each chunk */
+
+	long long* rw_index_no_of_points;		/**< pointer to the rows in each
+													chunk */
+
+	double* rw_index_t_first;				/**< pointer to the first time in
+													each chunk */
+
+	double* rw_index_t_last;				/**< pointer to the last time in
+													each chunk */
+
+	long long* rw_index_offset;				/**< pointer to the file offset of
+													each chunk */
+
+	long long rw_index_area_offset;			/**< file offset of the area that
+													holds the index */
+
+	int rw_index_area_entries;				/**< integer with the entries the
+													index area can hold */
+
+	int rw_index_entries_written;			/**< integer with the entries
+													written to the index area */
+
+	static volatile sig_atomic_t stop_requested;
+											/**< set by SIGINT or SIGTERM, the
+													simulation loop stops when
+													it sees it */
+
+	static results_writer* p_active_writers[MAX_NO_OF_RESULTS_WRITERS];
+											/**< array of pointers to the open
+													writers, which are finished
+													if the program exits early */
+
+	// Functions
+
+	double* reserve_row(void);				/**< function returns the next slot
+													in the queue, waiting if it
+													is full */
+
+	void commit_row(void);					/**< function passes the reserved
+													row to the writer thread */
+
+	void finish(void);						/**< function writes the remaining
+													rows and completes the file */
+
+	void write_loop(void);					/**< function run by the writer
+													thread */
+
+	void write_row(const double* p_row);	/**< function writes or buffers one
+													row */
+
+	void write_binary_header(void);			/**< function writes the header and
+													fields of a binary file */
+
+	void write_binary_chunk(void);			/**< function writes the buffered
+													chunk */
+
+	void write_encoded_chunk_fields(void);	/**< function writes the fields of
+													the buffered chunk with the
+													codec */
+
+	void reserve_index_area(long long area_offset, int no_of_entries);
+											/**< function fills an area for
+													the index with zeros */
+
+	void write_binary_index(void);			/**< function writes the index after
+													the last chunk and updates the
+													header, so that the file can
+													be read as it stands */
+
+	static void install_signal_handlers(void);
+											/**< function sets the handlers for
+													SIGINT and SIGTERM */
+
+	static void handle_signal(int signal_number);
+											/**< function called on SIGINT or
+													SIGTERM */
+
+	static void finish_at_exit(void);		/**< function registered with atexit
+													so that exit(1) paths still
+													complete the file */
+};
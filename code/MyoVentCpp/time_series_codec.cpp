@@ -0,0 +1,311 @@
+/**
+ * @file    time_series_codec.cpp
+ * @brief   Source file for a lossless codec for columns of time-series data
+ * @author  Ken Campbell
+ */
+
+#include <string.h>
+
+#include "time_series_codec.h"
+
+// An encoded column is
+//      uint8 mode, the residual used
+//          TIME_SERIES_CODEC_XOR, the bits XORed with the word before
+//          TIME_SERIES_CODEC_DELTA, the word before subtracted
+//          TIME_SERIES_CODEC_DELTA_2, a straight line through the two
+//              words before subtracted
+//      in each case the words are treated as unsigned integers and the
+//      differences are zig-zag encoded
+//      for each byte plane of the residuals, least significant first,
+//          uint32 number of bytes, little-endian, and the run-length
+//          encoded plane
+// A run-length encoded plane is a series of runs, each starting with a
+// control byte c
+//      c < 128, the next c + 1 bytes are copied
+//      c >= 128, the next byte is repeated c - 126 times
+
+namespace time_series_codec {
+
+    //! Returns the prediction of a word from the two before, which the
+    //! residual is taken from
+    static unsigned long long return_prediction(unsigned long long previous,
+        unsigned long long before_previous, int mode)
+    {
+        if (mode == TIME_SERIES_CODEC_DELTA_2)
+            return ((2 * previous) - before_previous);
+
+        return previous;
+    }
+
+    //! Returns the residual of a word, which is small when the word is
+    //! close to its prediction
+    static unsigned long long return_residual(unsigned long long word, unsigned long long prediction,
+        int mode, int word_bytes)
+    {
+        unsigned long long d;
+        unsigned int d32;
+
+        if (mode == TIME_SERIES_CODEC_XOR)
+            return (word ^ prediction);
+
+        // The difference is zig-zag encoded so that small negative steps
+        // have small residuals too
+        if (word_bytes == 8)
+        {
+            d = word - prediction;
+            return ((d << 1) ^ (unsigned long long)((long long)d >> 63));
+        }
+
+        d32 = (unsigned int)(word - prediction);
+        return (unsigned long long)((d32 << 1) ^ (unsigned int)((int)d32 >> 31));
+    }
+
+    //! Returns the word from its residual and its prediction
+    static unsigned long long return_word(unsigned long long residual, unsigned long long prediction,
+        int mode, int word_bytes)
+    {
+        unsigned long long d;
+        unsigned int d32;
+
+        if (mode == TIME_SERIES_CODEC_XOR)
+            return (residual ^ prediction);
+
+        if (word_bytes == 8)
+        {
+            d = (residual >> 1) ^ (0ULL - (residual & 1ULL));
+            return (prediction + d);
+        }
+
+        d32 = ((unsigned int)residual >> 1) ^ (0U - ((unsigned int)residual & 1U));
+        return (unsigned long long)((unsigned int)prediction + d32);
+    }
+
+    //! Fills p_planes with the residuals split in to byte planes
+    static void fill_planes(const unsigned long long p_words[], int n, int word_bytes, int mode,
+        unsigned char p_planes[])
+    {
+        unsigned long long previous = 0;
+        unsigned long long before_previous = 0;
+        unsigned long long residual;
+
+        for (int i = 0; i < n; i++)
+        {
+            residual = return_residual(p_words[i],
+                return_prediction(previous, before_previous, mode), mode, word_bytes);
+            before_previous = previous;
+            previous = p_words[i];
+
+            for (int k = 0; k < word_bytes; k++)
+            {
+                p_planes[((size_t)k * n) + i] = (unsigned char)(residual & 0xFF);
+                residual = residual >> 8;
+            }
+        }
+    }
+
+    //! Run-length encodes n bytes to p_out, or only counts the bytes if
+    //! p_out is NULL, and returns the number of bytes
+    static size_t rle_encode(const unsigned char p_in[], int n, unsigned char p_out[])
+    {
+        size_t out_bytes = 0;
+
+        int i = 0;
+        int run;
+        int literal_start;
+        int literal_length;
+
+        while (i < n)
+        {
+            run = 1;
+            while (((i + run) < n) && (run < 129) && (p_in[i + run] == p_in[i]))
+                run = run + 1;
+
+            if (run >= 3)
+            {
+                if (p_out != NULL)
+                {
+                    p_out[out_bytes] = (unsigned char)(run + 126);
+                    p_out[out_bytes + 1] = p_in[i];
+                }
+                out_bytes = out_bytes + 2;
+                i = i + run;
+                continue;
+            }
+
+            // Copy bytes until a run of 3 starts
+            literal_start = i;
+            literal_length = 0;
+
+            while ((i < n) && (literal_length < 128))
+            {
+                if (((i + 2) < n) && (p_in[i] == p_in[i + 1]) && (p_in[i] == p_in[i + 2]))
+                    break;
+
+                i = i + 1;
+                literal_length = literal_length + 1;
+            }
+
+            if (p_out != NULL)
+            {
+                p_out[out_bytes] = (unsigned char)(literal_length - 1);
+                memcpy(&p_out[out_bytes + 1], &p_in[literal_start], literal_length);
+            }
+            out_bytes = out_bytes + 1 + literal_length;
+        }
+
+        return out_bytes;
+    }
+
+    //! Decodes runs from p_in to exactly n bytes, returning false if the
+    //! runs do not make n bytes
+    static bool rle_decode(const unsigned char p_in[], size_t in_bytes, int n, unsigned char p_out[])
+    {
+        size_t j = 0;
+        int i = 0;
+        int length;
+
+        while (j < in_bytes)
+        {
+            if (p_in[j] < 128)
+            {
+                length = p_in[j] + 1;
+                if (((i + length) > n) || ((j + 1 + length) > in_bytes))
+                    return false;
+
+                memcpy(&p_out[i], &p_in[j + 1], length);
+                j = j + 1 + length;
+            }
+            else
+            {
+                length = p_in[j] - 126;
+                if (((i + length) > n) || ((j + 2) > in_bytes))
+                    return false;
+
+                memset(&p_out[i], p_in[j + 1], length);
+                j = j + 2;
+            }
+
+            i = i + length;
+        }
+
+        return (i == n);
+    }
+
+    size_t return_max_encoded_bytes(const int n, const int word_bytes)
+    {
+        return (1 + ((size_t)word_bytes * (4 + n + ((n + 127) / 128))));
+    }
+
+    size_t return_work_bytes(const int n, const int word_bytes)
+    {
+        return ((size_t)((n > 1) ? n : 1) * word_bytes);
+    }
+
+    //! Encodes a column, picking the residual that packs best
+    size_t encode(const unsigned long long p_words[], const int n, const int word_bytes,
+        unsigned char p_out[], unsigned char p_work[])
+    {
+        // Variables
+        size_t out_bytes;
+        size_t mode_bytes;
+        size_t best_bytes = 0;
+        size_t plane_bytes;
+
+        int mode = TIME_SERIES_CODEC_XOR;
+
+        // Code
+        for (int m = 0; m < TIME_SERIES_CODEC_NO_OF_MODES; m++)
+        {
+            fill_planes(p_words, n, word_bytes, m, p_work);
+
+            mode_bytes = 0;
+            for (int k = 0; k < word_bytes; k++)
+                mode_bytes = mode_bytes + rle_encode(&p_work[(size_t)k * n], n, NULL);
+
+            if ((m == 0) || (mode_bytes < best_bytes))
+            {
+                mode = m;
+                best_bytes = mode_bytes;
+            }
+        }
+
+        // The work space holds the planes for the last mode
+        if (mode != (TIME_SERIES_CODEC_NO_OF_MODES - 1))
+            fill_planes(p_words, n, word_bytes, mode, p_work);
+
+        p_out[0] = (unsigned char)mode;
+        out_bytes = 1;
+
+        for (int k = 0; k < word_bytes; k++)
+        {
+            plane_bytes = rle_encode(&p_work[(size_t)k * n], n, &p_out[out_bytes + 4]);
+
+            for (int b = 0; b < 4; b++)
+                p_out[out_bytes + b] = (unsigned char)((plane_bytes >> (8 * b)) & 0xFF);
+
+            out_bytes = out_bytes + 4 + plane_bytes;
+        }
+
+        return out_bytes;
+    }
+
+    //! Decodes a column
+    bool decode(const unsigned char p_in[], const size_t in_bytes, const int n,
+        const int word_bytes, unsigned long long p_words[], unsigned char p_work[])
+    {
+        // Variables
+        size_t j;
+        size_t plane_bytes;
+
+        int mode;
+
+        unsigned long long previous = 0;
+        unsigned long long before_previous = 0;
+        unsigned long long residual;
+
+        // Code
+        if (in_bytes < 1)
+            return false;
+
+        mode = p_in[0];
+        if (mode >= TIME_SERIES_CODEC_NO_OF_MODES)
+            return false;
+
+        j = 1;
+
+        for (int k = 0; k < word_bytes; k++)
+        {
+            if ((j + 4) > in_bytes)
+                return false;
+
+            plane_bytes = 0;
+            for (int b = 3; b >= 0; b--)
+                plane_bytes = (plane_bytes << 8) | p_in[j + b];
+
+            j = j + 4;
+
+            if (((j + plane_bytes) > in_bytes) ||
+                (!rle_decode(&p_in[j], plane_bytes, n, &p_work[(size_t)k * n])))
+            {
+                return false;
+            }
+
+            j = j + plane_bytes;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            residual = 0;
+            for (int k = word_bytes - 1; k >= 0; k--)
+                residual = (residual << 8) | p_work[((size_t)k * n) + i];
+
+            p_words[i] = return_word(residual,
+                return_prediction(previous, before_previous, mode), mode, word_bytes);
+            before_previous = previous;
+            previous = p_words[i];
+        }
+
+        return true;
+    }
+
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+/**
+ * @file    time_series_codec.h
+ * @brief   header file for a lossless codec for columns of time-series data
+ * @author  Ken Campbell
+ */
+
+#include <stddef.h>
+
+#include "global_definitions.h"
+
+namespace time_series_codec {
+
+    /**
+    * a function that returns the largest number of bytes encode can write
+    * for a column, which is the size the output buffer must have
+    * @param n integer, the number of values in the column
+    * @param word_bytes integer, 8 for doubles or 4 for floats
+    * @return size_t, the number of bytes
+    */
+    size_t return_max_encoded_bytes(const int n, const int word_bytes);
+
+    /**
+    * a function that returns the number of bytes of work space that encode
+    * and decode need for a column
+    * @param n integer, the number of values in the column
+    * @param word_bytes integer, 8 for doubles or 4 for floats
+    * @return size_t, the number of bytes
+    */
+    size_t return_work_bytes(const int n, const int word_bytes);
+
+    /**
+    * a function that encodes a column of values without loss. Each value
+    * is replaced by its IEEE bit pattern XORed with the one before, or by
+    * its difference from the one before or from a straight line through
+    * the two before, whichever packs best. The residuals are split in
+    * to byte planes and each plane is run-length encoded, so constant
+    * stretches and the high bytes of smooth signals take almost no space
+    * @param p_words pointer to the bit patterns, a double or a float in
+    *        the low bytes of each word
+    * @param n integer, the number of values
+    * @param word_bytes integer, 8 for doubles or 4 for floats
+    * @param p_out pointer to a buffer of return_max_encoded_bytes
+    * @param p_work pointer to a buffer of return_work_bytes
+    * @return size_t, the number of bytes written to p_out
+    */
+    size_t encode(const unsigned long long p_words[], const int n, const int word_bytes,
+        unsigned char p_out[], unsigned char p_work[]);
+
+    /**
+    * a function that decodes a column written by encode
+    * @param p_in pointer to the encoded bytes
+    * @param in_bytes size_t, the number of encoded bytes
+    * @param n integer, the number of values
+    * @param word_bytes integer, 8 for doubles or 4 for floats
+    * @param p_words pointer to n words that are set to the bit patterns
+    * @param p_work pointer to a buffer of return_work_bytes
+    * @return bool, false if the bytes are not a valid column
+    */
+    bool decode(const unsigned char p_in[], const size_t in_bytes, const int n,
+        const int word_bytes, unsigned long long p_words[], unsigned char p_work[]);
+
+};
@@ -55,6 +55,9 @@ transition::transition(const rapidjson::Value& tr, m_state* set_p_parent_m_state
 	JSON_functions::check_JSON_member_string(tr, "rate_type");
 	sprintf_s(rate_type, _MAX_PATH, tr["rate_type"].GetString());
 
+	// Resolve the rate function
+	set_rate_function();
+
 	// Read in parameters
 	JSON_functions::check_JSON_member_array(tr, "rate_parameters");
 	const rapidjson::Value& rp = tr["rate_parameters"];
@@ -75,6 +78,7 @@ transition::transition()
 	new_state = 0;
 	transition_type = 'x';
 	sprintf_s(rate_type, _MAX_PATH, "");
+	set_rate_function();
 	rate_parameters = gsl_vector_alloc(MAX_NO_OF_RATE_PARAMETERS);
 	gsl_vector_set_all(rate_parameters, GSL_NAN);
 }
@@ -88,9 +92,74 @@ transition::~transition(void)
 
 // Functions
 
+void transition::set_rate_function(void)
+{
+	//! Sets the rate function from the rate_type string
+
+	// Code
+	rate_function = rf_undefined;
+
+	if (!strcmp(rate_type, "constant"))
+		rate_function = rf_constant;
+
+	if (!strcmp(rate_type, "force_dependent"))
+		rate_function = rf_force_dependent;
+
+	if (!strcmp(rate_type, "gaussian"))
+		rate_function = rf_gaussian;
+
+	if (!strcmp(rate_type, "gaussian_hsl"))
+		rate_function = rf_gaussian_hsl;
+
+	if (!strcmp(rate_type, "poly"))
+		rate_function = rf_poly;
+
+	if (!strcmp(rate_type, "poly_asym"))
+		rate_function = rf_poly_asym;
+
+	if (!strcmp(rate_type, "exp_wall"))
+		rate_function = rf_exp_wall;
+
+	// Note whether the rate depends on the state of the half-sarcomere
+	// Rates that only depend on x can be cached by the kinetic scheme
+	rate_depends_on_force = (rate_function == rf_force_dependent);
+	rate_depends_on_hs_length = (rate_function == rf_gaussian_hsl);
+}
+
+static double hsl_rate_factor(double hs_length)
+{
+	//! Returns the factor that scales gaussian_hsl rates
+	//! Distance between surface of thick and thin filaments is
+	//! (2/3)*d_1,0 - r_thin - r_thick
+	//! Assume d_1_0 at hsl = 1100 nm is 37 nm, r_thin = 5.5 nm, t_thick = 7.5 nm
+	//! d at hsl = x is (2/3) * (37 / sqrt(x/1100)) - 5/5 - 7.5
+	//! first passage time to position y is t = y^2 / (2*D)
+	//! rate is proportional to 1/t
+	//! rate at hsl == x is ref_rate * (y_ref / y_x)^2
+	//! See PMID 35450825 and first passage in
+	//! Mechanics of motor proteins and the cytoskeleton, Joe Howard book
+
+	// Variables
+	double y_ref;		// distance between filaments at 1100 nm
+	double y_actual;	// distance between filaments at current hsl
+	double r_thick = 7.5;
+	double r_thin = 5.5;
+
+	// Code
+	y_ref = ((2.0 / 3.0) * 37.0) - r_thick - r_thin;
+
+	if (gsl_isnan(hs_length))
+		hs_length = 1100.0;
+
+	y_actual = (2.0 / 3.0) * (37.0 / sqrt(hs_length / 1100.0)) - r_thick - r_thin;
+
+	return gsl_pow_2(y_ref / y_actual);
+}
+
 double transition::calculate_rate(double x, double x_ext, double force, double hs_length)
 {
 	//! Returns the rate for a transition with a given x
+	//! This is the reference implementation for calculate_rates()
 
 	// Variables
 	double rate = 0.0;
@@ -101,110 +170,93 @@ double transition::calculate_rate(double x, double x_ext, double force, double h
 
 	// Code
 
-	// Constant
-	if (!strcmp(rate_type, "constant"))
+	switch (rate_function)
 	{
-		rate = gsl_vector_get(rate_parameters, 0);
-	}
+		case rf_constant:
+		{
+			rate = gsl_vector_get(rate_parameters, 0);
+			break;
+		}
 
-	// Force-dependent
-	if (!strcmp(rate_type, "force_dependent"))
-	{
-		rate = gsl_vector_get(rate_parameters, 0) *
-			(1.0 + (gsl_max(force, 0.0) * gsl_vector_get(rate_parameters, 1)));
-	}
+		case rf_force_dependent:
+		{
+			rate = gsl_vector_get(rate_parameters, 0) *
+				(1.0 + (gsl_max(force, 0.0) * gsl_vector_get(rate_parameters, 1)));
+			break;
+		}
 
-	// Gaussian
-	if (!strcmp(rate_type, "gaussian"))
-	{
-		rate = gsl_vector_get(rate_parameters, 0) *
-			exp(-(0.5 * k_cb * gsl_pow_int(x, 2)) /
-				(1e18 * GSL_CONST_MKSA_BOLTZMANN * temperature_K));
-	}
+		case rf_gaussian:
+		{
+			rate = gsl_vector_get(rate_parameters, 0) *
+				exp(-(0.5 * k_cb * gsl_pow_int(x, 2)) /
+					(1e18 * GSL_CONST_MKSA_BOLTZMANN * temperature_K));
+			break;
+		}
 
-	// Gaussian_hsl
-	if (!strcmp(rate_type, "gaussian_hsl"))
-	{
-		// Distance between surface of thick and thin filaments is
-		// (2/3)*d_1,0 - r_thin - r_thick
-		// Assume d_1_0 at hsl = 1100 nm is 37 nm, r_thin = 5.5 nm, t_thick = 7.5 nm
-		// d at hsl = x is (2/3) * (37 / sqrt(x/1100)) - 5/5 - 7.5
-		// first passage time to position y is t = y^2 / (2*D)
-		// rate is proportional to 1/t
-		// rate at hsl == x is ref_rate * (y_ref / y_x)^2
-		// See PMID 35450825 and first passage in
-		// Mechanics of motor proteins and the cytoskeleton, Joe Howard book
-
-		double y_ref;		// distance between filaments at 1100 nm
-		double y_actual;	// distance between filaments at current hsl
-		double r_thick = 7.5;
-		double r_thin = 5.5;
-
-		y_ref = ((2.0 / 3.0) * 37.0) - r_thick - r_thin;
-
-		if (gsl_isnan(hs_length))
-			hs_length = 1100.0;
-
-		y_actual = (2.0 / 3.0) * (37.0 / sqrt(hs_length / 1100.0)) - r_thick - r_thin;
-
-		rate = gsl_vector_get(rate_parameters, 0) *
-			exp(-(0.5 * k_cb * gsl_pow_int(x, 2)) /
-				(1e18 * GSL_CONST_MKSA_BOLTZMANN * temperature_K));
+		case rf_gaussian_hsl:
+		{
+			rate = gsl_vector_get(rate_parameters, 0) *
+				exp(-(0.5 * k_cb * gsl_pow_int(x, 2)) /
+					(1e18 * GSL_CONST_MKSA_BOLTZMANN * temperature_K));
 
-		rate = rate * gsl_pow_2(y_ref / y_actual);
-	}
+			rate = rate * hsl_rate_factor(hs_length);
+			break;
+		}
 
-	// Poly
-	if (!strcmp(rate_type, "poly"))
-	{
-		double x_center = gsl_vector_get(rate_parameters, 3); // optional parameter defining the zero of the polynomial
+		case rf_poly:
+		{
+			double x_center = gsl_vector_get(rate_parameters, 3); // optional parameter defining the zero of the polynomial
 
-		if (gsl_isnan(x_center)) { // optional parameter is not specified, use the state extension instead
-			x_center = x_ext;
-		}	
+			if (gsl_isnan(x_center)) { // optional parameter is not specified, use the state extension instead
+				x_center = x_ext;
+			}
 
-		rate = gsl_vector_get(rate_parameters, 0) +
+			rate = gsl_vector_get(rate_parameters, 0) +
 				(gsl_vector_get(rate_parameters, 1) *
 					gsl_pow_int(x + x_center, (int)gsl_vector_get(rate_parameters, 2)));
-
-	}
-
-	// Poly_asymmetric
-	if (!strcmp(rate_type, "poly_asym"))
-	{
-		double x_center = gsl_vector_get(rate_parameters, 5); // optional parameter defining the zero of the polynomial
-
-		if (gsl_isnan(x_center)) { // optional parameter is not specified, use the state extension instead
-			x_center = x_ext;
+			break;
 		}
 
-		if (x > x_center)
-			rate = gsl_vector_get(rate_parameters, 0) +
-				(gsl_vector_get(rate_parameters, 1) *
-					gsl_pow_int(x + x_center, (int)gsl_vector_get(rate_parameters, 3)));
-		else
-			rate = gsl_vector_get(rate_parameters, 0) +
-			(gsl_vector_get(rate_parameters, 2) *
-				gsl_pow_int(x + x_center, (int)gsl_vector_get(rate_parameters, 4)));
-	}
+		case rf_poly_asym:
+		{
+			double x_center = gsl_vector_get(rate_parameters, 5); // optional parameter defining the zero of the polynomial
+
+			if (gsl_isnan(x_center)) { // optional parameter is not specified, use the state extension instead
+				x_center = x_ext;
+			}
+
+			if (x > x_center)
+				rate = gsl_vector_get(rate_parameters, 0) +
+					(gsl_vector_get(rate_parameters, 1) *
+						gsl_pow_int(x + x_center, (int)gsl_vector_get(rate_parameters, 3)));
+			else
+				rate = gsl_vector_get(rate_parameters, 0) +
+					(gsl_vector_get(rate_parameters, 2) *
+						gsl_pow_int(x + x_center, (int)gsl_vector_get(rate_parameters, 4)));
+			break;
+		}
 
-	if (!strcmp(rate_type, "exp_wall"))
-	{
-		// Variables
-
-		double k0 = gsl_vector_get(rate_parameters, 0);
-		double F = k_cb * (x + x_ext);
-		double d = gsl_vector_get(rate_parameters, 1);
-		double x_wall = gsl_vector_get(rate_parameters, 2);
-		double x_smooth = gsl_vector_get(rate_parameters, 3);
-		double wall = p_cmv_options->max_rate * (1 /
-			(1 + exp(-x_smooth * (x - x_wall))));
-
-		// Code
-		rate = k0 * exp(-(F * d) /
+		case rf_exp_wall:
+		{
+			// Variables
+			double k0 = gsl_vector_get(rate_parameters, 0);
+			double F = k_cb * (x + x_ext);
+			double d = gsl_vector_get(rate_parameters, 1);
+			double x_wall = gsl_vector_get(rate_parameters, 2);
+			double x_smooth = gsl_vector_get(rate_parameters, 3);
+			double wall = p_cmv_options->max_rate * (1 /
+				(1 + exp(-x_smooth * (x - x_wall))));
+
+			// Code
+			rate = k0 * exp(-(F * d) /
 				(1e18 * GSL_CONST_MKSA_BOLTZMANN * temperature_K));
 
-		rate = GSL_MAX(rate, wall);
+			rate = GSL_MAX(rate, wall);
+			break;
+		}
+
+		default:
+			break;
 	}
 
 	// Curtail at max rate
@@ -216,7 +268,178 @@ double transition::calculate_rate(double x, double x_ext, double force, double h
 
 	if (rate < 0.0)
 		rate = 0.0;
-	
+
 	// Return
 	return rate;
 }
+
+static double int_power(double base, int n)
+{
+	//! Returns base^n for a small non-negative integer n
+	//! Written as a simple product so that it can be inlined in
+	//! vectorized loops
+
+	// Variables
+	double holder = 1.0;
+
+	// Code
+	for (int i = 0; i < n; i++)
+	{
+		holder = holder * base;
+	}
+
+	return holder;
+}
+
+static double clamp_rate(double rate, double max_rate)
+{
+	//! Returns the rate held between 0 and max_rate, in the same way as
+	//! calculate_rate(), so a NaN stays a NaN rather than becoming
+	//! max_rate as it would with fmin and fmax
+
+	// Code
+	return ((rate > max_rate) ? max_rate : ((rate < 0.0) ? 0.0 : rate));
+}
+
+void transition::calculate_rates(const double x[], double rates[], int no_of_bins,
+	double x_ext, double force, double hs_length)
+{
+	//! Fills rates[] with the rate at each position in x[]
+	//! Matches calculate_rate() but hoists the parameters and constants
+	//! out of the bin loop, and keeps each loop free of branches and
+	//! function calls other than exp() so that it vectorizes
+
+	// Variables
+	double k_cb = p_cmv_model->myof_k_cb;
+
+	double kT = 1e18 * GSL_CONST_MKSA_BOLTZMANN * p_cmv_model->temperature_K;
+
+	double max_rate = GSL_POSINF;
+
+	double p0 = gsl_vector_get(rate_parameters, 0);
+
+	// Code
+
+	if (p_cmv_options != NULL)
+		max_rate = p_cmv_options->max_rate;
+
+	switch (rate_function)
+	{
+		case rf_constant:
+		{
+			double rate = clamp_rate(p0, max_rate);
+
+			for (int i = 0; i < no_of_bins; i++)
+				rates[i] = rate;
+			break;
+		}
+
+		case rf_force_dependent:
+		{
+			double rate = p0 * (1.0 + (gsl_max(force, 0.0) * gsl_vector_get(rate_parameters, 1)));
+
+			rate = clamp_rate(rate, max_rate);
+
+			for (int i = 0; i < no_of_bins; i++)
+				rates[i] = rate;
+			break;
+		}
+
+		case rf_gaussian:
+		case rf_gaussian_hsl:
+		{
+			double c = (0.5 * k_cb) / kT;
+			double k = p0;
+
+			if (rate_function == rf_gaussian_hsl)
+				k = p0 * hsl_rate_factor(hs_length);
+
+			for (int i = 0; i < no_of_bins; i++)
+				rates[i] = -c * x[i] * x[i];
+
+			for (int i = 0; i < no_of_bins; i++)
+				rates[i] = exp(rates[i]);
+
+			for (int i = 0; i < no_of_bins; i++)
+				rates[i] = clamp_rate(k * rates[i], max_rate);
+			break;
+		}
+
+		case rf_poly:
+		{
+			double p1 = gsl_vector_get(rate_parameters, 1);
+			int n = (int)gsl_vector_get(rate_parameters, 2);
+			double x_center = gsl_vector_get(rate_parameters, 3);
+
+			if (gsl_isnan(x_center))
+				x_center = x_ext;
+
+			if (n < 0)
+			{
+				// Fall back to the reference version for negative powers
+				for (int i = 0; i < no_of_bins; i++)
+					rates[i] = calculate_rate(x[i], x_ext, force, hs_length);
+				break;
+			}
+
+			for (int i = 0; i < no_of_bins; i++)
+			{
+				double rate = p0 + (p1 * int_power(x[i] + x_center, n));
+				rates[i] = clamp_rate(rate, max_rate);
+			}
+			break;
+		}
+
+		case rf_poly_asym:
+		{
+			double p1 = gsl_vector_get(rate_parameters, 1);
+			double p2 = gsl_vector_get(rate_parameters, 2);
+			int n_hi = (int)gsl_vector_get(rate_parameters, 3);
+			int n_lo = (int)gsl_vector_get(rate_parameters, 4);
+			double x_center = gsl_vector_get(rate_parameters, 5);
+
+			if (gsl_isnan(x_center))
+				x_center = x_ext;
+
+			if ((n_hi < 0) || (n_lo < 0))
+			{
+				for (int i = 0; i < no_of_bins; i++)
+					rates[i] = calculate_rate(x[i], x_ext, force, hs_length);
+				break;
+			}
+
+			for (int i = 0; i < no_of_bins; i++)
+			{
+				double hi = p0 + (p1 * int_power(x[i] + x_center, n_hi));
+				double lo = p0 + (p2 * int_power(x[i] + x_center, n_lo));
+				double rate = (x[i] > x_center) ? hi : lo;
+				rates[i] = clamp_rate(rate, max_rate);
+			}
+			break;
+		}
+
+		case rf_exp_wall:
+		{
+			double d = gsl_vector_get(rate_parameters, 1);
+			double x_wall = gsl_vector_get(rate_parameters, 2);
+			double x_smooth = gsl_vector_get(rate_parameters, 3);
+			double wall_max = p_cmv_options->max_rate;
+			double c = (k_cb * d) / kT;
+
+			for (int i = 0; i < no_of_bins; i++)
+			{
+				double rate = p0 * exp(-c * (x[i] + x_ext));
+				double wall = wall_max / (1.0 + exp(-x_smooth * (x[i] - x_wall)));
+				rates[i] = clamp_rate(((rate > wall) ? rate : wall), max_rate);
+			}
+			break;
+		}
+
+		default:
+		{
+			for (int i = 0; i < no_of_bins; i++)
+				rates[i] = 0.0;
+			break;
+		}
+	}
+}
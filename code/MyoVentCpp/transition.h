@@ -19,6 +19,21 @@ class half_sarcomere;
 class cmv_model;
 class cmv_options;
 
+// Rate functions, resolved from the rate_type string when the
+// transition is loaded so that rates can be calculated without
+// string comparisons
+enum rate_function_type
+{
+	rf_undefined,
+	rf_constant,
+	rf_force_dependent,
+	rf_gaussian,
+	rf_gaussian_hsl,
+	rf_poly,
+	rf_poly_asym,
+	rf_exp_wall
+};
+
 class transition
 {
 public:
@@ -35,12 +50,22 @@ public:
 
 	char rate_type[_MAX_PATH];		/**< char array defining the transition type */
 
+	rate_function_type rate_function;
+									/**< enum with the rate function deduced
+											from rate_type */
+
 	char transition_type;			/**< char defining 'a' attachment, 'd' detachment, 'n' neutral */
 
 	char ATP_required;				/**< char with 'y' if ATP is required for the transition */
 
 	gsl_vector* rate_parameters;	/**< gsl_vector holding parameter variables */
 
+	bool rate_depends_on_force;		/**< bool, true if the rate changes with
+											hs_stress */
+
+	bool rate_depends_on_hs_length;	/**< bool, true if the rate changes with
+											hs_length */
+
 	// Functions
 
 	// Constructor
@@ -76,4 +101,22 @@ public:
 	*/
 
 	double calculate_rate(double, double, double force=0.0, double = GSL_NAN);
+
+	/**
+	* void calculate_rates(const double x[], double rates[], int no_of_bins,
+	*						double x_ext, double force, double hs_length)
+	* fills rates[] with the rate at each of the no_of_bins positions in x[]
+	* gives the same values as calculate_rate() but works on all the bins
+	* in a single pass with loops the compiler can vectorize
+	* @return void
+	*/
+	void calculate_rates(const double x[], double rates[], int no_of_bins,
+		double x_ext, double force = 0.0, double hs_length = GSL_NAN);
+
+	/**
+	* void set_rate_function(void)
+	* sets rate_function and the dependency flags from rate_type
+	* @return void
+	*/
+	void set_rate_function(void);
 };
@@ -0,0 +1,105 @@
+/**
+/* @file		update_schedule.cpp
+/* @brief		Source file for an update_schedule object
+/* @author		Ken Campbell
+*/
+
+#include "stdio.h"
+
+#include <iostream>
+
+#include "update_schedule.h"
+
+using namespace::std;
+
+// Constructor
+update_schedule::update_schedule(string set_module_name, string set_cadence, int set_n_steps)
+{
+	// Initialise
+
+	// Code
+	us_module_name = set_module_name;
+	us_cadence = set_cadence;
+	us_n_steps = set_n_steps;
+
+	if (us_cadence == "every_step")
+		us_cadence_type = uc_every_step;
+	else if (us_cadence == "every_n_steps")
+		us_cadence_type = uc_every_n_steps;
+	else if (us_cadence == "every_beat")
+		us_cadence_type = uc_every_beat;
+	else
+	{
+		cout << "Update cadence " << us_cadence << " for " << us_module_name <<
+			" not recognised\n";
+		exit(1);
+	}
+
+	if ((us_cadence_type == uc_every_n_steps) && (us_n_steps < 1))
+	{
+		cout << "Update schedule for " << us_module_name << " needs n_steps >= 1\n";
+		exit(1);
+	}
+
+	us_steps_since_update = 0;
+	us_elapsed_s = 0.0;
+	us_time_step_s = 0.0;
+	us_beat_pending = false;
+	us_new_beat = false;
+	us_first_step = true;
+
+	cout << "Update schedule for " << us_module_name << ": " << us_cadence;
+	if (us_cadence_type == uc_every_n_steps)
+		cout << " (" << us_n_steps << ")";
+	cout << "\n";
+}
+
+// Destructor
+update_schedule::~update_schedule(void)
+{
+	// Destructor
+}
+
+// Other functions
+
+bool update_schedule::advance(double time_step_s, bool new_beat)
+{
+	//! Function adds a time-step to the schedule and returns true if the
+	//! module is due an update
+	//! us_time_step_s and us_new_beat are then set for that update,
+	//! covering every time-step since the previous one
+
+	// Variables
+	bool due = false;
+
+	// Code
+	us_steps_since_update = us_steps_since_update + 1;
+	us_elapsed_s = us_elapsed_s + time_step_s;
+	us_beat_pending = (us_beat_pending || new_beat);
+
+	if ((us_cadence_type == uc_every_step) || (us_first_step))
+	{
+		due = true;
+	}
+	else if (us_cadence_type == uc_every_n_steps)
+	{
+		due = (us_steps_since_update >= us_n_steps);
+	}
+	else
+	{
+		due = new_beat;
+	}
+
+	if (due)
+	{
+		us_time_step_s = us_elapsed_s;
+		us_new_beat = us_beat_pending;
+
+		us_steps_since_update = 0;
+		us_elapsed_s = 0.0;
+		us_beat_pending = false;
+		us_first_step = false;
+	}
+
+	return due;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+/**
+/* @file		update_schedule.h
+/* @brief		Header file for an update_schedule object
+/* @author		Ken Campbell
+*/
+
+#include "stdio.h"
+
+#include <iostream>
+
+#include "global_definitions.h"
+
+using namespace::std;
+
+// Cadences, resolved from the cadence string in the constructor so that
+// the schedule can be advanced without string comparisons
+enum update_cadence_type
+{
+	uc_every_step,
+	uc_every_n_steps,
+	uc_every_beat
+};
+
+class update_schedule
+{
+public:
+	/**
+	 * Constructor
+	 */
+	update_schedule(string set_module_name, string set_cadence, int set_n_steps);
+
+	/**
+	 * Destructor
+	 */
+	 ~update_schedule(void);
+
+	 // Variables
+	 string us_module_name;					/**< string with the name of the
+													module, used for messages */
+
+	 string us_cadence;						/**< string defining when the module
+													is updated, every_step,
+													every_n_steps or every_beat */
+
+	 update_cadence_type us_cadence_type;	/**< enum with the cadence deduced
+													from us_cadence */
+
+	 int us_n_steps;						/**< integer with the number of
+													time-steps between updates for
+													every_n_steps */
+
+	 int us_steps_since_update;				/**< integer with the number of
+													time-steps since the last
+													update */
+
+	 double us_elapsed_s;					/**< double with the time in s since
+													the last update */
+
+	 double us_time_step_s;					/**< double with the time-step in s
+													for the current update, the
+													time since the previous one */
+
+	 bool us_beat_pending;					/**< bool, true if a beat started
+													since the last update */
+
+	 bool us_new_beat;						/**< bool, true if a beat started
+													between the previous update and
+													the current one */
+
+	 bool us_first_step;					/**< bool, true until the first
+													update so that every module
+													is updated on the first
+													time-step */
+
+	 // Functions
+
+	 bool advance(double time_step_s, bool new_beat);
+};
@@ -11,6 +11,8 @@
 #include "valve.h"
 #include "hemi_vent.h"
 #include "circulation.h"
+#include "cmv_options.h"
+#include "cmv_protocol.h"
 #include "cmv_results.h"
 #include "membranes.h"
 #include "myofilaments.h"
@@ -29,6 +31,10 @@ struct cmv_model_valve_structure {
 	double leak;
 };
 
+// Forward declaration of the function used by the GSL ODE system, so that
+// initialise_simulation can build the persistent driver
+int valve_derivs(double t, const double y[], double f[], void* params);
+
 // Constructor
 valve::valve(hemi_vent* set_p_parent_hemi_vent, cmv_model_valve_structure* set_p_cmv_model_structure)
 {
@@ -43,6 +49,11 @@ valve::valve(hemi_vent* set_p_parent_hemi_vent, cmv_model_valve_structure* set_p
 	// Set safe values
 	p_cmv_options = NULL;
 	p_cmv_results_beat = NULL;
+	p_valve_ode_driver = NULL;
+	valve_from_compartment = -1;
+	valve_to_compartment = -1;
+	valve_n_fallbacks = 0;
+	valve_report_counters = false;
 
 	// Update from cmv_model
 	p_cmv_model_valve = set_p_cmv_model_structure;
@@ -65,7 +76,12 @@ valve::~valve(void)
 
 	// Code
 
+	if (valve_report_counters)
+		cout << valve_name << " valve steps integrated numerically: " << valve_n_fallbacks << "\n";
+
 	// Tidy up
+	if (p_valve_ode_driver != NULL)
+		gsl_odeiv2_driver_free(p_valve_ode_driver);
 }
 
 // Other functions
@@ -75,12 +91,20 @@ void valve::initialise_simulation(void)
 	
 	// Variables
 	string label_string;
+
+	double eps_abs = 1e-6;
+	double eps_rel = 1e-6;
+
+	circulation* p_circ = p_parent_hemi_vent->p_parent_circulation;
 	
 	// Code
 
 	// Set options from parent
 	p_cmv_options = p_parent_hemi_vent->p_cmv_options;
 
+	// The options are deleted before the destructor runs
+	valve_report_counters = (p_cmv_options->report_counters == "True");
+
 	// Set results from parent
 	p_cmv_results_beat = p_parent_hemi_vent->p_cmv_results_beat;
 
@@ -88,6 +112,30 @@ void valve::initialise_simulation(void)
 	label_string = valve_name + "_valve_pos";
 
 	p_cmv_results_beat->add_results_field(label_string, &valve_pos);
+
+	// Find the compartments either side of the valve
+	for (int e = 0; e < p_circ->circ_no_of_edges; e++)
+	{
+		if (p_circ->p_edge_valve[e] == this)
+		{
+			valve_from_compartment = p_circ->circ_edge_from[e];
+			valve_to_compartment = p_circ->circ_edge_to[e];
+		}
+	}
+
+	if (valve_from_compartment < 0)
+	{
+		cout << "Error: " << valve_name << " valve is not on a circulation edge\n";
+		exit(1);
+	}
+
+	// Create the ODE driver once, it is reset when it is needed
+	valve_ode_system = { valve_derivs, NULL, 2, this };
+
+	p_valve_ode_driver = gsl_odeiv2_driver_alloc_y_new(&valve_ode_system,
+		gsl_odeiv2_step_rkf45,
+		0.5 * p_parent_hemi_vent->p_parent_circulation->p_cmv_protocol->time_step_s,
+		eps_abs, eps_rel);
 }
 
 // This function is not a member of the valve class but is used to interace
@@ -106,30 +154,15 @@ int valve_derivs(double t, const double y[], double f[], void* params)
 
 	circulation* p_circ = p_valve->p_parent_hemi_vent->p_parent_circulation;
 
-	double pressure_difference = GSL_NAN;
+	double pressure_difference;
 
 	// Code
 
 	// y[0] is the position of the valve
 	// y[1] is the velocity
 
-	if (p_valve->valve_name == "aortic")
-	{
-		pressure_difference = p_circ->circ_pressure[0] - p_circ->circ_pressure[1];
-		//cout << "pd: " << pressure_difference << "\n";
-	}
-
-	if (p_valve->valve_name == "mitral")
-	{
-		pressure_difference = p_circ->circ_pressure[p_circ->circ_no_of_compartments - 1] - p_circ->circ_pressure[0];
-		//cout << "pd: " << pressure_difference << "\n";
-	}
-
-	if (gsl_isnan(pressure_difference))
-	{
-		cout << "Pressure difference not defined for valve\n";
-		exit(1);
-	}
+	pressure_difference = p_circ->circ_pressure[p_valve->valve_from_compartment] -
+		p_circ->circ_pressure[p_valve->valve_to_compartment];
 
 	f[0] = y[1];
 	f[1] = (1.0 / p_valve->valve_mass) *
@@ -143,43 +176,238 @@ int valve_derivs(double t, const double y[], double f[], void* params)
 void valve::implement_time_step(double time_step_s)
 {
 	//! Implements time-step
+	//! The pressure difference is constant over the step, so the valve is
+	//! a damped oscillator with a closed-form solution. The limits are
+	//! imposed at the end of the step, which matches stopping the valve
+	//! when it reaches a stop unless it would have moved back off the
+	//! stop before the end of the step. Those steps, and valves without
+	//! a positive mass and stiffness, are integrated numerically in
+	//! sub-steps with the limits imposed after each one
 	
 	// Variables
-
-	double eps_abs = 1e-6;
-	double eps_rel = 1e-6;
-
 	int status;
 
+	int no_of_sub_steps = 10;
+
 	double t_start_s = 0.0;
-	double t_stop_s = time_step_s;
+	double t_stop_s;
+
+	double y_calc[2];
+
+	double pressure_difference;
+
+	circulation* p_circ = p_parent_hemi_vent->p_parent_circulation;
+
+	// Code
+
+	pressure_difference = p_circ->circ_pressure[valve_from_compartment] -
+		p_circ->circ_pressure[valve_to_compartment];
+
+	if ((valve_mass > 0.0) && (valve_k > 0.0) &&
+		(!free_motion_returns_from_stop(pressure_difference, time_step_s)))
+	{
+		return_free_state(pressure_difference, time_step_s, &valve_pos, &valve_vel);
+
+		impose_limits();
+
+		return;
+	}
+
+	valve_n_fallbacks = valve_n_fallbacks + 1;
+
+	gsl_odeiv2_driver_reset_hstart(p_valve_ode_driver, 0.5 * time_step_s / no_of_sub_steps);
+
+	for (int i = 1; i <= no_of_sub_steps; i++)
+	{
+		// Fill y_calc
+		y_calc[0] = valve_pos;
+		y_calc[1] = valve_vel;
+
+		t_stop_s = i * time_step_s / no_of_sub_steps;
 
-	double* y_calc = NULL;
+		status = gsl_odeiv2_driver_apply(p_valve_ode_driver, &t_start_s, t_stop_s, y_calc);
+
+		// Unpack
+		valve_pos = y_calc[0];
+		valve_vel = y_calc[1];
+
+		impose_limits();
+	}
+}
+
+void valve::return_free_state(double pressure_difference, double t,
+	double* p_pos, double* p_vel)
+{
+	//! Function returns the position and velocity of the valve t s after
+	//! the start of the step, ignoring the limits
+	//! With u the distance from equilibrium, m u'' + eta u' + k u = 0
+	//! and u(t) depends on the sign of (eta / 2m)^2 - k / m
+
+	// Variables
+	double x_eq = pressure_difference / valve_k;
+
+	double a = 0.5 * valve_eta / valve_mass;
+	double w0_sq = valve_k / valve_mass;
+	double disc = (a * a) - w0_sq;
+
+	double u0 = valve_pos - x_eq;
+	double v0 = valve_vel;
+
+	double u;
+	double v;
+
+	double w;
+	double s1;
+	double s2;
+	double c1;
+	double c2;
+	double e1;
+	double e2;
+
+	// Code
+	if (fabs(disc) <= (1e-12 * ((a * a) + w0_sq)))
+	{
+		// Critically damped
+		c2 = v0 + (a * u0);
+		e1 = exp(-a * t);
+
+		u = (u0 + (c2 * t)) * e1;
+		v = (v0 - (a * c2 * t)) * e1;
+	}
+	else if (disc < 0.0)
+	{
+		// Under-damped
+		w = sqrt(-disc);
+		c2 = (v0 + (a * u0)) / w;
+		e1 = exp(-a * t);
+
+		u = e1 * ((u0 * cos(w * t)) + (c2 * sin(w * t)));
+		v = e1 * ((v0 * cos(w * t)) - (((a * c2) + (w * u0)) * sin(w * t)));
+	}
+	else
+	{
+		// Over-damped, s1 is written to avoid cancellation when a >> w0
+		w = sqrt(disc);
+		s1 = -w0_sq / (a + w);
+		s2 = -a - w;
+
+		c1 = (v0 - (s2 * u0)) / (s1 - s2);
+		c2 = u0 - c1;
+		e1 = exp(s1 * t);
+		e2 = exp(s2 * t);
+
+		u = (c1 * e1) + (c2 * e2);
+		v = (c1 * s1 * e1) + (c2 * s2 * e2);
+	}
+
+	*p_pos = x_eq + u;
+	*p_vel = v;
+}
+
+bool valve::free_motion_returns_from_stop(double pressure_difference, double time_step_s)
+{
+	//! Function returns true if the free motion of the valve passes one
+	//! of its limits during the step and finishes between them, so that
+	//! imposing the limits at the end of the step would miss the contact
+	//! The furthest excursions are where the velocity is zero
+
+	// Variables
+	double a = 0.5 * valve_eta / valve_mass;
+	double w0_sq = valve_k / valve_mass;
+	double disc = (a * a) - w0_sq;
+
+	double u0 = valve_pos - (pressure_difference / valve_k);
+	double v0 = valve_vel;
+
+	double t_ext[3];
+	int no_of_ext = 0;
+
+	double w;
+	double s1;
+	double s2;
+	double c1;
+	double c2;
+	double delta;
+	double ratio;
+	double theta;
+
+	double pos;
+	double vel;
+
+	bool passes_limit = false;
 
 	// Code
 
-	// Allocate memory for y
-	y_calc = (double*)malloc(2 * sizeof(double));
+	// Where does the valve finish
+	return_free_state(pressure_difference, time_step_s, &pos, &vel);
 
-	// Fill y_calc
-	y_calc[0] = valve_pos;
-	y_calc[1] = valve_vel;
+	if ((pos > 1.0) || (pos < valve_leak))
+		return false;
 
-	gsl_odeiv2_system sys = { valve_derivs, NULL, 2, this };
+	// Find the times inside the step where the velocity is zero
+	if (fabs(disc) <= (1e-12 * ((a * a) + w0_sq)))
+	{
+		c2 = v0 + (a * u0);
+		if ((a * c2) != 0.0)
+			t_ext[no_of_ext++] = v0 / (a * c2);
+	}
+	else if (disc < 0.0)
+	{
+		// v is proportional to R cos(w t - delta), the zeros are pi / w apart
+		w = sqrt(-disc);
+		c2 = (v0 + (a * u0)) / w;
+		delta = atan2(-((a * c2) + (w * u0)), v0);
+
+		theta = fmod(delta + (0.5 * M_PI), M_PI);
+		if (theta <= 0.0)
+			theta = theta + M_PI;
+
+		while ((theta < (w * time_step_s)) && (no_of_ext < 3))
+		{
+			t_ext[no_of_ext++] = theta / w;
+			theta = theta + M_PI;
+		}
+
+		// More than two turns in a step, leave it to the integrator
+		if (theta < (w * time_step_s))
+			return true;
+	}
+	else
+	{
+		w = sqrt(disc);
+		s1 = -w0_sq / (a + w);
+		s2 = -a - w;
+
+		c1 = (v0 - (s2 * u0)) / (s1 - s2);
+		c2 = u0 - c1;
+
+		if ((c1 * s1) != 0.0)
+		{
+			ratio = -(c2 * s2) / (c1 * s1);
+			if (ratio > 0.0)
+				t_ext[no_of_ext++] = log(ratio) / (s1 - s2);
+		}
+	}
 
-	gsl_odeiv2_driver* d =
-		gsl_odeiv2_driver_alloc_y_new(&sys, gsl_odeiv2_step_rkf45,
-			0.5 * time_step_s, eps_abs, eps_rel);
+	for (int i = 0; i < no_of_ext; i++)
+	{
+		if ((t_ext[i] > 0.0) && (t_ext[i] < time_step_s))
+		{
+			return_free_state(pressure_difference, t_ext[i], &pos, &vel);
 
-	status = gsl_odeiv2_driver_apply(d, &t_start_s, t_stop_s, y_calc);
+			if ((pos > 1.0) || (pos < valve_leak))
+				passes_limit = true;
+		}
+	}
 
-	gsl_odeiv2_driver_free(d);
+	return passes_limit;
+}
 
-	// Unpack
-	valve_pos = y_calc[0];
-	valve_vel = y_calc[1];
+void valve::impose_limits(void)
+{
+	//! Holds the valve between its leak position and fully open
 
-	// Bounds
+	// Code
 	if (valve_pos > 1.0)
 	{
 		valve_pos = 1.0;
@@ -191,7 +419,4 @@ void valve::implement_time_step(double time_step_s)
 		valve_pos = valve_leak;
 		valve_vel = 0.0;
 	}
-
-	// Tidy up
-	free(y_calc);
 }
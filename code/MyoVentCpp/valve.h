@@ -12,6 +12,8 @@
 
 #include "global_definitions.h"
 
+#include "gsl_odeiv2.h"
+
 // Forward declararations
 class cmv_system;
 class cmv_model;
@@ -67,7 +69,37 @@ public:
 															0 if doesn't leak
 															<0 if it does */
 
+	gsl_odeiv2_system valve_ode_system;				/**< gsl_odeiv2_system wrapping
+															valve_derivs */
+
+	gsl_odeiv2_driver* p_valve_ode_driver;			/**< Pointer to a gsl_odeiv2_driver
+															created in
+															initialise_simulation and
+															used for steps where the
+															valve reaches a stop and
+															moves back */
+
+	int valve_from_compartment;						/**< Integer with the compartment
+															upstream of the valve, set
+															from its circulation edge */
+
+	int valve_to_compartment;						/**< Integer with the compartment
+															downstream of the valve */
+
+	long long valve_n_fallbacks;					/**< Number of steps integrated
+															numerically */
+
+	bool valve_report_counters;						/**< True if the counter is
+															printed by the destructor */
+
 	void initialise_simulation(void);
 	
 	void implement_time_step(double time_step_s);
+
+	void impose_limits(void);
+
+	void return_free_state(double pressure_difference, double t,
+			double* p_pos, double* p_vel);
+
+	bool free_motion_returns_from_stop(double pressure_difference, double time_step_s);
 };
\ No newline at end of file
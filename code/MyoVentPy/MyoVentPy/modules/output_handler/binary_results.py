@@ -0,0 +1,166 @@
+# -*- coding: utf-8 -*-
+"""
+Reader for the indexed binary results written by MyoVentCpp
+
+The layout is described in results_writer::write_binary_header.
+Everything is little-endian.
+"""
+
+import struct
+
+import numpy as np
+import pandas as pd
+
+from . import time_series_codec
+
+BINARY_MAGIC = b'MVRESBIN'
+BINARY_VERSION = 2
+HEADER_FORMAT = '<8sIIIIQIiddQ'
+HEADER_V2_FORMAT = '<II'
+INDEX_ENTRY_FORMAT = '<QQddQ'
+CODEC_NONE = 0
+CODEC_LOSSLESS = 1
+
+
+def is_binary_results_file(file_string):
+    """ Returns True if the file starts with the binary results magic """
+
+    with open(file_string, 'rb') as f:
+        return (f.read(len(BINARY_MAGIC)) == BINARY_MAGIC)
+
+
+def read_binary_header(file_string):
+    """ Returns a dict with the header, the fields and the chunk index """
+
+    with open(file_string, 'rb') as f:
+        return _read_header(f)
+
+
+def read_binary_results(file_string, fields=None, t_start=None, t_stop=None):
+    """ Returns a pandas DataFrame with the selected fields
+
+        fields is a list of field names, all of them if None.
+        t_start and t_stop limit the rows to a time window, and only
+        the chunks that overlap the window are read. """
+
+    with open(file_string, 'rb') as f:
+        header = _read_header(f)
+
+        if fields is None:
+            fields = header['fields']
+        for fn in fields:
+            if fn not in header['fields']:
+                raise ValueError('Field %s is not in %s' % (fn, file_string))
+
+        dtype = np.dtype('<f8') if (header['value_bytes'] == 8) \
+            else np.dtype('<f4')
+
+        have_time = ('time' in header['fields'])
+        if t_start is None:
+            t_start = -np.inf
+        if t_stop is None:
+            t_stop = np.inf
+
+        columns = {fn: [] for fn in fields}
+
+        for chunk in header['chunks']:
+            if have_time and ((chunk['t_last'] < t_start) or
+                              (chunk['t_first'] > t_stop)):
+                continue
+
+            n = chunk['no_of_time_points']
+
+            if have_time:
+                t = _read_chunk_field(f, header, chunk,
+                                      header['fields'].index('time'), dtype)
+                keep = (t >= t_start) & (t <= t_stop)
+            else:
+                keep = np.ones(n, dtype=bool)
+
+            for fn in fields:
+                values = _read_chunk_field(f, header, chunk,
+                                           header['fields'].index(fn), dtype)
+                columns[fn].append(values[keep])
+
+    data = {}
+    for fn in fields:
+        if columns[fn]:
+            data[fn] = np.concatenate(columns[fn]).astype(np.float64)
+        else:
+            data[fn] = np.zeros(0)
+
+    return pd.DataFrame(data, columns=fields)
+
+
+def _read_header(f):
+    """ Reads the header, fields and index from an open file """
+
+    header_bytes = f.read(struct.calcsize(HEADER_FORMAT))
+    (magic, version, value_bytes, no_of_fields, chunk_time_points,
+     no_of_time_points, no_of_chunks, system_id, time_step_s,
+     sim_time_step_s, index_offset) = struct.unpack(HEADER_FORMAT,
+                                                    header_bytes)
+
+    if (magic != BINARY_MAGIC):
+        raise ValueError('Not a binary results file')
+    if (version not in (1, BINARY_VERSION)):
+        raise ValueError('Binary results version %i, expected 1 to %i' %
+                         (version, BINARY_VERSION))
+
+    # Version 1 files have no codec
+    codec = CODEC_NONE
+    if (version == BINARY_VERSION):
+        (codec, _) = struct.unpack(HEADER_V2_FORMAT, f.read(
+            struct.calcsize(HEADER_V2_FORMAT)))
+
+    field_names = []
+    field_units = []
+    for i in range(no_of_fields):
+        for target in [field_names, field_units]:
+            (length,) = struct.unpack('<I', f.read(4))
+            target.append(f.read(length).decode('utf-8'))
+
+    f.seek(index_offset)
+    chunks = []
+    entry_bytes = struct.calcsize(INDEX_ENTRY_FORMAT)
+    for c in range(no_of_chunks):
+        (first, n, t_first, t_last, offset) = \
+            struct.unpack(INDEX_ENTRY_FORMAT, f.read(entry_bytes))
+        chunks.append({'first_time_point': first,
+                       'no_of_time_points': n,
+                       't_first': t_first,
+                       't_last': t_last,
+                       'offset': offset})
+
+    return {'value_bytes': value_bytes,
+            'codec': codec,
+            'no_of_fields': no_of_fields,
+            'chunk_time_points': chunk_time_points,
+            'no_of_time_points': no_of_time_points,
+            'system_id': system_id,
+            'time_step_s': time_step_s,
+            'sim_time_step_s': sim_time_step_s,
+            'fields': field_names,
+            'units': field_units,
+            'chunks': chunks}
+
+
+def _read_chunk_field(f, header, chunk, field_index, dtype):
+    """ Reads one field of a chunk, which is stored contiguously """
+
+    n = chunk['no_of_time_points']
+
+    if (header['codec'] == CODEC_LOSSLESS):
+        # The chunk starts with the size of each field
+        f.seek(chunk['offset'])
+        sizes = np.frombuffer(f.read(4 * header['no_of_fields']),
+                              dtype='<u4').astype(np.int64)
+        f.seek(chunk['offset'] + 4 * header['no_of_fields'] +
+               int(np.sum(sizes[:field_index])))
+        words = time_series_codec.decode(f.read(int(sizes[field_index])), n,
+                                         header['value_bytes'])
+        return words.view(np.float64 if (header['value_bytes'] == 8)
+                          else np.float32)
+
+    f.seek(chunk['offset'] + field_index * n * header['value_bytes'])
+    return np.frombuffer(f.read(n * header['value_bytes']), dtype=dtype)
@@ -0,0 +1,171 @@
+# -*- coding: utf-8 -*-
+"""
+Reader for the cross-bridge distribution dumps written by MyoVentCpp
+
+The layout is described in cb_dump_writer::write_header.
+Everything is little-endian.
+"""
+
+import os
+import struct
+
+import numpy as np
+
+from . import time_series_codec
+
+CB_DUMP_MAGIC = b'MVCBDUMP'
+CB_DUMP_VERSION = 2
+HEADER_FORMAT = '<8sIIIIQiId'
+HEADER_V2_FORMAT = '<II'
+CODEC_NONE = 0
+CODEC_LOSSLESS = 1
+PHASE_NAMES = ['none', 'end_diastole', 'peak_systole', 'end_systole']
+
+
+def read_cb_dump_header(file_string):
+    """ Returns a dict with the header and the bin positions """
+
+    with open(file_string, 'rb') as f:
+        header_bytes = f.read(struct.calcsize(HEADER_FORMAT))
+        (magic, version, no_of_attached_states, no_of_bins, frame_bytes,
+         no_of_frames, system_id, stride, sim_time_step_s) = \
+            struct.unpack(HEADER_FORMAT, header_bytes)
+
+        if (magic != CB_DUMP_MAGIC):
+            raise ValueError('Not a cb dump file')
+        if (version not in (1, CB_DUMP_VERSION)):
+            raise ValueError('Cb dump version %i, expected 1 or %i' %
+                             (version, CB_DUMP_VERSION))
+
+        # Version 1 files have no codec
+        codec = CODEC_NONE
+        chunk_frames = 0
+        header_size = struct.calcsize(HEADER_FORMAT)
+        if (version >= 2):
+            (codec, chunk_frames) = struct.unpack(
+                HEADER_V2_FORMAT, f.read(struct.calcsize(HEADER_V2_FORMAT)))
+            header_size = header_size + struct.calcsize(HEADER_V2_FORMAT)
+
+        if (codec not in (CODEC_NONE, CODEC_LOSSLESS)):
+            raise ValueError('Unknown cb dump codec %i' % codec)
+
+        x = np.frombuffer(f.read(8 * no_of_bins), dtype='<f8')
+
+    data_offset = header_size + (8 * no_of_bins)
+
+    # The count is written when the file is closed, so a file that is
+    # still growing, or from a run that stopped early, is sized instead.
+    # Packed files are counted as the chunks are read
+    if ((no_of_frames == 0) and (codec == CODEC_NONE)):
+        no_of_frames = (os.path.getsize(file_string) - data_offset) // \
+            frame_bytes
+
+    return {'no_of_attached_states': no_of_attached_states,
+            'no_of_bins': no_of_bins,
+            'frame_bytes': frame_bytes,
+            'no_of_frames': no_of_frames,
+            'system_id': system_id,
+            'stride': stride,
+            'sim_time_step_s': sim_time_step_s,
+            'codec': codec,
+            'chunk_frames': chunk_frames,
+            'x': x.astype(np.float64),
+            'data_offset': data_offset}
+
+
+def read_cb_dump(file_string, phases=None, t_start=None, t_stop=None):
+    """ Returns a dict with the bin positions x, and for each frame the
+        time_s, t_index, phase name and the populations as an array of
+        frames x attached states x bins
+
+        phases is a list of phase names, such as ['end_diastole'], to
+        keep only those frames. t_start and t_stop limit the frames to a
+        time window. The file is memory-mapped, so only the frames that
+        are kept are read, unless the file is packed by the codec, when
+        it is decoded a chunk at a time """
+
+    header = read_cb_dump_header(file_string)
+
+    n_states = header['no_of_attached_states']
+    n_bins = header['no_of_bins']
+
+    frame_dtype = np.dtype([('time_s', '<f8'),
+                            ('t_index', '<i4'),
+                            ('phase', '<u4'),
+                            ('values', '<f4', (n_states * n_bins,))])
+
+    if (frame_dtype.itemsize != header['frame_bytes']):
+        raise ValueError('Cb dump frames are %i bytes, expected %i' %
+                         (header['frame_bytes'], frame_dtype.itemsize))
+
+    if (header['codec'] == CODEC_LOSSLESS):
+        frames = _read_chunks(file_string, header, frame_dtype)
+    elif (header['no_of_frames'] > 0):
+        frames = np.memmap(file_string, dtype=frame_dtype, mode='r',
+                           offset=header['data_offset'],
+                           shape=(header['no_of_frames'],))
+    else:
+        frames = np.zeros(0, dtype=frame_dtype)
+
+    keep = np.ones(len(frames), dtype=bool)
+    if t_start is not None:
+        keep = keep & (frames['time_s'] >= t_start)
+    if t_stop is not None:
+        keep = keep & (frames['time_s'] <= t_stop)
+    if phases is not None:
+        codes = [PHASE_NAMES.index(p) for p in phases]
+        keep = keep & np.isin(frames['phase'], codes)
+
+    kept = frames[keep]
+
+    return {'x': header['x'],
+            'time_s': np.array(kept['time_s']),
+            't_index': np.array(kept['t_index']),
+            'phase': [PHASE_NAMES[p] if p < len(PHASE_NAMES) else str(p)
+                      for p in kept['phase']],
+            'populations': np.array(kept['values']).reshape(
+                (-1, n_states, n_bins))}
+
+
+def _read_chunks(file_string, header, frame_dtype):
+    """ Returns the frames of a file packed by the codec. Each chunk
+        holds its number of frames and columns, a table with the bytes
+        in each column, and the columns, which are the times, the
+        simulation indices, the phase codes and then each value """
+
+    chunks = []
+    with open(file_string, 'rb') as f:
+        f.seek(header['data_offset'])
+        while True:
+            counts = f.read(8)
+            if (len(counts) < 8):
+                break
+            (n, no_of_columns) = struct.unpack('<II', counts)
+            column_bytes = struct.unpack('<%iI' % no_of_columns,
+                                         f.read(4 * no_of_columns))
+            encoded = f.read(sum(column_bytes))
+
+            # A chunk cut short by a run that is still going is skipped
+            if (len(encoded) < sum(column_bytes)):
+                break
+
+            chunk = np.zeros(n, dtype=frame_dtype)
+            offset = 0
+            for (c, b) in enumerate(column_bytes):
+                words = time_series_codec.decode(encoded[offset:offset + b], n,
+                               8 if (c == 0) else 4)
+                offset = offset + b
+                if (c == 0):
+                    chunk['time_s'] = words.view(np.float64)
+                elif (c == 1):
+                    chunk['t_index'] = words.view(np.int32)
+                elif (c == 2):
+                    chunk['phase'] = words
+                else:
+                    chunk['values'][:, c - 3] = words.view(np.float32)
+            chunks.append(chunk)
+
+    if (len(chunks) == 0):
+        return np.zeros(0, dtype=frame_dtype)
+
+    return np.concatenate(chunks)
@@ -0,0 +1,126 @@
+# -*- coding: utf-8 -*-
+"""
+Reader for the memory-mapped live results published by MyoVentCpp
+while a simulation runs
+
+The layout is described in the live_results constructor. Rows below the
+committed counter are final, so they can be read in place while the
+simulation keeps adding beats.
+"""
+
+import struct
+import time
+
+import numpy as np
+import pandas as pd
+
+LIVE_MAGIC = b'MVRESLIV'
+LIVE_VERSION = 1
+LIVE_HEADER_FORMAT = '<8sIIIIQQiIdQ'
+COMMITTED_OFFSET = 32
+COMPLETE_OFFSET = 20
+
+
+class live_results():
+    """ Maps a live results file and reads the committed rows """
+
+    def __init__(self, file_string):
+
+        self.file_string = file_string
+        self.map = np.memmap(file_string, dtype=np.uint8, mode='r')
+
+        (magic, version, self.no_of_fields, self.page_points, complete,
+         self.capacity_points, committed, self.system_id, unused,
+         self.time_step_s, self.data_offset) = \
+            struct.unpack_from(LIVE_HEADER_FORMAT, self.map, 0)
+
+        if (magic != LIVE_MAGIC):
+            raise ValueError('%s is not a live results file' % file_string)
+        if (version != LIVE_VERSION):
+            raise ValueError('Live results version %i, expected %i' %
+                             (version, LIVE_VERSION))
+
+        self.fields = []
+        self.units = []
+        offset = struct.calcsize(LIVE_HEADER_FORMAT)
+        for i in range(self.no_of_fields):
+            for target in [self.fields, self.units]:
+                (length,) = struct.unpack_from('<I', self.map, offset)
+                target.append(bytes(self.map[offset + 4:offset + 4 + length])
+                              .decode('utf-8'))
+                offset = offset + 4 + length
+
+        # The pages as an array of [page, field, point] without a copy
+        no_of_pages = -(-self.capacity_points // self.page_points)
+        self.pages = np.ndarray(
+            (no_of_pages, self.no_of_fields, self.page_points),
+            dtype='<f8', buffer=self.map, offset=self.data_offset)
+
+    def committed_rows(self):
+        """ Returns the number of rows the simulation has published """
+
+        (n,) = struct.unpack_from('<Q', self.map, COMMITTED_OFFSET)
+        return n
+
+    def is_complete(self):
+        """ Returns True once the simulation has finished """
+
+        (complete,) = struct.unpack_from('<I', self.map, COMPLETE_OFFSET)
+        return (complete == 1)
+
+    def field(self, field_name, start_row=0, stop_row=None):
+        """ Returns the committed values of one field from start_row
+
+            Rows within one page are a view of the file. A range that
+            crosses pages is copied into a new array """
+
+        f = self.fields.index(field_name)
+        committed = self.committed_rows()
+        if (stop_row is None) or (stop_row > committed):
+            stop_row = committed
+        if (start_row >= stop_row):
+            return np.zeros(0)
+
+        first_page = start_row // self.page_points
+        last_page = (stop_row - 1) // self.page_points
+        if (first_page == last_page):
+            return self.pages[first_page, f,
+                              (start_row % self.page_points):
+                              (stop_row - first_page * self.page_points)]
+
+        return self.pages[first_page:last_page + 1, f, :].reshape(-1)[
+            (start_row - first_page * self.page_points):
+            (stop_row - first_page * self.page_points)]
+
+    def read(self, fields=None, start_row=0, stop_row=None):
+        """ Returns a pandas DataFrame with the committed rows from
+            start_row up to stop_row """
+
+        if fields is None:
+            fields = self.fields
+
+        # Fix the number of rows so that the columns have the same length
+        committed = self.committed_rows()
+        if (stop_row is None) or (stop_row > committed):
+            stop_row = committed
+
+        data = {}
+        for fn in fields:
+            data[fn] = np.array(self.field(fn, start_row, stop_row))
+
+        return pd.DataFrame(data, columns=fields)
+
+    def follow(self, fields=None, poll_s=0.5):
+        """ Yields a DataFrame with the new rows each time the simulation
+            publishes some, and stops when the simulation has finished """
+
+        start_row = 0
+        while True:
+            complete = self.is_complete()
+            committed = self.committed_rows()
+            if (committed > start_row):
+                yield self.read(fields, start_row, committed)
+                start_row = committed
+            if complete:
+                return
+            time.sleep(poll_s)
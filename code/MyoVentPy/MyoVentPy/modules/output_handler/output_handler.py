@@ -17,6 +17,8 @@ import matplotlib.pyplot as plt
 import matplotlib.gridspec as gridspec
 
 from ..display.multi_panel import multi_panel_from_flat_data
+from .binary_results import is_binary_results_file, read_binary_results
+from .cb_dump import read_cb_dump
 
 
 class output_handler():
@@ -42,8 +44,11 @@ class output_handler():
         # have been passed in
         if sim_results_file_string:
             print('Loading sim data from %s' % sim_results_file_string)
-            sim_data = pd.read_csv(sim_results_file_string,
-                                   delimiter='\t')
+            if is_binary_results_file(sim_results_file_string):
+                sim_data = read_binary_results(sim_results_file_string)
+            else:
+                sim_data = pd.read_csv(sim_results_file_string,
+                                       delimiter='\t')
 
         # Check we have data to do something with
         if not isinstance(sim_data, pd.DataFrame):
@@ -108,23 +113,21 @@ class output_handler():
     def animate_cb_distributions(self,
                                  cb_dump_file_string=[],
                                  output_image_file_string=[],
-                                 skip_frames=1):
-        """ Animates a cb distribution """
+                                 skip_frames=1,
+                                 phases=None):
+        """ Animates a cb distribution
+
+            phases is a list of beat phases, such as ['end_diastole'],
+            to animate only those frames """
 
         import imageio
 
-        # Open file and pull x values
-        with open(cb_dump_file_string, 'r') as f:
-            x_strings = f.readline().split('\t')
-        f.close()
-        x = []
-        for i, xs in enumerate(x_strings[1:]):
-            x.append(float(xs[1:]))
-        # Now load distribs as numpy arrray
-        cb_dump = np.loadtxt(cb_dump_file_string, skiprows=1)
-        cb_distribs = cb_dump[:, 1:]
-        t = cb_dump[:, 0]
-        max_pop = np.amax(cb_distribs)
+        # Load the frames
+        cb_dump = read_cb_dump(cb_dump_file_string, phases=phases)
+        x = cb_dump['x']
+        cb_distribs = cb_dump['populations']
+        t = cb_dump['time_s']
+        max_pop = np.amax(cb_distribs) if cb_distribs.size else 1.0
 
         temp_image_file_string = 'temp.png'
         print('Animating cross-bridge distribution')
@@ -133,7 +136,7 @@ class output_handler():
             for i in np.arange(0, np.shape(cb_distribs)[0],
                                skip_frames):
                 print(('Frame: %.0f' % i), end=' ', flush=True)
-                self.draw_cb_distribution(x, cb_distribs[i, :],
+                self.draw_cb_distribution(x, cb_distribs[i, :, :],
                                           t[i], 1.2*max_pop,
                                           temp_image_file_string)
                 image = imageio.imread(temp_image_file_string, format='png')
@@ -141,3 +144,18 @@ class output_handler():
             print('Animation built')
             print('Animation written to %s' % output_image_file_string)
         os.remove(temp_image_file_string)
+
+    def draw_cb_distribution(self, x, cb_distrib, t, max_pop,
+                             image_file_string):
+        """ Draws the distribution of each attached state at time t """
+
+        fig, ax = plt.subplots(figsize=(5, 3))
+        for s in range(np.shape(cb_distrib)[0]):
+            ax.plot(x, cb_distrib[s, :], label=('M%i' % (s + 1)))
+        ax.set_ylim([0, max_pop])
+        ax.set_xlabel('x (nm)')
+        ax.set_ylabel('Population')
+        ax.set_title('t = %.3f s' % t)
+        ax.legend(loc='upper right')
+        fig.savefig(image_file_string, dpi=100, bbox_inches='tight')
+        plt.close(fig)
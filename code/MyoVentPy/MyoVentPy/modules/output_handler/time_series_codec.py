@@ -0,0 +1,77 @@
+# -*- coding: utf-8 -*-
+"""
+Decoder for columns packed by the MyoVentCpp time_series_codec
+
+The layout is described at the top of time_series_codec.cpp.
+"""
+
+import struct
+
+import numpy as np
+
+CODEC_XOR = 0
+CODEC_DELTA = 1
+CODEC_DELTA_2 = 2
+
+
+def decode(encoded, n, word_bytes):
+    """ Returns the n words of a column as an array of uint64 for doubles
+        or uint32 for floats, which can be viewed as the values with
+        .view(np.float64) or .view(np.float32) """
+
+    encoded = memoryview(encoded)
+    mode = encoded[0]
+    if mode not in (CODEC_XOR, CODEC_DELTA, CODEC_DELTA_2):
+        raise ValueError('Unknown codec mode %i' % mode)
+
+    word_dtype = np.uint64 if (word_bytes == 8) else np.uint32
+
+    residuals = np.zeros(n, dtype=word_dtype)
+    j = 1
+    for k in range(word_bytes):
+        (plane_bytes,) = struct.unpack_from('<I', encoded, j)
+        j = j + 4
+        plane = _rle_decode(encoded[j:j + plane_bytes], n)
+        j = j + plane_bytes
+        residuals = residuals | (plane.astype(word_dtype) << word_dtype(8 * k))
+
+    if (mode == CODEC_XOR):
+        return np.bitwise_xor.accumulate(residuals)
+
+    # Undo the zig-zag, then sum the differences, which wraps around as
+    # the integers do in C++
+    one = word_dtype(1)
+    d = (residuals >> one) ^ (word_dtype(0) - (residuals & one))
+
+    with np.errstate(over='ignore'):
+        words = np.cumsum(d, dtype=word_dtype)
+        if (mode == CODEC_DELTA_2):
+            words = np.cumsum(words, dtype=word_dtype)
+
+    return words
+
+
+def _rle_decode(runs, n):
+    """ Returns the n bytes of a run-length encoded plane """
+
+    out = np.empty(n, dtype=np.uint8)
+    runs = bytes(runs)
+    i = 0
+    j = 0
+    while j < len(runs):
+        c = runs[j]
+        if c < 128:
+            length = c + 1
+            out[i:i + length] = np.frombuffer(runs, dtype=np.uint8,
+                                              count=length, offset=j + 1)
+            j = j + 1 + length
+        else:
+            length = c - 126
+            out[i:i + length] = runs[j + 1]
+            j = j + 2
+        i = i + length
+
+    if (i != n):
+        raise ValueError('Codec plane has %i bytes, expected %i' % (i, n))
+
+    return out